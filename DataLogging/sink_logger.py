@@ -10,9 +10,6 @@ SERIAL_PORT = 'COM36'  # Đảm bảo đúng cổng COM của bạn
 BAUD_RATE = 115200
 LOG_DIR = r"C:\ncs\v3.0.1\zephyr\samples\GRADIENT-SRV\DataLogging"
 
-# [NÂNG CẤP] Cache dữ liệu để đồng bộ Latency muộn
-# Cấu trúc: { (SourceAddr, Seq): row_index }
-latency_sync_cache = {}
 all_rows_buffer = []
 
 # Dictionary lưu trữ SET các Sequence Number để đếm Unique PDR
@@ -76,7 +73,11 @@ def main():
                 "FwdCount",
                 "Rx_Unique_Count", 
                 "Remote_Rx_Count",
-                "PDR_Percent"
+                "PDR_Percent",
+                "P50_ms",
+                "P90_ms",
+                "P99_ms",
+                "Max_ms"
             ]
             writer.writerow(headers)
             file.flush()
@@ -124,33 +125,29 @@ def main():
                                     row[3] = sender_hex
                                     row[4] = str(seq_val)
                                     row[5] = parts[4] # Hops
-                                    row[6] = "0"      # Latency (Chờ PONG report)
+                                    row[6] = ""       # Latency: xem dòng LATENCY (histogram)
                                     row[7] = parts[7] if len(parts) > 7 else parts[6]
                                     
-                                    # Lưu vào cache để điền Latency sau
-                                    latency_sync_cache[(src_hex, seq_val)] = len(all_rows_buffer)
                                     all_rows_buffer.append(row)
 
                                     if src_hex not in rx_stats:
                                         rx_stats[src_hex] = set()
                                     rx_stats[src_hex].add(seq_val)
                                     
-                                    print(f"[{now}] DATA | {src_hex} -> {sender_hex} | Seq:{seq_val} | Latency: Pending...")
-
-                            # --- [NEW] XỬ LÝ RTT_DATA ---
-                            # Format: CSV_LOG,RTT_DATA,Src,Seq,RTT
-                            elif log_type == "RTT_DATA":
-                                if len(parts) >= 4:
-                                    src_hex = f"0x{safe_int_convert(parts[1]):04x}"
-                                    seq_val = safe_int_convert(parts[2])
-                                    rtt_val = parts[3]
-                                    
-                                    key = (src_hex, seq_val)
-                                    if key in latency_sync_cache:
-                                        row_idx = latency_sync_cache[key]
-                                        all_rows_buffer[row_idx][6] = rtt_val
-                                        print(f"[{now}] RTT_DATA | {src_hex} Seq {seq_val} -> {rtt_val} ms")
-                                    continue # Không cần ghi dòng này vào CSV chính
+                                    print(f"[{now}] DATA | {src_hex} -> {sender_hex} | Seq:{seq_val}")
+
+                            # --- XỬ LÝ LATENCY (histogram p50/p90/p99 tại node) ---
+                            # Format: CSV_LOG,LATENCY,Src,Metric,Hops,Count,P50,P90,P99,Max
+                            elif log_type == "LATENCY":
+                                if len(parts) >= 9:
+                                    row[2] = f"0x{safe_int_convert(parts[1]):04x}"
+                                    row[3] = parts[2]
+                                    row[4] = parts[4]
+                                    row[5] = parts[3]
+                                    row[6] = parts[5]
+                                    row[15:19] = parts[5:9]
+                                    all_rows_buffer.append(row)
+                                    print(f"[{now}] LATENCY | {row[2]} {parts[2]} | p50={parts[5]} p90={parts[6]} p99={parts[7]} ms")
 
                             # --- XỬ LÝ GÓI TIN HEARTBEAT ---
                             elif log_type == "HEARTBEAT":
@@ -204,7 +201,6 @@ def main():
                                 if "TEST_START" in event_name:
                                     rx_stats.clear()
                                     reported_nodes.clear()
-                                    latency_sync_cache.clear()
                                     all_rows_buffer.clear()
                                     all_rows_buffer.append(row) # Giữ lại dòng TEST_START
                                     print(f"\n[{now}] --- NEW TEST SESSION STARTED ---")
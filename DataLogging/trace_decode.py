@@ -0,0 +1,162 @@
+"""
+trace_decode.py
+===============
+Giải mã trace nhị phân của firmware (lệnh shell "mesh trace dump") sang CSV
+hoặc Perfetto / Chrome JSON (mở bằng https://ui.perfetto.dev).
+
+Input là file log UART bất kỳ (có thể chứa nhiều node, nhiều lần dump):
+  $[TRACE_HDR],<version>,<addr>,<clock_hz>,<count>,<overruns>
+  $[TRACE],<hex 12 bytes/record>...
+  $[TRACE_END],<records_dumped>
+
+Record (little endian, 12 bytes): cycles u32, id u8, b u8, a0 u16, a1 u16, a2 u16
+(khớp struct gtrace_rec trong include/gtrace.h)
+
+Cách dùng:
+  python trace_decode.py uart_capture.log -o trace.csv
+  python trace_decode.py uart_capture.log --format perfetto -o trace.json
+"""
+
+import argparse
+import csv
+import json
+import re
+import struct
+import sys
+
+FORMAT_VERSION = 1
+RECORD = struct.Struct("<IBBHHH")
+
+# id -> (tên, tên các tham số b, a0, a1, a2) — khớp enum gtrace_event
+EVENTS = {
+    1:  ("DATA_RX",      ("hops", "src", "seq", "sender")),
+    2:  ("DATA_TX",      ("hops", "dst", "src", "seq")),
+    3:  ("DATA_FWD",     ("hops", "parent", "src", "seq")),
+    4:  ("DATA_SINK",    ("hops", "src", "seq", "sender")),
+    5:  ("DATA_TX_DONE", ("failed", "dst", "err", "_")),
+    6:  ("SENSOR_RX",    ("hops", "src", "count", "nexthop")),
+    7:  ("BP_RX",        ("hops", "dest", "payload", "sender")),
+    8:  ("BP_FWD",       ("hops", "dest", "payload", "nexthop")),
+    9:  ("BP_DELIVER",   ("hops", "payload", "delay_ms", "sender")),
+    10: ("BP_NO_ROUTE",  ("_", "dest", "payload", "_")),
+    11: ("RRT_HIT",      ("_", "dest", "nexthop", "_")),
+    12: ("NT_UPDATE",    ("pos", "addr", "grad", "rssi")),
+    13: ("PONG_RX",      ("_", "origin", "seq", "sender")),
+}
+
+# Tham số là địa chỉ mesh -> in dạng hex
+ADDR_ARGS = {"src", "dst", "sender", "parent", "dest", "nexthop", "addr", "origin"}
+
+HDR_RE = re.compile(r"\$\[TRACE_HDR\],(\d+),(0x[0-9a-fA-F]+),(\d+),(\d+),(\d+)")
+REC_RE = re.compile(r"\$\[TRACE\],([0-9a-fA-F]+)")
+
+
+def parse_log(lines):
+    """Trả về list event dict, timestamp (us) đã unwrap theo từng node."""
+    events = []
+    node = None
+    hz = 1
+    last_cycles = {}
+    wrap_base = {}
+
+    for line in lines:
+        m = HDR_RE.search(line)
+        if m:
+            version = int(m.group(1))
+            if version != FORMAT_VERSION:
+                raise ValueError(f"Unsupported trace version {version}")
+            node = int(m.group(2), 16)
+            hz = int(m.group(3)) or 1
+            if int(m.group(5)):
+                print(f"[WARN] Node 0x{node:04x}: {m.group(5)} records overwritten before dump",
+                      file=sys.stderr)
+            continue
+
+        m = REC_RE.search(line)
+        if not m or node is None:
+            continue
+
+        blob = bytes.fromhex(m.group(1))
+        for off in range(0, len(blob) - RECORD.size + 1, RECORD.size):
+            cycles, ev_id, b, a0, a1, a2 = RECORD.unpack_from(blob, off)
+
+            # Cycle counter 32-bit quay vòng: cộng dồn mỗi lần giá trị giảm
+            base = wrap_base.get(node, 0)
+            if cycles < last_cycles.get(node, 0):
+                base += 1 << 32
+                wrap_base[node] = base
+            last_cycles[node] = cycles
+
+            name, arg_names = EVENTS.get(ev_id, (f"EV_{ev_id}", ("b", "a0", "a1", "a2")))
+            args = {}
+            for key, val in zip(arg_names, (b, a0, a1, a2)):
+                if key == "_":
+                    continue
+                if key == "rssi":
+                    val = val - 0x10000 if val >= 0x8000 else val
+                args[key] = f"0x{val:04x}" if key in ADDR_ARGS else val
+
+            events.append({
+                "node": f"0x{node:04x}",
+                "ts_us": (base + cycles) * 1_000_000 // hz,
+                "event": name,
+                "args": args,
+            })
+
+    events.sort(key=lambda e: (e["node"], e["ts_us"]))
+    return events
+
+
+def write_csv(events, out):
+    w = csv.writer(out)
+    w.writerow(["Node", "Timestamp_us", "Event", "Args"])
+    for e in events:
+        w.writerow([e["node"], e["ts_us"], e["event"],
+                    ";".join(f"{k}={v}" for k, v in e["args"].items())])
+
+
+def write_perfetto(events, out):
+    """Chrome trace-event JSON: mỗi node là 1 process, mỗi event là instant."""
+    trace = []
+    for node in sorted({e["node"] for e in events}):
+        trace.append({"ph": "M", "name": "process_name", "pid": int(node, 16),
+                      "args": {"name": f"Node {node}"}})
+    for e in events:
+        trace.append({
+            "name": e["event"],
+            "cat": e["event"].split("_")[0],
+            "ph": "i",
+            "s": "t",
+            "ts": e["ts_us"],
+            "pid": int(e["node"], 16),
+            "tid": 0,
+            "args": e["args"],
+        })
+    json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Decode gradient_srv binary trace dumps")
+    ap.add_argument("input", help="UART log chứa output của 'mesh trace dump'")
+    ap.add_argument("--format", choices=["csv", "perfetto"], default="csv")
+    ap.add_argument("-o", "--output", help="File đầu ra (mặc định: stdout)")
+    args = ap.parse_args()
+
+    with open(args.input, encoding="utf-8", errors="ignore") as f:
+        events = parse_log(f)
+
+    out = open(args.output, "w", newline="", encoding="utf-8") if args.output else sys.stdout
+    try:
+        if args.format == "csv":
+            write_csv(events, out)
+        else:
+            write_perfetto(events, out)
+    finally:
+        if out is not sys.stdout:
+            out.close()
+
+    print(f"[trace_decode] {len(events)} events", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
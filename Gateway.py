@@ -28,7 +28,7 @@ if sys.stdout.encoding and sys.stdout.encoding.lower() != 'utf-8':
 # ==========================================
 BAUD_RATE = 115200
 POLLING_INTERVAL = 60 
-COLLECTION_WINDOW = 30 
+COLLECTION_WINDOW = 15  # Jitter 0-8s + ~1s bundle window mỗi hop relay
 PAGE_TIMEOUT = 4 
 BACKUP_INTERVAL = 300 
 GATEWAY_NODE = "0002" 
@@ -44,7 +44,8 @@ else:
     RAM_DISK_CSV = f'/dev/shm/GRADIENT_topo_log_{SESSION_ID}.csv' 
     BACKUP_DIR = '/home/pi/wsn_backup/'
 
-# Format: $[TOPO],Origin,Seq,TotalPg,CurPg,Count,Grad,Parent,Drp(u16),FwdR(u16),Uptime(u32),TotalSent(u32),[neighbors]
+# Format: $[TOPO],Origin,Seq,TotalPg,CurPg,Count,Grad,Parent,Drp(u16),FwdR(u16),Uptime(u32),TotalSent(u32),Ver,[neighbors]
+# (Ver rơi vào nhóm cuối, NEIGHBOR_PATTERN tự bỏ qua)
 TOPO_PATTERN = r"\$\[TOPO\],([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+),(\d+),([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+),(.*)"
 NEIGHBOR_PATTERN = r"\[([0-9A-F]{4}),(-?\d+),(\d+),(\d+)\]"
 
@@ -56,7 +57,8 @@ SENSOR_ENTRY_PATTERN = r"\[(\d+),(-?\d+)\]"
 STRESS_LOG_HEADERS = [
     "Timestamp", "Type", "SourceAddr", "SenderAddr", "Seq_or_TxCount",
     "HopCount", "Latency_ms", "PathMinRSSI", "BeaconTx", "HeartbeatTx",
-    "RouteChanges", "FwdCount", "Rx_Unique_Count", "Remote_Rx_Count", "PDR_Percent"
+    "RouteChanges", "FwdCount", "Rx_Unique_Count", "Remote_Rx_Count", "PDR_Percent",
+    "P50_ms", "P90_ms", "P99_ms", "Max_ms"
 ]
 STRESS_LOG_DIR = BACKUP_DIR
 
@@ -74,7 +76,6 @@ page_assembly = {}
 # Stress Test Buffers & Queues
 stress_queue = queue.Queue()
 stress_rows_buffer = []
-latency_sync_cache = {} # { (SourceAddr, Seq): row_index }
 rx_stats = {}           # { SourceAddr: set(Seq) }
 reported_nodes = set()  # { (SourceAddr, TxCount) }
 test_stop_time = None
@@ -182,7 +183,8 @@ def data_processor_thread():
         now = time.time()
         if now - last_polling_time >= POLLING_INTERVAL:
             print("\n=======================================")
-            send_uart_command("mesh topo_req 0")
+            # Gateway này không áp Delta ($[TOPOD]) -> luôn yêu cầu snapshot đầy đủ
+            send_uart_command("mesh topo_req 0 full")
             
             current_cycle_data.clear()
             page_assembly.clear()
@@ -208,10 +210,16 @@ def data_processor_thread():
                     if origin not in page_assembly or page_assembly[origin]['seq'] != int(seq):
                         page_assembly[origin] = {
                             'seq': int(seq), 'total': int(total), 'pages': {}, 
-                            'grad': int(grad), 'parent': parent, 'ts': now,
+                            'ts': now
+                        }
+
+                    # Grad/Parent/bộ đếm chỉ có ở trang 1 (trang khác in 0)
+                    if int(curr) == 1:
+                        page_assembly[origin].update({
+                            'grad': int(grad), 'parent': parent,
                             'drp': int(drp), 'fwdr': int(fwdr), 
                             'uptime': int(uptime), 'total_sent': int(total_sent)
-                        }
+                        })
                     
                     page_assembly[origin]['pages'][int(curr)] = parsed_nb
                     page_assembly[origin]['ts'] = now 
@@ -387,7 +395,7 @@ def export_stress_log():
         print(f"[LỖI] Không thể xuất file CSV stress: {e}")
 
 def stress_processor_thread():
-    global stress_rows_buffer, latency_sync_cache, rx_stats, reported_nodes, test_stop_time
+    global stress_rows_buffer, rx_stats, reported_nodes, test_stop_time
     print("[Luồng 4] Khởi động Xử lý Stress Test Log")
     
     while True:
@@ -424,26 +432,23 @@ def stress_processor_thread():
                 row[3] = sender_hex
                 row[4] = str(seq_val)
                 row[5] = parts[4] # Hops
-                row[6] = "0"
+                row[6] = ""       # Latency: xem dòng LATENCY (histogram)
                 row[7] = parts[7] if len(parts) > 7 else (parts[6] if len(parts) > 6 else "-99")
-                latency_sync_cache[(src_hex, seq_val)] = len(stress_rows_buffer)
                 if isinstance(stress_rows_buffer, list):
                     stress_rows_buffer.append(row)
                 if src_hex not in rx_stats: rx_stats[src_hex] = set()
                 rx_stats[src_hex].add(seq_val)
 
-            elif log_type == "RTT_DATA" and len(parts) >= 4:
-                src_hex = f"0x{safe_int_convert(parts[1]):04x}"
-                seq_val = safe_int_convert(parts[2])
-                rtt_val = parts[3]
-                key = (src_hex, seq_val)
-                if key in latency_sync_cache:
-                    row_idx = latency_sync_cache[key]
-                    if isinstance(row_idx, int) and row_idx < len(stress_rows_buffer):
-                        target_row = stress_rows_buffer[row_idx]
-                        if isinstance(target_row, list) and len(target_row) > 6:
-                            target_row[6] = rtt_val
-                continue
+            elif log_type == "LATENCY" and len(parts) >= 9:
+                # Format: LATENCY,Src,Metric,Hops,Count,P50,P90,P99,Max (histogram tại node)
+                row[2] = f"0x{safe_int_convert(parts[1]):04x}"
+                row[3] = parts[2] # Metric (RTT / BACKPROP / BACKPROP_HOP)
+                row[4] = parts[4] # Số mẫu
+                row[5] = parts[3] # Hops (chỉ với BACKPROP_HOP)
+                row[6] = parts[5] # p50 làm Latency đại diện
+                row[15:19] = parts[5:9]
+                stress_rows_buffer.append(row)
+                print(f"[STRESS] Node {row[2]} {parts[2]}(h={parts[3]}): n={parts[4]} p50={parts[5]} p90={parts[6]} p99={parts[7]} max={parts[8]} ms")
 
             elif log_type == "SENSOR_DATA" and len(parts) >= 5:
                 src_hex = f"0x{safe_int_convert(parts[1]):04x}"
@@ -485,7 +490,6 @@ def stress_processor_thread():
                     test_stop_time = None
                     rx_stats.clear()
                     reported_nodes.clear()
-                    latency_sync_cache.clear()
                     stress_rows_buffer.clear()
                     stress_rows_buffer.append(row)
                     print("\n[STRESS] --- PHIÊN TEST MỚI BẮT ĐẦU ---")
@@ -595,7 +599,7 @@ async def websocket_endpoint(websocket: WebSocket):
 
                 # ── Topology / Network ──────────────────────────────────
                 if action == "topo_req":
-                    send_uart_command("mesh topo_req 0")
+                    send_uart_command("mesh topo_req 0 full")
 
                 elif action == "sdn_reset":
                     send_uart_command("mesh sdn_reset")
@@ -1,7 +1,5 @@
 import serial
 import re
-import threading
-import queue
 import time
 import json
 import csv
@@ -12,16 +10,32 @@ from fastapi import FastAPI, WebSocket, WebSocketDisconnect
 from fastapi.responses import FileResponse
 import uvicorn
 import asyncio
-import lightgbm as lgb
 import numpy as np
 import datetime
+from sink_link import SinkLink
+from sink_rpc import SinkRpcClient, RPC_TIMEOUT
+from sdn_spt import reported_parents, mark_parents, parent_delta
+from link_cost import link_features, heuristic_cost
+from sdn_optimizer import SdnOptimizer
+from graph_store import GraphStore
 
 # ==========================================
 # CẤU HÌNH HỆ THỐNG & ĐỊNH DANH PHIÊN (SESSION)
 # ==========================================
 BAUD_RATE = 115200
+RPC_WINDOW = 8           # [NEW] Số lệnh "mesh rpc" chờ $[RSP] cùng lúc
+RPC_COMMANDS = {"backprop", "backprop_multi", "backprop_sr", "backprop_broadcast", "sdn_flow",
+                "sdn_reset", "topo_req", "wave", "attention", "sensor_interval",
+                "sensor_interval_all", "uart_mode"}  # Khớp rpc_cmds[] trong shell_commands.c
+SINK_UART_BINARY = True  # [NEW] Bật frame nhị phân COBS+CRC16 ở Sink khi khởi động ("mesh uart_mode bin")
 POLLING_INTERVAL = 60 
-COLLECTION_WINDOW = 30 
+COLLECTION_WINDOW = 15  # Jitter 0-8s + ~1s bundle window mỗi hop relay (khi không có wave)
+# [NEW] Collection wave: node trả lời theo slot (sâu nhất trước, hash địa chỉ trong level)
+WAVE_SLOT_MS = 250
+WAVE_SLOTS_PER_LEVEL = 8
+WAVE_DEFAULT_LEVELS = 4      # khớp CONFIG_BT_MESH_COLLECT_LEVELS
+WAVE_MAX_LEVELS = 15
+WAVE_MARGIN = 3              # s: drip-feed trang cuối + bundle window relay + UART
 PAGE_TIMEOUT = 4 
 BACKUP_INTERVAL = 300 
 GATEWAY_NODE = "0002" 
@@ -37,44 +51,72 @@ else:
     RAM_DISK_CSV = f'/dev/shm/topology_log_{SESSION_ID}.csv' 
     BACKUP_DIR = '/home/pi/wsn_backup/'
 
-# [UPD]: Regex bắt 11 nhóm (Drop_Count giờ là uint16, max 65535)
-# Format: $[TOPO],Origin,Seq,TotalPg,CurPg,Count,Grad,Parent,Drp(u16),FwdR(u16),Uptime(u32),TotalSent(u32),[neighbors]
-TOPO_PATTERN = r"\$\[TOPO\],([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+),(\d+),([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+),(.*)"
+# [UPD]: Regex bắt 12 nhóm (Drop_Count giờ là uint16, max 65535)
+# Format: $[TOPO],Origin,Seq,TotalPg,CurPg,Count,Grad,Parent,Drp(u16),FwdR(u16),Uptime(u32),TotalSent(u32),Ver,[neighbors]
+TOPO_PATTERN = r"\$\[TOPO\],([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+),(\d+),([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+),(\d+)(.*)"
 NEIGHBOR_PATTERN = r"\[([0-9A-F]{4}),(-?\d+),(\d+),(\d+)\]"
 
+# [NEW] Delta topology: chỉ neighbor thêm/đổi ([..]) và bị xóa (-[addr]) so với version BaseVer
+# Format: $[TOPOD],Origin,Seq,Flags,BaseVer,Ver,Grad,Parent,Drp,FwdR,Uptime,TotalSent,[upd]...,-[rem]...
+# Flags: bit0 = Grad/Parent hợp lệ, bit1 = bộ đếm hợp lệ (không có thì giữ giá trị cũ)
+TOPOD_PATTERN = r"\$\[TOPOD\],([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+),(\d+),([0-9A-F]{4}),(\d+),(\d+),(\d+),(\d+)(.*)"
+REMOVED_PATTERN = r"-\[([0-9A-F]{4})\]"
+TOPOD_FLAG_ROUTE = 0x01
+TOPOD_FLAG_COUNTERS = 0x02
+TOPO_REQ_MAX_RESYNC = 8  # Khớp TOPO_REQ_MAX_RESYNC trong firmware
+SR_MAX_HOPS = 8          # [NEW] Khớp CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS (mesh backprop_sr)
+BACKPROP_MULTI_MAX = 16  # [NEW] Khớp CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX (mesh backprop_multi)
+SDN_FLOW_MAX_RULES = 6   # [NEW] Khớp BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES (mesh sdn_flow)
+FLOW_CLASS_ANY = 0       # [NEW] Khớp SDN_FLOW_CLASS_ANY trong sdn_flow.h
+# [NEW] Tách hotspot theo nguồn: relay forward >= FLOW_SPLIT_MIN_FWDR gói/30s chuyển một phần
+# cây con (tối đa FLOW_SPLIT_MAX_SRCS nguồn, vừa bảng flow 8 luật cả khi gỡ luật cũ) sang uplink
+# thứ hai có cost AI không quá (1 + FLOW_SPLIT_COST_MARGIN) lần cost tới parent SDN.
+FLOW_SPLIT_MIN_FWDR = 60
+FLOW_SPLIT_MAX_SRCS = 3
+FLOW_SPLIT_COST_MARGIN = 0.25
+FLOW_SPLIT_REFRESH_S = 120  # Cài lại trước khi luật hết hạn (CONFIG_..._SDN_FLOW_LIFETIME_MIN = 5)
+
+# [NEW] Dòng "$[TRACE...]" từ "mesh trace dump" -> lưu nguyên văn, giải mã bằng DataLogging/trace_decode.py
+TRACE_CAPTURE_LOG = os.path.join(BACKUP_DIR, f'trace_{SESSION_ID}.log')
+
 # [NEW] Stress Test Log Configuration
 STRESS_LOG_HEADERS = [
     "Timestamp", "Type", "SourceAddr", "SenderAddr", "Seq_or_TxCount",
     "HopCount", "Latency_ms", "PathMinRSSI", "BeaconTx", "HeartbeatTx",
-    "RouteChanges", "FwdCount", "Rx_Unique_Count", "Remote_Rx_Count", "PDR_Percent"
+    "RouteChanges", "FwdCount", "Rx_Unique_Count", "Remote_Rx_Count", "PDR_Percent",
+    "P50_ms", "P90_ms", "P99_ms", "Max_ms"
 ]
 STRESS_LOG_DIR = BACKUP_DIR # Store stress logs in the backup directory
 
 # ==========================================
-# BIẾN TOÀN CỤC & KHÓA AN TOÀN
+# BIẾN TOÀN CỤC
 # ==========================================
-uart_queue = queue.Queue() 
+# [UPD] Mọi trạng thái dưới đây chỉ được vòng asyncio chính đụng tới (xem gateway_main()),
+# nên không còn graph_lock/serial_lock; phần nặng của SDN chạy ở process sdn_optimizer.
 ws_clients = set() 
 Master_Graph = nx.DiGraph()      # Before Dijkstra (Raw Topology)
 SDN_Graph = nx.DiGraph()         # After Dijkstra (Optimized Topology)
-AI_Model = None                  # LightGBM Model Instance
-latest_graph_json = ""
+sdn_pending = set()              # [NEW] Node đã commit báo cáo, chờ predict cost theo lô
+cycle_ai_costs = {}              # [NEW] (node, neighbor) -> cost AI của chu kỳ vừa tối ưu (cho CSV)
 missed_count_dict = {}
 current_cycle_data = {}          # Fixed global warning
 page_assembly = {}               # Fixed global warning
+collecting_data = False          # [NEW] Đang trong cửa sổ thu thập của chu kỳ poll
 pending_commit = False           # Flag for Phase 2 piggyback
+sdn_flow_version = 0             # [NEW] Version cài luật flow SDN (mesh sdn_flow)
+flow_splits = {}                 # [NEW] relay -> (uplink thứ hai, frozenset nguồn, lúc cài)
+address_plan = {}                # [NEW] Gợi ý cấp lại địa chỉ theo cây con (old -> new)
+topo_state = {}                  # [NEW] origin -> bản topology đã áp dụng (base cho Delta)
+topo_resync = set()              # [NEW] origin lệch version -> yêu cầu full ở lần poll sau
+wave_levels = WAVE_DEFAULT_LEVELS  # [NEW] Số level wave đang cấu hình trên Sink
 
-# [NEW] Stress Test Buffers & Queues
-stress_queue = queue.Queue()
+# [NEW] Stress Test Buffers
 stress_rows_buffer = []
-latency_sync_cache = {} # { (SourceAddr, Seq): row_index }
 rx_stats = {}           # { SourceAddr: set(Seq) }
 reported_nodes = set()  # { (SourceAddr, TxCount) }
-test_stop_time = None   # [NEW] Timer for delayed export
+stress_export_timer = None  # [UPD] loop.call_later xuất CSV stress 10 phút sau TEST_STOP
 total_control_packets = 0 # [NEW] Counter for all commands sent (topo_req, backprop, etc.)
-
-graph_lock = threading.Lock()
-serial_lock = threading.Lock() 
+background_tasks = set()  # [NEW] Task chạy nền (push SDN, lệnh websocket): giữ tham chiếu tới khi xong
 
 # ------------------------------------------
 # LOAD AI MODEL
@@ -88,25 +130,22 @@ POSSIBLE_PATHS = [
     os.path.join(BASE_DIR, 'ml_training', 'routing_cost_model.txt') # Cấu trúc chuẩn trong repo
 ]
 
-AI_Model = None
-MODEL_LOADED_PATH = None
-
-for path in POSSIBLE_PATHS:
-    if os.path.exists(path):
-        try:
-            AI_Model = lgb.Booster(model_file=path)
-            MODEL_LOADED_PATH = path
-            print(f"[Hệ Thống] Đã tải model AI LightGBM thành công từ: {path}")
-            break
-        except Exception as e:
-            print(f"[CẢNH BÁO] Lỗi khi load model tại {path}: {e}")
+# [UPD] Model được nạp trong process của sdn_optimizer (load_cost_model: ưu tiên bản biên
+# dịch routing_cost_model.so, thiếu / lệch sha256 -> lightgbm.Booster, không có -> heuristic).
+# Predict theo lô + SPT tăng dần chạy ở đó, vòng asyncio chỉ chờ kết quả.
+sdn_optimizer = SdnOptimizer(GATEWAY_NODE, POSSIBLE_PATHS)
 
-if AI_Model is None:
-    print(f"[CẢNH BÁO] Không tìm thấy file model tại các vị trí: {POSSIBLE_PATHS}")
-    print("[Hệ Thống] Sẽ dùng heuristic fallback để tính toán routing cost.")
+def start_sdn_optimizer():
+    model_path, model_kind = sdn_optimizer.start()
+    if model_path is not None:
+        print(f"[Hệ Thống] Đã tải model AI ({model_kind}) thành công từ: {model_path}")
+    else:
+        print(f"[CẢNH BÁO] Không tìm thấy file model tại các vị trí: {POSSIBLE_PATHS}")
+        print("[Hệ Thống] Sẽ dùng heuristic fallback để tính toán routing cost.")
 
 app = FastAPI()
 global_ser = None
+sink_link = None  # [NEW] Reader/writer UART asyncio (sink_link.py)
 
 def init_serial():
     global global_ser
@@ -123,45 +162,18 @@ def init_serial():
 # ==========================================
 # TÍNH TOÁN ROUTING COST PER-LINK (MỖI HÀNG CSV)
 # ==========================================
-import math
-
-def compute_routing_cost_per_link(grad, nb_rssi, nb_link_up_s, drop_rate, pin, drop_count, fwd_count, neighbor_count, use_ai=True):
-    """
-    Tính Routing_Cost cho TỪNG LINK riêng biệt (per-neighbor), đảm bảo mỗi
-    hàng CSV có giá trị khác nhau dựa vào RSSI và Link_UP của neighbor đó.
-
-    Dùng Model LightGBM (10 features) nếu có, nếu không thì fallback về Heuristic.
-    """
-    if use_ai and AI_Model is not None:
-        try:
-            # Features derived to match training:
-            # ['Grad', 'RSSI', 'Link_UP(s)', 'Drop_Count', 'Fwd_Count', 
-            #  'Drop_Rate(%)', 'Pin(%)', 'Neighbor_Count', 'Link_Stability', 'Load_Per_Neighbor']
-            link_stability = math.log1p(nb_link_up_s)
-            load_per_neighbor = fwd_count / (neighbor_count + 1)
-
-            features = np.array([[
-                grad, nb_rssi, nb_link_up_s, drop_count, fwd_count,
-                drop_rate, pin, neighbor_count, link_stability, load_per_neighbor
-            ]])
-            pred_cost = AI_Model.predict(features)[0]
-            return round(pred_cost, 2)
-        except Exception as e:
-            pass # Fallback to heuristic
-
-    hop_cost = grad * 10.0
-    signal_cost = max(0.0, (-nb_rssi - 70.0)) * 2.5
-    reliability_cost = min(400.0, pow(drop_rate, 1.5)) if drop_rate > 0 else 0.0
-    if pin < 20.0:
-        battery_cost = 200.0
-    elif pin < 60.0:
-        battery_cost = (60.0 - pin) * 1.5
-    else:
-        battery_cost = 0.0
-    
-    stability_cost = 100.0 * math.exp(-nb_link_up_s / 300.0)
-    total = hop_cost + signal_cost + reliability_cost + battery_cost + stability_cost
-    return round(total, 2)
+# [UPD] Công thức heuristic + vector feature LightGBM nằm ở link_cost.py; cả chu kỳ poll
+# dùng một lần predict trong sdn_optimizer, SDN_Graph và CSV đọc chung kết quả (cycle_ai_costs).
+def node_link_rows(origin, data):
+    """[NEW] [(origin, neighbor, features)] cho mọi link báo cáo của một node."""
+    nb_count = len(data["neighbors"])
+    return [
+        (origin, nb["addr"], link_features(
+            grad=data["grad"], nb_rssi=nb["rssi"], nb_link_up_s=nb["link_uptime"],
+            drop_rate=data["drop_rate"], pin=data["pin"],
+            drop_count=data["drp"], fwd_count=data["fwdr"], neighbor_count=nb_count))
+        for nb in data["neighbors"]
+    ]
 
 
 # ==========================================
@@ -174,45 +186,255 @@ def estimate_battery(uptime_s, tx_count):
     return round(max(0.0, min(100.0, battery_left)), 1)
 
 # ==========================================
-# LUỒNG 1: ĐỌC SERIAL
+# TASK 1: UART (ĐỌC / GHI KHÔNG CHẶN)
 # ==========================================
-def uart_reader_thread():
-    global global_ser
-    print("[Luồng 1] Đang túc trực lắng nghe dữ liệu...")
-    while True:
-        try:
-            if global_ser and global_ser.is_open:
-                with serial_lock:
-                    if global_ser.in_waiting > 0:
-                        line = global_ser.readline().decode('utf-8', errors='ignore').strip()
-                        if line:
-                            # print(f"[RAW UART] {line}")
-                            if "$[TOPO]" in line:
-                                uart_queue.put(line)
-                            elif "CSV_LOG" in line:
-                                stress_queue.put(line)
-            time.sleep(0.01)
-        except Exception:
-            time.sleep(1)
-
-def send_uart_command(cmd):
-    global global_ser, total_control_packets
-    if global_ser and global_ser.is_open:
+# [UPD] Thay luồng poll in_waiting mỗi 10 ms + serial_lock: sink_link.py đọc fd non-blocking
+# qua loop.add_reader và ghi bằng một writer task riêng. Mỗi dòng được xử lý ngay trong
+# callback của reader, không qua queue.
+def dispatch_line(line):
+    # print(f"[RAW UART] {line}")
+    if sink_rpc.on_line(line):  # $[RSP] của "mesh rpc"
+        return
+    if "$[TOPO" in line:  # $[TOPO] và $[TOPOD]
+        handle_topo_line(line)
+    elif "CSV_LOG" in line:
+        handle_stress_line(line)
+    elif "$[TRACE" in line:
+        os.makedirs(BACKUP_DIR, exist_ok=True)
+        with open(TRACE_CAPTURE_LOG, 'a', encoding='utf-8') as f:
+            f.write(line + "\n")
+
+def write_uart_line(line):
+    sink_link.write_line(line)
+
+# [NEW] Lệnh qua "mesh rpc": có id + $[RSP], tối đa RPC_WINDOW lệnh cùng lúc thay vì sleep cố định
+sink_rpc = SinkRpcClient(write_uart_line, window=RPC_WINDOW)
+
+async def send_uart_command(cmd):
+    """Gửi lệnh mesh cho Sink. Lệnh trong RPC_COMMANDS đi qua sink_rpc (chỉ chờ khi cửa sổ
+    đầy) và trả về RpcRequest để chờ kết quả; lệnh khác xếp thẳng vào writer, trả về None."""
+    global total_control_packets
+    if sink_link is not None:
         try:
-            with serial_lock:
-                global_ser.write(f"{cmd}\r\n".encode())
-                global_ser.flush() 
-                total_control_packets += 1
-                time.sleep(0.05) 
+            sub = cmd.split(maxsplit=2)
+            if len(sub) >= 2 and sub[0] == "mesh" and sub[1] in RPC_COMMANDS:
+                req = await sink_rpc.submit(cmd[len("mesh "):])
+            else:
+                write_uart_line(cmd)
+                req = None
+            total_control_packets += 1
             print(f"[UART TX] Đã nã lệnh: {cmd} (Tổng cộng: {total_control_packets})")
+            return req
         except Exception as e:
             print(f"[UART TX] Lỗi: {e}")
+    return None
+
+async def wait_rpc(reqs, what):
+    """[NEW] Chờ các lệnh pipelined xong, in lệnh bị Sink từ chối / không trả lời."""
+    reqs = [r for r in reqs if r is not None]
+    statuses = await sink_rpc.wait_all(reqs, timeout=sink_rpc.timeout * 2)
+    failed = [(r.cmd, "timeout" if st is RPC_TIMEOUT else st)
+              for r, st in zip(reqs, statuses) if st != 0]
+    print(f"[RPC] {what}: {len(reqs) - len(failed)}/{len(reqs)} lệnh OK")
+    for cmd, st in failed:
+        print(f"[RPC]   Lỗi {st}: mesh {cmd}")
+    return not failed
+
+def spawn(coro):
+    """[NEW] Chạy coroutine nền trên vòng chính (thay cho threading.Thread)."""
+    task = asyncio.get_running_loop().create_task(coro)
+    background_tasks.add(task)
+    task.add_done_callback(background_tasks.discard)
+    return task
 
 # ==========================================
-# LUỒNG 2: XỬ LÝ LOGIC, ĐỊNH TUYẾN & SAO LƯU
+# TASK 2: XỬ LÝ LOGIC, ĐỊNH TUYẾN & SAO LƯU
 # ==========================================
-def execute_hybrid_push(delta_nodes):
+def downlink_route(target):
+    """[NEW] Relay giữa Gateway và target theo cây uplink (cạnh is_parent) trong Master_Graph.
+    Trả về list relay phía Gateway trước (không gồm Gateway/target), None nếu không đủ thông tin."""
+    path, node = [], target
+    while node != GATEWAY_NODE:
+        if node not in Master_Graph or node in path or len(path) > SR_MAX_HOPS:
+            return None
+        path.append(node)
+        node = next((v for _, v, d in Master_Graph.out_edges(node, data=True)
+                     if d.get('is_parent') and not d.get('is_virtual')), None)
+        if node is None:
+            return None
+    return list(reversed(path[1:]))
+
+async def send_backprop(target, payload):
+    """[NEW] BACKPROP source-routed khi biết đường đi, ngược lại dùng RRT (mesh backprop)."""
+    hops = downlink_route(target)
+    if hops is None:
+        return await send_uart_command(f"mesh backprop {target} {payload}")
+    return await send_uart_command(" ".join([f"mesh backprop_sr {target} {payload}"] + hops))
+
+def count_rrt_runs(children, addr_of):
+    """[NEW] Số run [lo..hi] Sink cần trong RRT: mỗi con trực tiếp của Gateway giữ tập địa chỉ
+    của cả cây con, gộp thành các đoạn liên tiếp (khớp reverse_routing.c)."""
+    runs = 0
+    for child in children.get(GATEWAY_NODE, []):
+        addrs, stack = [], [child]
+        while stack:
+            n = stack.pop()
+            addrs.append(addr_of(n))
+            stack.extend(children.get(n, []))
+        addrs.sort()
+        runs += 1 + sum(1 for a, b in zip(addrs, addrs[1:]) if b != a + 1)
+    return runs
+
+def suggest_address_plan():
+    """[NEW] Provisioning nằm ngoài Gateway nên chỉ GỢI Ý cấp lại địa chỉ: duyệt preorder cây uplink
+    (cạnh is_parent) từ Gateway, mỗi cây con nhận một dải địa chỉ liên tiếp -> RRT của Sink và relay
+    thu về 1 run/nhánh. Gọi từ reconcile_master_graph()."""
+    global address_plan
+    children = {}
+    for u, v, d in Master_Graph.edges(data=True):
+        if d.get('is_parent'):
+            children.setdefault(v, []).append(u)
+    for kids in children.values():
+        kids.sort(key=lambda n: int(n, 16))
+
+    current = count_rrt_runs(children, lambda n: int(n, 16))
+    ideal = len(children.get(GATEWAY_NODE, []))
+    if current <= ideal:
+        return
+
+    order, stack = [], list(reversed(children.get(GATEWAY_NODE, [])))
+    while stack:
+        n = stack.pop()
+        if n in order:
+            continue  # vòng lặp parent tạm thời
+        order.append(n)
+        stack.extend(reversed(children.get(n, [])))
+
+    gw = int(GATEWAY_NODE, 16)
+    next_addr = min(int(n, 16) for n in order)
+    plan = {}
+    for n in order:
+        if next_addr == gw:
+            next_addr += 1
+        plan[n] = f"{next_addr:04X}"
+        next_addr += 1
+    if plan == address_plan:
+        return
+    address_plan = plan
+
+    moves = {old: new for old, new in plan.items() if int(old, 16) != int(new, 16)}
+    print(f"[ADDR PLAN] RRT Sink: {current} run / tối ưu {ideal}. Gợi ý cấp lại {len(moves)} địa chỉ:")
+    for old, new in moves.items():
+        print(f"    {old} -> {new}")
+    try:
+        os.makedirs(BACKUP_DIR, exist_ok=True)
+        with open(os.path.join(BACKUP_DIR, f"address_plan_{SESSION_ID}.json"), 'w') as f:
+            json.dump({"runs": current, "ideal_runs": ideal, "plan": plan}, f, indent=2)
+    except OSError as e:
+        print(f"[ADDR PLAN] Lỗi ghi file: {e}")
+
+def plan_flow_splits(delta_nodes):
+    """[NEW] Luật flow theo nguồn cho relay hotspot trên cây SDN_Graph (cạnh is_parent).
+    Mỗi nhánh con giữ nguyên, chỉ chọn cả nhánh (mọi nguồn trong nhánh) chuyển sang uplink Q:
+    Q gần Gateway hơn relay (grad nhỏ hơn), không nằm trong cây con của relay nên không tạo vòng.
+    Trả về {relay: [(src, class, next_hop)]} gồm cả luật gỡ (next_hop 0000) của lần tách trước;
+    relay có trong delta_nodes nhận luật (0000, ANY, parent mới) thay cho BACKPROP 0x8000."""
+    now = time.time()
+    parent_of, children = {}, {}
+    for u, v, d in SDN_Graph.edges(data=True):
+        if d.get('is_parent'):
+            parent_of[u] = v
+            children.setdefault(v, []).append(u)
+
+    def subtree(root):
+        out, stack = [], [root]
+        while stack:
+            n = stack.pop()
+            if n in out:
+                continue  # vòng lặp parent tạm thời
+            out.append(n)
+            stack.extend(children.get(n, []))
+        return out
+
+    def grad(n):
+        return 0 if n == GATEWAY_NODE else Master_Graph.nodes[n].get('grad', 0xFF)
+
+    wanted = {}
+    for relay, parent in parent_of.items():
+        attrs = Master_Graph.nodes.get(relay, {})
+        if attrs.get('fwdr', 0) < FLOW_SPLIT_MIN_FWDR or len(children.get(relay, [])) < 2:
+            continue
+        below = set(subtree(relay))
+        p_cost = SDN_Graph[relay][parent].get('cost', 999)
+        alts = [(d.get('cost', 999), q) for q, d in SDN_Graph[relay].items()
+                if q != parent and q not in below and q in Master_Graph and not d.get('is_virtual')
+                and grad(q) < attrs.get('grad', 0xFF)
+                and Master_Graph.nodes[q].get('fwdr', 0) < FLOW_SPLIT_MIN_FWDR
+                and d.get('cost', 999) <= p_cost * (1 + FLOW_SPLIT_COST_MARGIN)]
+        if not alts:
+            continue
+        via = min(alts)[1]
+
+        # Nhánh nặng trước; dừng khi đã chuyển khoảng nửa tải hoặc hết chỗ trong bảng flow
+        branches = sorted(((Master_Graph.nodes[c].get('fwdr', 0) + 1, subtree(c))
+                           for c in children[relay]), key=lambda b: -b[0])
+        total = sum(w for w, _ in branches)
+        moved, srcs = 0, []
+        for w, nodes in branches:
+            if moved + w <= total / 2 and len(srcs) + len(nodes) <= FLOW_SPLIT_MAX_SRCS:
+                moved += w
+                srcs.extend(nodes)
+        if srcs:
+            wanted[relay] = (via, frozenset(srcs))
+
+    updates = {}
+    for relay in set(wanted) | set(flow_splits):
+        if relay not in Master_Graph:
+            flow_splits.pop(relay, None)  # Node đã bị xóa: luật tự hết hạn
+            continue
+        via, srcs = wanted.get(relay, (None, frozenset()))
+        old_via, old_srcs, t = flow_splits.get(relay, (None, frozenset(), 0))
+        if (via, srcs) == (old_via, old_srcs) and now - t < FLOW_SPLIT_REFRESH_S:
+            continue
+        rules = [(src, FLOW_CLASS_ANY, via) for src in sorted(srcs)]
+        rules += [(src, FLOW_CLASS_ANY, "0000") for src in sorted(old_srcs - srcs)]
+        updates[relay] = rules
+        if srcs:
+            flow_splits[relay] = (via, srcs, now)
+            print(f"[SDN FLOW] Hotspot {relay}: {len(srcs)} nguồn qua {via} thay vì {parent_of[relay]}")
+        else:
+            flow_splits.pop(relay, None)
+            print(f"[SDN FLOW] Hotspot {relay}: gỡ tách luồng")
+
+    for node, new_parent in delta_nodes:
+        if node in updates:
+            updates[node].append(("0000", FLOW_CLASS_ANY, new_parent))
+    return updates
+
+async def push_flow_rules(node, rules, lifetime_min=0):
+    """[NEW] Cài bảng flow lên relay `node`: rules = [(src, traffic_class, next_hop)].
+    src "0000" = mọi nguồn, next_hop "0000" = xóa luật. Áp dụng ở lần COMMIT (TOPO_REQ) kế tiếp."""
+    global sdn_flow_version
+    sdn_flow_version = (sdn_flow_version + 1) & 0xFF
+    reqs = []
+    for i in range(0, len(rules), SDN_FLOW_MAX_RULES):
+        chunk = rules[i:i + SDN_FLOW_MAX_RULES]
+        args = " ".join(f"{src}:{cls}:{nh}:{lifetime_min}" for src, cls, nh in chunk)
+        reqs.append(await send_uart_command(f"mesh sdn_flow {node} {sdn_flow_version} {args}"))
+    return reqs
+
+async def execute_hybrid_push(delta_nodes, flow_updates=None):
     global pending_commit
+    if flow_updates:
+        # [NEW] Một version mới thay tập luật đang stage trên relay: đổi parent của relay đi
+        # cùng bản tin flow (luật mặc định), không gửi thêm BACKPROP 0x8000 cho relay đó.
+        reqs = []
+        for relay, rules in flow_updates.items():
+            reqs += await push_flow_rules(relay, rules)
+        await wait_rpc(reqs, f"sdn_flow {len(flow_updates)} relay")
+        delta_nodes = [(n, p) for n, p in delta_nodes if n not in flow_updates]
+        pending_commit = True
+
     K = len(delta_nodes)
     print(f"\n[AI SDN] Phát hiện {K} node cần thay đổi Next-Hop.")
     
@@ -220,13 +442,18 @@ def execute_hybrid_push(delta_nodes):
         return
         
     if K <= 13:
-        print("[AI SDN] K <= 13 -> Dùng chiến lược UNICAST đẩy lệnh.")
-        for node, new_parent in delta_nodes:
-            new_parent_int = int(str(new_parent), 16)
-            payload = 0x8000 | new_parent_int
-            cmd = f"mesh backprop {node} {payload}"
-            send_uart_command(cmd)
-            time.sleep(0.5) 
+        print("[AI SDN] K <= 13 -> Dùng chiến lược UNICAST gộp (BACKPROP_MULTI, tách tại nhánh).")
+        records = [(node, 0x8000 | int(str(new_parent), 16)) for node, new_parent in delta_nodes]
+        reqs = []
+        if len(records) == 1:
+            reqs.append(await send_backprop(*records[0]))
+        else:
+            # [NEW] Gộp thành BACKPROP_MULTI: relay tách theo nhánh, chi phí ~ kích thước cây con
+            for i in range(0, len(records), BACKPROP_MULTI_MAX):
+                chunk = records[i:i + BACKPROP_MULTI_MAX]
+                reqs.append(await send_uart_command(
+                    "mesh backprop_multi " + " ".join(f"{n}:{p}" for n, p in chunk)))
+        await wait_rpc(reqs, "AI SDN unicast")
     else:
         print(f"[AI SDN] K = {K} > 13 -> Dùng chiến lược BROADCAST gộp lệnh.")
         hex_payload = ""
@@ -234,62 +461,93 @@ def execute_hybrid_push(delta_nodes):
             for node, new_parent in delta_nodes:
                 hex_payload += f"{node}{new_parent}"
         cmd = f"mesh backprop_broadcast {hex_payload}"
-        send_uart_command(cmd)
+        await wait_rpc([await send_uart_command(cmd)], "AI SDN broadcast")
         
     pending_commit = True
 
-def data_processor_thread():
-    global current_cycle_data, page_assembly, pending_commit
-    print("[Luồng 2] Khởi động Xử lý Dữ liệu")
-    last_polling_time = time.time()
-    collecting_data = False
-    global current_cycle_data, page_assembly
-    current_cycle_data = {}
-    page_assembly = {}
+async def update_collection_wave():
+    """[NEW] Chỉnh số level wave theo độ sâu quan sát được; trả về collection window (s)."""
+    global wave_levels
+    grads = [st['grad'] for st in topo_state.values() if 0 < st.get('grad', 0) < 0xFF]
+    levels = max(1, min(max(grads, default=WAVE_DEFAULT_LEVELS), WAVE_MAX_LEVELS))
+    if levels != wave_levels:
+        await send_uart_command(f"mesh wave {WAVE_SLOT_MS} {levels} {WAVE_SLOTS_PER_LEVEL}")
+        print(f"[WAVE] Độ sâu mạng {wave_levels} -> {levels} level")
+        wave_levels = levels
+    return levels * WAVE_SLOTS_PER_LEVEL * WAVE_SLOT_MS / 1000 + WAVE_MARGIN
 
+async def poll_scheduler():
+    """[UPD] Chu kỳ poll theo hẹn giờ của vòng asyncio (thay vòng lặp kiểm tra đồng hồ mỗi
+    0.1 s): gửi topo_req, ngủ tới hết cửa sổ thu thập, tối ưu, ngủ tới hạn poll kế tiếp."""
+    global pending_commit, collecting_data
+    print("[Task 2] Khởi động lịch poll topology")
+    loop = asyncio.get_running_loop()
+    next_poll = loop.time() + POLLING_INTERVAL
     while True:
-        now = time.time()
-        if now - last_polling_time >= POLLING_INTERVAL:
-            print("\n=======================================")
-            if pending_commit:
-                print("[SDN 2PC] Kích đúp cờ COMMIT vào bản tin topo_req (Phase 2)")
-                send_uart_command("mesh topo_req 1")
-                pending_commit = False
-            else:
-                send_uart_command("mesh topo_req 0")
-            
-            current_cycle_data.clear()
-            page_assembly.clear()
-            collecting_data = True
-            last_polling_time = now
+        await asyncio.sleep(max(0.0, next_poll - loop.time()))
+        next_poll += POLLING_INTERVAL
+        print("\n=======================================")
+        # [NEW] Node lệch version Delta -> bắt gửi lại snapshot đầy đủ
+        resync_arg = ""
+        if len(topo_resync) > TOPO_REQ_MAX_RESYNC:
+            resync_arg = " full"
+        elif topo_resync:
+            resync_arg = " " + " ".join(sorted(topo_resync))
+        topo_resync.clear()
+        collection_window = await update_collection_wave()
 
-        if collecting_data and (now - last_polling_time >= COLLECTION_WINDOW):
-            collecting_data = False
-            reconcile_master_graph()
-            save_to_csv_ramdisk()
+        current_cycle_data.clear()
+        page_assembly.clear()
+        collecting_data = True
+        window_end = loop.time() + collection_window
+        if pending_commit:
+            print("[SDN 2PC] Kích đúp cờ COMMIT vào bản tin topo_req (Phase 2)")
+            pending_commit = False
+            await send_uart_command(f"mesh topo_req 1{resync_arg}")
+        else:
+            await send_uart_command(f"mesh topo_req 0{resync_arg}")
 
-        try:
-            raw_line = uart_queue.get(timeout=0.1)
-            match = re.search(TOPO_PATTERN, raw_line)
-            if match and collecting_data:
-                # [SỬA]: Lấy đúng 11 tham số từ Regex
-                origin, seq, total, curr, count, grad, parent, drp, fwdr, uptime, total_sent, n_str = match.groups()
-                neighbors = re.findall(NEIGHBOR_PATTERN, n_str)
-                parsed_nb = [{"addr": n[0], "rssi": int(n[1]), "grad": int(n[2]), "link_uptime": int(n[3])} for n in neighbors]
-                
-                if origin not in page_assembly or page_assembly[origin]['seq'] != int(seq):
-                    page_assembly[origin] = {
-                        'seq': int(seq), 'total': int(total), 'pages': {}, 
-                        'grad': int(grad), 'parent': parent, 'ts': now,
-                        'drp': int(drp), 'fwdr': int(fwdr), 
-                        'uptime': int(uptime), 'total_sent': int(total_sent)
-                    }
-                
-                page_assembly[origin]['pages'][int(curr)] = parsed_nb
-                page_assembly[origin]['ts'] = now 
-                if len(page_assembly[origin]['pages']) == int(total):
-                    commit_topology_to_temp(origin)
-        except queue.Empty: pass
+        await asyncio.sleep(max(0.0, window_end - loop.time()))
+        collecting_data = False
+        await reconcile_master_graph()
+        save_to_csv_ramdisk()
+        if loop.time() > next_poll:
+            next_poll = loop.time()  # Chu kỳ bị trễ: poll ngay, không dồn nhiều lần
+
+def handle_topo_line(raw_line):
+    """Một dòng $[TOPO] / $[TOPOD] từ reader UART (gọi ngay khi dòng tới)."""
+    now = time.time()
+    if "$[TOPOD]" in raw_line:
+        match = re.search(TOPOD_PATTERN, raw_line)
+        if match:
+            apply_topology_delta(match, now, collecting_data)
+        return
+
+    match = re.search(TOPO_PATTERN, raw_line)
+    if match and collecting_data:
+        # [SỬA]: Lấy đúng 12 tham số từ Regex
+        origin, seq, total, curr, count, grad, parent, drp, fwdr, uptime, total_sent, ver, n_str = match.groups()
+        neighbors = re.findall(NEIGHBOR_PATTERN, n_str)
+        parsed_nb = [{"addr": n[0], "rssi": int(n[1]), "grad": int(n[2]), "link_uptime": int(n[3])} for n in neighbors]
+
+        if origin not in page_assembly or page_assembly[origin]['seq'] != int(seq):
+            page_assembly[origin] = {
+                'seq': int(seq), 'total': int(total), 'pages': {},
+                'ts': now, 'ver': int(ver)
+            }
+
+        # [UPD] Grad/Parent/bộ đếm chỉ có ở trang 1 (trang khác in 0)
+        if int(curr) == 1:
+            page_assembly[origin].update({
+                'grad': int(grad), 'parent': parent,
+                'drp': int(drp), 'fwdr': int(fwdr),
+                'uptime': int(uptime), 'total_sent': int(total_sent)
+            })
+
+        page_assembly[origin]['pages'][int(curr)] = parsed_nb
+        page_assembly[origin]['ts'] = now
+        if len(page_assembly[origin]['pages']) == int(total):
+            commit_topology_to_temp(origin)
 
 def commit_topology_to_temp(origin):
     if origin not in page_assembly: return
@@ -297,125 +555,195 @@ def commit_topology_to_temp(origin):
     all_neighbors = []
     for page_num in sorted(data['pages'].keys()):
         all_neighbors.extend(data['pages'][page_num])
+
+    # [NEW] Snapshot đầy đủ = base mới cho các Delta tiếp theo
+    now = time.time()
+    topo_state[origin] = {
+        'ver': data['ver'], 'grad': data['grad'], 'parent': data['parent'],
+        'neighbors': {nb['addr']: dict(nb, ts=now) for nb in all_neighbors},
+        'drp': data['drp'], 'fwdr': data['fwdr'],
+        'uptime': data['uptime'], 'uptime_ts': now, 'total_sent': data['total_sent'],
+    }
+    topo_resync.discard(origin)
+    stage_topology_state(origin, is_partial=len(data['pages']) < data['total'])
+
+def apply_topology_delta(match, now, collecting_data):
+    """[NEW] Áp Delta lên topo_state[origin]; lệch BaseVer -> đánh dấu resync."""
+    origin, seq, flags, base_ver, ver, grad, parent, drp, fwdr, uptime, total_sent, rest = match.groups()
+    flags, base_ver, ver = int(flags), int(base_ver), int(ver)
+
+    state = topo_state.get(origin)
+    if state is None or state['ver'] != base_ver:
+        have = state['ver'] if state else None
+        print(f"[TOPO Delta] {origin}: base v{base_ver} != v{have} -> yêu cầu resync")
+        topo_resync.add(origin)
+        return
+
+    if flags & TOPOD_FLAG_ROUTE:
+        state['grad'] = int(grad)
+        state['parent'] = parent
+    if flags & TOPOD_FLAG_COUNTERS:
+        state['drp'] = int(drp)
+        state['fwdr'] = int(fwdr)
+        state['uptime'] = int(uptime)
+        state['uptime_ts'] = now
+        state['total_sent'] = int(total_sent)
+
+    for n in re.findall(NEIGHBOR_PATTERN, rest):
+        state['neighbors'][n[0]] = {"addr": n[0], "rssi": int(n[1]), "grad": int(n[2]),
+                                    "link_uptime": int(n[3]), "ts": now}
+    for addr in re.findall(REMOVED_PATTERN, rest):
+        state['neighbors'].pop(addr, None)
+    state['ver'] = ver
+
+    if collecting_data:
+        stage_topology_state(origin)
+
+def stage_topology_state(origin, is_partial=False):
+    """Đưa topo_state[origin] vào current_cycle_data (đầu vào của reconcile)."""
+    state = topo_state[origin]
+    now = time.time()
+
+    # Neighbor không đổi thì không được gửi lại: ngoại suy link_uptime / uptime theo đồng hồ Gateway
+    all_neighbors = [
+        {"addr": nb['addr'], "rssi": nb['rssi'], "grad": nb['grad'],
+         "link_uptime": min(65535, nb['link_uptime'] + int(now - nb['ts']))}
+        for nb in state['neighbors'].values()
+    ]
+    uptime = state['uptime'] + int(now - state['uptime_ts'])
         
-    pin_est = estimate_battery(data['uptime'], data['total_sent'])
+    pin_est = estimate_battery(uptime, state['total_sent'])
     
     # [SỬA]: Feature Engineering - Tính tỷ lệ Drop Rate (%) cho ML
-    total_processed = data['drp'] + data['fwdr']
+    total_processed = state['drp'] + state['fwdr']
     drop_rate = 0.0
     if total_processed > 0:
-        drop_rate = round((data['drp'] / total_processed) * 100.0, 1)
+        drop_rate = round((state['drp'] / total_processed) * 100.0, 1)
     
     current_cycle_data[origin] = {
-        "grad": data['grad'], 
-        "parent": data['parent'], 
+        "grad": state['grad'], 
+        "parent": state['parent'], 
         "neighbors": all_neighbors, 
-        "is_partial": len(data['pages']) < data['total'],
-        "drp": data['drp'],
-        "fwdr": data['fwdr'],
+        "is_partial": is_partial,
+        "drp": state['drp'],
+        "fwdr": state['fwdr'],
         "drop_rate": drop_rate,
         "pin": pin_est
     }
+    sdn_commit_node(origin)
 
-def reconcile_master_graph():
-    global Master_Graph, SDN_Graph, latest_graph_json, missed_count_dict
-    with graph_lock:
-        for node, data in current_cycle_data.items():
-            missed_count_dict[node] = 0
-            
-            Master_Graph.add_node(node, grad=data["grad"], color="green", drp=data["drp"], fwdr=data["fwdr"], drop_rate=data["drop_rate"], pin=data["pin"])
-            Master_Graph.remove_edges_from([(u, v) for u, v in Master_Graph.edges if u == node])
-            neighbors = data.get("neighbors", [])
-            if isinstance(neighbors, list):
-                nb_count = len(neighbors)
-                for nb in neighbors:
-                    edge_cost = compute_routing_cost_per_link(
-                        grad=data["grad"], nb_rssi=nb["rssi"], nb_link_up_s=nb["link_uptime"], 
-                        drop_rate=data["drop_rate"], pin=data["pin"],
-                        drop_count=data["drp"], fwd_count=data["fwdr"], neighbor_count=nb_count,
-                        use_ai=False # Raw View uses Heuristic Formula
-                    )
-                    Master_Graph.add_edge(node, nb["addr"], rssi=nb["rssi"], is_parent=(nb["addr"] == data["parent"]), 
-                                          link_uptime=nb["link_uptime"], cost=edge_cost)
-            
-            # [FIX] Force-add Reported Parent edge if it's missing (e.g. not in neighbor list due to overflow)
-            parent = data["parent"]
-            if parent != "0000" and parent != "ffff":
-                if not Master_Graph.has_edge(node, parent):
-                    Master_Graph.add_edge(node, parent, rssi=-99, is_parent=True, link_uptime=0, cost=999, is_virtual=True)
-                else:
-                    Master_Graph[node][parent]['is_parent'] = True
-        
-        for node in list(Master_Graph.nodes):
-            if node == GATEWAY_NODE: continue
-            if node not in current_cycle_data:
-                missed_count_dict[node] = missed_count_dict.get(node, 0) + 1
-                if missed_count_dict[node] >= 3:
-                    Master_Graph.remove_node(node)
-                else:
-                    Master_Graph.nodes[node]['color'] = 'yellow'
-                    
-        # --- SDN OPTIMIZATION (DIJKSTRA) ---
-        SDN_Graph = Master_Graph.copy()
-        for node in list(SDN_Graph.nodes):
-            if node == GATEWAY_NODE: continue
-            
-            # [NEW] Recalculate costs for SDN Graph using AI predictions
-            if node in current_cycle_data:
-                data = current_cycle_data[node]
-                nb_count = len(data["neighbors"])
-                for u, v, d in list(SDN_Graph.edges(node, data=True)):
-                    # Find neighbor data to get specific link_uptime/rssi
-                    nb_data = next((n for n in data["neighbors"] if n["addr"] == v), None)
-                    if nb_data:
-                        ai_cost = compute_routing_cost_per_link(
-                            grad=data["grad"], nb_rssi=nb_data["rssi"], nb_link_up_s=nb_data["link_uptime"],
-                            drop_rate=data["drop_rate"], pin=data["pin"],
-                            drop_count=data["drp"], fwd_count=data["fwdr"], neighbor_count=nb_count,
-                            use_ai=True # SDN View uses AI Prediction
-                        )
-                        SDN_Graph[u][v]['cost'] = ai_cost
+def sdn_commit_node(origin):
+    """[NEW] Ghi nhận báo cáo của `origin` đã commit; cost AI và SPT được cập nhật theo lô
+    ở sdn_flush_cycle() khi hết cửa sổ thu thập."""
+    if origin != GATEWAY_NODE:
+        sdn_pending.add(origin)
 
-            try:
-                # Find shortest path from node to Gateway using AI cost
-                path = nx.shortest_path(SDN_Graph, source=node, target=GATEWAY_NODE, weight='cost')
-                best_parent = path[1] if len(path) > 1 else None
-                
-                # Update Edge styles in SDN Graph to reflect the new parent
-                for u, v, d in SDN_Graph.edges(data=True):
-                    if u == node:
-                        SDN_Graph[u][v]['is_parent'] = (v == best_parent)
-            except nx.NetworkXNoPath:
-                pass # Unreachable
-                
-        # --- DELTA FILTERING AND HYBRID PUSH ---
-        delta_nodes = []
-        for node in SDN_Graph.nodes:
-            if node == GATEWAY_NODE: continue
-            
-            ai_parent = None
-            for u, v, d in SDN_Graph.edges(data=True):
-                if u == node and d.get('is_parent', False):
-                    ai_parent = v
-                    break
-            
-            # [NEW] Check if the ACTUAL parent reported by node matches AI recommendation
-            actual_parent = None
-            if node in Master_Graph:
-                for u, v, d in Master_Graph.edges(data=True):
-                    if u == node and d.get('is_parent', False):
-                        actual_parent = v
-                        # If matches AI, mark for styling
-                        Master_Graph[u][v]['is_ai_optimized'] = (v == ai_parent)
-                        break
-                    
-            if ai_parent and actual_parent and ai_parent != actual_parent:
-                delta_nodes.append((node, ai_parent))
-                
-        if isinstance(delta_nodes, list) and len(delta_nodes) > 0:
-            threading.Thread(target=execute_hybrid_push, args=(delta_nodes,), daemon=True).start()
+async def sdn_flush_cycle(removed):
+    """[NEW] Predict một lần cho mọi link của các node vừa báo cáo rồi sửa SPT tăng dần
+    (chỉ phần cây bị ảnh hưởng).
+    [UPD] Chạy ở process của sdn_optimizer: vòng chính vẫn đọc UART / phục vụ websocket
+    trong lúc chờ. Trả về {node: (parent AI, {neighbor: cost AI})} cần đồng bộ SDN_Graph."""
+    global cycle_ai_costs
+    reports = {}
+    for origin in sdn_pending:
+        data = current_cycle_data.get(origin)
+        if data is not None:
+            rows = node_link_rows(origin, data)
+            reports[origin] = (data["parent"], [(nb, f) for _, nb, f in rows])
+    sdn_pending.clear()
+    if not reports and not removed:
+        cycle_ai_costs = {}
+        return {}
+
+    result = await sdn_optimizer.run_cycle(reports, removed)
+    cycle_ai_costs = result["link_costs"]
+    for origin, n_moved, touched in result["log"]:
+        print(f"[SDN SPT] {origin}: {n_moved} node đổi parent AI (duyệt {touched} node)")
+    if cycle_ai_costs:
+        print(f"[AI COST] {len(cycle_ai_costs)} link / {len(reports)} node: predict "
+              f"{result['t_pred'] * 1000:.1f} ms, tối ưu {result['t_total'] * 1000:.1f} ms")
+    return result["nodes"]
+
+async def reconcile_master_graph():
+    global Master_Graph, SDN_Graph, missed_count_dict
+    # Node vắng 3 chu kỳ liên tiếp bị xóa (khỏi cả SPT của sdn_optimizer)
+    removed = [n for n in Master_Graph.nodes
+               if n != GATEWAY_NODE and n not in current_cycle_data
+               and missed_count_dict.get(n, 0) + 1 >= 3]
+    ai_nodes = await sdn_flush_cycle(removed)
+
+    # [UPD] Từ đây tới hết hàm không có await: Master_Graph/SDN_Graph chỉ đổi trong đoạn
+    # đồng bộ này nên reader UART và websocket luôn thấy một đồ thị nhất quán (thay graph_lock).
+    for node, data in current_cycle_data.items():
+        missed_count_dict[node] = 0
+
+        Master_Graph.add_node(node, grad=data["grad"], color="green", drp=data["drp"], fwdr=data["fwdr"], drop_rate=data["drop_rate"], pin=data["pin"])
+        Master_Graph.remove_edges_from([(u, v) for u, v in Master_Graph.edges if u == node])
+        neighbors = data.get("neighbors", [])
+        if isinstance(neighbors, list):
+            for nb in neighbors:
+                edge_cost = heuristic_cost(
+                    grad=data["grad"], nb_rssi=nb["rssi"], nb_link_up_s=nb["link_uptime"],
+                    drop_rate=data["drop_rate"], pin=data["pin"]
+                ) # Raw View uses Heuristic Formula
+                Master_Graph.add_edge(node, nb["addr"], rssi=nb["rssi"], is_parent=(nb["addr"] == data["parent"]), 
+                                      link_uptime=nb["link_uptime"], cost=edge_cost)
+        
+        # [FIX] Force-add Reported Parent edge if it's missing (e.g. not in neighbor list due to overflow)
+        parent = data["parent"]
+        if parent != "0000" and parent != "ffff":
+            if not Master_Graph.has_edge(node, parent):
+                Master_Graph.add_edge(node, parent, rssi=-99, is_parent=True, link_uptime=0, cost=999, is_virtual=True)
+            else:
+                Master_Graph[node][parent]['is_parent'] = True
+    
+    dirty = set(current_cycle_data)  # [NEW] Node cần so lại trong graph_store
+    for node in list(Master_Graph.nodes):
+        if node == GATEWAY_NODE: continue
+        if node not in current_cycle_data:
+            dirty.add(node)
+            missed_count_dict[node] = missed_count_dict.get(node, 0) + 1
+            if node in removed:
+                Master_Graph.remove_node(node)
+                if node in SDN_Graph: SDN_Graph.remove_node(node)
+            else:
+                Master_Graph.nodes[node]['color'] = 'yellow'
+                if node in SDN_Graph: SDN_Graph.nodes[node]['color'] = 'yellow'
                 
-    latest_graph_json = graph_to_json()
+    # --- SDN OPTIMIZATION (DIJKSTRA tăng dần) ---
+    # [UPD] SPT đã được sửa trong sdn_optimizer; ở đây chỉ đồng bộ SDN_Graph và tính delta
+    # cho node vừa báo cáo + node có parent AI vừa đổi (ai_nodes chứa đúng tập đó).
+    # Node không tới được Gateway giữ parent đang báo cáo (như trước).
+    changed = [n for n in ai_nodes if n in Master_Graph]
+    ai_parents = {}
+    for node in changed:
+        parent, ai_costs = ai_nodes[node]
+        if parent:
+            ai_parents[node] = parent
+        SDN_Graph.add_node(node, **Master_Graph.nodes[node])
+        SDN_Graph.remove_edges_from(list(SDN_Graph.out_edges(node)))
+        for v, d in Master_Graph[node].items():
+            ai_cost = ai_costs.get(v)
+            SDN_Graph.add_edge(node, v, **dict(d, cost=d['cost'] if ai_cost is None else ai_cost))
+
+    mark_parents(SDN_Graph, ai_parents)
+    actual_parents = reported_parents(Master_Graph, changed)
+
+    # --- DELTA FILTERING AND HYBRID PUSH ---
+    for node, parent in actual_parents.items():
+        # If matches AI, mark for styling
+        Master_Graph[node][parent]['is_ai_optimized'] = (parent == ai_parents.get(node, parent))
+    delta_nodes = parent_delta(ai_parents, actual_parents, GATEWAY_NODE)
+    flow_updates = plan_flow_splits(delta_nodes)
+
+    if delta_nodes or flow_updates:
+        spawn(execute_hybrid_push(delta_nodes, flow_updates))
+
+    suggest_address_plan()
+
+    # [UPD] Chỉ tuần tự hóa node bị đụng tới, đẩy bản vá cho mọi dashboard (graph_store.py)
+    dirty.update(changed)
+    graph_store.update({"before": Master_Graph, "after": SDN_Graph}, dirty)
 
 def save_to_csv_ramdisk():
     try:
@@ -430,59 +758,46 @@ def save_to_csv_ramdisk():
                     "Drop_Count", "Fwd_Count", "Drop_Rate(%)", "Pin(%)",
                     "Routing_Cost", "AI_Routing_Cost"
                 ])
+            # [UPD] AI cost lấy từ kết quả của chu kỳ (đã predict ở sdn_flush_cycle), không predict lại
+            ai_costs = cycle_ai_costs
             for origin, data in current_cycle_data.items():
                 safe_origin = f'="{origin}"'
                 safe_parent = f'="{data["parent"]}"'
                 neighbors = data.get("neighbors", [])
                 if isinstance(neighbors, list):
-                    nb_count = len(neighbors)
                     for nb in neighbors:
                         safe_neighbor = f'="{nb["addr"]}"'
-                    heuristic_cost = compute_routing_cost_per_link(
-                        grad         = data["grad"],
-                        nb_rssi      = nb["rssi"],
-                        nb_link_up_s = nb["link_uptime"],
-                        drop_rate    = data["drop_rate"],
-                        pin          = data["pin"],
-                        drop_count   = data["drp"],
-                        fwd_count    = data["fwdr"],
-                        neighbor_count = nb_count,
-                        use_ai       = False
-                    )
-                    ai_cost = compute_routing_cost_per_link(
-                        grad         = data["grad"],
-                        nb_rssi      = nb["rssi"],
-                        nb_link_up_s = nb["link_uptime"],
-                        drop_rate    = data["drop_rate"],
-                        pin          = data["pin"],
-                        drop_count   = data["drp"],
-                        fwd_count    = data["fwdr"],
-                        neighbor_count = nb_count,
-                        use_ai       = True
-                    )
-                    writer.writerow([
-                        ts, safe_origin, data["grad"], safe_parent,
-                        safe_neighbor, nb["rssi"], nb["link_uptime"],
-                        data["drp"], data["fwdr"], data["drop_rate"],
-                        data["pin"], heuristic_cost, ai_cost
-                    ])
+                        heuristic = heuristic_cost(
+                            grad         = data["grad"],
+                            nb_rssi      = nb["rssi"],
+                            nb_link_up_s = nb["link_uptime"],
+                            drop_rate    = data["drop_rate"],
+                            pin          = data["pin"]
+                        )
+                        writer.writerow([
+                            ts, safe_origin, data["grad"], safe_parent,
+                            safe_neighbor, nb["rssi"], nb["link_uptime"],
+                            data["drp"], data["fwdr"], data["drop_rate"],
+                            data["pin"], heuristic, ai_costs.get((origin, nb["addr"]), heuristic)
+                        ])
     except Exception as e:
         pass
 
-def backup_csv_thread():
+async def backup_csv_task():
     if not os.path.exists(BACKUP_DIR): os.makedirs(BACKUP_DIR)
     while True:
-        time.sleep(BACKUP_INTERVAL)
+        await asyncio.sleep(BACKUP_INTERVAL)
         if os.path.exists(RAM_DISK_CSV):
             ts_now = time.strftime("%H%M%S")
             backup_filename = f"topology_snapshot_{SESSION_ID}_{ts_now}.csv"
             try:
-                shutil.copy2(RAM_DISK_CSV, os.path.join(BACKUP_DIR, backup_filename))
+                # Copy sang thẻ SD có thể chậm: chạy ở executor, không chặn vòng chính
+                await asyncio.to_thread(shutil.copy2, RAM_DISK_CSV, os.path.join(BACKUP_DIR, backup_filename))
             except Exception as e:
                 pass
 
 # ==========================================
-# LUỒNG 4: XỬ LÝ STRESS TEST LOG (MIMIC SINK_LOGGER)
+# XỬ LÝ STRESS TEST LOG (MIMIC SINK_LOGGER)
 # ==========================================
 def safe_int_convert(val):
     try:
@@ -493,6 +808,45 @@ def safe_int_convert(val):
     except (ValueError, TypeError):
         return 0
 
+# Thứ tự counters trong snapshot nhị phân (khớp enum stat_id trong packet_stats.c)
+STATS_SNAPSHOT_FIELDS = ["DataTx", "BeaconTx", "HeartbeatTx", "RouteChanges",
+                         "FwdCount", "RxCount", "PongTimeouts"]
+LAT_METRIC_NAMES = {0: "RTT", 1: "BACKPROP", 2: "BACKPROP_HOP"}
+
+def decode_stats_snapshot(blob):
+    """Giải mã snapshot nhị phân của pkt_stats_snapshot_encode() (version 1)."""
+    pos = 0
+    def u8():
+        nonlocal pos
+        pos += 1
+        return blob[pos - 1]
+    def uleb():
+        val, shift = 0, 0
+        while True:
+            b = u8()
+            val |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return val
+    def le16():
+        return u8() | (u8() << 8)
+
+    if u8() != 1:
+        raise ValueError("Unsupported stats snapshot version")
+    snap = {"Epoch": u8(), "SinceReset_s": uleb()}
+    counters = [uleb() for _ in range(u8())]
+    for i, name in enumerate(STATS_SNAPSHOT_FIELDS):
+        snap[name] = counters[i] if i < len(counters) else 0
+    snap["Latency"] = []
+    if pos < len(blob):
+        for _ in range(u8()):
+            metric = u8()
+            snap["Latency"].append({
+                "Metric": LAT_METRIC_NAMES.get(metric & 0x0F, "UNKNOWN"), "Hops": metric >> 4,
+                "Count": le16(), "P50": le16(), "P90": le16(), "P99": le16(), "Max": le16(),
+            })
+    return snap
+
 def export_stress_log():
     """Ghi lại file CSV stress test cuối cùng với mã hóa utf-8-sig."""
     if not stress_rows_buffer:
@@ -513,179 +867,175 @@ def export_stress_log():
     except Exception as e:
         print(f"[LỖI] Không thể xuất file CSV stress: {e}")
 
-def stress_processor_thread():
-    global stress_rows_buffer, latency_sync_cache, rx_stats, reported_nodes, test_stop_time
-    print("[Luồng 4] Khởi động Xử lý Stress Test Log")
-    
-    while True:
-        try:
-            # [NEW] Check if 10 minutes passed since TEST_STOP
-            if test_stop_time and (time.time() - test_stop_time > 600):
-                print("\n[STRESS] --- Hết thời gian chờ 10 phút. Đang xuất file... ---")
-                export_stress_log()
-                test_stop_time = None
-
-            line = stress_queue.get(timeout=0.1)
-            if "CSV_LOG," not in line:
-                continue
+def stress_export_due():
+    global stress_export_timer
+    stress_export_timer = None
+    print("\n[STRESS] --- Hết thời gian chờ 10 phút. Đang xuất file... ---")
+    export_stress_log()
+
+def handle_stress_line(line):
+    """[UPD] Một dòng CSV_LOG từ reader UART (trước đây qua stress_queue + luồng riêng)."""
+    global stress_rows_buffer, rx_stats, reported_nodes, stress_export_timer
+    try:
+        if "CSV_LOG," not in line:
+            return
                 
-            raw_data = line.split("CSV_LOG,")[1]
-            parts = [p.strip() for p in raw_data.split(',')]
-            if not parts:
-                continue
+        raw_data = line.split("CSV_LOG,")[1]
+        parts = [p.strip() for p in raw_data.split(',')]
+        if not parts:
+            return
                 
-            # Correct slicing and conversion
-            now_obj = datetime.datetime.now()
-            now = now_obj.strftime('%H:%M:%S') + f".{now_obj.microsecond // 1000:03d}"
-            log_type = parts[0]
+        # Correct slicing and conversion
+        now_obj = datetime.datetime.now()
+        now = now_obj.strftime('%H:%M:%S') + f".{now_obj.microsecond // 1000:03d}"
+        log_type = parts[0]
             
-            row = [""] * len(STRESS_LOG_HEADERS)
-            row[0] = now
-            row[1] = log_type
+        row = [""] * len(STRESS_LOG_HEADERS)
+        row[0] = now
+        row[1] = log_type
             
-            if log_type == "DATA" and len(parts) >= 6:
-                src_val = safe_int_convert(parts[1])
-                sender_val = safe_int_convert(parts[2])
-                seq_val = safe_int_convert(parts[3])
-                
-                src_hex = f"0x{src_val:04x}"
-                sender_hex = f"0x{sender_val:04x}"
+        if log_type == "DATA" and len(parts) >= 6:
+            src_val = safe_int_convert(parts[1])
+            sender_val = safe_int_convert(parts[2])
+            seq_val = safe_int_convert(parts[3])
                 
-                row[2] = src_hex
-                row[3] = sender_hex
-                row[4] = str(seq_val)
-                row[5] = parts[4] # Hops
-                row[6] = "0"      # Latency (Chờ PONG report)
-                row[7] = parts[7] if len(parts) > 7 else (parts[6] if len(parts) > 6 else "-99")
+            src_hex = f"0x{src_val:04x}"
+            sender_hex = f"0x{sender_val:04x}"
                 
-                latency_sync_cache[(src_hex, seq_val)] = len(stress_rows_buffer)
-                if isinstance(stress_rows_buffer, list):
-                    stress_rows_buffer.append(row)
-                if src_hex not in rx_stats: rx_stats[src_hex] = set()
-                rx_stats[src_hex].add(seq_val)
-
-            elif log_type == "RTT_DATA" and len(parts) >= 4:
-                src_hex = f"0x{safe_int_convert(parts[1]):04x}"
-                seq_val = safe_int_convert(parts[2])
-                rtt_val = parts[3]
+            row[2] = src_hex
+            row[3] = sender_hex
+            row[4] = str(seq_val)
+            row[5] = parts[4] # Hops
+            row[6] = ""       # Latency: xem dòng LATENCY (histogram)
+            row[7] = parts[7] if len(parts) > 7 else (parts[6] if len(parts) > 6 else "-99")
                 
-                key = (src_hex, seq_val)
-                if key in latency_sync_cache:
-                    row_idx = latency_sync_cache[key]
-                    if isinstance(row_idx, int) and row_idx < len(stress_rows_buffer):
-                        target_row = stress_rows_buffer[row_idx]
-                        if isinstance(target_row, list) and len(target_row) > 6:
-                            target_row[6] = rtt_val
-                continue # RTT_DATA chỉ để cập nhật Latency, không ghi dòng riêng
-
-            elif log_type == "SENSOR_DATA" and len(parts) >= 5:
-                src_hex = f"0x{safe_int_convert(parts[1]):04x}"
-                row[2] = src_hex
-                row[3] = f"0x{safe_int_convert(parts[2]):04x}"
-                row[5] = parts[3] # Hops
-                row[6] = parts[4] # Latency
+            if isinstance(stress_rows_buffer, list):
                 stress_rows_buffer.append(row)
+            if src_hex not in rx_stats: rx_stats[src_hex] = set()
+            rx_stats[src_hex].add(seq_val)
+
+        elif log_type == "LATENCY" and len(parts) >= 9:
+            # Format: LATENCY,Src,Metric,Hops,Count,P50,P90,P99,Max (histogram tại node)
+            row[2] = f"0x{safe_int_convert(parts[1]):04x}"
+            row[3] = parts[2] # Metric (RTT / BACKPROP / BACKPROP_HOP)
+            row[4] = parts[4] # Số mẫu
+            row[5] = parts[3] # Hops (chỉ với BACKPROP_HOP)
+            row[6] = parts[5] # p50 làm Latency đại diện
+            row[15:19] = parts[5:9]
+            stress_rows_buffer.append(row)
+            print(f"[STRESS] Node {row[2]} {parts[2]}(h={parts[3]}): n={parts[4]} p50={parts[5]} p90={parts[6]} p99={parts[7]} max={parts[8]} ms")
+
+        elif log_type == "STATS_BIN" and len(parts) >= 3:
+            # Snapshot nhị phân từ "mesh stats snapshot" (1 dòng = toàn bộ stats)
+            snap = decode_stats_snapshot(bytes.fromhex(parts[2]))
+            print(f"[STRESS] Node 0x{safe_int_convert(parts[1]):04x} Snapshot: {snap}")
+            return
 
-            elif log_type == "REPORT" and len(parts) >= 7:
-                src_hex = f"0x{safe_int_convert(parts[1]):04x}"
-                tx_count = parts[2]
-                report_key = (src_hex, tx_count)
+        elif log_type == "SENSOR_DATA" and len(parts) >= 5:
+            src_hex = f"0x{safe_int_convert(parts[1]):04x}"
+            row[2] = src_hex
+            row[3] = f"0x{safe_int_convert(parts[2]):04x}"
+            row[5] = parts[3] # Hops
+            row[6] = parts[4] # Latency
+            stress_rows_buffer.append(row)
+
+        elif log_type == "REPORT" and len(parts) >= 7:
+            src_hex = f"0x{safe_int_convert(parts[1]):04x}"
+            tx_count = parts[2]
+            report_key = (src_hex, tx_count)
                 
-                if report_key in reported_nodes:
-                    continue
+            if report_key in reported_nodes:
+                return
                 
-                reported_nodes.add(report_key)
-                data_tx = safe_int_convert(tx_count)
-                measured_rx = len(rx_stats.get(src_hex, set()))
-                pdr = (measured_rx / data_tx * 100.0) if data_tx > 0 else 0.0
-                if pdr > 100.0: pdr = 100.0 # Safety cap for display
-                remote_rx = parts[7] if len(parts) > 7 else (parts[6] if len(parts) > 6 else "0")
-
-                row[2] = src_hex
-                row[4] = str(data_tx)
-                row[8] = parts[3] if len(parts) > 3 else "0"  # BeaconTx
-                row[9] = parts[4] if len(parts) > 4 else "0"  # HeartbeatTx
-                row[10] = parts[5] if len(parts) > 5 else "0" # RouteChanges
-                row[11] = parts[6] if len(parts) > 6 else "0" # FwdCount
-                row[12] = str(measured_rx) # Unique RX
-                row[13] = str(remote_rx)   # Remote RX (if any)
-                row[14] = f"{pdr:.2f}"
-                stress_rows_buffer.append(row)
-                print(f"[STRESS] Node {src_hex} Report: PDR {pdr:.2f}% (RX: {measured_rx}, Node_TX: {data_tx})")
+            reported_nodes.add(report_key)
+            data_tx = safe_int_convert(tx_count)
+            measured_rx = len(rx_stats.get(src_hex, set()))
+            pdr = (measured_rx / data_tx * 100.0) if data_tx > 0 else 0.0
+            if pdr > 100.0: pdr = 100.0 # Safety cap for display
+            remote_rx = parts[7] if len(parts) > 7 else (parts[6] if len(parts) > 6 else "0")
 
-            elif "EVENT" in log_type and len(parts) >= 2:
-                event_name = parts[1]
-                msg = parts[2] if len(parts) >= 3 else ""
-                row[2] = event_name
-                row[3] = msg
+            row[2] = src_hex
+            row[4] = str(data_tx)
+            row[8] = parts[3] if len(parts) > 3 else "0"  # BeaconTx
+            row[9] = parts[4] if len(parts) > 4 else "0"  # HeartbeatTx
+            row[10] = parts[5] if len(parts) > 5 else "0" # RouteChanges
+            row[11] = parts[6] if len(parts) > 6 else "0" # FwdCount
+            row[12] = str(measured_rx) # Unique RX
+            row[13] = str(remote_rx)   # Remote RX (if any)
+            row[14] = f"{pdr:.2f}"
+            stress_rows_buffer.append(row)
+            print(f"[STRESS] Node {src_hex} Report: PDR {pdr:.2f}% (RX: {measured_rx}, Node_TX: {data_tx})")
+
+        elif "EVENT" in log_type and len(parts) >= 2:
+            event_name = parts[1]
+            msg = parts[2] if len(parts) >= 3 else ""
+            row[2] = event_name
+            row[3] = msg
                 
-                if "TEST_START" in event_name:
-                    test_stop_time = None # Cancel pending export
-                    rx_stats.clear()
-                    reported_nodes.clear()
-                    latency_sync_cache.clear()
-                    stress_rows_buffer.clear()
-                    stress_rows_buffer.append(row)
-                    print("\n[STRESS] --- PHIÊN TEST MỚI BẮT ĐẦU ---")
+            if "TEST_START" in event_name:
+                if stress_export_timer: # Cancel pending export
+                    stress_export_timer.cancel()
+                    stress_export_timer = None
+                rx_stats.clear()
+                reported_nodes.clear()
+                stress_rows_buffer.clear()
+                stress_rows_buffer.append(row)
+                print("\n[STRESS] --- PHIÊN TEST MỚI BẮT ĐẦU ---")
                 
-                elif "TEST_STOP" in event_name:
-                    stress_rows_buffer.append(row)
-                    test_stop_time = time.time()
-                    print("\n[STRESS] --- KẾT THÚC TEST. Đang chờ 10 phút để nhận nốt log... ---")
+            elif "TEST_STOP" in event_name:
+                stress_rows_buffer.append(row)
+                if stress_export_timer:
+                    stress_export_timer.cancel()
+                # [UPD] Hẹn giờ trên vòng asyncio thay cho kiểm tra mỗi 0.1 s
+                stress_export_timer = asyncio.get_running_loop().call_later(600, stress_export_due)
+                print("\n[STRESS] --- KẾT THÚC TEST. Đang chờ 10 phút để nhận nốt log... ---")
             
-        except queue.Empty:
-            pass
-        except Exception as e:
-            print(f"[LUỒNG 4 LỖI] {e}")
+    except Exception as e:
+        print(f"[STRESS LỖI] {e}")
 
 # ==========================================
-# LUỒNG 5: FASTAPI & WEBSOCKETS CÓ WEB SERVER
+# TASK 3: FASTAPI & WEBSOCKETS CÓ WEB SERVER
 # ==========================================
-def serialize_graph(g_nx):
-    nodes = []
-    for n, d in g_nx.nodes(data=True):
-        is_gw = (n == GATEWAY_NODE)
-        if is_gw:
-            tooltip_html = "<b>GATEWAY</b><br>Gradient: 0"
-        else:
-            tooltip_html = f"<b>Node: {n}</b><br>Gradient: {d.get('grad', '?')}<br>Mất gói (Drop): {d.get('drop_rate', 0.0)}%<br>Thông lượng: {d.get('fwdr', 0)} pkt/30s<br>Dự đoán Pin: {d.get('pin', '?')}%"
-
-        nodes.append({
-            "id": n, 
-            "label": f"Node {n}\n(Grad: {d.get('grad', 0 if is_gw else '?')})", 
-            "color": "red" if is_gw else d.get('color', 'blue'),
-            "level": 0 if is_gw else (int(d.get('grad', 3)) if str(d.get('grad')).isdigit() else 3),
-            "title": tooltip_html 
-        })
+# [UPD] Tuần tự hóa từng node / cạnh (thay serialize_graph cả đồ thị): graph_store chỉ gọi
+# cho phần đồ thị đổi trong chu kỳ.
+def serialize_node(n, d):
+    is_gw = (n == GATEWAY_NODE)
+    if is_gw:
+        tooltip_html = "<b>GATEWAY</b><br>Gradient: 0"
+    else:
+        tooltip_html = f"<b>Node: {n}</b><br>Gradient: {d.get('grad', '?')}<br>Mất gói (Drop): {d.get('drop_rate', 0.0)}%<br>Thông lượng: {d.get('fwdr', 0)} pkt/30s<br>Dự đoán Pin: {d.get('pin', '?')}%"
+
+    return {
+        "id": n, 
+        "label": f"Node {n}\n(Grad: {d.get('grad', 0 if is_gw else '?')})", 
+        "color": "red" if is_gw else d.get('color', 'blue'),
+        "level": 0 if is_gw else (int(d.get('grad', 3)) if str(d.get('grad')).isdigit() else 3),
+        "title": tooltip_html 
+    }
+
+def serialize_edge(u, v, d):
+    is_p = d.get('is_parent')
+    is_ai = d.get('is_ai_optimized', False)
+    is_v = d.get('is_virtual', False)
+    cost = d.get('cost', '?')
     
-    edges = []
-    for u, v, d in g_nx.edges(data=True):
-        is_p = d.get('is_parent')
-        is_ai = d.get('is_ai_optimized', False)
-        is_v = d.get('is_virtual', False)
-        cost = d.get('cost', '?')
-        
-        rssi_val = d.get('rssi')
-        label_text = f"{rssi_val}dBm\nC: {cost}" if not is_v else f"VIRTUAL\nC: {cost}"
-        
-        # Color Logic:
-        # - AI Optimized & Parent: SPRING GREEN (#00FF7F)
-        # - Regular Parent: RED
-        # - Non-parent: GRAY
-        edge_color = "#00FF7F" if is_ai else ("#ff4d4d" if is_p else "gray")
-        
-        edges.append({
-            "from": u, "to": v, "label": label_text, 
-            "width": 3 if is_p else 1, "dashes": not is_p, 
-            "color": edge_color, "physics": is_p
-        })
-    return {"nodes": nodes, "edges": edges}
-
-def graph_to_json():
-    with graph_lock:
-        before_data = serialize_graph(Master_Graph)
-        after_data = serialize_graph(SDN_Graph)
-    return json.dumps({"before": before_data, "after": after_data})
+    rssi_val = d.get('rssi')
+    label_text = f"{rssi_val}dBm\nC: {cost}" if not is_v else f"VIRTUAL\nC: {cost}"
+    
+    # Color Logic:
+    # - AI Optimized & Parent: SPRING GREEN (#00FF7F)
+    # - Regular Parent: RED
+    # - Non-parent: GRAY
+    edge_color = "#00FF7F" if is_ai else ("#ff4d4d" if is_p else "gray")
+    
+    return {
+        "id": GraphStore.edge_id(u, v), "from": u, "to": v, "label": label_text, 
+        "width": 3 if is_p else 1, "dashes": not is_p, 
+        "color": edge_color, "physics": is_p
+    }
+
+# [NEW] Trạng thái dashboard có version: bản vá mỗi chu kỳ, snapshot khi kết nối / lệch version
+graph_store = GraphStore(("before", "after"), serialize_node, serialize_edge)
 
 @app.get("/")
 async def get_dashboard():
@@ -695,7 +1045,7 @@ async def get_dashboard():
 async def websocket_endpoint(websocket: WebSocket):
     await websocket.accept()
     ws_clients.add(websocket)
-    await websocket.send_text(latest_graph_json if latest_graph_json else graph_to_json())
+    graph_sub = graph_store.subscribe()  # Tin đầu tiên là snapshot đầy đủ
     
     async def listen_for_commands():
         try:
@@ -703,16 +1053,18 @@ async def websocket_endpoint(websocket: WebSocket):
                 data = await websocket.receive_text()
                 cmd = json.loads(data)
                 target, action, led = cmd.get("target"), cmd.get("action"), cmd.get("led")
-                if action == "toggle":
-                    send_uart_command(f"mesh backprop {target} {led}")
+                if action == "resync":
+                    graph_sub.resync()  # [NEW] Client lỡ bản vá (lệch version) -> snapshot
+                elif action == "toggle":
+                    await send_backprop(target, led)
                 elif action == "identify":
-                    send_uart_command(f"mesh attention {target}")
+                    await send_uart_command(f"mesh attention {target}")
                 elif action == "set_sensor_interval":
                     interval = cmd.get("interval", 20)
                     try:
                         interval = int(interval)
                         if 1 <= interval <= 65535:
-                            send_uart_command(f"mesh sensor_interval {target} {interval}")
+                            await send_uart_command(f"mesh sensor_interval {target} {interval}")
                         else:
                             print(f"[WS] Invalid interval={interval}, must be 1-65535")
                     except (ValueError, TypeError):
@@ -720,29 +1072,46 @@ async def websocket_endpoint(websocket: WebSocket):
         except: pass
 
     async def broadcast_graph():
-        last_sent = ""
+        # [UPD] Đẩy ngay khi graph_store có bản vá, không poll latest_graph_json mỗi 0.5 s
         try:
             while True:
-                if latest_graph_json != last_sent and latest_graph_json != "":
-                    await websocket.send_text(latest_graph_json)
-                    last_sent = latest_graph_json
-                await asyncio.sleep(0.5)
+                await websocket.send_text(await graph_sub.next())
         except: pass
 
-    await asyncio.gather(listen_for_commands(), broadcast_graph())
+    # Một phía kết thúc (client ngắt / gửi lỗi) -> dừng phía còn lại
+    tasks = [asyncio.ensure_future(listen_for_commands()), asyncio.ensure_future(broadcast_graph())]
+    await asyncio.wait(tasks, return_when=asyncio.FIRST_COMPLETED)
+    for t in tasks:
+        t.cancel()
+    graph_store.unsubscribe(graph_sub)
     ws_clients.remove(websocket)
 
+async def gateway_main():
+    """[NEW] Một vòng asyncio cho cả Gateway: UART (sink_link), lịch poll, backup CSV và
+    uvicorn chạy chung; dừng uvicorn (Ctrl+C) thì hủy các task còn lại."""
+    global sink_link
+    sink_link = SinkLink(global_ser, dispatch_line)
+    tasks = [asyncio.create_task(sink_link.run())]
+    await send_uart_command(f"mesh uart_mode {'bin' if SINK_UART_BINARY else 'text'}")
+    tasks += [asyncio.create_task(poll_scheduler()), asyncio.create_task(backup_csv_task())]
+
+    server = uvicorn.Server(uvicorn.Config(app, host="0.0.0.0", port=8000, log_level="warning"))
+    try:
+        await server.serve()
+    finally:
+        for t in tasks + list(background_tasks):
+            t.cancel()
+        await asyncio.gather(*tasks, return_exceptions=True)
+
 if __name__ == "__main__":
+    start_sdn_optimizer()  # Fork worker trước khi mở cổng serial / có luồng nào khác
     init_serial() 
-    threading.Thread(target=uart_reader_thread, daemon=True).start()
-    threading.Thread(target=data_processor_thread, daemon=True).start()
-    threading.Thread(target=stress_processor_thread, daemon=True).start()
-    threading.Thread(target=backup_csv_thread, daemon=True).start()
     try:
-        uvicorn.run(app, host="0.0.0.0", port=8000, log_level="warning")
+        asyncio.run(gateway_main())
     except KeyboardInterrupt:
         print("\n[Hệ Thống] Đang dừng Gateway...")
     finally:
+        sdn_optimizer.shutdown()
         # Ghi nhận số gói tin điều khiển vào cuối file Topo Log trước khi thoát
         if total_control_packets > 0:
             try:
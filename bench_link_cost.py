@@ -0,0 +1,94 @@
+"""
+Benchmark tính routing cost AI mỗi chu kỳ poll theo số link:
+predict từng link (ma trận 1x10, cách cũ, x2 cho SDN_Graph + CSV) vs LinkCostEngine
+(một ma trận, một lần predict; logger đọc lại dict cost của chu kỳ).
+
+Feature tổng hợp lấy ngẫu nhiên trong miền feature_infos của model. Cần lightgbm và
+ml_training/routing_cost_model.txt. Chạy:
+    python bench_link_cost.py                  # 50, 100, 300, 1000, 3000 link
+    python bench_link_cost.py 300 5000 --model path/to/model.txt
+"""
+import argparse
+import os
+import random
+import time
+
+import numpy as np
+
+from link_cost import LinkCostEngine, link_features
+
+DEFAULT_MODEL = os.path.join(os.path.dirname(__file__), 'ml_training', 'routing_cost_model.txt')
+NB_PER_NODE = 8
+
+
+def make_links(n_links, seed=1):
+    """[(node, neighbor, features)] kiểu một chu kỳ: NB_PER_NODE link mỗi node."""
+    rnd = random.Random(seed)
+    links = []
+    n_nodes = max(1, n_links // NB_PER_NODE)
+    for i in range(n_nodes):
+        node = f"{i + 3:04X}"
+        grad, drp, fwd = rnd.randint(1, 3), rnd.randint(0, 53), rnd.randint(1, 198)
+        drop_rate = round(drp / (drp + fwd) * 100.0, 1)
+        pin = round(rnd.uniform(5, 100), 1)
+        count = min(NB_PER_NODE, n_links - len(links))
+        for k in range(count):
+            links.append((node, f"{(i + k + 1) % (n_nodes + NB_PER_NODE) + 3:04X}", link_features(
+                grad, rnd.randint(-90, -41), rnd.randint(0, 4680), drop_rate, pin,
+                drp, fwd, count)))
+    return links
+
+
+def per_link_cycle(model, links):
+    """Logic cũ: predict riêng từng link, một lần cho SDN_Graph và một lần cho CSV."""
+    out = {}
+    for _ in range(2):
+        for node, nb, f in links:
+            out[(node, nb)] = round(float(model.predict(np.array([f]))[0]), 2)
+    return out
+
+
+def batched_cycle(model, links):
+    """Chu kỳ mới: SDN predict một lần, logger đọc lại chính dict kết quả."""
+    return LinkCostEngine(model).costs(links)
+
+
+def timed(fn, *args, repeat=3):
+    best, out = float('inf'), None
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        out = fn(*args)
+        best = min(best, time.perf_counter() - t0)
+    return best, out
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("sizes", nargs="*", type=int, default=[50, 100, 300, 1000, 3000])
+    ap.add_argument("--model", default=DEFAULT_MODEL)
+    ap.add_argument("--per-link-max", type=int, default=3000,
+                    help="Bỏ qua cách cũ khi số link lớn hơn (rất chậm)")
+    args = ap.parse_args()
+
+    try:
+        import lightgbm as lgb
+    except ImportError:
+        print("Cần lightgbm để chạy benchmark (pip install lightgbm)")
+        return
+    model = lgb.Booster(model_file=args.model)
+
+    print(f"{'links':>6} {'per-link (ms)':>14} {'batched (ms)':>13} {'speedup':>8}")
+    for n in args.sizes:
+        links = make_links(n)
+        t_new, new = timed(batched_cycle, model, links)
+        if n <= args.per_link_max:
+            t_old, old = timed(per_link_cycle, model, links, repeat=1)
+            assert old == new  # Cùng model, cùng làm tròn -> cùng cost
+            old_s, speed = f"{t_old * 1000:.1f}", f"{t_old / t_new:.0f}x"
+        else:
+            old_s, speed = "-", "-"
+        print(f"{n:>6} {old_s:>14} {t_new * 1000:>13.2f} {speed:>8}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,164 @@
+"""
+Benchmark bộ tối ưu SDN: shortest_path từng node (cách cũ) vs một SPT ngược từ Gateway,
+và SPT tăng dần (DynamicSPT) khi mỗi chu kỳ chỉ vài node đổi cost.
+
+Đồ thị tổng hợp: node rải ngẫu nhiên trên mặt phẳng, cạnh hai chiều giữa các node trong
+tầm radio, cost kiểu heuristic (hop + RSSI). Chạy:
+    python bench_sdn_spt.py                 # 100, 500, 2000 node
+    python bench_sdn_spt.py 100 500 --legacy-max 2000
+    python bench_sdn_spt.py --changes 10     # số node đổi cost mỗi chu kỳ (phần tăng dần)
+"""
+import argparse
+import math
+import random
+import time
+
+import networkx as nx
+
+from sdn_spt import DynamicSPT, reverse_spt_parents, reported_parents, mark_parents, parent_delta
+
+GATEWAY_NODE = "0002"
+AVG_DEGREE = 8
+
+
+def make_graph(n, seed=1):
+    rnd = random.Random(seed)
+    names = [GATEWAY_NODE] + [f"{i:04X}" for i in range(3, n + 2)]
+    pos = {name: (rnd.random(), rnd.random()) for name in names}
+    pos[GATEWAY_NODE] = (0.5, 0.5)
+    radius = math.sqrt(AVG_DEGREE / (math.pi * n))
+    g = nx.random_geometric_graph(names, radius, pos=pos, seed=seed)
+    # Nối các thành phần rời về Gateway để mọi node có đường đi
+    comps = list(nx.connected_components(g))
+    for comp in comps[1:]:
+        g.add_edge(next(iter(comp)), GATEWAY_NODE)
+
+    dg = nx.DiGraph()
+    hops = nx.single_source_shortest_path_length(g, GATEWAY_NODE)
+    for u, v in g.edges:
+        d = math.dist(pos[u], pos[v]) / radius
+        rssi = -50 - 45 * d
+        for a, b in ((u, v), (v, u)):
+            cost = hops[a] * 10.0 + max(0.0, -rssi - 70.0) * 2.5 + rnd.uniform(0, 20)
+            dg.add_edge(a, b, cost=round(cost, 2), is_parent=False)
+    # Parent "thực tế": neighbor có hop nhỏ nhất (như gradient routing)
+    for node in dg.nodes:
+        if node == GATEWAY_NODE:
+            continue
+        best = min(dg[node], key=lambda v: (hops[v], v))
+        dg[node][best]['is_parent'] = True
+    return dg
+
+
+def legacy_cycle(master):
+    """Bản sao logic cũ của reconcile_master_graph(): Dijkstra + quét cạnh từng node."""
+    sdn = master.copy()
+    for node in list(sdn.nodes):
+        if node == GATEWAY_NODE:
+            continue
+        try:
+            path = nx.shortest_path(sdn, source=node, target=GATEWAY_NODE, weight='cost')
+            best_parent = path[1] if len(path) > 1 else None
+            for u, v, d in sdn.edges(data=True):
+                if u == node:
+                    sdn[u][v]['is_parent'] = (v == best_parent)
+        except nx.NetworkXNoPath:
+            pass
+    delta = []
+    for node in sdn.nodes:
+        if node == GATEWAY_NODE:
+            continue
+        ai_parent = next((v for u, v, d in sdn.edges(data=True)
+                          if u == node and d.get('is_parent', False)), None)
+        actual = next((v for u, v, d in master.edges(data=True)
+                       if u == node and d.get('is_parent', False)), None)
+        if ai_parent and actual and ai_parent != actual:
+            delta.append((node, ai_parent))
+    return sdn, delta
+
+
+def spt_cycle(master):
+    sdn = master.copy()
+    actual = reported_parents(master)
+    ai, dist = reverse_spt_parents(sdn, GATEWAY_NODE)
+    mark_parents(sdn, ai)
+    return sdn, parent_delta(ai, actual, GATEWAY_NODE), dist
+
+
+def timed(fn, *args, repeat=3):
+    best, out = float('inf'), None
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        out = fn(*args)
+        best = min(best, time.perf_counter() - t0)
+    return best, out
+
+
+def check_optimal(sdn, dist):
+    """Mọi parent SPT phải nằm trên một đường ngắn nhất (tie có thể khác cách cũ)."""
+    for node, parent in reported_parents(sdn).items():
+        if node in dist and parent in dist:
+            assert math.isclose(dist[parent] + sdn[node][parent]['cost'], dist[node],
+                                rel_tol=1e-9, abs_tol=1e-6), node
+
+
+def incremental_run(g, changes, cycles=20, seed=2):
+    """Mỗi chu kỳ `changes` node báo cáo cost mới (±30%): DynamicSPT vs SPT tính lại từ đầu."""
+    rnd = random.Random(seed)
+    eng = DynamicSPT(GATEWAY_NODE)
+    for node in g.nodes:
+        if node != GATEWAY_NODE:
+            eng.update_node(node, {v: d['cost'] for v, d in g[node].items()})
+    nodes = [n for n in g.nodes if n != GATEWAY_NODE]
+    t_inc = t_full = 0.0
+    touched = 0
+    for _ in range(cycles):
+        batch = []
+        for node in rnd.sample(nodes, min(changes, len(nodes))):
+            for v, d in g[node].items():
+                d['cost'] = round(d['cost'] * rnd.uniform(0.7, 1.3), 2)
+            batch.append((node, {v: d['cost'] for v, d in g[node].items()}))
+        t0 = time.perf_counter()
+        for node, costs in batch:
+            eng.update_node(node, costs)
+            touched += eng.touched
+        t_inc += time.perf_counter() - t0
+        t0 = time.perf_counter()
+        _, dist = reverse_spt_parents(g, GATEWAY_NODE)
+        t_full += time.perf_counter() - t0
+        for n, d in dist.items():
+            assert math.isclose(eng.dist[n], d, rel_tol=1e-9, abs_tol=1e-6), n
+    return t_inc / cycles, t_full / cycles, touched / cycles
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("sizes", nargs="*", type=int, default=[100, 500, 2000])
+    ap.add_argument("--legacy-max", type=int, default=500,
+                    help="Bỏ qua cách cũ với đồ thị lớn hơn (O(N·E), rất chậm)")
+    ap.add_argument("--changes", type=int, default=5,
+                    help="Số node đổi cost mỗi chu kỳ cho phần SPT tăng dần")
+    args = ap.parse_args()
+
+    print(f"{'N':>6} {'E':>7} {'legacy (s)':>11} {'SPT (s)':>9} {'speedup':>8} {'delta':>6}")
+    for n in args.sizes:
+        g = make_graph(n)
+        t_spt, (sdn, delta, dist) = timed(spt_cycle, g)
+        check_optimal(sdn, dist)
+        if n <= args.legacy_max:
+            t_old, (sdn_old, _) = timed(legacy_cycle, g, repeat=1)
+            check_optimal(sdn_old, dist)  # Hai cách cho cùng tổng cost
+            old_s, speed = f"{t_old:.3f}", f"{t_old / t_spt:.0f}x"
+        else:
+            old_s, speed = "-", "-"
+        print(f"{n:>6} {g.number_of_edges():>7} {old_s:>11} {t_spt:>9.4f} {speed:>8} {len(delta):>6}")
+
+    print(f"\nSPT tăng dần, {args.changes} node đổi cost / chu kỳ:")
+    print(f"{'N':>6} {'full SPT (s)':>13} {'dynamic (s)':>12} {'node duyệt':>11}")
+    for n in args.sizes:
+        t_inc, t_full, touched = incremental_run(make_graph(n), args.changes)
+        print(f"{n:>6} {t_full:>13.4f} {t_inc:>12.5f} {touched:>11.0f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,367 @@
+"""
+Model routing cost biên dịch trước (AOT) cho Gateway.
+
+`python cost_model.py [ml_training/routing_cost_model.txt]` đọc bản dump text của
+LightGBM, sinh C (mỗi cây một hàm if/else lồng nhau, ngưỡng và giá trị lá ghi dạng
+hex float nên không lệch bit nào), rồi build thành thư viện chia sẻ cạnh file model
+(routing_cost_model.c / .so). Gateway nạp .so qua ctypes: không cần import lightgbm
+(chậm trên Pi), mỗi lần predict chỉ còn một lời gọi C.
+
+Kết quả bit-identical với Booster.predict: cùng phép so sánh double `x <= threshold`,
+cùng xử lý missing (decision_type), cộng dồn lá theo đúng thứ tự cây từ 0.0.
+Khi có lightgbm, script kiểm tra lại trên dữ liệu ngẫu nhiên + dữ liệu training.
+
+load_cost_model() dùng .so nếu có và khớp sha256 của file text; nếu thiếu / lệch thì
+fallback về lightgbm.Booster như trước.
+"""
+import argparse
+import csv
+import ctypes
+import hashlib
+import os
+import subprocess
+import sys
+import time
+
+import numpy as np
+
+SHLIB_EXT = '.dll' if os.name == 'nt' else '.so'
+
+# Hằng số / bit của LightGBM (include/LightGBM/tree.h, meta.h)
+K_ZERO_THRESHOLD = 1e-35
+CATEGORICAL_MASK = 1
+DEFAULT_LEFT_MASK = 2
+MISSING_NONE, MISSING_ZERO, MISSING_NAN = 0, 1, 2
+
+# Objective có output = raw score (không sigmoid / exp)
+IDENTITY_OBJECTIVES = {'regression', 'regression_l1', 'huber', 'fair', 'quantile', 'mape'}
+
+
+class ModelCompileError(Exception):
+    pass
+
+
+# ------------------------------------------
+# PARSE + SINH C
+# ------------------------------------------
+def parse_model(text):
+    """Trả về (header, trees) từ bản dump text; mỗi tree là dict các mảng."""
+    header, trees, cur = {}, [], None
+    for line in text.splitlines():
+        line = line.strip()
+        if line == 'end of trees':
+            break
+        if line.startswith('Tree='):
+            cur = {}
+            trees.append(cur)
+            continue
+        if '=' not in line:
+            continue
+        key, val = line.split('=', 1)
+        (header if cur is None else cur)[key] = val
+
+    for t in trees:
+        if int(t.get('num_cat', 0)) > 0:
+            raise ModelCompileError("split categorical chưa được hỗ trợ")
+        if int(t.get('is_linear', 0)):
+            raise ModelCompileError("linear tree chưa được hỗ trợ")
+        t['num_leaves'] = int(t['num_leaves'])
+        t['leaf_value'] = [float(v) for v in t['leaf_value'].split()]
+        if t['num_leaves'] > 1:
+            t['split_feature'] = [int(v) for v in t['split_feature'].split()]
+            t['threshold'] = [float(v) for v in t['threshold'].split()]
+            t['decision_type'] = [int(v) for v in t['decision_type'].split()]
+            t['left_child'] = [int(v) for v in t['left_child'].split()]
+            t['right_child'] = [int(v) for v in t['right_child'].split()]
+    return header, trees
+
+
+def _check_header(header):
+    objective = header.get('objective', '').split()[0] if header.get('objective') else ''
+    if objective not in IDENTITY_OBJECTIVES:
+        raise ModelCompileError(f"objective '{objective}' cần transform output, chưa hỗ trợ")
+    if int(header.get('num_tree_per_iteration', 1)) != 1 or int(header.get('num_class', 1)) != 1:
+        raise ModelCompileError("chỉ hỗ trợ model một output")
+    if 'average_output' in header:
+        raise ModelCompileError("average_output (random forest) chưa hỗ trợ")
+
+
+def _decision(node, t):
+    f = t['split_feature'][node]
+    thr = t['threshold'][node].hex()
+    dt = t['decision_type'][node]
+    if dt & CATEGORICAL_MASK:
+        raise ModelCompileError("split categorical chưa được hỗ trợ")
+    missing = (dt >> 2) & 3
+    default_left = 1 if dt & DEFAULT_LEFT_MASK else 0
+    if missing == MISSING_ZERO:
+        return f"dec_zero(x[{f}], {thr}, {default_left})"
+    if missing == MISSING_NAN:
+        return f"dec_nan(x[{f}], {thr}, {default_left})"
+    return f"dec_none(x[{f}], {thr})"
+
+
+def _emit_tree(out, idx, t):
+    out.append(f"static double tree_{idx}(const double *x)\n{{")
+    if t['num_leaves'] == 1:
+        out.append(f"    return {t['leaf_value'][0].hex()};\n}}\n")
+        return
+
+    def walk(child, depth):
+        pad = '    ' * depth
+        if child < 0:
+            out.append(f"{pad}return {t['leaf_value'][~child].hex()};")
+            return
+        out.append(f"{pad}if ({_decision(child, t)}) {{")
+        walk(t['left_child'][child], depth + 1)
+        out.append(f"{pad}}} else {{")
+        walk(t['right_child'][child], depth + 1)
+        out.append(f"{pad}}}")
+
+    walk(0, 1)
+    out.append("}\n")
+
+
+def generate_c(text):
+    header, trees = parse_model(text)
+    _check_header(header)
+    n_features = int(header['max_feature_idx']) + 1
+    sha = hashlib.sha256(text.encode('utf-8')).hexdigest()
+
+    out = [
+        "/* Sinh tự động bởi cost_model.py từ bản dump LightGBM - không sửa tay. */",
+        "#include <math.h>",
+        "#include <stddef.h>",
+        "",
+        f"#define N_FEATURES {n_features}",
+        f"#define N_TREES {len(trees)}",
+        "",
+        "/* NumericalDecision() của LightGBM (x đã qua bước zero-threshold) */",
+        "static inline int dec_none(double v, double t)",
+        "{",
+        "    if (isnan(v)) v = 0.0;",
+        "    return v <= t;",
+        "}",
+        "",
+        "static inline int dec_zero(double v, double t, int default_left)",
+        "{",
+        "    if (isnan(v)) v = 0.0;",
+        "    if (v == 0.0) return default_left;",
+        "    return v <= t;",
+        "}",
+        "",
+        "static inline int dec_nan(double v, double t, int default_left)",
+        "{",
+        "    if (isnan(v)) return default_left;",
+        "    return v <= t;",
+        "}",
+        "",
+    ]
+    for i, t in enumerate(trees):
+        _emit_tree(out, i, t)
+    out += [
+        f'const char *cost_model_sha256(void) {{ return "{sha}"; }}',
+        "int cost_model_num_features(void) { return N_FEATURES; }",
+        "",
+        "/* x: n_rows x n_cols (row-major, n_cols >= N_FEATURES); out: n_rows */",
+        "void cost_model_predict(const double *x, size_t n_rows, size_t n_cols, double *out)",
+        "{",
+        "    double row[N_FEATURES];",
+        "",
+        "    for (size_t r = 0; r < n_rows; r++) {",
+        "        const double *src = x + r * n_cols;",
+        "        double sum = 0.0;",
+        "",
+        "        /* Predictor của LightGBM bỏ giá trị |v| <= kZeroThreshold (coi là 0) */",
+        "        for (int j = 0; j < N_FEATURES; j++) {",
+        f"            row[j] = fabs(src[j]) <= {K_ZERO_THRESHOLD.hex()} ? 0.0 : src[j];",
+        "        }",
+    ]
+    out += [f"        sum += tree_{i}(row);" for i in range(len(trees))]
+    out += [
+        "        out[r] = sum;",
+        "    }",
+        "}",
+        "",
+    ]
+    return "\n".join(out), sha, n_features
+
+
+def compile_model(model_txt, cc='cc'):
+    """Sinh <model>.c rồi build <model>.so cạnh file text. Trả về đường dẫn thư viện."""
+    with open(model_txt, encoding='utf-8') as f:
+        text = f.read()
+    c_src, _, _ = generate_c(text)
+    base = os.path.splitext(model_txt)[0]
+    c_path, lib_path = base + '.c', base + SHLIB_EXT
+    with open(c_path, 'w', encoding='utf-8') as f:
+        f.write(c_src)
+    # Không -ffast-math / fp-contract: giữ đúng thứ tự cộng double như LightGBM
+    subprocess.run([cc, '-O2', '-shared', '-fPIC', '-ffp-contract=off',
+                    '-o', lib_path, c_path, '-lm'], check=True)
+    return lib_path
+
+
+# ------------------------------------------
+# RUNTIME
+# ------------------------------------------
+def model_sha256(model_txt):
+    with open(model_txt, 'rb') as f:
+        return hashlib.sha256(f.read().replace(b'\r\n', b'\n')).hexdigest()
+
+
+class CompiledModel:
+    """Model đã biên dịch; predict() cùng giao diện với lightgbm.Booster.predict."""
+
+    def __init__(self, lib_path):
+        self.lib = ctypes.CDLL(os.path.abspath(lib_path))
+        self.lib.cost_model_sha256.restype = ctypes.c_char_p
+        self.lib.cost_model_predict.restype = None
+        self.lib.cost_model_predict.argtypes = [ctypes.c_void_p, ctypes.c_size_t,
+                                                ctypes.c_size_t, ctypes.c_void_p]
+        self.sha256 = self.lib.cost_model_sha256().decode()
+        self.num_features = self.lib.cost_model_num_features()
+        self.path = lib_path
+
+    def predict(self, data):
+        x = np.ascontiguousarray(data, dtype=np.float64)
+        if x.ndim == 1:
+            x = x.reshape(1, -1)
+        if x.shape[1] < self.num_features:
+            raise ValueError(f"cần {self.num_features} feature, nhận {x.shape[1]}")
+        out = np.empty(x.shape[0], dtype=np.float64)
+        self.lib.cost_model_predict(x.ctypes.data, x.shape[0], x.shape[1], out.ctypes.data)
+        return out
+
+
+def load_cost_model(paths):
+    """Nạp model từ danh sách file text. Ưu tiên bản biên dịch khớp sha256, nếu không
+    có thì fallback lightgbm.Booster. Trả về (model, path, kind) hoặc (None, None, None)."""
+    for path in paths:
+        if not os.path.exists(path):
+            continue
+        lib = os.path.splitext(path)[0] + SHLIB_EXT
+        if os.path.exists(lib):
+            try:
+                model = CompiledModel(lib)
+                if model.sha256 == model_sha256(path):
+                    return model, lib, 'compiled'
+                print(f"[CẢNH BÁO] {lib} không khớp {path} (cần chạy lại cost_model.py)")
+            except OSError as e:
+                print(f"[CẢNH BÁO] Không nạp được {lib}: {e}")
+        try:
+            import lightgbm as lgb
+            return lgb.Booster(model_file=path), path, 'lightgbm'
+        except Exception as e:
+            print(f"[CẢNH BÁO] Lỗi khi load model tại {path}: {e}")
+    return None, None, None
+
+
+# ------------------------------------------
+# KIỂM TRA BIT-IDENTICAL + ĐO THỜI GIAN
+# ------------------------------------------
+def _feature_ranges(header):
+    ranges = []
+    for info in header['feature_infos'].split():
+        lo, hi = info.strip('[]').split(':')
+        ranges.append((float(lo), float(hi)))
+    return ranges
+
+
+def _verify_rows(header, trees, n_random, seed=1):
+    rnd = np.random.default_rng(seed)
+    ranges = _feature_ranges(header)
+    lo = np.array([r[0] for r in ranges])
+    hi = np.array([r[1] for r in ranges])
+    rows = [lo + (hi - lo) * rnd.random((n_random, len(ranges)))]
+    # Đúng ngưỡng split và lân cận 1 ulp: nơi so sánh <= dễ lệch nhất
+    for t in trees:
+        for f, thr in zip(t.get('split_feature', []), t.get('threshold', [])):
+            base = lo + (hi - lo) * rnd.random((3, len(ranges)))
+            base[:, f] = [np.nextafter(thr, -np.inf), thr, np.nextafter(thr, np.inf)]
+            rows.append(base)
+    return np.vstack(rows)
+
+
+def verify(model_txt, lib_path, csv_path=None, n_random=20000):
+    try:
+        import lightgbm as lgb
+    except ImportError:
+        print("[verify] Không có lightgbm: bỏ qua kiểm tra bit-identical")
+        return True
+    with open(model_txt, encoding='utf-8') as f:
+        header, trees = parse_model(f.read())
+    x = _verify_rows(header, trees, n_random)
+    if csv_path and os.path.exists(csv_path):
+        names = header['feature_names'].split()
+        with open(csv_path, newline='', encoding='utf-8') as f:
+            reader = csv.DictReader(f)
+            if all(n in reader.fieldnames for n in names):
+                real = [[float(r[n]) for n in names] for r in reader]
+                if real:
+                    x = np.vstack([x, np.array(real, dtype=np.float64)])
+    ref = lgb.Booster(model_file=model_txt).predict(x)
+    got = CompiledModel(lib_path).predict(x)
+    bad = np.count_nonzero(ref.view(np.uint64) != got.view(np.uint64))
+    print(f"[verify] {len(x)} hàng, {bad} lệch bit")
+    return bad == 0
+
+
+def _load_time(stmt):
+    """Thời gian import + nạp model trong một tiến trình Python mới (ms). numpy được import
+    trước khi bấm giờ vì Gateway luôn cần nó."""
+    code = ("import time, numpy; t0 = time.perf_counter(); " + stmt +
+            "; print((time.perf_counter() - t0) * 1e3)")
+    res = subprocess.run([sys.executable, '-c', code], capture_output=True, text=True,
+                         cwd=os.path.dirname(os.path.abspath(__file__)), check=True)
+    return float(res.stdout.split()[-1])
+
+
+def bench(model_txt, lib_path, n_batch=300, repeat=200):
+    import lightgbm as lgb
+    t_lgb_load = _load_time(f"import lightgbm; lightgbm.Booster(model_file={model_txt!r})")
+    t_c_load = _load_time(f"import cost_model; cost_model.CompiledModel({lib_path!r})")
+    booster = lgb.Booster(model_file=model_txt)
+    compiled = CompiledModel(lib_path)
+
+    x = np.random.default_rng(2).random((n_batch, compiled.num_features)) * 100
+    print(f"{'':<22} {'lightgbm':>12} {'compiled':>12}")
+    print(f"{'import + load (ms)':<22} {t_lgb_load:>12.1f} {t_c_load:>12.1f}")
+    for label, rows in (("predict 1 hàng (us)", x[:1]), (f"predict {n_batch} hàng (us)", x)):
+        times = []
+        for m in (booster, compiled):
+            t0 = time.perf_counter()
+            for _ in range(repeat):
+                m.predict(rows)
+            times.append((time.perf_counter() - t0) / repeat * 1e6)
+        print(f"{label:<22} {times[0]:>12.1f} {times[1]:>12.1f}")
+
+
+def main():
+    default = os.path.join(os.path.dirname(__file__), 'ml_training', 'routing_cost_model.txt')
+    ap = argparse.ArgumentParser(description="Biên dịch model LightGBM (text) thành thư viện C")
+    ap.add_argument("model", nargs="?", default=default)
+    ap.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    ap.add_argument("--csv", default=os.path.join(os.path.dirname(__file__), 'ml_training',
+                                                  'wsn_training_data_ready.csv'),
+                    help="Dữ liệu thật dùng thêm cho bước kiểm tra")
+    ap.add_argument("--no-verify", action="store_true")
+    ap.add_argument("--bench", action="store_true", help="So sánh thời gian nạp / predict với lightgbm")
+    args = ap.parse_args()
+
+    try:
+        lib = compile_model(args.model, args.cc)
+    except (ModelCompileError, subprocess.CalledProcessError, OSError) as e:
+        print(f"[LỖI] Không biên dịch được {args.model}: {e}")
+        sys.exit(1)
+    print(f"[Hệ Thống] Đã biên dịch {args.model} -> {lib}")
+    if not args.no_verify and not verify(args.model, lib, args.csv):
+        os.remove(lib)  # Không để Gateway nạp bản lệch
+        print("[LỖI] Kết quả khác lightgbm, đã xóa thư viện")
+        sys.exit(1)
+    if args.bench:
+        bench(args.model, lib)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,174 @@
+"""
+Kho trạng thái đồ thị có version cho dashboard (websocket /ws).
+
+Mỗi view ("before" = Master_Graph, "after" = SDN_Graph) được giữ ở dạng đã tuần tự hóa
+(dict hiển thị của từng node / cạnh). Mỗi chu kỳ reconcile chỉ các node bị đụng tới
+(`dirty`) được tuần tự hóa và so lại; khác biệt thành một bản vá kiểu JSON-Patch:
+
+    {"type": "graph_patch", "base": 41, "version": 42, "ops": [
+        {"op": "add" | "replace", "path": "/before/nodes/0005", "value": {...}},
+        {"op": "remove", "path": "/after/edges/0005-0002"}, ...]}
+
+Bản vá được dump JSON MỘT lần rồi đẩy cho mọi client (không poll). Snapshot đầy đủ
+({"type": "graph_snapshot", "version": v, "before": {"nodes": [...], "edges": [...]}, ...})
+chỉ gửi khi client mới kết nối, khi client xin lại (lệch version) hoặc khi client quá chậm
+để hàng đợi của nó tràn; snapshot được cache theo version.
+"""
+import asyncio
+import json
+from collections import deque
+
+
+def _ptr(token):
+    """Escape một token JSON Pointer (RFC 6901)."""
+    return str(token).replace("~", "~0").replace("/", "~1")
+
+
+class GraphView:
+    def __init__(self):
+        self.nodes = {}   # node id -> dict hiển thị
+        self.edges = {}   # edge id -> dict hiển thị
+        self.ends = {}    # edge id -> (u, v)
+        self.out = {}     # node -> {edge id} cạnh ra
+        self.inc = {}     # node -> {edge id} cạnh vào
+
+
+class GraphSubscriber:
+    """Hàng đợi bản vá của một client websocket."""
+
+    def __init__(self, store, max_pending):
+        self.store = store
+        self.max_pending = max_pending
+        self.pending = deque()
+        self.wakeup = asyncio.Event()
+        self.need_snapshot = True
+
+    def push(self, msg):
+        if len(self.pending) >= self.max_pending:
+            # Client không theo kịp: bỏ các bản vá, lần sau gửi snapshot
+            self.resync()
+            return
+        self.pending.append(msg)
+        self.wakeup.set()
+
+    def resync(self):
+        self.pending.clear()
+        self.need_snapshot = True
+        self.wakeup.set()
+
+    async def next(self):
+        """Tin nhắn kế tiếp cần gửi (chờ tới khi có)."""
+        while True:
+            if self.need_snapshot:
+                self.need_snapshot = False
+                self.pending.clear()  # Snapshot đã gồm mọi bản vá tới version hiện tại
+                self.store.stats["snapshots"] += 1
+                return self.store.snapshot_json()
+            if self.pending:
+                return self.pending.popleft()
+            self.wakeup.clear()
+            await self.wakeup.wait()
+
+
+class GraphStore:
+    def __init__(self, views, serialize_node, serialize_edge, max_pending=32):
+        self.views = {name: GraphView() for name in views}
+        self.serialize_node = serialize_node   # (node, attrs) -> dict
+        self.serialize_edge = serialize_edge   # (u, v, attrs) -> dict
+        self.max_pending = max_pending
+        self.version = 0
+        self.subscribers = set()
+        self._snapshot = (None, None)
+        self.stats = {"patches": 0, "ops": 0, "patch_bytes": 0, "snapshots": 0}
+
+    @staticmethod
+    def edge_id(u, v):
+        return f"{u}-{v}"  # Khớp id mặc định của cạnh trong index.html
+
+    # ---------------- Diff ----------------
+    def _put(self, ops, table, path, key, value):
+        old = table.get(key)
+        if old == value:
+            return
+        table[key] = value
+        ops.append({"op": "add" if old is None else "replace", "path": path, "value": value})
+
+    def _remove_edge(self, ops, name, view, eid):
+        u, v = view.ends.pop(eid)
+        del view.edges[eid]
+        view.out[u].discard(eid)
+        view.inc[v].discard(eid)
+        ops.append({"op": "remove", "path": f"/{name}/edges/{_ptr(eid)}"})
+
+    def _put_node(self, ops, name, view, graph, n):
+        self._put(ops, view.nodes, f"/{name}/nodes/{_ptr(n)}", n,
+                  self.serialize_node(n, graph.nodes[n]))
+        view.out.setdefault(n, set())
+        view.inc.setdefault(n, set())
+
+    def _diff_view(self, ops, name, view, graph, dirty):
+        if dirty is None:
+            dirty = set(graph.nodes) | set(view.nodes)
+        for n in dirty:
+            if n not in graph:
+                if n in view.nodes:
+                    for eid in list(view.out.get(n, ())) + list(view.inc.get(n, ())):
+                        if eid in view.edges:
+                            self._remove_edge(ops, name, view, eid)
+                    del view.nodes[n]
+                    view.out.pop(n, None)
+                    view.inc.pop(n, None)
+                    ops.append({"op": "remove", "path": f"/{name}/nodes/{_ptr(n)}"})
+                continue
+
+            self._put_node(ops, name, view, graph, n)
+            seen = set()
+            for v, d in graph[n].items():
+                if v not in view.nodes:
+                    self._put_node(ops, name, view, graph, v)  # node chỉ xuất hiện như neighbor
+                eid = self.edge_id(n, v)
+                seen.add(eid)
+                self._put(ops, view.edges, f"/{name}/edges/{_ptr(eid)}", eid,
+                          self.serialize_edge(n, v, d))
+                view.ends[eid] = (n, v)
+                view.out[n].add(eid)
+                view.inc[v].add(eid)
+            for eid in view.out[n] - seen:
+                self._remove_edge(ops, name, view, eid)
+
+    def update(self, graphs, dirty=None):
+        """graphs = {view: nx graph}; dirty = node cần so lại (None = cả đồ thị).
+        Node đã bị xóa khỏi graph phải nằm trong dirty. Trả về số op của bản vá."""
+        ops = []
+        for name, graph in graphs.items():
+            self._diff_view(ops, name, self.views[name], graph, dirty)
+        if not ops:
+            return 0
+        self.version += 1
+        msg = json.dumps({"type": "graph_patch", "base": self.version - 1,
+                          "version": self.version, "ops": ops})
+        self.stats["patches"] += 1
+        self.stats["ops"] += len(ops)
+        self.stats["patch_bytes"] += len(msg)
+        for sub in self.subscribers:
+            sub.push(msg)
+        return len(ops)
+
+    # ---------------- Client ----------------
+    def snapshot_json(self):
+        version, msg = self._snapshot
+        if version != self.version:
+            doc = {"type": "graph_snapshot", "version": self.version}
+            for name, view in self.views.items():
+                doc[name] = {"nodes": list(view.nodes.values()), "edges": list(view.edges.values())}
+            msg = json.dumps(doc)
+            self._snapshot = (self.version, msg)
+        return msg
+
+    def subscribe(self):
+        sub = GraphSubscriber(self, self.max_pending)
+        self.subscribers.add(sub)
+        return sub
+
+    def unsubscribe(self, sub):
+        self.subscribers.discard(sub)
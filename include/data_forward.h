@@ -53,8 +53,19 @@ int data_forward_send_direct(struct bt_mesh_gradient_srv *gradient_srv,
                              uint16_t addr, uint16_t data, 
                              int8_t initial_rssi);
 
-const neighbor_entry_t *find_strict_upstream_parent(
-    struct bt_mesh_gradient_srv *srv, uint16_t exclude_addr);
+/**
+ * @brief Uplink next hop for a flow: a live SDN flow rule for
+ *        (flow_src, flow_class) if its next hop is a neighbor, otherwise the
+ *        best neighbor with a strictly lower gradient.
+ *
+ * Lock-free: reads the published forwarding table view.
+ *
+ * @param out Optional copy of the chosen neighbor entry
+ * @return Parent address, BT_MESH_ADDR_UNASSIGNED if none
+ */
+uint16_t find_strict_upstream_parent(
+    struct bt_mesh_gradient_srv *srv, uint16_t exclude_addr,
+    uint16_t flow_src, uint8_t flow_class, neighbor_entry_t *out);
 
 #ifdef __cplusplus
 }
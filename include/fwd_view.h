@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file fwd_view.h
+ * @brief Double-buffered, read-mostly view of the forwarding table
+ *
+ * The forwarding table (neighbors + reverse routes) stays owned by its
+ * writers under forwarding_table_mutex. After every change a writer
+ * flattens it into the inactive buffer and swaps the published index.
+ * RX-path readers (parent selection, topology snapshot, BACKPROP lookup)
+ * pin the current buffer with an atomic reader count and never block:
+ *
+ *   view = fwd_view_acquire(pub);   ... scan view ...   fwd_view_release(pub, view);
+ *
+ * A writer only waits for readers still pinned on the buffer it is about
+ * to overwrite, i.e. the view published two versions ago.
+ */
+
+#ifndef FWD_VIEW_H__
+#define FWD_VIEW_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include "gradient_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** One reverse route run [lo..hi] (or a single moved-node exception) */
+struct fwd_view_route {
+    uint16_t lo;
+    uint16_t hi;
+    uint16_t nexthop;
+    bool moved;
+};
+
+struct fwd_view {
+    uint32_t version;
+    uint8_t nb_count;        /**< Valid entries in nb[], table order */
+    bool routes_truncated;   /**< RRT had more runs than routes[] holds */
+    uint16_t route_count;
+    neighbor_entry_t nb[CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE]; /**< backprop_dest = NULL */
+    struct fwd_view_route routes[CONFIG_BT_MESH_GRADIENT_SRV_FWD_VIEW_ROUTES];
+};
+
+struct fwd_view_pub {
+    struct fwd_view buf[2];
+    atomic_t cur;            /**< Index of the published buffer */
+    atomic_t readers[2];     /**< Readers pinned on each buffer */
+};
+
+void fwd_view_init(struct fwd_view_pub *pub);
+
+/**
+ * @brief Publish a new view of @p table
+ *
+ * Caller holds forwarding_table_mutex (writers are serialized by it).
+ * May sleep while a reader is still pinned on the inactive buffer.
+ */
+void fwd_view_publish(struct fwd_view_pub *pub, const neighbor_entry_t *table,
+                      size_t table_size);
+
+/** @brief Pin the current view (wait-free unless a swap races the pin) */
+const struct fwd_view *fwd_view_acquire(struct fwd_view_pub *pub);
+
+void fwd_view_release(struct fwd_view_pub *pub, const struct fwd_view *view);
+
+/** @return Neighbor entry in the view, or NULL */
+const neighbor_entry_t *fwd_view_find_neighbor(const struct fwd_view *view,
+                                               uint16_t addr);
+
+/**
+ * @brief Same lookup as rrt_find_nexthop() on the view:
+ *        direct neighbor > moved exception > run
+ * @return Nexthop, or 0 if not found (check routes_truncated)
+ */
+uint16_t fwd_view_find_nexthop(const struct fwd_view *view, uint16_t dest_addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FWD_VIEW_H__ */
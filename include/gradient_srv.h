@@ -4,6 +4,8 @@
 #include <zephyr/bluetooth/mesh.h>
 #include <bluetooth/mesh/model_types.h>
 #include "gradient_types.h"
+#include "sdn_flow.h"
+#include "fwd_view.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -69,8 +71,10 @@ extern "C" {
 
 /* [NEW] Sensor Interval opcode — Gateway → Node (unicast or broadcast) */
 /* Sets the periodic SENSOR_DATA transmission interval for a target node.  */
-/* Payload: dest_addr(2B LE) + interval_sec(2B LE) + ttl(1B) = 5 bytes     */
+/* Payload: dest_addr(2B LE) + interval_sec(2B LE) + ttl(1B) + seq(1B)    */
+/*          = 6 bytes                                                      */
 /* dest_addr == 0xFFFF → broadcast to ALL non-sink nodes (no relay needed) */
+/* seq: new per Sink send, so a re-sent interval is flooded again          */
 #define BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL BT_MESH_MODEL_OP_3(0x17, \
                         BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
 
@@ -79,10 +83,54 @@ extern "C" {
 #define BT_MESH_GRADIENT_SRV_OP_SENSOR_DATA     BT_MESH_MODEL_OP_3(0x18, \
                         BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
 
+/* [NEW] Delta Topology Report opcode — Uplink from Node to Sink */
+/* Only neighbors added/removed/changed since the last delivered report */
+#define BT_MESH_GRADIENT_SRV_OP_TOPO_DELTA      BT_MESH_MODEL_OP_3(0x19, \
+                        BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
+
+/* [NEW] Topology Bundle opcode — Relay merges children's TOPO_REP/TOPO_DELTA */
+/* Payload: Count(1B) + Count * [Type(1B) + Len(1B) + Record(Len)]          */
+#define BT_MESH_GRADIENT_SRV_OP_TOPO_BUNDLE     BT_MESH_MODEL_OP_3(0x1A, \
+                        BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
+
+/* [NEW] Aggregated REPORT_ACK — Sink broadcasts which reporters it has     */
+/* Payload: ReqID(1B) + Seq(1B) + BaseAddr(2B LE)                          */
+/*          + Bitmap(1..REPORT_ACK_BITMAP_BYTES)                           */
+/* bit i (LSB first) set = report from BaseAddr + i received               */
+/* Seq changes on every broadcast pass so relays forward the repeats       */
+#define BT_MESH_GRADIENT_SRV_OP_REPORT_ACK_BITMAP BT_MESH_MODEL_OP_3(0x1B, \
+                        BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
+
+/* [NEW] Source-routed BACKPROP (downlink, path chosen by the Gateway)      */
+/* Payload: BACKPROP_DATA fields(11B) + HopCnt(1B) + HopCnt * Addr(2B LE)   */
+/* Hop list = relays still to visit after the receiver; each relay pops one */
+#define BT_MESH_GRADIENT_SRV_OP_BACKPROP_SR     BT_MESH_MODEL_OP_3(0x1C, \
+                        BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
+
+/* [NEW] Multi-destination BACKPROP (downlink, split at branch points)      */
+/* Payload: TTL(1B) + Hops(1B) + TS(4B LE) + MinRSSI(1B) + Count(1B)        */
+/*          + Count * [Dest(2B LE) + Payload(2B LE)]                        */
+#define BT_MESH_GRADIENT_SRV_OP_BACKPROP_MULTI  BT_MESH_MODEL_OP_3(0x1D, \
+                        BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
+
+/* [NEW] SDN flow install (downlink, RRT-routed like BACKPROP_DATA)         */
+/* Payload: Dest(2B LE) + TTL(1B) + Version(1B) + Count(1B)                 */
+/*          + Count * [Src(2B LE) + Class(1B) + NextHop(2B LE) + Life(1B)]  */
+/* Life in minutes (0 = CONFIG_BT_MESH_GRADIENT_SDN_FLOW_LIFETIME_MIN);     */
+/* staged until the next TOPO_REQ commit flag                               */
+#define BT_MESH_GRADIENT_SRV_OP_SDN_FLOW        BT_MESH_MODEL_OP_3(0x1E, \
+                        BT_MESH_GRADIENT_SRV_VENDOR_COMPANY_ID)
+
 #define BT_MESH_GRADIENT_SRV_MSG_MINLEN_MESSAGE  1
 #define BT_MESH_GRADIENT_SRV_MSG_MAXLEN_MESSAGE  64 /* Increased safety margin */
 #define BT_MESH_GRADIENT_SRV_DATA_MSG_LEN        7  /* Src(2)+Data(2)+TTL(1)+Hop(1)+MinRSSI(1) */
 #define BT_MESH_GRADIENT_SRV_BACKPROP_DEFAULT_TTL  10
+#define BT_MESH_GRADIENT_SRV_BACKPROP_LEN          11 /* Dest(2)+Payload(2)+TTL(1)+Hops(1)+TS(4)+MinRSSI(1) */
+#define BT_MESH_GRADIENT_SRV_BACKPROP_SR_HDR_LEN   (BT_MESH_GRADIENT_SRV_BACKPROP_LEN + 1)
+#define BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_HDR_LEN 8
+#define BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_REC_LEN 4
+#define BT_MESH_GRADIENT_SRV_SDN_FLOW_HDR_LEN       5
+#define BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES     6
 
 /** Minimum TTL to forward (drop if TTL <= this value) */
 #define BT_MESH_GRADIENT_SRV_BACKPROP_MIN_TTL      1
@@ -94,6 +142,55 @@ extern "C" {
 #define REPORT_RETRY_TIMEOUT_MS 3000 // Tăng thời gian chờ cơ bản
 #define REPORT_MAX_RETRIES      10   // Tăng số lần thử lại tối đa
 
+/**
+ * @brief [NEW] Reply schedule for Sink-initiated collection rounds
+ *        (TOPO_REQ, REPORT_REQ). Wire: SlotUnits(1) Levels(1) SlotsPerLevel(1).
+ *
+ * Deepest level answers first so relays already hold their children's
+ * records when their own slot comes; inside a level the slot is picked
+ * by an address hash salted with the round ID:
+ *   slot = (levels - grad) * slots_per_level + hash(addr, round) % slots_per_level
+ *   delay = slot * slot_units * COLLECT_WAVE_SLOT_UNIT_MS
+ * Nodes deeper than @c levels share the first level.
+ */
+struct collect_wave {
+  uint8_t slot_units;       /**< Slot length in COLLECT_WAVE_SLOT_UNIT_MS */
+  uint8_t levels;           /**< Deepest gradient given its own level */
+  uint8_t slots_per_level;  /**< Hash slots inside one level */
+};
+
+#define COLLECT_WAVE_LEN          3
+#define COLLECT_WAVE_SLOT_UNIT_MS 10
+
+/**
+ * @brief TTL for a Sink-originated gradient-model broadcast.
+ *        With controlled flooding the message goes one radio hop and
+ *        elected relays carry it further (network layer never relays it).
+ */
+#define BT_MESH_GRADIENT_SRV_BCAST_TTL(legacy_ttl)                   \
+  (IS_ENABLED(CONFIG_BT_MESH_GRADIENT_BCAST_CONTROLLED) ? 0 : (legacy_ttl))
+
+/** Bitmap bytes per REPORT_ACK_BITMAP: 4 + 4 keeps it unsegmented (32 nodes) */
+#define REPORT_ACK_BITMAP_BYTES   4
+#define REPORT_ACK_BITMAP_HDR_LEN 4
+
+/**
+ * @brief [NEW] Sink-side aggregated REPORT_ACK state for one REPORT_REQ round.
+ *        Reporters are acked by periodic bitmap broadcasts instead of one
+ *        RRT unicast each; a reporter that sends again (missed the bitmap)
+ *        gets the old unicast REPORT_ACK.
+ */
+struct sink_report_ack {
+  uint16_t addrs[CONFIG_BT_MESH_REPORT_ACK_MAX_NODES]; /**< Sorted, acked */
+  uint8_t count;
+  uint8_t req_id;                  /**< Round the bitmap belongs to */
+  uint8_t repeats_left;            /**< Broadcasts still due after last change */
+  uint8_t seq;                     /**< Broadcast pass counter (relay dedup) */
+  bool round_open;                 /**< Broadcast REPORT_REQ round in progress */
+  struct k_mutex lock;
+  struct k_work_delayable flush_work;
+};
+
 #ifndef CONFIG_BT_MESH_GRADIENT_SRV_NODE_TIMEOUT_MS
 #define CONFIG_BT_MESH_GRADIENT_SRV_NODE_TIMEOUT_MS 120000  // 120 giây (Publish every 40s)
 #endif
@@ -175,11 +272,66 @@ struct bt_mesh_gradient_srv_handlers {
 /** Maximum neighbors tracked in a single Topology report session */
 #define TOPO_REP_MAX_NEIGHBORS  16
 
-/** Neighbors per page: Header=17B, each neighbor=6B, 4 per page = 41B total */
-#define TOPO_REP_MAX_PER_PAGE   4
+/**
+ * TOPO_REP page layout (dense, see topo_codec.h):
+ *   Origin(2) Seq|Total(1) CurPg|Count(1) Ver(1) Fmt|AddrW-1(1)
+ *   [Grad(1) Parent(2) Drops(2) FwdRate(2) Uptime(4) TotalSent(4)]  page 1 only
+ *   Count * neighbor (AddrW + 16 bits, LSB first, byte padded)
+ */
+#define TOPO_REP_MAX_PER_PAGE   8
+
+/** Bytes before the counters / neighbor bitstream */
+#define TOPO_REP_HDR_LEN        6
+
+/** Route + counter bytes carried by page 1 only */
+#define TOPO_REP_FIRST_PAGE_LEN 15
+
+/** Worst case 32 bits per neighbor (16-bit address delta) */
+#define TOPO_REP_MAX_PAYLOAD    (TOPO_REP_HDR_LEN + TOPO_REP_FIRST_PAGE_LEN + \
+                                 (TOPO_REP_MAX_PER_PAGE * 32 + 7) / 8)
+
+/** Neighbor encoding version (upper nibble of the Fmt|AddrW byte) */
+#define TOPO_CODEC_FORMAT       1
+
+/** TOPO_REQ byte 0: Commit | Full | Wave | - | Seq(4) */
+#define TOPO_REQ_FLAG_COMMIT    0x80
+#define TOPO_REQ_FLAG_FULL      0x40 /**< Every node sends a full snapshot */
+#define TOPO_REQ_FLAG_WAVE      0x20 /**< struct collect_wave follows byte 0 */
+
+/** Max addresses in the TOPO_REQ resync list (after byte 0) */
+#define TOPO_REQ_MAX_RESYNC     8
+
+/** Pass as resync_count to bt_mesh_gradient_srv_send_topo_req() to set FULL */
+#define TOPO_REQ_RESYNC_ALL     0xFF
+
+/**
+ * TOPO_DELTA layout:
+ *   Origin(2) SeqFlags(1) BaseVer(1) Ver(1) N_Upd(1) N_Rem(1) Fmt|AddrW-1(1)
+ *   [Grad(1) Parent(2)]                            if TOPO_DELTA_FLAG_ROUTE
+ *   [Drops(2) FwdRate(2) Uptime(4) TotalSent(4)]   if TOPO_DELTA_FLAG_COUNTERS
+ *   bitstream: N_Upd * neighbor (as TOPO_REP)  then  N_Rem * addr (AddrW bits)
+ * SeqFlags = Seq(4 bits cao) | flags(4 bits thấp).
+ * A stable node with nothing to report (8 bytes + 3-byte opcode) fits in one
+ * unsegmented access PDU and is sent without send_rel (TOPO_SEND_REL()).
+ */
+/** Largest access PDU (opcode + params) sent unsegmented, 32-bit TransMIC */
+#define TOPO_UNSEG_MAX_LEN       11
+
+/** send_rel only when the message is segmented anyway: forcing it on a short
+ * message turns one unsegmented PDU into a segment + BlockAck exchange.
+ * A lost unsegmented delta shows up as a version gap and is resynced. */
+#define TOPO_SEND_REL(msg)       ((msg)->len > TOPO_UNSEG_MAX_LEN)
+
+#define TOPO_DELTA_FLAG_ROUTE    0x01
+#define TOPO_DELTA_FLAG_COUNTERS 0x02
+#define TOPO_DELTA_HDR_LEN       8
+#define TOPO_DELTA_MAX_PAYLOAD   (TOPO_DELTA_HDR_LEN + 3 + 12 + \
+                                  (TOPO_REP_MAX_NEIGHBORS * 32 + \
+                                   TOPO_REP_MAX_NEIGHBORS * 16 + 7) / 8)
 
-/** Maximum payload bytes in a single TOPO_REP message */
-#define TOPO_REP_MAX_PAYLOAD    44  /* 20B header + 4*6B neighbors */
+/** TOPO_BUNDLE record types (record = original message payload, verbatim) */
+#define TOPO_BUNDLE_REC_REP      0x01
+#define TOPO_BUNDLE_REC_DELTA    0x02
 
 /**
  * @brief Neighbor item for Topology snapshot (packed into TOPO_REP)
@@ -207,6 +359,45 @@ struct sensor_topo_ctx {
   bool is_reporting;               /**< Lock: true while drip-feed is active */
   uint8_t req_seq_id;              /**< Sequence ID from polling request (0-15) */
   struct k_work_delayable reply_work; /**< Delayed work for drip-feed TX */
+
+  /* [NEW] Delta reporting: what the Sink holds for us (last delivered report) */
+  struct neighbor_item acked[TOPO_REP_MAX_NEIGHBORS];
+  uint8_t acked_count;
+  uint8_t acked_grad;
+  uint16_t acked_parent;
+  uint16_t acked_drop;
+  uint16_t acked_fwd;
+  uint8_t acked_ver;               /**< Version of the last delivered report */
+  bool acked_valid;                /**< false until a full report is delivered */
+  uint8_t deltas_since_full;       /**< Deltas delivered since the last full */
+
+  /* [NEW] Report in flight: becomes the acked state once delivered */
+  bool is_delta;                   /**< Current session sends OP_TOPO_DELTA */
+  uint8_t ver;                     /**< Version of the report in flight */
+  uint8_t delta_flags;             /**< TOPO_DELTA_FLAG_* of the report in flight */
+  struct neighbor_item pending[TOPO_REP_MAX_NEIGHBORS];
+  uint8_t pending_count;
+  uint8_t pending_grad;
+  uint16_t pending_parent;
+  struct neighbor_item delta_upd[TOPO_REP_MAX_NEIGHBORS];
+  uint16_t delta_rem[TOPO_REP_MAX_NEIGHBORS];
+  uint8_t n_upd;
+  uint8_t n_rem;
+  atomic_t tx_outstanding;         /**< Queued messages + 1 guard while paging */
+  bool tx_failed;                  /**< Any message of the session failed */
+};
+
+/**
+ * @brief Relay-side Topology bundling context
+ *        Records from children are buffered for
+ *        CONFIG_BT_MESH_TOPO_BUNDLE_WINDOW_MS and sent upstream as one
+ *        OP_TOPO_BUNDLE instead of one reliable message each.
+ */
+struct relay_topo_bundle {
+  uint8_t buf[CONFIG_BT_MESH_TOPO_BUNDLE_MAX_LEN]; /**< Count + records */
+  uint16_t len;                    /**< 0 = empty (Count byte not written) */
+  struct k_mutex lock;
+  struct k_work_delayable flush_work;
 };
 
 /* .. include_startingpoint_gradient_srv_rst_3 */
@@ -235,22 +426,36 @@ struct bt_mesh_gradient_srv {
         forwarding_table[
             CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE];
 
+    /** [NEW] Published read-only copy of forwarding_table for RX handlers */
+    struct fwd_view_pub fwd_view;
+
     /* Reliable Reporting Context */
     struct k_work_delayable report_retry_work;
     uint8_t report_retry_count;
     bool is_report_pending;
 
+    /* [NEW] Collection wave: Sink config / schedule of the last REPORT_REQ */
+    struct collect_wave wave_cfg;
+    struct collect_wave report_wave;
+    uint8_t report_wave_round;
+    bool report_wave_valid;
+    bool report_round_bcast;   /**< Pending report answers a broadcast REPORT_REQ */
+
+    /* [NEW] Sink: aggregated bitmap ACK of received REPORT_RSP */
+    struct sink_report_ack report_ack;
+
     /* Topology Reporting Context */
     struct sensor_topo_ctx topo_ctx;
     struct k_work_delayable topo_poll_work;
 
+    /* [NEW] Relay-side merging of children's topology records */
+    struct relay_topo_bundle topo_bundle;
+
     /* [NEW] Account for application-level send failures (Soft Drops) */
     uint32_t soft_drop_count;
 
-    /* [NEW] SDN 2-Phase Commit State */
-    uint16_t sdn_next_hop_pending;
-    uint16_t sdn_next_hop_active;
-    int64_t sdn_route_expiry; // [NEW] Soft-state: Time when active route expires
+    /* [UPD] SDN 2-Phase Commit State: per-flow next hops (staged/active) */
+    struct sdn_flow_table sdn_flows;
 };
 /* .. include_endpoint_gradient_srv_rst_3 */
 
@@ -301,6 +506,72 @@ int bt_mesh_gradient_srv_backprop_send(struct bt_mesh_gradient_srv *gradient_srv
                                        uint16_t dest_addr,
                                        uint16_t payload);
 
+/** One (destination, payload) record of a multi-destination BACKPROP */
+struct bt_mesh_gradient_srv_bp_rec {
+  uint16_t dest;
+  uint16_t payload;
+};
+
+/** @brief [NEW] Send one downlink payload to each of several destinations.
+ *
+ * Records are grouped by RRT next hop; each branch gets one
+ * BACKPROP_MULTI (or a plain BACKPROP_DATA when it holds a single
+ * record), and every relay splits again the same way.
+ *
+ * @param gradient_srv Pointer to gradient server instance.
+ * @param recs Destination/payload records.
+ * @param count Number of records, at most
+ *              CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX.
+ *
+ * @retval 0 At least one branch was sent.
+ * @retval -EINVAL Bad record count.
+ * @retval -ENETUNREACH No record had a route.
+ */
+int bt_mesh_gradient_srv_backprop_send_multi(
+    struct bt_mesh_gradient_srv *gradient_srv,
+    const struct bt_mesh_gradient_srv_bp_rec *recs, uint8_t count);
+
+/** @brief [NEW] Stage SDN flow rules on a node (commit follows with the
+ *         next TOPO_REQ commit flag).
+ *
+ * @param gradient_srv Pointer to gradient server instance.
+ * @param dest_addr Node whose flow table is programmed.
+ * @param version Install version; rules of an older unfinished version
+ *                staged on the node are discarded.
+ * @param rules Rules; @c expiry holds the lifetime in ms (0 = default).
+ * @param count Number of rules (1..BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES).
+ *
+ * @retval 0 Successfully sent the message.
+ * @retval -EINVAL Bad arguments.
+ * @retval -ENETUNREACH No route to destination.
+ */
+int bt_mesh_gradient_srv_sdn_flow_send(struct bt_mesh_gradient_srv *gradient_srv,
+                                       uint16_t dest_addr, uint8_t version,
+                                       const struct sdn_flow_rule *rules,
+                                       uint8_t count);
+
+/** @brief [NEW] Send a source-routed BACKPROP to a specific destination.
+ *
+ * Relays follow @p hops (Sink side first, destination excluded) without
+ * RRT lookups. A relay whose next hop is no longer a neighbor continues
+ * as plain BACKPROP_DATA over its RRT. If the first hop is not a
+ * neighbor of the Sink, this falls back to bt_mesh_gradient_srv_backprop_send().
+ *
+ * @param gradient_srv Pointer to gradient server instance.
+ * @param dest_addr Address of final destination node.
+ * @param payload Data payload to send.
+ * @param hops Relay addresses between Sink and destination.
+ * @param hop_count Number of relays (0 = destination is a direct neighbor),
+ *                  at most CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS.
+ *
+ * @retval 0 Successfully sent the message.
+ * @retval -EINVAL Cannot send to self, or too many hops.
+ * @retval -ENETUNREACH No route to destination.
+ */
+int bt_mesh_gradient_srv_backprop_send_sr(struct bt_mesh_gradient_srv *gradient_srv,
+                                          uint16_t dest_addr, uint16_t payload,
+                                          const uint16_t *hops, uint8_t hop_count);
+
 /** @brief [UPDATED] Broadcast a REPORT REQUEST to all nodes.
  *
  * This function should be called by the SINK NODE to trigger the 
@@ -336,6 +607,22 @@ int bt_mesh_gradient_srv_send_test_start(struct bt_mesh_gradient_srv *srv, bool
  */
 int bt_mesh_gradient_srv_report_rsp_send(struct bt_mesh_gradient_srv *gradient_srv);
 
+/** @brief [NEW] Reply delay of this node inside a collection wave.
+ *
+ * @param wave  Schedule carried by the request.
+ * @param grad  Own gradient (1 = next to the Sink).
+ * @param addr  Own unicast address.
+ * @param round Request ID, salts the in-level hash so colliding nodes
+ *              separate in the next round.
+ * @return Delay in milliseconds from reception of the request.
+ */
+uint32_t bt_mesh_gradient_srv_wave_delay_ms(const struct collect_wave *wave,
+                                            uint8_t grad, uint16_t addr,
+                                            uint8_t round);
+
+/** @brief [NEW] Duration of one full collection wave in milliseconds. */
+uint32_t bt_mesh_gradient_srv_wave_round_ms(const struct collect_wave *wave);
+
 /** @brief [NEW] Send a DOWNLINK REPORT (Unicast) to a Sensor Node.
  *
  * This function should be called by the SINK NODE to send its final
@@ -366,11 +653,22 @@ int bt_mesh_gradient_srv_send_pong(struct bt_mesh_gradient_srv *gradient_srv,
 void topo_routing_init(struct bt_mesh_gradient_srv *srv);
 
 /** @brief Broadcast a TOPO_REQ to all nodes (Sink only).
+ *
+ *  Nodes answer with OP_TOPO_DELTA against their last delivered report,
+ *  or with a full paged OP_TOPO_REP when they have no delivered base,
+ *  are listed in @p resync_addrs, or @p resync_count is TOPO_REQ_RESYNC_ALL.
+ *
  *  @param srv Pointer to gradient server instance.
  *  @param commit_flag Boolean to indicate if this is a commit request.
+ *  @param resync_addrs Nodes that must send a full snapshot (may be NULL).
+ *  @param resync_count Entries in @p resync_addrs (max TOPO_REQ_MAX_RESYNC),
+ *                      or TOPO_REQ_RESYNC_ALL.
  *  @retval 0 Successfully sent.
  */
-int bt_mesh_gradient_srv_send_topo_req(struct bt_mesh_gradient_srv *srv, bool commit_flag);
+int bt_mesh_gradient_srv_send_topo_req(struct bt_mesh_gradient_srv *srv,
+                                       bool commit_flag,
+                                       const uint16_t *resync_addrs,
+                                       uint8_t resync_count);
 
 /** @brief [NEW] Send OP_SENSOR_INTERVAL command to set periodic data interval.
  *
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file gtrace.h
+ * @brief Binary ring-buffer event tracer for the routing hot path
+ *
+ * Each trace point stores one fixed 12-byte record (cycle timestamp,
+ * event id, 1 byte + 3 x u16 arguments) into a RAM ring. No string
+ * formatting happens on the data path; the ring is drained on demand
+ * ("mesh trace dump") as hex lines and decoded on the host by
+ * DataLogging/trace_decode.py into CSV or Perfetto JSON.
+ *
+ * Trace points compile to nothing when CONFIG_BT_MESH_GRADIENT_SRV_TRACE
+ * is disabled.
+ */
+
+#ifndef GTRACE_H__
+#define GTRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Dump format version (bump when record layout or event ids change) */
+#define GTRACE_FORMAT_VERSION 1
+
+/**
+ * @brief Trace event ids
+ *
+ * Argument meaning is listed per event as (b, a0, a1, a2).
+ * Keep in sync with EVENTS in DataLogging/trace_decode.py.
+ */
+enum gtrace_event {
+    GT_DATA_RX = 1,     /**< (hops, src, seq, sender) */
+    GT_DATA_TX,         /**< (hops, dst, src, seq) */
+    GT_DATA_FWD,        /**< (hops, parent, src, seq) */
+    GT_DATA_SINK,       /**< (hops, src, seq, sender) */
+    GT_DATA_TX_DONE,    /**< (err != 0, dst, -err, 0) */
+    GT_SENSOR_RX,       /**< (hops, src, count, nexthop) */
+    GT_BP_RX,           /**< (hops, dest, payload, sender) */
+    GT_BP_FWD,          /**< (hops, dest, payload, nexthop) */
+    GT_BP_DELIVER,      /**< (hops, payload, delay_ms, sender) */
+    GT_BP_NO_ROUTE,     /**< (0, dest, payload, 0) */
+    GT_RRT_HIT,         /**< (0, dest, nexthop, 0) */
+    GT_NT_UPDATE,       /**< (pos, addr, grad, rssi) */
+    GT_PONG_RX,         /**< (0, origin, seq, sender) */
+    GT_EVENT_MAX,
+};
+
+/**
+ * @brief One trace record (12 bytes, little endian on the wire)
+ */
+struct gtrace_rec {
+    uint32_t cycles;    /**< k_cycle_get_32() at record time */
+    uint8_t id;         /**< enum gtrace_event */
+    uint8_t b;          /**< Small argument (hops, pos, flag) */
+    uint16_t a[3];      /**< Event arguments */
+} __attribute__((packed));
+
+#if defined(CONFIG_BT_MESH_GRADIENT_SRV_TRACE)
+
+/**
+ * @brief Append one record to the ring (overwrites the oldest when full)
+ */
+void gtrace_emit(uint8_t id, uint8_t b, uint16_t a0, uint16_t a1, uint16_t a2);
+
+#define GTRACE(id, b, a0, a1, a2)                                              \
+    gtrace_emit((id), (uint8_t)(b), (uint16_t)(a0), (uint16_t)(a1),            \
+                (uint16_t)(a2))
+
+#else
+
+#define GTRACE(id, b, a0, a1, a2) do { } while (0)
+
+#endif /* CONFIG_BT_MESH_GRADIENT_SRV_TRACE */
+
+/**
+ * @brief Enable or disable recording (records are kept)
+ */
+void gtrace_set_enabled(bool enable);
+
+/**
+ * @brief Check if recording is enabled
+ */
+bool gtrace_is_enabled(void);
+
+/**
+ * @brief Copy out and remove the oldest records
+ * @param out Destination array
+ * @param max_count Size of @p out
+ * @return Number of records copied
+ */
+size_t gtrace_drain(struct gtrace_rec *out, size_t max_count);
+
+/**
+ * @brief Number of records currently buffered
+ */
+size_t gtrace_count(void);
+
+/**
+ * @brief Number of records overwritten before they were drained
+ */
+uint32_t gtrace_overruns(void);
+
+/**
+ * @brief Drop all buffered records and reset the overrun counter
+ */
+void gtrace_clear(void);
+
+/**
+ * @brief Timestamp clock rate in Hz (for the host decoder)
+ */
+uint32_t gtrace_clock_hz(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GTRACE_H__ */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file link_cost_model.h
+ * @brief On-node fixed-point evaluator of the Gateway routing-cost model
+ *
+ * The LightGBM ensemble the Gateway uses for SDN link costs
+ * (ml_training/routing_cost_model.txt) is turned into constant tables at
+ * build time by ml_training/gen_cost_tables.py. Features are integers
+ * computed from the same raw counters the node reports in $[TOPO], and every
+ * split threshold is pre-mapped onto that integer, so the node takes the
+ * same branches as the Gateway model. Leaf values are Q16; the only error
+ * left is leaf rounding (< trees x 2^-17) and rare rounding ties in
+ * Drop_Rate / Pin. Checked on the host by ml_training/check_cost_tables.py.
+ *
+ * Pure C (no Zephyr dependencies) so the host check compiles this module
+ * as is.
+ */
+
+#ifndef LINK_COST_MODEL_H__
+#define LINK_COST_MODEL_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Fraction bits of link_cost_model_score() results */
+#define LINK_COST_FRAC_BITS     16
+
+/** Feature slots, in model order (routing_cost_model_features.txt) */
+enum link_cost_feature {
+    LINK_COST_F_GRAD = 0,       /**< Own gradient */
+    LINK_COST_F_RSSI,           /**< Neighbor RSSI (dBm) */
+    LINK_COST_F_LINK_UP,        /**< Link uptime (s, max 65535) */
+    LINK_COST_F_DROP_COUNT,
+    LINK_COST_F_FWD_COUNT,
+    LINK_COST_F_DROP_RATE,      /**< Drop rate, tenths of a percent */
+    LINK_COST_F_PIN,            /**< Battery estimate, tenths of a percent */
+    LINK_COST_F_NB_COUNT,
+    LINK_COST_F_LINK_STAB,      /**< log1p(Link_UP): thresholds are on Link_UP (s) */
+    LINK_COST_F_LOAD_PER_NB,    /**< Fwd / (Neighbors + 1), Q16 */
+    LINK_COST_N_FEATURES,
+};
+
+/** Raw inputs, the same values the node reports to the Gateway */
+struct link_cost_input {
+    uint8_t grad;           /**< Own gradient */
+    int8_t rssi;            /**< Neighbor RSSI */
+    uint16_t link_up_s;     /**< Seconds since the neighbor was first seen */
+    uint16_t drop_count;    /**< topo_ctx.drop_count_snapshot */
+    uint16_t fwd_count;     /**< topo_ctx.fwd_rate_snapshot */
+    uint32_t uptime_s;      /**< Node uptime */
+    uint32_t total_sent;    /**< topo_ctx.total_sent_snapshot */
+    uint8_t nb_count;       /**< Valid neighbors (as in $[TOPO]) */
+};
+
+/** Table node: goes left when q[feature] <= threshold (see gen_cost_tables.py) */
+struct cost_model_node {
+    int32_t threshold;
+    int16_t left;           /**< >= 0 node index, < 0 ~leaf index */
+    int16_t right;
+    uint8_t feature;        /**< enum link_cost_feature */
+    uint8_t flags;          /**< COST_MODEL_NODE_* */
+};
+
+#define COST_MODEL_NODE_DEFAULT_LEFT    0x01
+#define COST_MODEL_NODE_MISSING_ZERO    0x02  /**< q == 0 takes the default side */
+
+/** @brief Integer features as the Gateway computes them (drop rate, pin, load) */
+void link_cost_model_features(const struct link_cost_input *in,
+                              int32_t q[LINK_COST_N_FEATURES]);
+
+/** @brief Sum of the tree ensemble for features @p q, Q16 */
+int32_t link_cost_model_eval(const int32_t q[LINK_COST_N_FEATURES]);
+
+/** @brief Predicted routing cost of one link, Q16 (lower is better) */
+int32_t link_cost_model_score(const struct link_cost_input *in);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINK_COST_MODEL_H__ */
@@ -49,12 +49,16 @@ void nt_init(neighbor_entry_t *table, size_t table_size);
  * @param sender_gradient Gradient value of the sender
  * @param sender_rssi RSSI of the received message
  * @param now_ms Current timestamp in milliseconds (from k_uptime_get)
+ * @param evicted If not NULL, receives the entry pushed out of a full table
+ *                by a new sender (addr = GR_ADDR_UNASSIGNED if none). The
+ *                caller owns its backprop_dest list and must free it
+ *                (rrt_free_evicted()).
  *
  * @return true if table was modified, false otherwise
  */
 bool nt_update_sorted(neighbor_entry_t *table, size_t table_size,
                       uint16_t sender_addr, uint8_t sender_gradient, int8_t sender_rssi,
-                      int64_t now_ms);
+                      int64_t now_ms, neighbor_entry_t *evicted);
 
 /**
  * @brief Get the best (first) entry in the neighbor table
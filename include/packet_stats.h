@@ -26,14 +26,36 @@
 extern "C" {
 #endif
 
+/** Number of per-hop-count backprop delay histograms (last bin is "N+ hops") */
+#define PKT_LAT_HOP_BINS 8
+
+/**
+ * @brief Latency metrics tracked by log-bucketed histograms
+ */
+enum pkt_lat_metric {
+    PKT_LAT_UPLINK_RTT = 0,   /**< DATA -> PONG round trip at the source */
+    PKT_LAT_BACKPROP_DELAY,   /**< Sink -> node downlink delay (all hops) */
+    PKT_LAT_BACKPROP_HOP,     /**< Downlink delay split by hop count */
+};
+
 /**
- * @brief RTT Sample structure
+ * @brief Percentile summary of one latency histogram
+ *
+ * Values are bucket upper bounds (HDR style, ~12.5% relative precision).
  */
-struct rtt_sample {
-    uint16_t seq;
-    uint16_t rtt_ms;
+struct pkt_lat_summary {
+    uint8_t metric;    /**< enum pkt_lat_metric */
+    uint8_t hops;      /**< Hop count for PKT_LAT_BACKPROP_HOP, else 0 */
+    uint32_t count;    /**< Number of recorded samples */
+    uint16_t p50_ms;
+    uint16_t p90_ms;
+    uint16_t p99_ms;
+    uint16_t max_ms;
 };
 
+/** Maximum number of summaries returned by pkt_stats_get_latency_summary() */
+#define PKT_LAT_MAX_SUMMARIES (2 + PKT_LAT_HOP_BINS)
+
 /**
  * @brief Packet statistics structure
  */
@@ -44,8 +66,23 @@ struct packet_stats {
     uint32_t data_fwd_tx;          /**< DATA packet Forwarded count (Relay) */
     uint32_t route_change_count;   /**< Number of times best parent changed */
     uint32_t rx_data_count;        /**< [NEW] Count received DATA/BACKPROP at destination */
+    uint32_t pong_timeouts;        /**< DATA packets whose PONG never arrived */
+    uint32_t since_reset_s;        /**< Seconds since the counters were last reset */
+    uint8_t epoch;                 /**< Reset generation (increments on every reset, wraps) */
 };
 
+/** Version byte leading the binary snapshot */
+#define PKT_STATS_SNAPSHOT_VERSION 1
+
+/**
+ * Worst-case encoded snapshot size:
+ * version(1) + epoch(1) + uptime(5) + n(1) + 7 counters(5 each)
+ * + lat_count(1) + PKT_LAT_MAX_SUMMARIES * 11
+ */
+#define PKT_STATS_SNAPSHOT_MAX_LEN (44 + PKT_LAT_MAX_SUMMARIES * 11)
+
+struct net_buf_simple;
+
 /**
  * @brief Initialize packet statistics (reset all counters to 0)
  */
@@ -59,23 +96,42 @@ void pkt_stats_record_sent(uint16_t seq);
 
 /**
  * @brief Record that a PONG was received (stop RTT timer and store)
+ *
+ * The RTT is added to the uplink RTT histogram. Pending entries older than
+ * the pong timeout are expired and counted as lost.
+ *
  * @param seq Sequence number of the packet
- * @return True if buffer is full (50 samples reached)
+ * @return True if a matching pending DATA was found
  */
 bool pkt_stats_record_pong(uint16_t seq);
 
 /**
- * @brief Get RTT history history
- * @param buffer Buffer to fill with RTT samples
- * @param max_count Maximum number of samples to copy
- * @return Actual number of samples copied
+ * @brief Record the delay of a BACKPROP packet that reached this node
+ * @param delay_ms Sink-relative delay in milliseconds
+ * @param hops Hop count carried in the packet
+ */
+void pkt_stats_record_backprop_delay(uint32_t delay_ms, uint8_t hops);
+
+/**
+ * @brief Get percentile summaries of all non-empty latency histograms
+ * @param out Array to fill (at least PKT_LAT_MAX_SUMMARIES entries)
+ * @param max_count Size of @p out
+ * @return Number of summaries written
+ */
+uint8_t pkt_stats_get_latency_summary(struct pkt_lat_summary *out, uint8_t max_count);
+
+/**
+ * @brief Get number of pending DATA packets that expired without a PONG
+ * @return Expired count since last reset
  */
-uint16_t pkt_stats_get_rtt_history(struct rtt_sample *buffer, uint16_t max_count);
+uint32_t pkt_stats_get_pong_timeouts(void);
 
 /**
- * @brief Clear RTT history after reporting
+ * @brief Get printable name of a latency metric
+ * @param metric enum pkt_lat_metric value
+ * @return Static string (e.g. "RTT")
  */
-void pkt_stats_clear_rtt_history(void);
+const char *pkt_stats_lat_metric_str(uint8_t metric);
 
 /**
  * @brief Increment Gradient Beacon TX counter
@@ -105,10 +161,37 @@ void pkt_stats_inc_route_change(void);
 /**
  * @brief Get current packet statistics
  *
+ * Lock-free seqlock read: the copy never mixes values from before and
+ * after a concurrent reset.
+ *
  * @param stats Pointer to struct to fill with current stats
  */
 void pkt_stats_get(struct packet_stats *stats);
 
+/**
+ * @brief Append a compact binary snapshot (counters + latency summaries)
+ *
+ * Format (little endian):
+ *   version(1) epoch(1) since_reset_s(uleb) n(1) counters[n](uleb)
+ *   lat_count(1) { (hops<<4|metric)(1) count(2) p50(2) p90(2) p99(2) max(2) }
+ *
+ * @param buf Buffer with at least PKT_STATS_SNAPSHOT_MAX_LEN tailroom
+ * @return 0 on success, -ENOBUFS if the buffer is too small
+ */
+int pkt_stats_snapshot_encode(struct net_buf_simple *buf);
+
+/**
+ * @brief Parse a snapshot produced by pkt_stats_snapshot_encode()
+ *
+ * @param buf Buffer positioned at the version byte (consumed)
+ * @param stats Decoded counters
+ * @param lat Array of PKT_LAT_MAX_SUMMARIES summaries
+ * @param lat_count Number of summaries written to @p lat
+ * @return 0 on success, negative errno on malformed input
+ */
+int pkt_stats_snapshot_decode(struct net_buf_simple *buf, struct packet_stats *stats,
+                              struct pkt_lat_summary *lat, uint8_t *lat_count);
+
 /**
  * @brief Get Gradient Beacon TX count
  * @return Current count
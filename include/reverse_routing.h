@@ -32,11 +32,21 @@ extern "C" {
 /**
  * @brief Node in backprop_dest linked list
  * 
- * Each node stores information about a destination reachable via the corresponding nexthop.
+ * Each node stores a run of consecutive destination addresses [addr, hi]
+ * reachable via the corresponding nexthop. With addresses assigned in
+ * contiguous ranges per subtree (see Gateway address plan) a nexthop needs
+ * one node for its whole subtree, so RRT memory scales with the number of
+ * branches rather than the number of nodes.
+ *
+ * A node that moved to another nexthop from the middle of a run is kept
+ * as a single-address exception at its new nexthop (@c moved); exceptions
+ * are looked up before runs, so the old run does not have to be split.
  */
 typedef struct backprop_node {
-    uint16_t addr;              /**< Destination address */
-    int64_t last_seen;          /**< Timestamp of last packet received from this dest */
+    uint16_t addr;              /**< First destination address of the run */
+    uint16_t hi;                /**< Last destination address of the run (>= addr) */
+    bool moved;                 /**< Exception entry overriding another nexthop's run */
+    int64_t last_seen;          /**< Timestamp of last packet received from any dest of the run */
     struct backprop_node *next; /**< Pointer to next node in list */
 } backprop_node_t;
 
@@ -57,7 +67,8 @@ void rrt_init(void *table, size_t table_size);
  * Logic:
  * - If dest exists in same nexthop: only update last_seen
  * - If dest exists in DIFFERENT nexthop: remove from old, add to new
- * - If dest doesn't exist: add new node to linked list
+ *   (inside an old run: exception entry at the new nexthop instead)
+ * - If dest doesn't exist: extend/merge an adjacent run, or add a new node
  *
  * @param table Pointer to forwarding table
  * @param table_size Number of entries in table
@@ -122,6 +133,13 @@ int rrt_cleanup_expired(void *table, size_t table_size,
  */
 size_t rrt_get_dest_count(const void *table, size_t table_size, size_t index);
 
+/**
+ * @brief Count list nodes (runs + exceptions) in backprop_dest of an entry
+ *
+ * @return Number of nodes, 0 if entry invalid
+ */
+size_t rrt_get_run_count(const void *table, size_t table_size, size_t index);
+
 /**
  * @brief Print entire reverse routing table (for debugging)
  *
@@ -141,6 +159,26 @@ void rrt_print_table(const void *table, size_t table_size);
  */
 void rrt_clear_entry(void *table, size_t table_size, size_t index);
 
+/**
+ * @brief Free the routes of a neighbor entry evicted by nt_update_sorted()
+ *
+ * Same as rrt_clear_entry() on a detached entry (bumps the generation).
+ * No-op when @p entry is unassigned.
+ *
+ * @param entry Evicted entry returned through nt_update_sorted()
+ */
+void rrt_free_evicted(void *entry);
+
+/**
+ * @brief Route generation counter
+ *
+ * Incremented (atomically) whenever a destination may have lost its route:
+ * expiry, eviction, move to another nexthop, entry cleared. A reader can
+ * cache "dest D is fresh via nexthop N" outside the table mutex and trust
+ * it while the generation is unchanged.
+ */
+uint32_t rrt_generation(void);
+
 /**
  * @brief Get any known destination from the reverse routing table
  *
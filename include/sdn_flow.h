@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file sdn_flow.h
+ * @brief Per-node SDN flow table for uplink next-hop overrides
+ *
+ * Each rule matches (original source, traffic class) and names the
+ * neighbor that traffic should be relayed to. Wildcards are allowed on
+ * both fields; the most specific live rule wins:
+ *   (src, class) > (src, ANY) > (ANY, class) > (ANY, ANY)
+ *
+ * Rules are installed in two phases like the old single SDN override:
+ * the Gateway stages them under a version (OP_SDN_FLOW, BACKPROP_DATA
+ * 0x8000 | nexthop or BACKPROP_BROADCAST pairs), and the next TOPO_REQ
+ * with the commit flag merges the staged set into the active table.
+ * A staged rule whose next hop is unassigned deletes the active rule with
+ * the same match. Every rule carries its own lifetime (soft state).
+ */
+
+#ifndef SDN_FLOW_H__
+#define SDN_FLOW_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Match wildcards */
+#define SDN_FLOW_SRC_ANY        0x0000
+#define SDN_FLOW_CLASS_ANY      0
+
+/** Traffic classes (uplink) */
+#define SDN_FLOW_CLASS_DATA     1   /**< DATA and heartbeats */
+#define SDN_FLOW_CLASS_SENSOR   2   /**< SENSOR_DATA telemetry */
+#define SDN_FLOW_CLASS_CTRL     3   /**< TOPO / REPORT replies */
+#define SDN_FLOW_CLASS_MAX      SDN_FLOW_CLASS_CTRL
+
+/** Lifetime of the legacy single next-hop push and of rules with Life = 0 */
+#define SDN_FLOW_DEFAULT_LIFETIME_MS \
+    (CONFIG_BT_MESH_GRADIENT_SDN_FLOW_LIFETIME_MIN * 60U * 1000U)
+
+/** Wire format of one rule in OP_SDN_FLOW */
+#define SDN_FLOW_RULE_LEN       6   /* Src(2) Class(1) NextHop(2) Lifetime(1) */
+
+struct sdn_flow_rule {
+    uint16_t src;       /**< Original source, SDN_FLOW_SRC_ANY = any */
+    uint16_t next_hop;  /**< Neighbor to relay to; unassigned = delete */
+    int64_t expiry;     /**< k_uptime_get() deadline (active) / lifetime ms (staged) */
+    uint8_t tclass;     /**< SDN_FLOW_CLASS_*, SDN_FLOW_CLASS_ANY = any */
+};
+
+struct sdn_flow_table {
+    struct sdn_flow_rule active[CONFIG_BT_MESH_GRADIENT_SDN_FLOW_TABLE_SIZE];
+    struct sdn_flow_rule staged[CONFIG_BT_MESH_GRADIENT_SDN_FLOW_TABLE_SIZE];
+    uint8_t active_count;
+    uint8_t staged_count;
+    uint8_t active_version;  /**< Version of the last committed set */
+    uint8_t staged_version;  /**< Version the staged rules belong to */
+    struct k_spinlock lock;
+};
+
+void sdn_flow_init(struct sdn_flow_table *ft);
+
+/** Drop active and staged rules (SDN RESET) */
+void sdn_flow_reset(struct sdn_flow_table *ft);
+
+/**
+ * @brief Stage a rule for the next commit
+ *
+ * A rule with a different @p version than the staged set discards the
+ * staged rules first (a newer install replaced an unfinished one).
+ *
+ * @param lifetime_ms Rule lifetime once committed
+ * @retval 0 staged, -ENOMEM staged set full
+ */
+int sdn_flow_stage(struct sdn_flow_table *ft, uint8_t version, uint16_t src,
+                   uint8_t tclass, uint16_t next_hop, uint32_t lifetime_ms);
+
+/** Stage the (ANY, ANY) rule under the current staged version */
+int sdn_flow_stage_default(struct sdn_flow_table *ft, uint16_t next_hop,
+                           uint32_t lifetime_ms);
+
+/**
+ * @brief Merge the staged rules into the active table
+ * @return number of rules applied (0 = nothing staged)
+ */
+int sdn_flow_commit(struct sdn_flow_table *ft);
+
+/**
+ * @brief Next hop for a flow, or BT_MESH_ADDR_UNASSIGNED if no live rule
+ *        matches. Expired rules are removed on the way.
+ */
+uint16_t sdn_flow_lookup(struct sdn_flow_table *ft, uint16_t src, uint8_t tclass);
+
+/**
+ * @brief Copy the live active rules (expiry as remaining ms)
+ * @return number of rules copied
+ */
+int sdn_flow_snapshot(struct sdn_flow_table *ft, struct sdn_flow_rule *out,
+                      int max, uint8_t *version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SDN_FLOW_H__ */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file sink_frame.h
+ * @brief Binary framed Sink -> Gateway UART records
+ *
+ * In binary mode the Sink writes one COBS frame per record instead of a
+ * CSV_LOG / $[SENSOR] / $[TOPO] text line:
+ *
+ *   0x00 | COBS( Ver(1) Type(1) Body(N) CRC16(2, LE) ) | 0x00
+ *
+ * CRC16 is CRC-16/CCITT (poly 0x1021, init 0xFFFF) over Ver..Body. COBS
+ * removes every 0x00 from the frame, so a 0x00 always marks a boundary and
+ * the Gateway resynchronises on the next one after a corrupted frame.
+ * Shell and log output keep sharing the console as text: the Gateway
+ * treats anything outside a 0x00 pair as text lines.
+ *
+ * Bodies are little-endian; layouts are listed per type below and are
+ * mirrored in sink_frame.py on the Gateway.
+ */
+
+#ifndef SINK_FRAME_H__
+#define SINK_FRAME_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SINK_FRAME_VERSION      1
+
+/** Largest body accepted by sink_frame_send() (a full TOPO_DELTA fits) */
+#define SINK_FRAME_BODY_MAX     200
+
+enum sink_frame_type {
+    /** Src(2) Via(2) Seq(2) Hop(1) Rssi(1) */
+    SINK_FRAME_DATA = 1,
+    /** Src(2) Via(2) Hop(1) */
+    SINK_FRAME_HEARTBEAT,
+    /** Src(2) Count(1) Count x [Id(1) Val(2)] */
+    SINK_FRAME_SENSOR,
+    /** Origin(2) Seq(1) TotalPg(1) CurPg(1) Grad(1) Parent(2) Drops(2)
+     *  FwdRate(2) Uptime(4) TotalSent(4) Ver(1) N(1) N x Nb */
+    SINK_FRAME_TOPO,
+    /** Origin(2) Seq(1) Flags(1) BaseVer(1) Ver(1) Grad(1) Parent(2)
+     *  Drops(2) FwdRate(2) Uptime(4) TotalSent(4) NUpd(1) NUpd x Nb
+     *  NRem(1) NRem x Addr(2) */
+    SINK_FRAME_TOPO_DELTA,
+    /** Src(2) DataTx(4) BeaconTx(4) HbTx(4) RouteChg(4) FwdTx(4) RxData(4)
+     *  PongTimeouts(4) Epoch(4) SinceReset(4) */
+    SINK_FRAME_REPORT,
+    /** Src(2) Metric(1) Hops(1) Count(4) P50(2) P90(2) P99(2) Max(2) */
+    SINK_FRAME_LATENCY,
+    /** Dest(2) Seq(2) Err(1, signed) -- PONG sent by the Sink */
+    SINK_FRAME_PONG,
+    /** Id(2) Status(2, signed) -- reply to "mesh rpc" */
+    SINK_FRAME_RSP,
+};
+
+/** Neighbor entry in TOPO / TOPO_DELTA bodies: Addr(2) Rssi(1) Grad(1) LinkUp(2) */
+#define SINK_FRAME_NB_LEN       6
+
+/** @brief true if records are written as binary frames, false for text */
+bool sink_frame_binary(void);
+
+/** @brief Switch between binary frames and text lines at runtime */
+void sink_frame_set_binary(bool binary);
+
+/**
+ * @brief Frame one record and write it to the console UART
+ *
+ * Safe from any thread; frames are never interleaved with each other.
+ *
+ * @retval 0 written, -EMSGSIZE body too long, -ENODEV no console UART
+ */
+int sink_frame_send(uint8_t type, const uint8_t *body, size_t len);
+
+/** @brief Frames / bytes written since boot (for "mesh uart_mode") */
+void sink_frame_get_stats(uint32_t *frames, uint32_t *bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SINK_FRAME_H__ */
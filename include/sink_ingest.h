@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file sink_ingest.h
+ * @brief Sink ingest stage: mesh RX handlers -> SPSC ring -> ingest thread
+ *
+ * At the Sink, the RX handlers only copy what they received into a
+ * compact record and return. A lower-priority thread formats the
+ * CSV_LOG / $[SENSOR] / $[TOPO] lines, writes them to the UART and sends
+ * the PONGs. The ring is single-producer (Bluetooth RX thread) /
+ * single-consumer (ingest thread) and lock-free; a full ring drops the
+ * new record and counts it.
+ *
+ *   rec = sink_ingest_alloc();  ... fill ...  sink_ingest_commit(rec);
+ *
+ * With CONFIG_BT_MESH_GRADIENT_SINK_INGEST disabled, commit runs the
+ * handler inline in the RX context (the previous behaviour).
+ */
+
+#ifndef SINK_INGEST_H__
+#define SINK_INGEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest raw payload kept per record (fits a full TOPO_DELTA) */
+#define SINK_INGEST_RAW_MAX 120
+
+enum sink_ingest_type {
+    SINK_INGEST_DATA = 1,    /**< DATA at the Sink: CSV_LOG,DATA + PONG */
+    SINK_INGEST_HEARTBEAT,   /**< Heartbeat DATA: CSV_LOG,SENSOR_DATA */
+    SINK_INGEST_SENSOR,      /**< SENSOR_DATA: raw = count x (id, le16) */
+    SINK_INGEST_TOPO_REP,    /**< raw = TOPO_REP payload */
+    SINK_INGEST_TOPO_DELTA,  /**< raw = TOPO_DELTA payload */
+};
+
+struct sink_ingest_rec {
+    uint8_t type;      /**< enum sink_ingest_type */
+    uint8_t hop;
+    int8_t rssi;       /**< Path min RSSI (DATA) */
+    uint8_t len;       /**< Bytes used in raw[] */
+    uint16_t src;      /**< Original source / origin */
+    uint16_t via;      /**< Neighbor the packet arrived from */
+    uint16_t data;     /**< DATA seq / SENSOR count */
+    uint8_t raw[SINK_INGEST_RAW_MAX];
+};
+
+struct sink_ingest_stats {
+    uint32_t queued;     /**< Records accepted */
+    uint32_t dropped;    /**< Records lost because the ring was full */
+    uint32_t max_depth;  /**< High-water mark of the ring */
+};
+
+typedef void (*sink_ingest_handler_t)(struct sink_ingest_rec *rec, void *user_data);
+
+/** Set the handler run by the ingest thread for every record */
+void sink_ingest_init(sink_ingest_handler_t handler, void *user_data);
+
+/**
+ * @brief Reserve the next ring slot (producer side, RX thread only)
+ * @return Slot to fill, or NULL if the ring is full (counted as dropped)
+ */
+struct sink_ingest_rec *sink_ingest_alloc(void);
+
+/** Publish a slot returned by sink_ingest_alloc() */
+void sink_ingest_commit(struct sink_ingest_rec *rec);
+
+void sink_ingest_get_stats(struct sink_ingest_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SINK_INGEST_H__ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file topo_codec.h
+ * @brief Dense bit-packed neighbor encoding for TOPO_REP / TOPO_DELTA
+ *
+ * One neighbor takes W + 16 bits instead of 6 bytes:
+ *   addr   W bits  zigzag(addr - origin), W = 1..16 chosen per message
+ *   rssi   6 bits  -(rssi + 40), clamped: -40 .. -103 dBm at 1 dB
+ *   grad   5 bits  0..30, 31 = 31 or more (incl. unreachable)
+ *   uptime 5 bits  half-octave log code: 0 s, 2 s, 3 s, 4 s, 6 s ... 65535 s
+ *
+ * Bits are packed LSB first. Mirrored by the decoder in the Sink only; the
+ * Gateway sees decoded values in the $[TOPO] / $[TOPOD] UART lines.
+ */
+
+#ifndef TOPO_CODEC_H__
+#define TOPO_CODEC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/net_buf.h>
+#include "gradient_srv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Field widths (bits) */
+#define TOPO_CODEC_RSSI_BITS    6
+#define TOPO_CODEC_GRAD_BITS    5
+#define TOPO_CODEC_UPTIME_BITS  5
+
+/** Bits per neighbor excluding the address */
+#define TOPO_CODEC_ITEM_BITS \
+    (TOPO_CODEC_RSSI_BITS + TOPO_CODEC_GRAD_BITS + TOPO_CODEC_UPTIME_BITS)
+
+/** Worst-case bytes for @p n neighbors (16-bit address deltas) */
+#define TOPO_CODEC_MAX_BYTES(n) (((n) * (16 + TOPO_CODEC_ITEM_BITS) + 7) / 8)
+
+/** Bit writer appending to a net_buf_simple */
+struct topo_bitw {
+    struct net_buf_simple *buf;
+    uint32_t acc;
+    uint8_t bits;
+};
+
+/** Bit reader consuming a net_buf_simple */
+struct topo_bitr {
+    struct net_buf_simple *buf;
+    uint32_t acc;
+    uint8_t bits;
+};
+
+/**
+ * @brief Smallest address width (1..16) that fits every address as a
+ *        zigzag delta from @p origin
+ */
+uint8_t topo_codec_addr_width(uint16_t origin, const struct neighbor_item *items,
+                              uint8_t count, const uint16_t *addrs,
+                              uint8_t addr_count);
+
+void topo_bitw_init(struct topo_bitw *w, struct net_buf_simple *buf);
+void topo_bitw_put(struct topo_bitw *w, uint32_t val, uint8_t nbits);
+/** Pad the last partial byte with zeros */
+void topo_bitw_flush(struct topo_bitw *w);
+
+void topo_bitr_init(struct topo_bitr *r, struct net_buf_simple *buf);
+/** @return false if the buffer ran out */
+bool topo_bitr_get(struct topo_bitr *r, uint8_t nbits, uint32_t *val);
+
+void topo_codec_put_addr(struct topo_bitw *w, uint16_t origin, uint8_t width,
+                         uint16_t addr);
+bool topo_codec_get_addr(struct topo_bitr *r, uint16_t origin, uint8_t width,
+                         uint16_t *addr);
+
+void topo_codec_put_item(struct topo_bitw *w, uint16_t origin, uint8_t width,
+                         const struct neighbor_item *item);
+bool topo_codec_get_item(struct topo_bitr *r, uint16_t origin, uint8_t width,
+                         struct neighbor_item *item);
+
+/** Quantizers (exposed so callers can compare in the coded domain) */
+uint8_t topo_codec_rssi_q(int8_t rssi);
+int8_t topo_codec_rssi_dq(uint8_t q);
+uint8_t topo_codec_uptime_q(uint16_t seconds);
+uint16_t topo_codec_uptime_dq(uint8_t q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOPO_CODEC_H__ */
@@ -0,0 +1,87 @@
+"""
+Routing cost per-link cho Gateway: LightGBM theo lô.
+
+Mỗi chu kỳ poll, feature của mọi link (node -> neighbor) được gom vào MỘT ma trận
+và AI_Model.predict chạy một lần; gọi predict từng link (ma trận 1x10) tốn overhead
+cố định mỗi lần gấp nhiều lần phần tính cây. Kết quả là dict cost của riêng chu kỳ
+đó, (node, neighbor) -> cost: SDN_Graph và logger CSV đọc chung dict này nên mỗi link
+chỉ predict một lần mỗi chu kỳ. Không có cache qua các chu kỳ: Link_UP(s) và Pin đổi
+ở mỗi lần poll nên vector feature gần như không bao giờ lặp lại.
+"""
+import math
+
+import numpy as np
+
+# Thứ tự cột khớp ml_training/routing_cost_model_features.txt
+FEATURE_NAMES = ['Grad', 'RSSI', 'Link_UP(s)', 'Drop_Count', 'Fwd_Count',
+                 'Drop_Rate(%)', 'Pin(%)', 'Neighbor_Count', 'Link_Stability', 'Load_Per_Neighbor']
+
+
+def link_features(grad, nb_rssi, nb_link_up_s, drop_rate, pin, drop_count, fwd_count, neighbor_count):
+    """Vector feature của một link (tuple)."""
+    link_stability = math.log1p(nb_link_up_s)
+    load_per_neighbor = fwd_count / (neighbor_count + 1)
+    return (grad, nb_rssi, nb_link_up_s, drop_count, fwd_count,
+            drop_rate, pin, neighbor_count, link_stability, load_per_neighbor)
+
+
+def heuristic_cost(grad, nb_rssi, nb_link_up_s, drop_rate, pin):
+    """Công thức heuristic (Raw View, và fallback khi không có model)."""
+    hop_cost = grad * 10.0
+    signal_cost = max(0.0, (-nb_rssi - 70.0)) * 2.5
+    reliability_cost = min(400.0, pow(drop_rate, 1.5)) if drop_rate > 0 else 0.0
+    if pin < 20.0:
+        battery_cost = 200.0
+    elif pin < 60.0:
+        battery_cost = (60.0 - pin) * 1.5
+    else:
+        battery_cost = 0.0
+
+    stability_cost = 100.0 * math.exp(-nb_link_up_s / 300.0)
+    total = hop_cost + signal_cost + reliability_cost + battery_cost + stability_cost
+    return round(total, 2)
+
+
+def _heuristic_from_features(f):
+    return heuristic_cost(grad=f[0], nb_rssi=f[1], nb_link_up_s=f[2], drop_rate=f[5], pin=f[6])
+
+
+class LinkCostEngine:
+    """Cost AI theo lô, mỗi lần gọi costs() là một chu kỳ."""
+
+    def __init__(self, model):
+        self.model = model
+        self.stats = {"links": 0, "dup": 0, "predicted": 0, "batches": 0, "fallback": 0}
+
+    def predict_rows(self, rows):
+        """Một lần predict cho cả list vector feature; lỗi model -> heuristic."""
+        if not rows:
+            return []
+        if self.model is not None:
+            try:
+                pred = self.model.predict(np.asarray(rows, dtype=np.float64))
+                self.stats["batches"] += 1
+                self.stats["predicted"] += len(rows)
+                return [round(float(p), 2) for p in pred]
+            except Exception:
+                pass  # Fallback to heuristic
+        self.stats["fallback"] += len(rows)
+        return [_heuristic_from_features(f) for f in rows]
+
+    def costs(self, links):
+        """links = [(node, neighbor, features)] -> {(node, neighbor): cost}.
+        Link lặp lại trong cùng lô chỉ predict một lần (giữ feature đầu tiên)."""
+        keys, rows, seen = [], [], set()
+        for node, nb, feats in links:
+            key = (node, nb)
+            if key in seen:
+                self.stats["dup"] += 1
+                continue
+            seen.add(key)
+            keys.append(key)
+            rows.append(feats)
+        self.stats["links"] += len(links)
+        return dict(zip(keys, self.predict_rows(rows)))
+
+    def cost(self, node, nb, feats):
+        return self.costs([(node, nb, feats)])[(node, nb)]
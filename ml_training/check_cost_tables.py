@@ -0,0 +1,158 @@
+"""
+Host check for the on-node routing-cost evaluator.
+
+Generates cost_model_tables.h, builds src/link_cost_model.c with the host C
+compiler, scores random raw node inputs and compares with the Gateway model
+(the compiled model from cost_model.py if present, otherwise lightgbm) on the
+features Gateway_main.py would compute from the same report.
+
+    python check_cost_tables.py [--rows 50000] [--cc cc]
+
+Passes when every row is within the Q16 leaf rounding bound
+(trees x 2^-17) of the Gateway prediction. Rows where the Gateway's float
+rounding of Drop_Rate / Pin lands on the other side of a .x5 tie are
+reported separately and must stay rare (MAX_TIE_FRACTION).
+"""
+import argparse
+import ctypes
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(HERE, '..')
+sys.path.insert(0, ROOT)
+
+from cost_model import load_cost_model  # noqa: E402
+from link_cost import link_features  # noqa: E402
+from gen_cost_tables import emit_header, FRAC_BITS  # noqa: E402
+
+N_FEATURES = 10  # LINK_COST_N_FEATURES
+MAX_TIE_FRACTION = 0.001
+
+DRIVER_C = r"""
+#include <stddef.h>
+#include "link_cost_model.h"
+
+static struct link_cost_input to_input(const int64_t *raw)
+{
+    struct link_cost_input in = {
+        .grad = (uint8_t)raw[0], .rssi = (int8_t)raw[1],
+        .link_up_s = (uint16_t)raw[2], .drop_count = (uint16_t)raw[3],
+        .fwd_count = (uint16_t)raw[4], .uptime_s = (uint32_t)raw[5],
+        .total_sent = (uint32_t)raw[6], .nb_count = (uint8_t)raw[7],
+    };
+    return in;
+}
+
+void check_score_batch(const int64_t *raw, size_t n, int32_t *out, int32_t *q)
+{
+    for (size_t i = 0; i < n; i++, raw += 8, q += LINK_COST_N_FEATURES) {
+        struct link_cost_input in = to_input(raw);
+
+        link_cost_model_features(&in, q);
+        out[i] = link_cost_model_score(&in);
+    }
+}
+"""
+
+
+def estimate_battery(uptime_s, tx_count):
+    """Same as Gateway_main.estimate_battery()."""
+    W_idle = 0.00005
+    W_tx = 0.002
+    battery_left = 100.0 - (uptime_s * W_idle + tx_count * W_tx)
+    return round(max(0.0, min(100.0, battery_left)), 1)
+
+
+def gateway_features(grad, rssi, link_up, drp, fwd, uptime, total_sent, nb_count):
+    """Feature row exactly as stage_topology_state() + node_link_rows() build it."""
+    total = drp + fwd
+    drop_rate = round((drp / total) * 100.0, 1) if total > 0 else 0.0
+    pin = estimate_battery(uptime, total_sent)
+    return link_features(grad, rssi, link_up, drop_rate, pin, drp, fwd, nb_count)
+
+
+def random_inputs(n, seed=1):
+    rnd = random.Random(seed)
+    rows = []
+    for _ in range(n):
+        link_up = rnd.choice([rnd.randint(0, 600), rnd.randint(0, 5000), rnd.randint(0, 65535)])
+        rows.append((rnd.randint(1, 4), rnd.randint(-95, -40), link_up,
+                     rnd.choice([0, rnd.randint(0, 60)]), rnd.randint(0, 220),
+                     rnd.randint(0, 400000), rnd.randint(0, 50000), rnd.randint(0, 17)))
+    return rows
+
+
+def build_lib(model_txt, workdir, cc):
+    hdr = os.path.join(workdir, 'cost_model_tables.h')
+    emit_header(model_txt, hdr)
+    drv = os.path.join(workdir, 'driver.c')
+    with open(drv, 'w') as f:
+        f.write(DRIVER_C)
+    lib = os.path.join(workdir, 'link_cost_model.so')
+    subprocess.run([cc, '-O2', '-Wall', '-Werror', '-shared', '-fPIC',
+                    '-I', os.path.join(ROOT, 'include'), '-I', workdir,
+                    os.path.join(ROOT, 'src', 'link_cost_model.c'), drv, '-o', lib], check=True)
+    return lib
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--model", default=os.path.join(HERE, 'routing_cost_model.txt'))
+    ap.add_argument("--rows", type=int, default=50000)
+    ap.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    args = ap.parse_args()
+
+    model, path, kind = load_cost_model([args.model])
+    if model is None:
+        print("[ERROR] No reference model (run cost_model.py or install lightgbm)")
+        sys.exit(1)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        lib = ctypes.CDLL(build_lib(args.model, tmp, args.cc))
+        lib.check_score_batch.restype = None
+        lib.check_score_batch.argtypes = [ctypes.c_void_p, ctypes.c_size_t,
+                                          ctypes.c_void_p, ctypes.c_void_p]
+
+        raw = random_inputs(args.rows)  # (grad, rssi, link_up, drp, fwd, uptime, total_sent, nb)
+        x = np.array(raw, dtype=np.int64)
+        out = np.empty(len(raw), dtype=np.int32)
+        q = np.empty((len(raw), N_FEATURES), dtype=np.int32)
+        lib.check_score_batch(x.ctypes.data, len(raw), out.ctypes.data, q.ctypes.data)
+
+    feats = np.array([gateway_features(*r) for r in raw], dtype=np.float64)
+    node = out.astype(np.float64) / (1 << FRAC_BITS)
+    ref = model.predict(feats)
+    err = np.abs(node - ref)
+
+    # Drop_Rate / Pin: the Gateway rounds a float to 0.1, the node rounds the exact
+    # ratio. They only disagree on exact .x5 ties; such rows may take another branch.
+    ties = np.zeros(len(raw), dtype=bool)
+    for slot in (5, 6):
+        ties |= q[:, slot] != np.round(feats[:, slot] * 10).astype(np.int32)
+
+    with open(args.model, encoding='utf-8') as f:
+        n_trees = sum(1 for line in f if line.startswith('Tree='))
+    bound = n_trees / 2 ** (FRAC_BITS + 1)
+    bad = np.flatnonzero((err > bound) & ~ties)
+
+    print(f"[check] reference: {kind} ({path})")
+    print(f"[check] {len(raw)} rows, max |node - gateway| = {err[~ties].max():.6f} "
+          f"(bound {bound:.6f}), mean = {err[~ties].mean():.6f}")
+    print(f"[check] {ties.sum()} rounding-tie rows, max |node - gateway| there = "
+          f"{err[ties].max() if ties.any() else 0:.4f}")
+    for i in bad[:10]:
+        print(f"  raw={raw[i]} node={node[i]:.4f} gateway={ref[i]:.4f}")
+    if len(bad) or ties.sum() > len(raw) * MAX_TIE_FRACTION:
+        print(f"[FAIL] {len(bad)} rows outside the quantization bound")
+        sys.exit(1)
+    print("[PASS]")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,198 @@
+"""
+Build-time generator: LightGBM text dump -> constant tables for the on-node
+fixed-point evaluator (src/link_cost_model.c, include/link_cost_model.h).
+
+    python gen_cost_tables.py routing_cost_model.txt cost_model_tables.h
+
+Invoked by CMakeLists.txt when CONFIG_BT_MESH_GRADIENT_LOCAL_COST=y.
+
+Every feature is an integer on the node (see LINK_COST_F_* in
+link_cost_model.h). For each split `x <= threshold` the generator stores the
+largest integer q such that the Gateway-side value of q still goes left, so a
+node that sees the same raw counters as the Gateway takes the same branch:
+  - Grad, RSSI, Link_UP, Drop_Count, Fwd_Count, Neighbor_Count: q = x
+  - Drop_Rate(%), Pin(%): tenths (the Gateway rounds both to 0.1)
+  - Link_Stability = log1p(Link_UP): monotone, compared on Link_UP seconds
+  - Load_Per_Neighbor = Fwd / (Neighbors + 1): Q16 fixed point
+Leaf values are Q16 (LINK_COST_FRAC_BITS) and summed in int32.
+"""
+import math
+import os
+import sys
+
+FRAC_BITS = 16
+
+# Feature order of the model (routing_cost_model_features.txt) -> node encoding
+FEATURES = [
+    # (name, kind, scale)
+    ('Grad', 'int', 1),
+    ('RSSI', 'int', 1),
+    ('Link_UP(s)', 'int', 1),
+    ('Drop_Count', 'int', 1),
+    ('Fwd_Count', 'int', 1),
+    ('Drop_Rate(%)', 'int', 10),
+    ('Pin(%)', 'int', 10),
+    ('Neighbor_Count', 'int', 1),
+    ('Link_Stability', 'log1p', 1),
+    ('Load_Per_Neighbor', 'int', 1 << FRAC_BITS),
+]
+
+LINK_UP_MAX = 65535  # Link uptime is reported as uint16 seconds
+INT32_MIN, INT32_MAX = -(1 << 31), (1 << 31) - 1
+
+NODE_FLAG_DEFAULT_LEFT = 1
+NODE_FLAG_MISSING_ZERO = 2
+
+# decision_type bits of LightGBM (include/LightGBM/tree.h)
+CATEGORICAL_MASK = 1
+DEFAULT_LEFT_MASK = 2
+MISSING_ZERO = 1
+
+
+class ModelCompileError(Exception):
+    pass
+
+
+def parse_model(text):
+    """(header, trees) from the text dump. Kept standalone (no numpy / lightgbm):
+    this runs inside the firmware build."""
+    header, trees, cur = {}, [], None
+    for line in text.splitlines():
+        line = line.strip()
+        if line == 'end of trees':
+            break
+        if line.startswith('Tree='):
+            cur = {}
+            trees.append(cur)
+        elif '=' in line:
+            key, val = line.split('=', 1)
+            (header if cur is None else cur)[key] = val
+
+    if header.get('objective', '').split()[:1] != ['regression']:
+        raise ModelCompileError("only plain regression models are supported")
+    if int(header.get('num_tree_per_iteration', 1)) != 1 or 'average_output' in header:
+        raise ModelCompileError("only single-output boosted models are supported")
+    for t in trees:
+        if int(t.get('num_cat', 0)) > 0 or int(t.get('is_linear', 0)):
+            raise ModelCompileError("categorical / linear trees are not supported")
+        t['num_leaves'] = int(t['num_leaves'])
+        t['leaf_value'] = [float(v) for v in t['leaf_value'].split()]
+        if t['num_leaves'] > 1:
+            for key in ('split_feature', 'decision_type', 'left_child', 'right_child'):
+                t[key] = [int(v) for v in t[key].split()]
+            t['threshold'] = [float(v) for v in t['threshold'].split()]
+    return header, trees
+
+
+def quantize_threshold(thr, kind, scale):
+    """Largest integer q whose Gateway-side value (q / scale, or log1p(q)) is <= thr."""
+    if kind == 'log1p':
+        if math.log1p(0) > thr:
+            return -1
+        lo, hi = 0, LINK_UP_MAX
+        while lo < hi:  # log1p is monotone: last q with log1p(q) <= thr
+            mid = (lo + hi + 1) // 2
+            if math.log1p(mid) <= thr:
+                lo = mid
+            else:
+                hi = mid - 1
+        return lo
+    q = math.floor(thr * scale)
+    while (q + 1) / scale <= thr:
+        q += 1
+    while q / scale > thr:
+        q -= 1
+    return max(INT32_MIN, min(INT32_MAX, q))
+
+
+def build_tables(text):
+    header, trees = parse_model(text)
+    names = header['feature_names'].split()
+    if names != [f[0] for f in FEATURES]:
+        raise ModelCompileError(f"feature list {names} does not match link_cost_model.h")
+
+    nodes, leaves, roots = [], [], []
+    for t in trees:
+        node_base, leaf_base = len(nodes), len(leaves)
+        leaves += [round(v * (1 << FRAC_BITS)) for v in t['leaf_value']]
+
+        def child(c):
+            return node_base + c if c >= 0 else ~(leaf_base + ~c)
+
+        if t['num_leaves'] == 1:
+            roots.append(~leaf_base)
+            continue
+        roots.append(node_base)
+        for i, f in enumerate(t['split_feature']):
+            dt = t['decision_type'][i]
+            if dt & CATEGORICAL_MASK:
+                raise ModelCompileError("categorical splits are not supported")
+            flags = NODE_FLAG_DEFAULT_LEFT if dt & DEFAULT_LEFT_MASK else 0
+            if (dt >> 2) & 3 == MISSING_ZERO:
+                flags |= NODE_FLAG_MISSING_ZERO
+            _, kind, scale = FEATURES[f]
+            nodes.append((quantize_threshold(t['threshold'][i], kind, scale),
+                          child(t['left_child'][i]), child(t['right_child'][i]), f, flags))
+
+    if len(nodes) > 32767 or len(leaves) > 32767:
+        raise ModelCompileError("model too large for int16 node indices")
+    # Worst-case running sum must fit the int32 accumulator
+    worst = 0
+    for t in trees:
+        worst += max(abs(v) for v in t['leaf_value'])
+    if worst * (1 << FRAC_BITS) >= INT32_MAX:
+        raise ModelCompileError("leaf sum overflows Q16 int32")
+    return header, nodes, leaves, roots
+
+
+def emit_header(model_path, out_path):
+    with open(model_path, encoding='utf-8') as f:
+        text = f.read()
+    _, nodes, leaves, roots = build_tables(text)
+
+    out = [
+        "/* Generated by ml_training/gen_cost_tables.py from",
+        f" * {os.path.basename(model_path)} - do not edit. */",
+        "",
+        "#ifndef COST_MODEL_TABLES_H__",
+        "#define COST_MODEL_TABLES_H__",
+        "",
+        f"#define COST_MODEL_N_TREES      {len(roots)}",
+        f"#define COST_MODEL_N_NODES      {len(nodes)}",
+        f"#define COST_MODEL_N_LEAVES     {len(leaves)}",
+        f"#define COST_MODEL_FRAC_BITS    {FRAC_BITS}",
+        "",
+        "static const int16_t cost_model_roots[COST_MODEL_N_TREES] = {",
+    ]
+    for i in range(0, len(roots), 12):
+        out.append("    " + " ".join(f"{r}," for r in roots[i:i + 12]))
+    out += ["};", "", "static const struct cost_model_node cost_model_nodes[COST_MODEL_N_NODES] = {"]
+    for thr, left, right, feat, flags in nodes:
+        out.append(f"    {{ {thr}, {left}, {right}, {feat}, {flags} }},")
+    out += ["};", "", "static const int32_t cost_model_leaves[COST_MODEL_N_LEAVES] = {"]
+    for i in range(0, len(leaves), 8):
+        out.append("    " + " ".join(f"{v}," for v in leaves[i:i + 8]))
+    out += ["};", "", "#endif /* COST_MODEL_TABLES_H__ */", ""]
+
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    with open(out_path, 'w', encoding='utf-8') as f:
+        f.write("\n".join(out))
+    return len(roots), len(nodes), len(leaves)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(f"usage: {sys.argv[0]} <model.txt> <out.h>")
+        sys.exit(2)
+    try:
+        n_trees, n_nodes, n_leaves = emit_header(sys.argv[1], sys.argv[2])
+    except (ModelCompileError, OSError) as e:
+        print(f"[ERROR] {e}")
+        sys.exit(1)
+    size = n_nodes * 12 + n_leaves * 4 + n_trees * 2
+    print(f"[gen_cost_tables] {n_trees} trees, {n_nodes} nodes, {n_leaves} leaves "
+          f"(~{size / 1024:.1f} KiB flash) -> {sys.argv[2]}")
+
+
+if __name__ == "__main__":
+    main()
@@ -222,6 +222,8 @@ if __name__ == '__main__':
         f.write('\n'.join(FEATURE_COLS))
     print(f"\n[Export] Model saved: {MODEL_OUTPUT}")
     print(f"[Export] Feature list: {feat_file}")
+    print("[Export] On the gateway host run `python cost_model.py` to rebuild the compiled model"
+          " (otherwise the gateway falls back to lightgbm)")
 
     demo_predict(model)
     print("\nDone!")
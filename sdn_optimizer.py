@@ -0,0 +1,132 @@
+"""
+Bộ tối ưu SDN (cost AI theo lô + SPT tăng dần) chạy trong một process riêng.
+
+Vòng asyncio của Gateway chỉ gửi báo cáo đã commit trong chu kỳ và nhận lại parent/cost
+mới; predict model và sửa SPT không chặn đọc UART hay websocket. Pool có đúng MỘT worker:
+model (LinkCostEngine) và DynamicSPT sống trong worker giữa các chu kỳ.
+
+Worker chết (BrokenProcessPool) -> tạo pool mới rồi phát lại báo cáo gần nhất của mọi node
+còn sống, nên SPT dựng lại đúng như trước. Không tạo được process -> chạy tại chỗ.
+"""
+import asyncio
+import multiprocessing
+import time
+from concurrent.futures import ProcessPoolExecutor
+from concurrent.futures.process import BrokenProcessPool
+
+from cost_model import load_cost_model
+from link_cost import LinkCostEngine
+from sdn_spt import DynamicSPT
+
+# ------------------------------------------
+# PHÍA WORKER
+# ------------------------------------------
+_state = None
+
+
+class _OptimizerState:
+    def __init__(self, root, model_paths):
+        model, self.model_path, self.model_kind = load_cost_model(model_paths)
+        self.root = root
+        self.cost_engine = LinkCostEngine(model)
+        self.spt = DynamicSPT(root)
+
+    def out_costs(self, node, parent, rows, link_costs):
+        """Cost AI cạnh ra của node (cùng tập cạnh với Master_Graph, kể cả cạnh parent ảo
+        cost 999 khi parent không có trong danh sách neighbor)."""
+        costs = {nb: link_costs[(node, nb)] for nb, _ in rows}
+        if parent != "0000" and parent != "ffff" and parent not in costs:
+            costs[parent] = 999
+        return costs
+
+    def cycle(self, reports, removed):
+        """reports = {node: (parent, [(neighbor, features)])}, removed = [node].
+        Một lần predict cho mọi link, sửa SPT, trả về kết quả cho vòng chính."""
+        t0 = time.perf_counter()
+        link_costs = self.cost_engine.costs(
+            [(node, nb, f) for node, (_, rows) in reports.items() for nb, f in rows])
+        t_pred = time.perf_counter() - t0
+
+        moved, log = set(), []
+        for node in removed:
+            moved.update(self.spt.remove_node(node))
+        for node, (parent, rows) in reports.items():
+            m = self.spt.update_node(node, self.out_costs(node, parent, rows, link_costs))
+            moved.update(m)
+            if m:
+                log.append((node, len(m), self.spt.touched))
+
+        # Parent + cost AI của mọi node cần đồng bộ lại SDN_Graph
+        nodes = {n: (self.spt.parent.get(n), dict(self.spt.out.get(n, {})))
+                 for n in set(reports) | moved if n != self.root}
+        return {"link_costs": link_costs, "moved": moved, "nodes": nodes, "log": log,
+                "t_pred": t_pred, "t_total": time.perf_counter() - t0}
+
+
+def _worker_init(root, model_paths):
+    global _state
+    _state = _OptimizerState(root, model_paths)
+
+
+def _worker_info():
+    return _state.model_path, _state.model_kind
+
+
+def _worker_cycle(reports, removed):
+    return _state.cycle(reports, removed)
+
+
+# ------------------------------------------
+# PHÍA GATEWAY
+# ------------------------------------------
+class SdnOptimizer:
+    def __init__(self, root, model_paths, use_process=True):
+        self.root = root
+        self.model_paths = model_paths
+        self.use_process = use_process
+        self.pool = None
+        self.local = None
+        self.reports = {}   # node -> báo cáo gần nhất (phát lại khi worker khởi động lại)
+        self.restarts = 0
+
+    def _start_pool(self):
+        # fork khi có (Linux/Pi): worker không import lại Gateway_main. Gọi start() trước khi
+        # có luồng nào khác để fork an toàn.
+        methods = multiprocessing.get_all_start_methods()
+        ctx = multiprocessing.get_context("fork" if "fork" in methods else "spawn")
+        self.pool = ProcessPoolExecutor(max_workers=1, mp_context=ctx, initializer=_worker_init,
+                                        initargs=(self.root, self.model_paths))
+        return self.pool.submit(_worker_info).result()
+
+    def start(self):
+        """Khởi động worker (chặn tới khi model đã nạp). Trả về (model_path, model_kind)."""
+        if self.use_process:
+            try:
+                return self._start_pool()
+            except (OSError, BrokenProcessPool) as e:
+                print(f"[SDN OPT] Không tạo được process worker ({e}) -> tối ưu tại chỗ")
+                self.use_process = False
+        _worker_init(self.root, self.model_paths)
+        self.local = _state
+        return self.local.model_path, self.local.model_kind
+
+    async def run_cycle(self, reports, removed):
+        for node in removed:
+            self.reports.pop(node, None)
+        self.reports.update(reports)
+        if not self.use_process:
+            return self.local.cycle(reports, removed)
+
+        loop = asyncio.get_running_loop()
+        try:
+            return await loop.run_in_executor(self.pool, _worker_cycle, reports, removed)
+        except BrokenProcessPool:
+            self.restarts += 1
+            print(f"[SDN OPT] Worker chết -> khởi động lại, phát lại {len(self.reports)} node")
+            self.pool.shutdown(wait=False)
+            await loop.run_in_executor(None, self._start_pool)
+            return await loop.run_in_executor(self.pool, _worker_cycle, dict(self.reports), [])
+
+    def shutdown(self):
+        if self.pool is not None:
+            self.pool.shutdown(wait=True, cancel_futures=True)
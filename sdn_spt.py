@@ -0,0 +1,169 @@
+"""
+Cây đường đi ngắn nhất (SPT) về Gateway cho bộ tối ưu SDN.
+
+Cạnh trong Master_Graph/SDN_Graph đi node -> neighbor (hướng uplink), cost ở cạnh đó.
+Thay vì chạy nx.shortest_path(node -> Gateway) cho từng node (N lần Dijkstra), chạy
+MỘT Dijkstra từ Gateway trên đồ thị đảo chiều: predecessor của node trong cây đảo
+chính là next-hop (parent) của node. Cả chu kỳ còn O(E log V).
+"""
+import heapq
+
+import networkx as nx
+
+
+def reverse_spt_parents(graph, root, weight='cost'):
+    """Parent tối ưu (next-hop về `root`) của mọi node đến được `root`.
+    Trả về (parents, dist): parents = {node: parent}, dist = {node: tổng cost về root}."""
+    pred, dist = nx.dijkstra_predecessor_and_distance(graph.reverse(copy=False), root,
+                                                      weight=weight)
+    return {n: p[0] for n, p in pred.items() if p}, dist
+
+
+def reported_parents(graph, nodes=None):
+    """Parent node đang dùng (cạnh is_parent đầu tiên), đọc theo adjacency.
+    `nodes` giới hạn tập node cần đọc (mặc định: cả đồ thị)."""
+    parents = {}
+    for node in graph if nodes is None else nodes:
+        for v, d in graph[node].items():
+            if d.get('is_parent', False):
+                parents[node] = v
+                break
+    return parents
+
+
+def mark_parents(graph, parents):
+    """Đặt is_parent trên các cạnh ra của từng node theo `parents` (node vắng mặt giữ nguyên)."""
+    for node, parent in parents.items():
+        for v, d in graph[node].items():
+            d['is_parent'] = (v == parent)
+
+
+def parent_delta(ai_parents, actual_parents, root):
+    """[(node, ai_parent)] cho node có parent thực tế khác parent AI đề xuất."""
+    return [(node, ai) for node, ai in ai_parents.items()
+            if node != root and actual_parents.get(node) not in (None, ai)]
+
+
+INF = float('inf')
+EPS = 1e-9
+
+
+class DynamicSPT:
+    """SPT về `root` được sửa tăng dần khi cost cạnh thay đổi (kiểu Ramalingam–Reps).
+
+    Mỗi lần một node báo cáo xong chỉ có cạnh ra của nó đổi (update_node). Cạnh giảm/thêm:
+    chạy Dijkstra từ các node được lợi, lan ngược theo cạnh vào. Cạnh parent tăng/mất: chỉ
+    cây con SPT bên dưới node đó bị vô hiệu hóa rồi nối lại từ phần còn đúng của cây.
+    Chi phí tỷ lệ với vùng bị ảnh hưởng, không phải kích thước mạng.
+    """
+
+    def __init__(self, root):
+        self.root = root
+        self.out = {root: {}}     # u -> {v: cost}  (cạnh uplink u -> v)
+        self.inc = {root: {}}     # v -> {u: cost}
+        self.dist = {root: 0.0}
+        self.parent = {root: None}
+        self.children = {}        # p -> {node có parent p}
+        self.touched = 0          # Số node Dijkstra đã đụng tới ở lần cập nhật gần nhất
+
+    def _ensure(self, n):
+        if n not in self.out:
+            self.out[n] = {}
+            self.inc[n] = {}
+            self.dist[n] = INF
+            self.parent[n] = None
+
+    def _set_parent(self, n, p, before):
+        old = self.parent[n]
+        if old == p:
+            return
+        before.setdefault(n, old)
+        if old is not None:
+            self.children[old].discard(n)
+        if p is not None:
+            self.children.setdefault(p, set()).add(n)
+        self.parent[n] = p
+
+    def apply(self, changes):
+        """changes = [(u, v, cost | None)]; None = xóa cạnh.
+        Trả về {node: parent mới} cho các node đổi parent (None = mất đường về root)."""
+        before = {}
+        invalid_roots, seeds = set(), set()
+        for u, v, c in changes:
+            self._ensure(u)
+            self._ensure(v)
+            old = self.out[u].get(v)
+            if c is None:
+                self.out[u].pop(v, None)
+                self.inc[v].pop(u, None)
+            else:
+                self.out[u][v] = c
+                self.inc[v][u] = c
+            if self.parent[u] == v and (c is None or c > old):
+                invalid_roots.add(u)
+            elif c is not None and (old is None or c < old):
+                seeds.add(u)
+
+        # Cây con bên dưới cạnh parent xấu đi: khoảng cách không còn đúng
+        affected, stack = set(), list(invalid_roots)
+        while stack:
+            x = stack.pop()
+            if x in affected:
+                continue
+            affected.add(x)
+            stack.extend(self.children.get(x, ()))
+        for x in affected:
+            self.dist[x] = INF
+            self._set_parent(x, None, before)
+
+        heap = []
+        for x in affected | seeds:
+            if x == self.root:
+                continue
+            best, bp = self.dist[x], None
+            for w, c in self.out[x].items():
+                nd = c + self.dist[w]
+                if nd < best - EPS:
+                    best, bp = nd, w
+            if bp is not None:
+                self.dist[x] = best
+                self._set_parent(x, bp, before)
+                heapq.heappush(heap, (best, x))
+
+        self.touched = len(affected)
+        while heap:
+            d, x = heapq.heappop(heap)
+            if d > self.dist[x]:
+                continue
+            self.touched += 1
+            for u, c in self.inc[x].items():
+                nd = d + c
+                if u != self.root and nd < self.dist[u] - EPS:
+                    self.dist[u] = nd
+                    self._set_parent(u, x, before)
+                    heapq.heappush(heap, (nd, u))
+
+        return {n: self.parent[n] for n, old in before.items() if self.parent[n] != old}
+
+    def update_node(self, node, out_costs):
+        """Thay toàn bộ cạnh ra của `node` bằng out_costs = {neighbor: cost}."""
+        self._ensure(node)
+        cur = self.out[node]
+        changes = [(node, v, None) for v in cur if v not in out_costs]
+        changes += [(node, v, c) for v, c in out_costs.items() if cur.get(v) != c]
+        return self.apply(changes)
+
+    def remove_node(self, node):
+        if node not in self.out or node == self.root:
+            return {}
+        changes = [(node, v, None) for v in self.out[node]]
+        changes += [(u, node, None) for u in self.inc[node]]
+        moved = self.apply(changes)
+        for m in (self.out, self.inc, self.dist, self.parent):
+            m.pop(node, None)
+        self.children.pop(node, None)
+        moved.pop(node, None)
+        return moved
+
+    def cost(self, u, v):
+        return self.out.get(u, {}).get(v)
@@ -0,0 +1,187 @@
+"""
+Giải mã frame nhị phân Sink -> Gateway (khớp include/sink_frame.h).
+
+    0x00 | COBS( Ver(1) Type(1) Body(N) CRC16(2, LE) ) | 0x00
+
+CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) trên Ver..Body = binascii.crc_hqx.
+Mỗi record được dịch lại thành đúng dòng text mà firmware in ở text mode
+(CSV_LOG,... / $[SENSOR] / $[TOPO] / $[TOPOD]), nên phần xử lý phía sau
+(TOPO_PATTERN, handle_stress_line, ...) không phải đổi.
+Byte nằm ngoài cặp 0x00 là text thường (shell, log) và được tách theo dòng.
+"""
+import binascii
+import struct
+
+SINK_FRAME_VERSION = 1
+
+FRAME_DATA = 1
+FRAME_HEARTBEAT = 2
+FRAME_SENSOR = 3
+FRAME_TOPO = 4
+FRAME_TOPO_DELTA = 5
+FRAME_REPORT = 6
+FRAME_LATENCY = 7
+FRAME_PONG = 8
+FRAME_RSP = 9
+
+LAT_METRIC_NAMES = {0: "RTT", 1: "BACKPROP", 2: "BACKPROP_HOP"}
+
+MAX_TEXT_LINE = 1024  # Dòng text không có '\n' dài hơn thế này bị bỏ
+
+
+def cobs_decode(data):
+    """Giải COBS (không gồm delimiter). Trả về bytes, None nếu hỏng."""
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        code = data[i]
+        if code == 0 or i + code > n:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < n:
+            out.append(0)
+    return bytes(out)
+
+
+def _nbs(body, off, count):
+    items = []
+    for _ in range(count):
+        addr, rssi, grad, up = struct.unpack_from("<HbBH", body, off)
+        items.append(f"[{addr:04X},{rssi},{grad},{up}]")
+        off += 6
+    return items, off
+
+
+def frame_to_line(ftype, body):
+    """Dịch một record thành dòng text tương ứng của text mode."""
+    if ftype == FRAME_DATA:
+        src, via, seq, hop, rssi = struct.unpack_from("<HHHBb", body)
+        return f"CSV_LOG,DATA,0x{src:04x},0x{via:04x},{seq},{hop},0,{rssi}"
+
+    if ftype == FRAME_HEARTBEAT:
+        src, via, hop = struct.unpack_from("<HHB", body)
+        return f"CSV_LOG,SENSOR_DATA,0x{src:04x},0x{via:04x},{hop},0"
+
+    if ftype == FRAME_SENSOR:
+        src, count = struct.unpack_from("<HB", body)
+        line = f"$[SENSOR],0x{src:04X},{count}"
+        for k in range(count):
+            sid, val = struct.unpack_from("<Bh", body, 3 + 3 * k)
+            line += f",[{sid},{val}]"
+        return line
+
+    if ftype == FRAME_TOPO:
+        (origin, seq, total, page, grad, parent, drops, fwd, uptime, sent, ver,
+         n) = struct.unpack_from("<HBBBBHHHIIBB", body)
+        items, _ = _nbs(body, 22, n)
+        return (f"$[TOPO],{origin:04X},{seq},{total},{page},{n},{grad},{parent:04X},"
+                f"{drops},{fwd},{uptime},{sent},{ver}" + "".join("," + it for it in items))
+
+    if ftype == FRAME_TOPO_DELTA:
+        (origin, seq, flags, base, ver, grad, parent, drops, fwd, uptime, sent,
+         n_upd) = struct.unpack_from("<HBBBBBHHHIIB", body)
+        items, off = _nbs(body, 22, n_upd)
+        n_rem = body[off]
+        rems = struct.unpack_from(f"<{n_rem}H", body, off + 1)
+        return (f"$[TOPOD],{origin:04X},{seq},{flags},{base},{ver},{grad},{parent:04X},"
+                f"{drops},{fwd},{uptime},{sent}"
+                + "".join("," + it for it in items)
+                + "".join(f",-[{a:04X}]" for a in rems))
+
+    if ftype == FRAME_REPORT:
+        src, *vals = struct.unpack_from("<H9I", body)
+        return f"CSV_LOG,REPORT,0x{src:04x}," + ",".join(str(v) for v in vals)
+
+    if ftype == FRAME_LATENCY:
+        src, metric, hops, count, p50, p90, p99, mx = struct.unpack_from("<HBBIHHHH", body)
+        name = LAT_METRIC_NAMES.get(metric, "UNKNOWN")
+        return f"CSV_LOG,LATENCY,0x{src:04x},{name},{hops},{count},{p50},{p90},{p99},{mx}"
+
+    if ftype == FRAME_PONG:
+        dest, seq, err = struct.unpack_from("<HHb", body)
+        return f"CSV_LOG,PONG,0x{dest:04x},{seq},{err}"
+
+    if ftype == FRAME_RSP:
+        rid, status = struct.unpack_from("<Hh", body)
+        return f"$[RSP],{rid},{status}"
+
+    return None
+
+
+class SinkFrameReader:
+    """Tách luồng byte UART thành dòng text; frame hợp lệ được dịch sang text."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.frames = 0
+        self.crc_errors = 0
+        self.bad_frames = 0
+
+    def _decode(self, chunk):
+        raw = cobs_decode(chunk)
+        if raw is None or len(raw) < 4:
+            self.bad_frames += 1
+            return None
+        payload, crc = raw[:-2], struct.unpack_from("<H", raw, len(raw) - 2)[0]
+        if binascii.crc_hqx(payload, 0xFFFF) != crc:
+            self.crc_errors += 1
+            return None
+        if payload[0] != SINK_FRAME_VERSION:
+            self.bad_frames += 1
+            return None
+        try:
+            line = frame_to_line(payload[1], payload[2:])
+        except (struct.error, IndexError):
+            line = None
+        if line is None:
+            self.bad_frames += 1
+            return None
+        self.frames += 1
+        return line
+
+    def _text_lines(self, data):
+        text = data.decode('utf-8', errors='ignore')
+        return [l.strip() for l in text.split('\n') if l.strip()]
+
+    def feed(self, data):
+        """Nạp byte mới, trả về list dòng text hoàn chỉnh (theo thứ tự nhận)."""
+        self.buf += data
+        lines = []
+        while True:
+            start = self.buf.find(0)
+            if start < 0:
+                # Chỉ có text: lấy đến '\n' cuối cùng, giữ phần dở dang
+                end = self.buf.rfind(b'\n')
+                if end >= 0:
+                    lines += self._text_lines(self.buf[:end])
+                    del self.buf[:end + 1]
+                elif len(self.buf) > MAX_TEXT_LINE:
+                    self.buf.clear()
+                break
+
+            if start > 0:
+                # Text trước frame (hoặc đuôi frame bị mất đồng bộ)
+                lines += self._text_lines(self.buf[:start])
+                del self.buf[:start]
+                continue
+
+            end = self.buf.find(0, 1)
+            if end < 0:
+                if len(self.buf) > 2 * MAX_TEXT_LINE:
+                    self.buf.clear()  # Không bao giờ đóng frame: bỏ
+                break
+            if end == 1:
+                # 0x00 0x00: hết frame trước + mở frame sau -> giữ byte sau
+                del self.buf[:1]
+                continue
+
+            line = self._decode(bytes(self.buf[1:end]))
+            if line:
+                lines.append(line)
+                del self.buf[:end + 1]
+            else:
+                # Frame hỏng / mất đồng bộ: 0x00 này có thể là mở của frame kế
+                del self.buf[:end]
+        return lines
@@ -0,0 +1,135 @@
+"""
+UART Gateway <-> Sink trên vòng asyncio.
+
+Reader và writer độc lập, không có lock chung:
+  - Reader: fd của cổng serial ở chế độ non-blocking + loop.add_reader; byte được giải
+    (SinkFrameReader) và từng dòng chuyển cho on_line ngay khi tới, không poll in_waiting.
+    Nền tảng không có add_reader cho serial (Windows / ProactorEventLoop): một luồng
+    executor chặn ở ser.read() và trả chunk về vòng, vẫn không có chu kỳ poll.
+  - Writer: một task duy nhất ghi hàng đợi tx; write_line() không chặn, gọi được từ
+    bất kỳ coroutine/callback nào trong vòng. Dòng liền nhau được gộp vào một lần write.
+"""
+import asyncio
+import os
+
+from sink_frame import SinkFrameReader
+
+READ_CHUNK = 4096
+WRITE_COALESCE = 1024   # Byte tối đa gộp vào một lần write
+
+
+class SinkLink:
+    def __init__(self, ser, on_line):
+        self.ser = ser
+        self.on_line = on_line
+        self.frames = SinkFrameReader()
+        self.tx = asyncio.Queue()
+        self.stats = {"rx_bytes": 0, "rx_lines": 0, "tx_bytes": 0, "tx_writes": 0,
+                      "tx_blocked": 0}
+
+    def write_line(self, line):
+        self.tx.put_nowait(f"{line}\r\n".encode())
+
+    def _fileno(self):
+        try:
+            return self.ser.fileno()
+        except (AttributeError, OSError, ValueError):
+            return None
+
+    async def run(self):
+        """Chạy reader + writer tới khi bị hủy."""
+        loop = asyncio.get_running_loop()
+        fd = self._fileno()
+        if fd is not None:
+            try:
+                os.set_blocking(fd, False)
+                loop.add_reader(fd, self._on_readable, fd)
+            except (NotImplementedError, OSError):
+                fd = None
+        if fd is None:
+            await asyncio.gather(self._thread_reader(), self._writer(None))
+            return
+        try:
+            await self._writer(fd)
+        finally:
+            loop.remove_reader(fd)
+
+    # ---------------- Reader ----------------
+    def _feed(self, chunk):
+        self.stats["rx_bytes"] += len(chunk)
+        for line in self.frames.feed(chunk):
+            self.stats["rx_lines"] += 1
+            try:
+                self.on_line(line)
+            except Exception as e:
+                print(f"[UART RX] Lỗi xử lý dòng: {e} | {line[:80]}")
+
+    def _on_readable(self, fd):
+        try:
+            chunk = os.read(fd, READ_CHUNK)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError as e:
+            print(f"[UART RX] Lỗi đọc: {e}")
+            asyncio.get_running_loop().remove_reader(fd)
+            return
+        if not chunk:
+            print("[UART RX] Cổng serial đã đóng (EOF)")
+            asyncio.get_running_loop().remove_reader(fd)
+            return
+        self._feed(chunk)
+
+    def _read_blocking(self):
+        # Chặn tối đa ser.timeout cho byte đầu tiên, rồi lấy hết phần đã có trong buffer
+        chunk = self.ser.read(1)
+        waiting = self.ser.in_waiting if chunk else 0
+        return chunk + self.ser.read(waiting) if waiting else chunk
+
+    async def _thread_reader(self):
+        loop = asyncio.get_running_loop()
+        while True:
+            try:
+                chunk = await loop.run_in_executor(None, self._read_blocking)
+            except Exception as e:
+                print(f"[UART RX] Lỗi đọc: {e}")
+                await asyncio.sleep(1)
+                continue
+            if chunk:
+                self._feed(chunk)
+
+    # ---------------- Writer ----------------
+    async def _write_fd(self, fd, data):
+        loop = asyncio.get_running_loop()
+        view = memoryview(data)
+        while view:
+            try:
+                n = os.write(fd, view)
+                view = view[n:]
+                continue
+            except (BlockingIOError, InterruptedError):
+                pass
+            # Buffer TX của driver đầy: chờ fd ghi được, không chặn vòng
+            self.stats["tx_blocked"] += 1
+            ready = loop.create_future()
+            loop.add_writer(fd, lambda: ready.done() or ready.set_result(None))
+            try:
+                await ready
+            finally:
+                loop.remove_writer(fd)
+
+    async def _writer(self, fd):
+        loop = asyncio.get_running_loop()
+        while True:
+            data = await self.tx.get()
+            while not self.tx.empty() and len(data) < WRITE_COALESCE:
+                data += self.tx.get_nowait()
+            try:
+                if fd is not None:
+                    await self._write_fd(fd, data)
+                else:
+                    await loop.run_in_executor(None, self.ser.write, data)
+            except OSError as e:
+                print(f"[UART TX] Lỗi ghi: {e}")
+                continue
+            self.stats["tx_bytes"] += len(data)
+            self.stats["tx_writes"] += 1
@@ -0,0 +1,142 @@
+"""
+Client RPC Gateway -> Sink qua lệnh shell "mesh rpc <id> <cmd> [args...]".
+
+Sink trả "$[RSP],<id>,<status>" (text hoặc frame SINK_FRAME_RSP, xem sink_frame.py)
+ngay khi lệnh đã vào hàng đợi mesh. Client giữ tối đa `window` yêu cầu cùng lúc
+(và không quá `max_bytes` byte chưa được trả lời, để không tràn ring RX của shell),
+ghép phản hồi theo id, gửi lại khi Sink báo hàng đợi đầy (-ENOBUFS / -EBUSY).
+
+[UPD] Chạy trên vòng asyncio của Gateway: không có luồng timer hay lock, timeout và
+gửi lại là call_later; on_line() được gọi thẳng từ reader UART trong cùng vòng.
+"""
+import asyncio
+import time
+
+# errno của Zephyr (lib/libc/minimal/include/errno.h)
+EBUSY = 16
+ENOBUFS = 105
+RPC_RETRY_STATUS = (-ENOBUFS, -EBUSY)
+
+RPC_TIMEOUT = object()  # status khi không nhận được $[RSP] trong hạn
+
+
+class RpcRequest:
+    def __init__(self, rid, cmd, loop):
+        self.id = rid
+        self.cmd = cmd
+        self.line = f"mesh rpc {rid} {cmd}"
+        self.status = None
+        self.attempts = 0
+        self.sent_at = 0.0
+        self.timer = None
+        self.done = loop.create_future()
+
+    @property
+    def ok(self):
+        return self.status == 0
+
+    async def wait(self, timeout=None):
+        await asyncio.wait([self.done], timeout=timeout)
+        return self.status
+
+
+class SinkRpcClient:
+    def __init__(self, write_line, window=8, max_bytes=768, timeout=3.0,
+                 retries=5, backoff=0.05):
+        self.write_line = write_line  # Không chặn (xếp vào hàng đợi của writer UART)
+        self.window = window
+        self.max_bytes = max_bytes
+        self.timeout = timeout
+        self.retries = retries
+        self.backoff = backoff
+        self.inflight = {}   # id -> RpcRequest đang chờ $[RSP]
+        self.retry_q = []    # RpcRequest đã tới hạn gửi lại, chờ chỗ trong cửa sổ
+        self.waiters = []    # Future của submit() đang chờ chỗ trong cửa sổ
+        self.next_id = 1
+        self.stats = {"sent": 0, "ok": 0, "err": 0, "retry": 0, "timeout": 0}
+
+    def _inflight_bytes(self):
+        return sum(len(r.line) + 2 for r in self.inflight.values())
+
+    def _has_room(self, req):
+        if not self.inflight:
+            return True
+        return (len(self.inflight) < self.window and
+                self._inflight_bytes() + len(req.line) + 2 <= self.max_bytes)
+
+    def _send(self, req):
+        loop = asyncio.get_running_loop()
+        req.attempts += 1
+        req.sent_at = time.time()
+        self.inflight[req.id] = req
+        self.stats["sent"] += 1
+        req.timer = loop.call_later(self.timeout, self._on_timeout, req)
+        self.write_line(req.line)
+
+    def _wake(self):
+        """Cửa sổ vừa có chỗ: lệnh gửi lại đi trước, rồi đánh thức submit() đang chờ."""
+        while self.retry_q and self._has_room(self.retry_q[0]):
+            self._send(self.retry_q.pop(0))
+        waiters, self.waiters = self.waiters, []
+        for fut in waiters:
+            if not fut.done():
+                fut.set_result(None)
+
+    async def submit(self, cmd):
+        """Gửi lệnh (không có tiền tố "mesh "), chỉ chờ khi cửa sổ đầy."""
+        loop = asyncio.get_running_loop()
+        rid = self.next_id
+        self.next_id = self.next_id % 0xFFFF + 1
+        req = RpcRequest(rid, cmd, loop)
+        while self.retry_q or not self._has_room(req):
+            fut = loop.create_future()
+            self.waiters.append(fut)
+            await fut
+        self._send(req)
+        return req
+
+    async def call(self, cmd, timeout=None):
+        return await (await self.submit(cmd)).wait(timeout)
+
+    async def wait_all(self, reqs, timeout=None):
+        if reqs:
+            await asyncio.wait([r.done for r in reqs], timeout=timeout)
+        return [r.status for r in reqs]
+
+    def _finish(self, req, status):
+        req.status = status
+        key = "ok" if status == 0 else ("timeout" if status is RPC_TIMEOUT else "err")
+        self.stats[key] += 1
+        if not req.done.done():
+            req.done.set_result(status)
+
+    def _on_timeout(self, req):
+        # Không gửi lại: lệnh có thể đã chạy, chỉ mất phản hồi
+        if self.inflight.get(req.id) is req:
+            del self.inflight[req.id]
+            self._finish(req, RPC_TIMEOUT)
+            self._wake()
+
+    def _retry(self, req):
+        self.retry_q.append(req)
+        self._wake()
+
+    def on_line(self, line):
+        """Xử lý dòng "$[RSP],<id>,<status>"; trả về True nếu đã tiêu thụ."""
+        if not line.startswith("$[RSP],"):
+            return False
+        try:
+            _, rid, status = line.split(",")[:3]
+            rid, status = int(rid), int(status)
+        except ValueError:
+            return True
+        req = self.inflight.pop(rid, None)
+        if req is not None:
+            req.timer.cancel()
+            if status in RPC_RETRY_STATUS and req.attempts <= self.retries:
+                asyncio.get_running_loop().call_later(self.backoff * req.attempts, self._retry, req)
+                self.stats["retry"] += 1
+            else:
+                self._finish(req, status)
+        self._wake()
+        return True
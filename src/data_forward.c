@@ -8,6 +8,10 @@
 #include "neighbor_table.h"
 #include "led_indication.h"
 #include "packet_stats.h"
+#include "gtrace.h"
+#if defined(CONFIG_BT_MESH_GRADIENT_LOCAL_COST)
+#include "link_cost_model.h"
+#endif
 #include <zephyr/bluetooth/mesh.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
@@ -39,54 +43,108 @@ static int data_send_internal(struct bt_mesh_gradient_srv *gradient_srv,
                               uint16_t data, uint8_t hop_count,
                               int8_t path_min_rssi);
 
+#if defined(CONFIG_BT_MESH_GRADIENT_LOCAL_COST)
+/** Valid neighbors as counted in $[TOPO] (the model's Neighbor_Count) */
+static uint8_t local_nb_count(const struct fwd_view *view, int64_t now)
+{
+    uint8_t count = 0;
+
+    for (int i = 0; i < view->nb_count && count < TOPO_REP_MAX_NEIGHBORS; i++) {
+        if ((now - view->nb[i].last_seen) <= CONFIG_BT_MESH_GRADIENT_SRV_NODE_TIMEOUT_MS) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Predicted routing cost (Q16) of the link to @p nb, from the same
+ *        values this node reports in $[TOPO]. The last chosen parent gets
+ *        the hysteresis bonus.
+ */
+static int32_t local_link_cost(const struct bt_mesh_gradient_srv *srv,
+                               const neighbor_entry_t *nb, uint8_t nb_count,
+                               int64_t now)
+{
+    int64_t link_up_s = (now - nb->first_seen) / 1000;
+    struct link_cost_input in = {
+        .grad = srv->gradient,
+        .rssi = nb->rssi,
+        .link_up_s = (uint16_t)MIN(link_up_s, UINT16_MAX),
+        .drop_count = srv->topo_ctx.drop_count_snapshot,
+        .fwd_count = srv->topo_ctx.fwd_rate_snapshot,
+        .uptime_s = (uint32_t)(now / 1000),
+        .total_sent = srv->topo_ctx.total_sent_snapshot,
+        .nb_count = nb_count,
+    };
+    int32_t cost = link_cost_model_score(&in);
+
+    if (nb->addr == last_parent_addr) {
+        cost -= CONFIG_BT_MESH_GRADIENT_LOCAL_COST_HYSTERESIS << LINK_COST_FRAC_BITS;
+    }
+    return cost;
+}
+#endif
+
 /**
  * @brief Find the BEST Parent strictly for Uplink Routing
- * * Scans the entire table to find a neighbor with:
+ * * An SDN flow rule matching (flow_src, flow_class) wins if its next hop
+ * is in the table. Otherwise scans the entire table to find a neighbor with:
  * 1. Gradient < My Gradient (CRITICAL CONDITION)
  * 2. Best Gradient among valid candidates
- * 3. Best RSSI among ties
+ * 3. Best RSSI among ties (lowest on-node model cost with
+ *    CONFIG_BT_MESH_GRADIENT_LOCAL_COST)
+ * * Reads the published forwarding table view, so callers need not (and
+ * should not) hold forwarding_table_mutex.
  * * @param srv Pointer to gradient server
  * @param exclude_addr Address to exclude (e.g., the sender)
- * @return Pointer to best entry, or NULL if no VALID PARENT found.
+ * @param flow_src Original source of the packet (flow match)
+ * @param flow_class SDN_FLOW_CLASS_* of the packet (flow match)
+ * @param out Optional copy of the chosen neighbor entry
+ * @return Parent address, or BT_MESH_ADDR_UNASSIGNED if no VALID PARENT found.
  */
-const neighbor_entry_t *find_strict_upstream_parent(
-    struct bt_mesh_gradient_srv *srv, uint16_t exclude_addr)
+uint16_t find_strict_upstream_parent(
+    struct bt_mesh_gradient_srv *srv, uint16_t exclude_addr,
+    uint16_t flow_src, uint8_t flow_class, neighbor_entry_t *out)
 {
     const neighbor_entry_t *best_candidate = NULL;
+    uint16_t addr = BT_MESH_ADDR_UNASSIGNED;
     uint8_t my_gradient = srv->gradient;
 
     /* If I am uninitialized, I cannot route properly */
     if (my_gradient == UINT8_MAX) {
-        return NULL;
+        return addr;
     }
 
-    /* [SDN AI] Check if we have an active SDN route */
-    if (srv->sdn_next_hop_active != BT_MESH_ADDR_UNASSIGNED && srv->sdn_next_hop_active != 0) {
-        /* [NEW] Check Soft-state expiry (5 minute TTL) */
-        if (k_uptime_get() < srv->sdn_route_expiry) {
-            /* We must return the neighbor_entry_t from the table. */
-            for (int i = 0; i < CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE; i++) {
-                if (srv->forwarding_table[i].addr == srv->sdn_next_hop_active) {
-                    return &srv->forwarding_table[i];
-                }
-            }
-            /* If not in table, fall back to default dynamic routing */
-            LOG_WRN("[AI SDN] Failed to find active NextHop 0x%04x in Forwarding Table. Falling back.", srv->sdn_next_hop_active);
-        } else {
-            LOG_WRN("[AI SDN] Route for 0x%04x expired (TTL). Reverting to Gradient.", srv->sdn_next_hop_active);
-            srv->sdn_next_hop_active = BT_MESH_ADDR_UNASSIGNED;
-            srv->sdn_route_expiry = 0;
+    /* [NEW] Scan the published view: no forwarding_table_mutex on the RX path */
+    const struct fwd_view *view = fwd_view_acquire(&srv->fwd_view);
+
+    /* [SDN AI] Check if a live flow rule steers this packet (expired rules
+     * are dropped by the lookup: soft state, reverts to Gradient) */
+    uint16_t sdn_next_hop = sdn_flow_lookup(&srv->sdn_flows, flow_src, flow_class);
+
+    if (sdn_next_hop != BT_MESH_ADDR_UNASSIGNED && sdn_next_hop != exclude_addr) {
+        /* The flow next hop must still be a neighbor */
+        best_candidate = fwd_view_find_neighbor(view, sdn_next_hop);
+        if (best_candidate != NULL) {
+            goto out;
         }
+        /* If not in table, fall back to default dynamic routing */
+        LOG_WRN("[AI SDN] Failed to find flow NextHop 0x%04x in Forwarding Table. Falling back.", sdn_next_hop);
     }
 
+#if defined(CONFIG_BT_MESH_GRADIENT_LOCAL_COST)
+    /* [NEW] Costs are only computed for gradient ties, at most once per entry */
+    int64_t now = k_uptime_get();
+    uint8_t nb_count = local_nb_count(view, now);
+    int32_t best_cost = 0;
+    bool best_cost_valid = false;
+#endif
+
     /* Fallback exactly as before */
-    for (int i = 0; i < CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE; i++) {
-        const neighbor_entry_t *entry = nt_get(
-            (const neighbor_entry_t *)srv->forwarding_table,
-            CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-            i);
+    for (int i = 0; i < view->nb_count; i++) {
+        const neighbor_entry_t *entry = &view->nb[i];
 
-        if (!entry) continue;
         if (entry->addr == exclude_addr) continue;
 
         /* --- THE LAW: STRICT UPLINK RULE --- */
@@ -103,7 +161,25 @@ const neighbor_entry_t *find_strict_upstream_parent(
             /* Prioritize Lower Gradient */
             if (entry->gradient < best_candidate->gradient) {
                 best_candidate = entry;
+#if defined(CONFIG_BT_MESH_GRADIENT_LOCAL_COST)
+                best_cost_valid = false;
+#endif
             }
+#if defined(CONFIG_BT_MESH_GRADIENT_LOCAL_COST)
+            /* [NEW] Tie-break with the on-node routing cost model */
+            else if (entry->gradient == best_candidate->gradient) {
+                int32_t cost = local_link_cost(srv, entry, nb_count, now);
+
+                if (!best_cost_valid) {
+                    best_cost = local_link_cost(srv, best_candidate, nb_count, now);
+                    best_cost_valid = true;
+                }
+                if (cost < best_cost) {
+                    best_candidate = entry;
+                    best_cost = cost;
+                }
+            }
+#else
             /* Tie-break with RSSI */
             else if (entry->gradient == best_candidate->gradient) {
                 // [HYSTERESIS STABILITY FIX]
@@ -126,10 +202,20 @@ const neighbor_entry_t *find_strict_upstream_parent(
                     best_candidate = entry;
                 }
             }
+#endif
         }
     }
 
-    return best_candidate;
+out:
+    if (best_candidate != NULL) {
+        addr = best_candidate->addr;
+        if (out != NULL) {
+            *out = *best_candidate;
+        }
+    }
+    fwd_view_release(&srv->fwd_view, view);
+
+    return addr;
 }
 
 static void data_send_end_cb(int err, void *user_data)
@@ -143,8 +229,9 @@ static void data_send_end_cb(int err, void *user_data)
            Retrying blindly causes loops. We just fail. 
            Reliability is handled by upper layers or next periodic send. */
     } else {
-        LOG_INF("[TX Complete] SUCCESS sent to 0x%04x", dest_addr);
+        LOG_DBG("[TX Complete] SUCCESS sent to 0x%04x", dest_addr);
     }
+    GTRACE(GT_DATA_TX_DONE, err != 0, dest_addr, -err, 0);
     
     /* Always clear active flag (REMOVED: handled by Zephyr queue) */
     // ctx->active = false;
@@ -177,10 +264,11 @@ static int data_send_internal(struct bt_mesh_gradient_srv *gradient_srv,
     net_buf_simple_add_u8(&buf, hop_count);
     net_buf_simple_add_u8(&buf, (uint8_t)path_min_rssi);
     
-    /* [DIAGNOSTIC] Hex-dump outgoing DATA message */
-    LOG_HEXDUMP_INF(buf.data, buf.len, "DATA TX Payload:");
+    /* [DIAGNOSTIC] Hex-dump outgoing DATA message (per packet: DBG only) */
+    LOG_HEXDUMP_DBG(buf.data, buf.len, "DATA TX Payload:");
 
-    LOG_INF("[TX] To 0x%04x: Src=0x%04x, Seq=%d, Hops=%d, MinRSSI=%d", 
+    GTRACE(GT_DATA_TX, hop_count, addr, original_source, data);
+    LOG_DBG("[TX] To 0x%04x: Src=0x%04x, Seq=%d, Hops=%d, MinRSSI=%d", 
             addr, original_source, data, hop_count, path_min_rssi);
     
     int err = bt_mesh_model_send(gradient_srv->model, &ctx, &buf, 
@@ -224,9 +312,11 @@ int data_forward_send(struct bt_mesh_gradient_srv *gradient_srv,
     // }
 
     /* Logic: Tìm cha tốt nhất theo hướng Uplink (về Sink) */
-    const neighbor_entry_t *best_parent = find_strict_upstream_parent(gradient_srv, sender_addr);
+    neighbor_entry_t best_parent;
 
-    if (best_parent == NULL) {
+    if (find_strict_upstream_parent(gradient_srv, sender_addr, original_source,
+                                    SDN_FLOW_CLASS_DATA, &best_parent) ==
+        BT_MESH_ADDR_UNASSIGNED) {
         LOG_ERR("[Forward] DROP! No valid PARENT found (neighbors have >= gradient %d)", 
                 gradient_srv->gradient);
         return -ENETUNREACH;
@@ -240,19 +330,20 @@ int data_forward_send(struct bt_mesh_gradient_srv *gradient_srv,
     data_send_ctx.gradient_srv = gradient_srv;
     data_send_ctx.data = data;
     data_send_ctx.original_source = original_source;
-    data_send_ctx.target_addr = best_parent->addr;
+    data_send_ctx.target_addr = best_parent.addr;
     // data_send_ctx.active = true;
     
-    LOG_INF("[Forward] Relay via 0x%04x (Grad: %d) Seq: %d, Hops: %d -> %d", 
-            best_parent->addr, best_parent->gradient, data, 
+    GTRACE(GT_DATA_FWD, next_hop_count, best_parent.addr, original_source, data);
+    LOG_DBG("[Forward] Relay via 0x%04x (Grad: %d) Seq: %d, Hops: %d -> %d", 
+            best_parent.addr, best_parent.gradient, data, 
             hop_count_received, next_hop_count);
     
     /* [NEW] Đếm số bản tin chuyển tiếp */
     pkt_stats_inc_data_fwd();
-    last_parent_addr = best_parent->addr;
+    last_parent_addr = best_parent.addr;
     
     /* Gửi đi với giá trị hop_count mới và min_rssi đã cập nhật (Timestamp removed) */
-    int err = data_send_internal(gradient_srv, best_parent->addr, original_source, 
+    int err = data_send_internal(gradient_srv, best_parent.addr, original_source, 
                                  data, next_hop_count, path_min_rssi);
 
     if (err) {
@@ -284,16 +375,15 @@ int data_forward_send_direct(struct bt_mesh_gradient_srv *gradient_srv,
 
     /* FIX: Even for direct send (Heartbeat/Data), strictly use Upstream Parent */
     /* Ignore 'addr' parameter as this is for Uplink Data */
-    const neighbor_entry_t *best_parent = find_strict_upstream_parent(gradient_srv, BT_MESH_ADDR_UNASSIGNED);
+    uint16_t nexthop = find_strict_upstream_parent(
+        gradient_srv, BT_MESH_ADDR_UNASSIGNED, my_addr, SDN_FLOW_CLASS_DATA, NULL);
     
-    if (best_parent == NULL) {
+    if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
         LOG_WRN("[Direct] No Uplink Route! (Gradient %d, no lower neighbor)", 
                 gradient_srv->gradient);
         return -ENETUNREACH;
     }
     
-    uint16_t nexthop = best_parent->addr;
-    
     /* [NEW] Khởi tạo Hop Count = 1 cho gói tin gốc */
     uint8_t initial_hop_count = 1;
     
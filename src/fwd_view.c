@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file fwd_view.c
+ * @brief Double-buffered forwarding table view (publish / acquire / release)
+ */
+
+#include "fwd_view.h"
+#include "reverse_routing.h"
+#include "gtrace.h"
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(fwd_view, LOG_LEVEL_INF);
+
+/*============================================================================*/
+/* Public Functions                                                           */
+/*============================================================================*/
+
+void fwd_view_init(struct fwd_view_pub *pub)
+{
+    memset(pub, 0, sizeof(*pub));
+}
+
+void fwd_view_publish(struct fwd_view_pub *pub, const neighbor_entry_t *table,
+                      size_t table_size)
+{
+    int next = !atomic_get(&pub->cur);
+    struct fwd_view *v = &pub->buf[next];
+
+    /* Readers pinned here picked it up before the previous swap; they only
+     * scan a few hundred bytes, so this is a short wait at most */
+    while (atomic_get(&pub->readers[next]) != 0) {
+        k_sleep(K_MSEC(1));
+    }
+
+    v->nb_count = 0;
+    v->route_count = 0;
+    v->routes_truncated = false;
+
+    for (size_t i = 0; i < table_size && v->nb_count < ARRAY_SIZE(v->nb); i++) {
+        if (table[i].addr == GR_ADDR_UNASSIGNED) {
+            continue;
+        }
+
+        v->nb[v->nb_count] = table[i];
+        v->nb[v->nb_count].backprop_dest = NULL;
+        v->nb_count++;
+
+        for (const backprop_node_t *n = table[i].backprop_dest; n != NULL; n = n->next) {
+            if (v->route_count >= ARRAY_SIZE(v->routes)) {
+                v->routes_truncated = true;
+                break;
+            }
+            v->routes[v->route_count++] = (struct fwd_view_route){
+                .lo = n->addr,
+                .hi = n->hi,
+                .nexthop = table[i].addr,
+                .moved = n->moved,
+            };
+        }
+    }
+
+    if (v->routes_truncated) {
+        LOG_WRN("[VIEW] RRT exceeds %u runs, lookups fall back to the table",
+                (unsigned)ARRAY_SIZE(v->routes));
+    }
+
+    v->version = pub->buf[!next].version + 1;
+
+    /* Sequentially consistent swap: the buffer contents are visible first */
+    atomic_set(&pub->cur, next);
+}
+
+const struct fwd_view *fwd_view_acquire(struct fwd_view_pub *pub)
+{
+    for (;;) {
+        int idx = atomic_get(&pub->cur);
+
+        atomic_inc(&pub->readers[idx]);
+        if (atomic_get(&pub->cur) == idx) {
+            return &pub->buf[idx];
+        }
+        /* Swapped between the read and the pin: the writer may already be
+         * rebuilding this buffer */
+        atomic_dec(&pub->readers[idx]);
+    }
+}
+
+void fwd_view_release(struct fwd_view_pub *pub, const struct fwd_view *view)
+{
+    atomic_dec(&pub->readers[view - pub->buf]);
+}
+
+const neighbor_entry_t *fwd_view_find_neighbor(const struct fwd_view *view,
+                                               uint16_t addr)
+{
+    for (int i = 0; i < view->nb_count; i++) {
+        if (view->nb[i].addr == addr) {
+            return &view->nb[i];
+        }
+    }
+    return NULL;
+}
+
+uint16_t fwd_view_find_nexthop(const struct fwd_view *view, uint16_t dest_addr)
+{
+    uint16_t run_hop = 0;
+
+    if (fwd_view_find_neighbor(view, dest_addr) != NULL) {
+        return dest_addr;
+    }
+
+    for (int i = 0; i < view->route_count; i++) {
+        const struct fwd_view_route *r = &view->routes[i];
+
+        if (dest_addr < r->lo || dest_addr > r->hi) {
+            continue;
+        }
+        if (r->moved) {
+            GTRACE(GT_RRT_HIT, 1, dest_addr, r->nexthop, 0);
+            return r->nexthop;
+        }
+        if (run_hop == 0) {
+            run_hop = r->nexthop;
+        }
+    }
+
+    if (run_hop != 0) {
+        GTRACE(GT_RRT_HIT, 0, dest_addr, run_hop, 0);
+    }
+    return run_hop;
+}
@@ -1,6 +1,7 @@
 #include "gradient_srv.h"
 #include "mesh/net.h"
 #include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 #include <zephyr/bluetooth/mesh.h>
 #include <zephyr/logging/log.h>
@@ -11,12 +12,18 @@
 #include "led_indication.h"
 #include "neighbor_table.h"
 #include "packet_stats.h"
+#include "gtrace.h"
+#include "topo_codec.h"
 #include "reverse_routing.h"
 #include "routing_policy.h"
 #include <zephyr/bluetooth/mesh/statistic.h>
 #include <zephyr/kernel.h>
 #include <zephyr/random/random.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
 #include "sensor_manager.h"
+#include "sink_ingest.h"
+#include "sink_frame.h"
 
 
 LOG_MODULE_REGISTER(gradient_srv, LOG_LEVEL_INF);
@@ -40,6 +47,12 @@ BUILD_ASSERT(BT_MESH_MODEL_BUF_LEN(BT_MESH_GRADIENT_SRV_OP_GRADIENT_STATUS,
                                    BT_MESH_GRADIENT_SRV_MSG_MAXLEN_MESSAGE) <=
                  BT_MESH_TX_SDU_MAX,
              "The message must fit inside an application SDU.");
+BUILD_ASSERT(BT_MESH_MODEL_BUF_LEN(BT_MESH_GRADIENT_SRV_OP_TOPO_BUNDLE,
+                                   CONFIG_BT_MESH_TOPO_BUNDLE_MAX_LEN) <=
+                 BT_MESH_TX_SDU_MAX,
+             "The topology bundle must fit inside an application SDU.");
+BUILD_ASSERT(CONFIG_BT_MESH_TOPO_BUNDLE_MAX_LEN >= 3 + TOPO_DELTA_MAX_PAYLOAD,
+             "A topology bundle must hold at least one full delta record.");
 
 /* -------------------------------------------------------------------------
  * STATIC VARIABLES (SEQUENCE NUMBERS & DEDUP)
@@ -58,10 +71,12 @@ extern uint32_t g_test_start_time;
 /* -------------------------------------------------------------------------
  * HELPER FUNCTIONS
  * ------------------------------------------------------------------------- */
-static int srv_send_msg_with_stat(struct bt_mesh_gradient_srv *srv,
-                                  struct bt_mesh_msg_ctx *ctx,
-                                  struct net_buf_simple *msg) {
-  int err = bt_mesh_model_send(srv->model, ctx, msg, NULL, NULL);
+static int srv_send_msg_with_cb(struct bt_mesh_gradient_srv *srv,
+                                struct bt_mesh_msg_ctx *ctx,
+                                struct net_buf_simple *msg,
+                                const struct bt_mesh_send_cb *cb,
+                                void *cb_data) {
+  int err = bt_mesh_model_send(srv->model, ctx, msg, cb, cb_data);
 
   /* If send fails at Application level (Buffer Full, Queue Full, etc.)
    * increment Soft Drop counter. We ignore -EAGAIN as it's often transient
@@ -74,6 +89,173 @@ static int srv_send_msg_with_stat(struct bt_mesh_gradient_srv *srv,
   return err;
 }
 
+static int srv_send_msg_with_stat(struct bt_mesh_gradient_srv *srv,
+                                  struct bt_mesh_msg_ctx *ctx,
+                                  struct net_buf_simple *msg) {
+  return srv_send_msg_with_cb(srv, ctx, msg, NULL, NULL);
+}
+
+/******************************************************************************/
+/* Controlled Flooding (gradient-model broadcasts)                            */
+/******************************************************************************/
+
+/* Dedup for broadcasts that carry no ID of their own (key = tag | value) */
+#define BCAST_KEY_TOPO_REQ       0x01
+#define BCAST_KEY_SENSOR_INTV    0x02
+#define BCAST_KEY_REPORT_ACK     0x03
+#define BCAST_KEY(tag, v)        (((uint32_t)(tag) << 24) | ((v) & 0xFFFFFF))
+#define BCAST_SEEN_SLOTS         8
+#define BCAST_SEEN_TTL_MS        30000
+
+static struct {
+  uint32_t key;
+  int64_t ts;
+} bcast_seen_cache[BCAST_SEEN_SLOTS];
+static uint8_t bcast_seen_next;
+
+/**
+ * @brief Check-and-record a broadcast key (RX thread only).
+ * @return true if the same key was seen within BCAST_SEEN_TTL_MS
+ */
+static bool bcast_seen(uint32_t key) {
+  int64_t now = k_uptime_get();
+
+  for (int i = 0; i < BCAST_SEEN_SLOTS; i++) {
+    if (bcast_seen_cache[i].ts != 0 && bcast_seen_cache[i].key == key &&
+        now - bcast_seen_cache[i].ts < BCAST_SEEN_TTL_MS) {
+      return true;
+    }
+  }
+
+  bcast_seen_cache[bcast_seen_next].key = key;
+  bcast_seen_cache[bcast_seen_next].ts = now;
+  bcast_seen_next = (bcast_seen_next + 1) % BCAST_SEEN_SLOTS;
+  return false;
+}
+
+/** FNV-1a folded to 24 bits, for payloads without an ID */
+static uint32_t bcast_hash24(const uint8_t *data, uint16_t len) {
+  uint32_t h = 2166136261u;
+
+  for (uint16_t i = 0; i < len; i++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  return (h >> 24) ^ (h & 0xFFFFFF);
+}
+
+/**
+ * @brief Is this node an elected broadcast relay?
+ *        Needs children (a neighbor further from the Sink). With pruning,
+ *        also needs to be somebody's uplink parent (non-empty RRT).
+ */
+static bool bcast_relay_elected(struct bt_mesh_gradient_srv *srv) {
+  bool has_children = false;
+  bool has_descendants = false;
+
+  const struct fwd_view *view = fwd_view_acquire(&srv->fwd_view);
+  for (int i = 0; i < view->nb_count; i++) {
+    const neighbor_entry_t *e = &view->nb[i];
+
+    if (e->gradient > srv->gradient && e->gradient != UINT8_MAX) {
+      has_children = true;
+    }
+  }
+  has_descendants = view->route_count > 0;
+  fwd_view_release(&srv->fwd_view, view);
+
+  if (IS_ENABLED(CONFIG_BT_MESH_GRADIENT_BCAST_PRUNE)) {
+    return has_children && has_descendants;
+  }
+  return has_children;
+}
+
+/**
+ * @brief Carry a gradient-model broadcast one hop further (Sink never does).
+ *   - Controlled flooding: elected relays only, TTL 0.
+ *   - Managed flooding (legacy): everyone, TTL - 1.
+ *   Caller has already dropped duplicates.
+ */
+static void bcast_relay(struct bt_mesh_gradient_srv *srv,
+                        const struct bt_mesh_msg_ctx *rx_ctx,
+                        struct net_buf_simple *msg) {
+  struct bt_mesh_msg_ctx ctx = {
+      .app_idx = srv->model->keys[0],
+      .addr = BT_MESH_ADDR_ALL_NODES,
+  };
+
+  if (srv->gradient == 0) {
+    return;
+  }
+
+  if (IS_ENABLED(CONFIG_BT_MESH_GRADIENT_BCAST_CONTROLLED)) {
+    if (!bcast_relay_elected(srv)) {
+      LOG_DBG("Broadcast from 0x%04x: not an elected relay", rx_ctx->addr);
+      return;
+    }
+    ctx.send_ttl = 0;
+  } else {
+    if (rx_ctx->recv_ttl <= 1) {
+      return;
+    }
+    ctx.send_ttl = rx_ctx->recv_ttl - 1;
+  }
+
+  (void)srv_send_msg_with_stat(srv, &ctx, msg);
+}
+
+/******************************************************************************/
+/* Collection Wave (Sink-initiated rounds)                                    */
+/******************************************************************************/
+
+static bool collect_wave_enabled(const struct collect_wave *wave) {
+  return wave->slot_units > 0 && wave->levels > 0 && wave->slots_per_level > 0;
+}
+
+static void collect_wave_add(struct net_buf_simple *msg,
+                             const struct collect_wave *wave) {
+  net_buf_simple_add_u8(msg, wave->slot_units);
+  net_buf_simple_add_u8(msg, wave->levels);
+  net_buf_simple_add_u8(msg, wave->slots_per_level);
+}
+
+static bool collect_wave_pull(struct net_buf_simple *buf,
+                              struct collect_wave *wave) {
+  if (buf->len < COLLECT_WAVE_LEN) {
+    return false;
+  }
+  wave->slot_units = net_buf_simple_pull_u8(buf);
+  wave->levels = net_buf_simple_pull_u8(buf);
+  wave->slots_per_level = net_buf_simple_pull_u8(buf);
+  return collect_wave_enabled(wave);
+}
+
+uint32_t bt_mesh_gradient_srv_wave_delay_ms(const struct collect_wave *wave,
+                                            uint8_t grad, uint16_t addr,
+                                            uint8_t round) {
+  if (!collect_wave_enabled(wave)) {
+    return 0;
+  }
+
+  /* Deepest level first; nodes beyond 'levels' share level 0 */
+  uint32_t level = (grad >= wave->levels) ? 0 : (wave->levels - grad);
+
+  /* Fibonacci hash spreads consecutive addresses evenly; the round picks
+   * a different bit window so pairs colliding now are split next round */
+  uint32_t h = (uint32_t)addr * 2654435761u;
+  uint32_t slot = level * wave->slots_per_level +
+                  (h >> (16 - (round & 0x07))) % wave->slots_per_level;
+
+  return slot * wave->slot_units * COLLECT_WAVE_SLOT_UNIT_MS;
+}
+
+uint32_t bt_mesh_gradient_srv_wave_round_ms(const struct collect_wave *wave) {
+  if (!collect_wave_enabled(wave)) {
+    return 0;
+  }
+  return (uint32_t)wave->levels * wave->slots_per_level * wave->slot_units *
+         COLLECT_WAVE_SLOT_UNIT_MS;
+}
+
 /******************************************************************************/
 /* Message Handlers                                                           */
 /******************************************************************************/
@@ -123,10 +305,47 @@ static int handle_gradient_message(const struct bt_mesh_model *model,
                                    struct bt_mesh_msg_ctx *ctx,
                                    struct net_buf_simple *buf);
 
+/* [NEW] Amortized RRT refresh: the RRT/neighbor entry for (source, nexthop)
+ * is only touched once it is older than RRT_REFRESH_AGE_S. Freshness is kept
+ * in a direct-mapped cache read without the mutex; the slow path (mutex +
+ * list walk) republishes the slot. The RRT generation in the key drops every
+ * slot as soon as any route is removed or moved. */
+#define RRT_FRESH_SLOTS 32 /* power of two, indexed by source address */
+#define RRT_REFRESH_AGE_S                                                      \
+  MIN(CONFIG_BT_MESH_GRADIENT_SRV_RRT_TIMEOUT_SEC /                            \
+          CONFIG_BT_MESH_GRADIENT_SRV_RRT_REFRESH_DIV,                         \
+      CONFIG_BT_MESH_GRADIENT_SRV_NODE_TIMEOUT_MS / 4000)
+
+static struct {
+  atomic_t key; /* source << 16 | RRT generation (16 bit), 0 = empty */
+  atomic_t val; /* nexthop << 16 | refresh time (uptime seconds, 16 bit) */
+} rrt_fresh[RRT_FRESH_SLOTS];
+
+static inline uint32_t rrt_fresh_key(uint16_t original_source) {
+  return ((uint32_t)original_source << 16) | (rrt_generation() & 0xFFFF);
+}
+
 static void rrt_update_from_uplink_msg(struct bt_mesh_gradient_srv *srv,
                                        uint16_t sender_addr,
                                        uint16_t original_source, int8_t rssi,
                                        int64_t now) {
+  uint32_t now_s = (uint32_t)(now / 1000);
+  uint32_t key = rrt_fresh_key(original_source);
+  atomic_t *slot_key = &rrt_fresh[original_source & (RRT_FRESH_SLOTS - 1)].key;
+  atomic_t *slot_val = &rrt_fresh[original_source & (RRT_FRESH_SLOTS - 1)].val;
+
+  /* 0. Fast path: route refreshed recently via the same nexthop (no lock).
+   * Key is re-read so a concurrent republish of the slot is detected. */
+  if ((uint32_t)atomic_get(slot_key) == key) {
+    uint32_t val = (uint32_t)atomic_get(slot_val);
+
+    if ((uint32_t)atomic_get(slot_key) == key &&
+        (uint16_t)(val >> 16) == sender_addr &&
+        (uint16_t)(now_s - val) < RRT_REFRESH_AGE_S) {
+      return;
+    }
+  }
+
   k_mutex_lock(&srv->forwarding_table_mutex, K_FOREVER);
 
   /* 1. Update/Add Neighbor Table (Robust Discovery)
@@ -134,6 +353,8 @@ static void rrt_update_from_uplink_msg(struct bt_mesh_gradient_srv *srv,
    * based on Uplink traffic (DATA/Heartbeat/TOPO) to ensure RRT learning.
    */
   uint8_t sender_gradient = UINT8_MAX;
+  neighbor_entry_t evicted;
+
   for (int i = 0; i < CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE; i++) {
     if (srv->forwarding_table[i].addr == sender_addr) {
       sender_gradient = srv->forwarding_table[i].gradient;
@@ -143,18 +364,51 @@ static void rrt_update_from_uplink_msg(struct bt_mesh_gradient_srv *srv,
 
   nt_update_sorted((neighbor_entry_t *)srv->forwarding_table,
                    CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-                   sender_addr, sender_gradient, rssi, now);
+                   sender_addr, sender_gradient, rssi, now, &evicted);
+  /* A new neighbor may have pushed the last one out of a full table */
+  rrt_free_evicted(&evicted);
 
   /* 2. Reverse Route Learning (RRT) */
-  rrt_add_dest(srv->forwarding_table,
-               CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-               sender_addr,     /* nexthop */
-               original_source, /* destination */
-               now);
+  int err = rrt_add_dest(srv->forwarding_table,
+                         CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
+                         sender_addr,     /* nexthop */
+                         original_source, /* destination */
+                         now);
+
+  /* 3. Republish the freshness slot (generation read after our own changes) */
+  atomic_set(slot_key, 0);
+  if (err == 0) {
+    atomic_set(slot_val, ((uint32_t)sender_addr << 16) | (now_s & 0xFFFF));
+    atomic_set(slot_key, rrt_fresh_key(original_source));
+  }
 
+  fwd_view_publish(&srv->fwd_view, srv->forwarding_table,
+                   CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE);
   k_mutex_unlock(&srv->forwarding_table_mutex);
 }
 
+/**
+ * @brief BACKPROP next hop from the published view (lock-free); only an
+ *        RRT larger than the view falls back to the locked table.
+ */
+static uint16_t srv_rrt_nexthop(struct bt_mesh_gradient_srv *srv,
+                                uint16_t dest) {
+  const struct fwd_view *view = fwd_view_acquire(&srv->fwd_view);
+  uint16_t nexthop = fwd_view_find_nexthop(view, dest);
+  bool truncated = view->routes_truncated;
+
+  fwd_view_release(&srv->fwd_view, view);
+
+  if (nexthop == BT_MESH_ADDR_UNASSIGNED && truncated) {
+    k_mutex_lock(&srv->forwarding_table_mutex, K_FOREVER);
+    nexthop = rrt_find_nexthop(srv->forwarding_table,
+                               CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
+                               dest);
+    k_mutex_unlock(&srv->forwarding_table_mutex);
+  }
+  return nexthop;
+}
+
 static int handle_data_message(const struct bt_mesh_model *model,
                                struct bt_mesh_msg_ctx *ctx,
                                struct net_buf_simple *buf) {
@@ -162,8 +416,8 @@ static int handle_data_message(const struct bt_mesh_model *model,
   uint16_t sender_addr = ctx->addr;
   int8_t rssi = ctx->recv_rssi;
 
-  /* [DIAGNOSTIC] Hex-dump incoming DATA message */
-  LOG_HEXDUMP_INF(buf->data, buf->len, "DATA RX Payload:");
+  /* [DIAGNOSTIC] Hex-dump incoming DATA message (per packet: DBG only) */
+  LOG_HEXDUMP_DBG(buf->data, buf->len, "DATA RX Payload:");
 
   /* Bóc tách các trường dữ liệu theo đúng thứ tự đóng gói */
   uint16_t original_source = net_buf_simple_pull_le16(buf);
@@ -181,14 +435,13 @@ static int handle_data_message(const struct bt_mesh_model *model,
   /* [NEW] Bóc tách Min RSSI (1 byte) */
   int8_t path_min_rssi = (int8_t)net_buf_simple_pull_u8(buf);
 
-  uint32_t delay_ms = 0; /* Sẽ được tính bằng Ping-Pong sau này */
-
-  /* Logging Logic */
+  /* Logging Logic: binary trace point, formatted text only at DBG level */
+  GTRACE(GT_DATA_RX, hop_count, original_source, received_data, sender_addr);
   if (received_data == BT_MESH_GRADIENT_SRV_HEARTBEAT_MARKER) {
-    LOG_INF("[CONTROL - SensorData] Recv from 0x%04x (via 0x%04x), Hops: %d",
+    LOG_DBG("[CONTROL - SensorData] Recv from 0x%04x (via 0x%04x), Hops: %d",
             original_source, sender_addr, hop_count);
   } else {
-    LOG_INF("[DATA - Sensor] Recv from 0x%04x (via 0x%04x), Seq: %d, Hops: %d, "
+    LOG_DBG("[DATA - Sensor] Recv from 0x%04x (via 0x%04x), Seq: %d, Hops: %d, "
             "MinRSSI: %d",
             original_source, sender_addr, received_data, hop_count,
             path_min_rssi);
@@ -208,29 +461,27 @@ static int handle_data_message(const struct bt_mesh_model *model,
   if (gradient_srv->gradient == 0) {
     /* I AM THE SINK (Gateway) */
     led_indicate_sink_received();
+    GTRACE(GT_DATA_SINK, hop_count, original_source, received_data,
+           sender_addr);
 
-    /* [MODIFIED] Log thêm Delay vào CSV (Chỉ log khi phiên test đang chạy) */
+    /* [MODIFIED] Log thêm Delay vào CSV (Chỉ log khi phiên test đang chạy)
+     * [UPD] CSV line + PONG are produced by the ingest thread */
     if (pkt_stats_is_enabled()) {
-      char csv_buf[128];
-      if (received_data == BT_MESH_GRADIENT_SRV_HEARTBEAT_MARKER) {
-        snprintf(csv_buf, sizeof(csv_buf), "CSV_LOG,SENSOR_DATA,0x%04x,0x%04x,%d,%d",
-                 original_source, sender_addr, hop_count, delay_ms);
-        printk("%s\n", csv_buf);
-      } else {
+      struct sink_ingest_rec *rec = sink_ingest_alloc();
+
+      if (rec != NULL) {
         if (rssi < path_min_rssi) {
           path_min_rssi = rssi;
         }
-        snprintf(csv_buf, sizeof(csv_buf), "CSV_LOG,DATA,0x%04x,0x%04x,%d,%d,0,%d",
-                 original_source, sender_addr, received_data, hop_count, path_min_rssi);
-        printk("%s\n", csv_buf);
-
-        /* [NEW] Send PONG back to original source */
-        bt_mesh_gradient_srv_send_pong(gradient_srv, original_source,
-                                       received_data);
-
-        if (gradient_srv->handlers->data_received) {
-          gradient_srv->handlers->data_received(gradient_srv, received_data);
-        }
+        rec->type = (received_data == BT_MESH_GRADIENT_SRV_HEARTBEAT_MARKER)
+                        ? SINK_INGEST_HEARTBEAT
+                        : SINK_INGEST_DATA;
+        rec->src = original_source;
+        rec->via = sender_addr;
+        rec->data = received_data;
+        rec->hop = hop_count;
+        rec->rssi = path_min_rssi;
+        sink_ingest_commit(rec);
       }
     }
 
@@ -271,25 +522,25 @@ static int handle_sensor_data_message(const struct bt_mesh_model *model,
   uint8_t count = net_buf_simple_pull_u8(buf);
 
   if (srv->gradient == 0) {
-    /* I AM SINK: Output to UART for Gateway.py */
-    char uart_buf[256];
-    int pos = snprintf(uart_buf, sizeof(uart_buf), "$[SENSOR],0x%04X,%d", src, count);
-
-    for (int i = 0; i < count; i++) {
-      if (buf->len < 3) break;
-      uint8_t id = net_buf_simple_pull_u8(buf);
-      int16_t val = net_buf_simple_pull_le16(buf);
-      if (pos < (int)sizeof(uart_buf)) {
-        pos += snprintf(uart_buf + pos, sizeof(uart_buf) - pos, ",[%d,%d]", id, val);
-      }
+    /* I AM SINK: Output to UART for Gateway.py (ingest thread formats) */
+    struct sink_ingest_rec *rec = sink_ingest_alloc();
+
+    if (rec != NULL) {
+      rec->type = SINK_INGEST_SENSOR;
+      rec->src = src;
+      rec->via = ctx->addr;
+      rec->hop = hop;
+      rec->data = count;
+      rec->len = MIN(buf->len, SINK_INGEST_RAW_MAX);
+      memcpy(rec->raw, buf->data, rec->len);
+      sink_ingest_commit(rec);
     }
-    printk("%s\n", uart_buf);
-    LOG_INF("[SENSOR] Received telemetry from 0x%04x, count=%d, hops=%d", src, count, hop);
+    GTRACE(GT_SENSOR_RX, hop, src, count, 0);
+    LOG_DBG("[SENSOR] Received telemetry from 0x%04x, count=%d, hops=%d", src, count, hop);
   } else {
     /* I AM RELAY: Forward to best parent */
-    k_mutex_lock(&srv->forwarding_table_mutex, K_FOREVER);
-    uint16_t nexthop = srv->forwarding_table[0].addr;
-    k_mutex_unlock(&srv->forwarding_table_mutex);
+    uint16_t nexthop = find_strict_upstream_parent(
+        srv, ctx->addr, src, SDN_FLOW_CLASS_SENSOR, NULL);
 
     if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
       LOG_WRN("[SENSOR] Relay: No parent to forward from 0x%04x", src);
@@ -310,7 +561,8 @@ static int handle_sensor_data_message(const struct bt_mesh_model *model,
     };
 
     srv_send_msg_with_stat(srv, &fwd_ctx, &msg);
-    LOG_INF("[SENSOR] Relayed telemetry from 0x%04x to 0x%04x (hop %d)", src, nexthop, hop);
+    GTRACE(GT_SENSOR_RX, hop, src, count, nexthop);
+    LOG_DBG("[SENSOR] Relayed telemetry from 0x%04x to 0x%04x (hop %d)", src, nexthop, hop);
   }
 
   return 0;
@@ -339,7 +591,8 @@ static int handle_backprop_message(const struct bt_mesh_model *model,
     path_min_rssi = current_rssi;
   }
 
-  LOG_INF("[CONTROL - Backprop] Recv: dest=0x%04x, payload=%d, hops=%d, "
+  GTRACE(GT_BP_RX, hop_count, final_dest, payload, sender_addr);
+  LOG_DBG("[CONTROL - Backprop] Recv: dest=0x%04x, payload=%d, hops=%d, "
           "from=0x%04x",
           final_dest, payload, hop_count, sender_addr);
 
@@ -352,6 +605,8 @@ static int handle_backprop_message(const struct bt_mesh_model *model,
 
     if (payload == 0xFFFE) {
       LOG_WRN("[CONTROL] Received REPORT REQ (via Backprop)!");
+      gradient_srv->report_wave_valid = false; /* Single node: no wave */
+      gradient_srv->report_round_bcast = false;
       if (gradient_srv->handlers->report_req_received) {
         gradient_srv->handlers->report_req_received(gradient_srv);
       }
@@ -367,10 +622,10 @@ static int handle_backprop_message(const struct bt_mesh_model *model,
       /* [PHASE 1] Unicast Backprop SDN Route Update (Exclude special range 0xFF00+) */
       uint16_t new_nexthop = payload & 0x7FFF;
       LOG_WRN("[SDN 2PC] RX Unicast Route! Pending NextHop = 0x%04x", new_nexthop);
-      gradient_srv->sdn_next_hop_pending = new_nexthop;
-      
-      /* [NEW] Update expiry on route reception (5 minute TTL) */
-      gradient_srv->sdn_route_expiry = k_uptime_get() + (5 * 60 * 1000);
+
+      /* Staged as the (any, any) flow rule; soft-state lifetime from Kconfig */
+      sdn_flow_stage_default(&gradient_srv->sdn_flows, new_nexthop,
+                             SDN_FLOW_DEFAULT_LIFETIME_MS);
     } else {
       /* [NEW] CSV LOG AT SENSOR FOR DOWNLINK (Atomic) */
       char csv_buf[120];
@@ -378,9 +633,12 @@ static int handle_backprop_message(const struct bt_mesh_model *model,
                my_addr, sender_addr, payload, hop_count, delay_ms, path_min_rssi);
       printk("%s\n", csv_buf);
 
-      LOG_INF("[CONTROL - Backprop] Destination Reached! Payload: %d, Hops: %d",
+      GTRACE(GT_BP_DELIVER, hop_count, payload, MIN(delay_ms, UINT16_MAX),
+             sender_addr);
+      LOG_DBG("[CONTROL - Backprop] Destination Reached! Payload: %d, Hops: %d",
               payload, hop_count);
       pkt_stats_inc_rx();
+      pkt_stats_record_backprop_delay(delay_ms, hop_count);
       if (gradient_srv->handlers->data_received) {
         gradient_srv->handlers->data_received(gradient_srv, payload);
       }
@@ -392,15 +650,16 @@ static int handle_backprop_message(const struct bt_mesh_model *model,
     return 0;
   }
 
-  uint16_t nexthop = rrt_find_nexthop(
-      gradient_srv->forwarding_table,
-      CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE, final_dest);
+  uint16_t nexthop = srv_rrt_nexthop(gradient_srv, final_dest);
 
   if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
+    GTRACE(GT_BP_NO_ROUTE, 0, final_dest, payload, 0);
     LOG_WRN("[CONTROL - Backprop] No route to dest=0x%04x", final_dest);
     return 0;
   }
 
+  GTRACE(GT_BP_FWD, hop_count, final_dest, payload, nexthop);
+
   /* Forwarding: Cấu trúc mới 11 bytes */
   BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA, 11);
   bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA);
@@ -424,6 +683,327 @@ static int handle_backprop_message(const struct bt_mesh_model *model,
   return 0;
 }
 
+static bool srv_is_neighbor(struct bt_mesh_gradient_srv *srv, uint16_t addr) {
+  bool found = false;
+
+  const struct fwd_view *view = fwd_view_acquire(&srv->fwd_view);
+  found = fwd_view_find_neighbor(view, addr) != NULL;
+  fwd_view_release(&srv->fwd_view, view);
+
+  return found;
+}
+
+/**
+ * @brief [NEW] Send a source-routed BACKPROP: header fields of BACKPROP_DATA
+ *        followed by the relays still to visit after @p nexthop.
+ */
+static int backprop_sr_send(struct bt_mesh_gradient_srv *srv, uint16_t nexthop,
+                            const uint8_t *hdr, const uint16_t *hops,
+                            uint8_t hop_count) {
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_SR,
+                           BT_MESH_GRADIENT_SRV_BACKPROP_SR_HDR_LEN +
+                               CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS * 2);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_SR);
+  net_buf_simple_add_mem(&msg, hdr, BT_MESH_GRADIENT_SRV_BACKPROP_LEN);
+  net_buf_simple_add_u8(&msg, hop_count);
+  for (uint8_t i = 0; i < hop_count; i++) {
+    net_buf_simple_add_le16(&msg, hops[i]);
+  }
+
+  struct bt_mesh_msg_ctx tx_ctx = {
+      .app_idx = srv->model->keys[0],
+      .addr = nexthop,
+      .send_ttl = 0,
+      .send_rel = true,
+  };
+
+  return srv_send_msg_with_stat(srv, &tx_ctx, &msg);
+}
+
+/**
+ * @brief [NEW] Handle source-routed BACKPROP (Gateway -> Node downlink)
+ *
+ * Relays pop the next hop from the list, no RRT lookup. Delivery, and
+ * forwarding when the listed next hop is no longer a neighbor, go through
+ * the plain BACKPROP_DATA path (RRT fallback).
+ */
+static int handle_backprop_sr(const struct bt_mesh_model *model,
+                              struct bt_mesh_msg_ctx *ctx,
+                              struct net_buf_simple *buf) {
+  struct bt_mesh_gradient_srv *srv = model->rt->user_data;
+  uint16_t my_addr = bt_mesh_model_elem(srv->model)->rt->addr;
+  uint16_t hops[CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS];
+
+  /* Plain BACKPROP_DATA view of the common fields */
+  NET_BUF_SIMPLE_DEFINE(plain, BT_MESH_GRADIENT_SRV_BACKPROP_LEN);
+  net_buf_simple_add_mem(&plain, net_buf_simple_pull_mem(
+                                     buf, BT_MESH_GRADIENT_SRV_BACKPROP_LEN),
+                         BT_MESH_GRADIENT_SRV_BACKPROP_LEN);
+
+  uint8_t hop_count = net_buf_simple_pull_u8(buf);
+  if (hop_count > ARRAY_SIZE(hops) || buf->len < hop_count * 2) {
+    LOG_WRN("[CONTROL - Backprop SR] Bad hop list (%u)", hop_count);
+    return -EINVAL;
+  }
+  for (uint8_t i = 0; i < hop_count; i++) {
+    hops[i] = net_buf_simple_pull_le16(buf);
+  }
+
+  uint8_t *hdr = plain.data;
+  uint16_t final_dest = sys_get_le16(&hdr[0]);
+  uint8_t ttl = hdr[4];
+
+  if (final_dest == my_addr) {
+    return handle_backprop_message(model, ctx, &plain);
+  }
+
+  if (ttl <= 1) {
+    return 0;
+  }
+
+  uint16_t nexthop = (hop_count > 0) ? hops[0] : final_dest;
+
+  if (!srv_is_neighbor(srv, nexthop)) {
+    LOG_WRN("[CONTROL - Backprop SR] 0x%04x is not a neighbor, using RRT",
+            nexthop);
+    return handle_backprop_message(model, ctx, &plain);
+  }
+
+  /* Same per-hop update as BACKPROP_DATA, then pop our entry */
+  int8_t path_min_rssi = MIN((int8_t)hdr[10], ctx->recv_rssi);
+
+  GTRACE(GT_BP_FWD, hdr[5], final_dest, sys_get_le16(&hdr[2]), nexthop);
+  hdr[4] = ttl - 1;
+  hdr[5] = hdr[5] + 1;
+  hdr[10] = (uint8_t)path_min_rssi;
+
+  return backprop_sr_send(srv, nexthop, hdr,
+                          (hop_count > 0) ? &hops[1] : hops,
+                          (hop_count > 0) ? hop_count - 1 : 0);
+}
+
+/**
+ * @brief [NEW] Group BACKPROP_MULTI records by RRT next hop and send one
+ *        message per branch. A branch with a single record goes out as
+ *        plain BACKPROP_DATA. TTL/Hops/TS/MinRSSI are the outgoing values.
+ * @return number of branches sent
+ */
+static int backprop_multi_split(struct bt_mesh_gradient_srv *srv, uint8_t ttl,
+                                uint8_t hops, uint32_t timestamp,
+                                int8_t min_rssi,
+                                const struct bt_mesh_gradient_srv_bp_rec *recs,
+                                uint8_t count) {
+  uint16_t nexthop[CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX];
+  int branches = 0;
+
+  for (uint8_t i = 0; i < count; i++) {
+    nexthop[i] = srv_rrt_nexthop(srv, recs[i].dest);
+    if (nexthop[i] == BT_MESH_ADDR_UNASSIGNED) {
+      GTRACE(GT_BP_NO_ROUTE, 0, recs[i].dest, recs[i].payload, 0);
+      LOG_WRN("[CONTROL - Backprop MULTI] No route to dest=0x%04x", recs[i].dest);
+    }
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    uint16_t nh = nexthop[i];
+    uint8_t n = 0;
+
+    if (nh == BT_MESH_ADDR_UNASSIGNED) {
+      continue;
+    }
+    for (uint8_t j = i; j < count; j++) {
+      n += (nexthop[j] == nh);
+    }
+
+    struct bt_mesh_msg_ctx tx_ctx = {
+        .app_idx = srv->model->keys[0],
+        .addr = nh,
+        .send_ttl = 0,
+        .send_rel = true,
+    };
+
+    if (n == 1) {
+      BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA,
+                               BT_MESH_GRADIENT_SRV_BACKPROP_LEN);
+      bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA);
+      net_buf_simple_add_le16(&msg, recs[i].dest);
+      net_buf_simple_add_le16(&msg, recs[i].payload);
+      net_buf_simple_add_u8(&msg, ttl);
+      net_buf_simple_add_u8(&msg, hops);
+      net_buf_simple_add_le32(&msg, timestamp);
+      net_buf_simple_add_u8(&msg, (uint8_t)min_rssi);
+      GTRACE(GT_BP_FWD, hops, recs[i].dest, recs[i].payload, nh);
+      srv_send_msg_with_stat(srv, &tx_ctx, &msg);
+    } else {
+      BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_MULTI,
+                               BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_HDR_LEN +
+                                   CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX *
+                                       BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_REC_LEN);
+      bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_MULTI);
+      net_buf_simple_add_u8(&msg, ttl);
+      net_buf_simple_add_u8(&msg, hops);
+      net_buf_simple_add_le32(&msg, timestamp);
+      net_buf_simple_add_u8(&msg, (uint8_t)min_rssi);
+      net_buf_simple_add_u8(&msg, n);
+      for (uint8_t j = i; j < count; j++) {
+        if (nexthop[j] == nh) {
+          net_buf_simple_add_le16(&msg, recs[j].dest);
+          net_buf_simple_add_le16(&msg, recs[j].payload);
+          GTRACE(GT_BP_FWD, hops, recs[j].dest, recs[j].payload, nh);
+        }
+      }
+      srv_send_msg_with_stat(srv, &tx_ctx, &msg);
+    }
+
+    /* Branch done: clear it so later records don't start it again */
+    for (uint8_t j = i; j < count; j++) {
+      if (nexthop[j] == nh) {
+        nexthop[j] = BT_MESH_ADDR_UNASSIGNED;
+      }
+    }
+    branches++;
+  }
+
+  return branches;
+}
+
+/**
+ * @brief [NEW] Handle multi-destination BACKPROP (Gateway -> Nodes downlink)
+ *
+ * Records for this node are delivered through the BACKPROP_DATA handler,
+ * the rest are split by RRT next hop (one message per branch).
+ */
+static int handle_backprop_multi(const struct bt_mesh_model *model,
+                                 struct bt_mesh_msg_ctx *ctx,
+                                 struct net_buf_simple *buf) {
+  struct bt_mesh_gradient_srv *srv = model->rt->user_data;
+  uint16_t my_addr = bt_mesh_model_elem(srv->model)->rt->addr;
+  struct bt_mesh_gradient_srv_bp_rec recs[CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX];
+  uint8_t fwd_count = 0;
+
+  uint8_t ttl = net_buf_simple_pull_u8(buf);
+  uint8_t hop_count = net_buf_simple_pull_u8(buf);
+  uint32_t timestamp = net_buf_simple_pull_le32(buf);
+  int8_t path_min_rssi = (int8_t)net_buf_simple_pull_u8(buf);
+  uint8_t count = net_buf_simple_pull_u8(buf);
+
+  if (count > ARRAY_SIZE(recs) ||
+      buf->len < count * BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_REC_LEN) {
+    LOG_WRN("[CONTROL - Backprop MULTI] Bad record count (%u)", count);
+    return -EINVAL;
+  }
+
+  LOG_DBG("[CONTROL - Backprop MULTI] Recv %u records, hops=%d, from=0x%04x",
+          count, hop_count, ctx->addr);
+
+  for (uint8_t i = 0; i < count; i++) {
+    uint16_t dest = net_buf_simple_pull_le16(buf);
+    uint16_t payload = net_buf_simple_pull_le16(buf);
+
+    if (dest != my_addr) {
+      recs[fwd_count].dest = dest;
+      recs[fwd_count].payload = payload;
+      fwd_count++;
+      continue;
+    }
+
+    /* Own record: same delivery path as a plain BACKPROP_DATA */
+    NET_BUF_SIMPLE_DEFINE(plain, BT_MESH_GRADIENT_SRV_BACKPROP_LEN);
+    net_buf_simple_add_le16(&plain, dest);
+    net_buf_simple_add_le16(&plain, payload);
+    net_buf_simple_add_u8(&plain, ttl);
+    net_buf_simple_add_u8(&plain, hop_count);
+    net_buf_simple_add_le32(&plain, timestamp);
+    net_buf_simple_add_u8(&plain, (uint8_t)path_min_rssi);
+    (void)handle_backprop_message(model, ctx, &plain);
+  }
+
+  if (fwd_count == 0 || ttl <= 1) {
+    return 0;
+  }
+
+  backprop_multi_split(srv, ttl - 1, hop_count + 1, timestamp,
+                       MIN(path_min_rssi, ctx->recv_rssi), recs, fwd_count);
+  return 0;
+}
+
+/**
+ * @brief [NEW] Handle SDN_FLOW (Gateway -> Node flow rule install)
+ *
+ * Routed hop by hop over the RRT like BACKPROP_DATA. The destination
+ * stages the rules; the next TOPO_REQ commit flag activates them.
+ */
+static int handle_sdn_flow(const struct bt_mesh_model *model,
+                           struct bt_mesh_msg_ctx *ctx,
+                           struct net_buf_simple *buf) {
+  struct bt_mesh_gradient_srv *srv = model->rt->user_data;
+  uint16_t my_addr = bt_mesh_model_elem(srv->model)->rt->addr;
+
+  uint16_t dest = net_buf_simple_pull_le16(buf);
+  uint8_t ttl = net_buf_simple_pull_u8(buf);
+  uint8_t version = net_buf_simple_pull_u8(buf);
+  uint8_t count = net_buf_simple_pull_u8(buf);
+
+  if (count > BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES ||
+      buf->len < count * SDN_FLOW_RULE_LEN) {
+    LOG_WRN("[SDN FLOW] Bad rule count (%u)", count);
+    return -EINVAL;
+  }
+
+  if (dest == my_addr) {
+    for (uint8_t i = 0; i < count; i++) {
+      uint16_t src = net_buf_simple_pull_le16(buf);
+      uint8_t tclass = net_buf_simple_pull_u8(buf);
+      uint16_t next_hop = net_buf_simple_pull_le16(buf);
+      uint8_t life_min = net_buf_simple_pull_u8(buf);
+      uint32_t life_ms = life_min ? life_min * 60U * 1000U
+                                  : SDN_FLOW_DEFAULT_LIFETIME_MS;
+
+      if (sdn_flow_stage(&srv->sdn_flows, version, src, tclass, next_hop,
+                         life_ms)) {
+        LOG_WRN("[SDN FLOW] Staged set full, rule 0x%04x/%u dropped", src,
+                tclass);
+        continue;
+      }
+      LOG_WRN("[SDN 2PC] RX Flow v%u: src=0x%04x class=%u -> 0x%04x (%u min)",
+              version, src, tclass, next_hop,
+              life_min ? life_min : CONFIG_BT_MESH_GRADIENT_SDN_FLOW_LIFETIME_MIN);
+    }
+    return 0;
+  }
+
+  if (ttl <= 1) {
+    return 0;
+  }
+
+  uint16_t nexthop = srv_rrt_nexthop(srv, dest);
+
+  if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
+    LOG_WRN("[SDN FLOW] No route to dest=0x%04x", dest);
+    return 0;
+  }
+
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SDN_FLOW,
+                           BT_MESH_GRADIENT_SRV_SDN_FLOW_HDR_LEN +
+                               BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES *
+                                   SDN_FLOW_RULE_LEN);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_SDN_FLOW);
+  net_buf_simple_add_le16(&msg, dest);
+  net_buf_simple_add_u8(&msg, ttl - 1);
+  net_buf_simple_add_u8(&msg, version);
+  net_buf_simple_add_u8(&msg, count);
+  net_buf_simple_add_mem(&msg, buf->data, count * SDN_FLOW_RULE_LEN);
+
+  struct bt_mesh_msg_ctx tx_ctx = {
+      .app_idx = srv->model->keys[0],
+      .addr = nexthop,
+      .send_ttl = 0,
+      .send_rel = true,
+  };
+
+  return srv_send_msg_with_stat(srv, &tx_ctx, &msg);
+}
+
 static uint8_t last_processed_bundle_id = 0xFF;
 
 static int handle_backprop_broadcast(const struct bt_mesh_model *model,
@@ -453,34 +1033,23 @@ static int handle_backprop_broadcast(const struct bt_mesh_model *model,
       if (target_node == BT_MESH_ADDR_ALL_NODES && nexthop == 0x0000) {
           /* [NEW] SDN RESET - Clear active and pending routes (Broadcast) */
           LOG_INF("[SDN 2PC] Received RESET command! Reverting to Gradient.");
-          srv->sdn_next_hop_active = BT_MESH_ADDR_UNASSIGNED;
-          srv->sdn_next_hop_pending = BT_MESH_ADDR_UNASSIGNED;
-          srv->sdn_route_expiry = 0;
+          sdn_flow_reset(&srv->sdn_flows);
           pkt_stats_reset();
       } else if (target_node == my_addr) {
           LOG_WRN("[SDN 2PC] RX Broadcast Route Update! Pending NextHop = 0x%04x", nexthop);
-          srv->sdn_next_hop_pending = nexthop;
-          /* [NEW] Update expiry (5 minute TTL) */
-          srv->sdn_route_expiry = k_uptime_get() + (5 * 60 * 1000);
+          sdn_flow_stage_default(&srv->sdn_flows, nexthop,
+                                 SDN_FLOW_DEFAULT_LIFETIME_MS);
       }
   }
 
   net_buf_simple_restore(buf, &state);
 
-  // Re-broadcast
-  if (srv->gradient != 0 && ctx->recv_ttl > 1) {
-      BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_BROADCAST, 127);
-      bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_BROADCAST);
-      net_buf_simple_add_u8(&msg, bundle_id);
-      net_buf_simple_add_mem(&msg, buf->data, buf->len);
-
-      struct bt_mesh_msg_ctx send_ctx = {
-          .app_idx = model->keys[0],
-          .addr = BT_MESH_ADDR_ALL_NODES,
-          .send_ttl = ctx->recv_ttl - 1,
-      };
-      (void)srv_send_msg_with_stat(srv, &send_ctx, &msg);
-  }
+  // Re-broadcast (elected relays only with controlled flooding)
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_BROADCAST, 127);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_BROADCAST);
+  net_buf_simple_add_u8(&msg, bundle_id);
+  net_buf_simple_add_mem(&msg, buf->data, MIN(buf->len, 126));
+  bcast_relay(srv, ctx, &msg);
   return 0;
 }
 
@@ -507,6 +1076,7 @@ static int handle_downlink_report(const struct bt_mesh_model *model,
 /**
  * @brief [UPDATED] Handle REPORT REQUEST (Broadcast from Sink)
  * Triggered at Sensor Nodes (STOP command)
+ * Payload: ReqID(1) + optional collection wave (3)
  * Logic: Receive -> Dedup -> Action -> Re-broadcast
  */
 static int handle_report_req(const struct bt_mesh_model *model,
@@ -532,28 +1102,28 @@ static int handle_report_req(const struct bt_mesh_model *model,
   /* 3. Update State */
   last_processed_req_id = received_req_id;
 
+  /* [NEW] REPORT_RSP goes out in this node's wave slot */
+  srv->report_wave_valid = collect_wave_pull(buf, &srv->report_wave);
+  srv->report_wave_round = received_req_id;
+  srv->report_round_bcast = true;
+
   /* 4. Action: Notify app to stop sending */
   if (srv->handlers->report_req_received) {
     srv->handlers->report_req_received(srv);
   }
 
   /* 5. Re-broadcast (Controlled Flooding) */
-  /* Chỉ re-broadcast nếu TTL còn và tôi không phải là Sink */
-  if (srv->gradient != 0 && ctx->recv_ttl > 1) {
-    LOG_DBG("Re-broadcasting STOP REQ ID %d...", received_req_id);
-
-    BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_REQ, 1);
-    bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_REQ);
-    net_buf_simple_add_u8(&msg, received_req_id);
-
-    struct bt_mesh_msg_ctx send_ctx = {
-        .app_idx = model->keys[0],
-        .addr = BT_MESH_ADDR_ALL_NODES,
-        .send_ttl = ctx->recv_ttl - 1,
-    };
+  /* Chỉ relay được bầu (có node con) re-broadcast; Sink không bao giờ */
+  LOG_DBG("Re-broadcasting STOP REQ ID %d...", received_req_id);
 
-    (void)srv_send_msg_with_stat(srv, &send_ctx, &msg);
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_REQ,
+                           1 + COLLECT_WAVE_LEN);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_REQ);
+  net_buf_simple_add_u8(&msg, received_req_id);
+  if (srv->report_wave_valid) {
+    collect_wave_add(&msg, &srv->report_wave);
   }
+  bcast_relay(srv, ctx, &msg);
 
   return 0;
 }
@@ -570,6 +1140,9 @@ static int handle_report_req_unicast(const struct bt_mesh_model *model,
 
   LOG_WRN(">>> RX UNICAST REPORT REQ from 0x%04x <<<", ctx->addr);
 
+  srv->report_wave_valid = false; /* Single node: no wave */
+  srv->report_round_bcast = false;
+
   /* Action: Notify app to stop sending/report */
   if (srv->handlers->report_req_received) {
     srv->handlers->report_req_received(srv);
@@ -630,26 +1203,16 @@ static int handle_test_start(const struct bt_mesh_model *model,
   }
 
   /* 5. Re-broadcast (Controlled Flooding) */
-  /* Điều kiện: TTL còn đủ và tôi không phải là Sink
+  /* Điều kiện: tôi là relay được bầu và không phải là Sink
    * (Sink đã phát rồi, không cần re-broadcast lại cái mình vừa nhận)
    */
-  if (srv->gradient != 0 && ctx->recv_ttl > 1) {
+  LOG_DBG("Re-broadcasting TEST START ID %d...", received_test_id);
 
-    LOG_DBG("Re-broadcasting TEST START ID %d...", received_test_id);
-
-    BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TEST_START, 3);
-    bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_TEST_START);
-    net_buf_simple_add_u8(&msg, received_test_id);
-    net_buf_simple_add_le16(&msg, interval_ms);
-
-    struct bt_mesh_msg_ctx send_ctx = {
-        .app_idx = model->keys[0],
-        .addr = BT_MESH_ADDR_ALL_NODES, // Gửi cho tất cả hàng xóm
-        .send_ttl = ctx->recv_ttl - 1,  // Giảm TTL đi 1
-    };
-
-    (void)srv_send_msg_with_stat(srv, &send_ctx, &msg);
-  }
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TEST_START, 3);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_TEST_START);
+  net_buf_simple_add_u8(&msg, received_test_id);
+  net_buf_simple_add_le16(&msg, interval_ms);
+  bcast_relay(srv, ctx, &msg);
 
   return 0;
 }
@@ -661,6 +1224,9 @@ static int handle_test_start(const struct bt_mesh_model *model,
 /* FORWARD DECLARATION for public API if needed, but we can access srv directly
  * if passed */
 
+/* REPORT_RSP: reporter(2) + binary stats snapshot */
+#define REPORT_RSP_MAX_PAYLOAD (2 + PKT_STATS_SNAPSHOT_MAX_LEN)
+
 static void report_retry_handler(struct k_work *work) {
   struct k_work_delayable *dwork = k_work_delayable_from_work(work);
   struct bt_mesh_gradient_srv *srv =
@@ -675,9 +1241,6 @@ static void report_retry_handler(struct k_work *work) {
     LOG_ERR("Max retries for REPORT reached. Giving up.");
     srv->is_report_pending = false;
     srv->report_retry_count = 0; // Reset để chu kỳ sau bắt đầu lại từ đầu
-
-    /* [FIX] Clear RTT buffer to allow future triggers */
-    pkt_stats_clear_rtt_history();
     return;
   }
 
@@ -685,12 +1248,8 @@ static void report_retry_handler(struct k_work *work) {
   LOG_WRN("Resending REPORT_RSP (Retry %u)...", srv->report_retry_count);
 
   /* Re-send Report */
-  /* [NEW] Fetch RTT History */
-  struct rtt_sample rtt_history[50];
-  uint16_t rtt_count = pkt_stats_get_rtt_history(rtt_history, 50);
-
-  /* [UPDATED] Payload size Max 215 bytes */
-  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_RSP, 220);
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_RSP,
+                           REPORT_RSP_MAX_PAYLOAD);
   bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_RSP);
 
   /* Gắn thêm địa chỉ nguồn gốc (Reporter) vào payload để Relay/Sink nhận diện
@@ -698,21 +1257,8 @@ static void report_retry_handler(struct k_work *work) {
   uint16_t my_addr = bt_mesh_model_elem(srv->model)->rt->addr;
   net_buf_simple_add_le16(&msg, my_addr);
 
-  struct packet_stats stats;
-  pkt_stats_get(&stats);
-  net_buf_simple_add_le16(&msg, (uint16_t)stats.data_tx);
-  net_buf_simple_add_le16(&msg, (uint16_t)stats.gradient_beacon_tx);
-  net_buf_simple_add_le16(&msg, (uint16_t)stats.heartbeat_tx);
-  net_buf_simple_add_le16(&msg, (uint16_t)stats.route_change_count);
-  net_buf_simple_add_le16(&msg, (uint16_t)stats.data_fwd_tx);
-  net_buf_simple_add_le16(&msg, (uint16_t)stats.rx_data_count);
-
-  /* [NEW] Append RTT Data */
-  net_buf_simple_add_u8(&msg, (uint8_t)rtt_count);
-  for (int i = 0; i < rtt_count; i++) {
-    net_buf_simple_add_le16(&msg, rtt_history[i].seq);
-    net_buf_simple_add_le16(&msg, rtt_history[i].rtt_ms);
-  }
+  /* One coherent binary snapshot: counters + latency percentiles */
+  (void)pkt_stats_snapshot_encode(&msg);
 
   /* [DYNAMIC PARENT SWITCHING] - GIỮ NGUYÊN */
   uint16_t target_parent = BT_MESH_ADDR_UNASSIGNED;
@@ -765,11 +1311,221 @@ static void report_retry_handler(struct k_work *work) {
   }
 
   /* Scheduler Retry tiếp theo (để đảm bảo tin cậy) */
+  if (srv->report_wave_valid) {
+    /* [NEW] Keep the same slot in a later wave (>= 4s): retries never land
+     * on top of another node's first attempt */
+    uint32_t round_ms = bt_mesh_gradient_srv_wave_round_ms(&srv->report_wave);
+    k_work_schedule(&srv->report_retry_work,
+                    K_MSEC(round_ms * DIV_ROUND_UP(4000, round_ms)));
+    return;
+  }
   uint32_t jitter = sys_rand32_get() % 1000;
   /* [FIX] Tăng thời gian chờ retry lên 4-5s để tránh nghẽn mạng */
   k_work_schedule(&srv->report_retry_work, K_MSEC(4000 + jitter));
 }
 
+/**
+ * @brief [SINK] Unicast REPORT_ACK to the original reporter via Reverse Routing
+ */
+static void report_ack_send_unicast(struct bt_mesh_gradient_srv *srv,
+                                    uint16_t reporter_addr, uint16_t via) {
+  uint16_t nexthop = srv_rrt_nexthop(srv, reporter_addr);
+
+  if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
+    LOG_WRN("Sink cannot find RRT route for ACK to 0x%04x (Source: 0x%04x)",
+            reporter_addr, via);
+    return;
+  }
+
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK, 2);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK);
+  net_buf_simple_add_le16(&msg, reporter_addr);
+
+  struct bt_mesh_msg_ctx ack_ctx = {
+      .app_idx = srv->model->keys[0],
+      .addr = nexthop,
+      .send_ttl = BT_MESH_TTL_DEFAULT,
+  };
+  srv_send_msg_with_stat(srv, &ack_ctx, &msg);
+  LOG_DBG("Sink sent REPORT_ACK for 0x%04x via Nexthop 0x%04x", reporter_addr,
+          nexthop);
+}
+
+/**
+ * @brief [SINK] Add a reporter to the current round's ACK set.
+ * @return 1 if newly added (bitmap will carry it), 0 if it was already
+ *         acked, -ENOENT if no broadcast round is open, -ENOMEM if full.
+ */
+static int report_ack_mark(struct bt_mesh_gradient_srv *srv, uint16_t addr) {
+  struct sink_report_ack *ra = &srv->report_ack;
+  int ret;
+
+  k_mutex_lock(&ra->lock, K_FOREVER);
+
+  if (!ra->round_open) {
+    ret = -ENOENT;
+    goto out;
+  }
+
+  /* Sorted insert (tens of nodes: linear is fine) */
+  uint8_t pos = 0;
+  while (pos < ra->count && ra->addrs[pos] < addr) {
+    pos++;
+  }
+  if (pos < ra->count && ra->addrs[pos] == addr) {
+    ret = 0;
+    goto out;
+  }
+  if (ra->count >= ARRAY_SIZE(ra->addrs)) {
+    ret = -ENOMEM;
+    goto out;
+  }
+
+  memmove(&ra->addrs[pos + 1], &ra->addrs[pos],
+          (ra->count - pos) * sizeof(ra->addrs[0]));
+  ra->addrs[pos] = addr;
+  ra->count++;
+  ra->repeats_left = CONFIG_BT_MESH_REPORT_ACK_REPEATS;
+  ret = 1;
+
+out:
+  k_mutex_unlock(&ra->lock);
+  return ret;
+}
+
+/**
+ * @brief [SINK] Broadcast the cumulative ACK set as one or more bitmaps.
+ *        Each message covers REPORT_ACK_BITMAP_BYTES * 8 consecutive
+ *        addresses starting at the lowest not yet covered.
+ *        Caller holds srv->report_ack.lock.
+ */
+static void report_ack_broadcast_locked(struct bt_mesh_gradient_srv *srv) {
+  struct sink_report_ack *ra = &srv->report_ack;
+  uint8_t msgs = 0;
+
+  /* Repeats carry the same bitmap: a new Seq keeps relays from dropping them */
+  ra->seq++;
+
+  for (uint8_t i = 0; i < ra->count;) {
+    uint16_t base = ra->addrs[i];
+    uint8_t bitmap[REPORT_ACK_BITMAP_BYTES] = {0};
+    uint16_t last_bit = 0;
+
+    while (i < ra->count &&
+           ra->addrs[i] - base < REPORT_ACK_BITMAP_BYTES * 8) {
+      last_bit = ra->addrs[i] - base;
+      bitmap[last_bit / 8] |= BIT(last_bit % 8);
+      i++;
+    }
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK_BITMAP,
+                             REPORT_ACK_BITMAP_HDR_LEN + REPORT_ACK_BITMAP_BYTES);
+    bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK_BITMAP);
+    net_buf_simple_add_u8(&msg, ra->req_id);
+    net_buf_simple_add_u8(&msg, ra->seq);
+    net_buf_simple_add_le16(&msg, base);
+    net_buf_simple_add_mem(&msg, bitmap, last_bit / 8 + 1);
+
+    struct bt_mesh_msg_ctx ctx = {
+        .app_idx = srv->model->keys[0],
+        .addr = BT_MESH_ADDR_ALL_NODES,
+        .send_ttl = BT_MESH_GRADIENT_SRV_BCAST_TTL(BT_MESH_TTL_DEFAULT),
+    };
+    (void)srv_send_msg_with_stat(srv, &ctx, &msg);
+    msgs++;
+  }
+
+  LOG_INF("Sink broadcast REPORT_ACK bitmap: round %u seq %u, %u reporters, %u msgs",
+          ra->req_id, ra->seq, ra->count, msgs);
+}
+
+static void report_ack_flush_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct sink_report_ack *ra =
+      CONTAINER_OF(dwork, struct sink_report_ack, flush_work);
+  struct bt_mesh_gradient_srv *srv =
+      CONTAINER_OF(ra, struct bt_mesh_gradient_srv, report_ack);
+
+  k_mutex_lock(&ra->lock, K_FOREVER);
+  if (ra->round_open && ra->count > 0) {
+    report_ack_broadcast_locked(srv);
+
+    /* Broadcasts are unacknowledged: repeat the set a few times */
+    if (ra->repeats_left > 0) {
+      ra->repeats_left--;
+      k_work_schedule(&ra->flush_work,
+                      K_MSEC(CONFIG_BT_MESH_REPORT_ACK_INTERVAL_MS));
+    }
+  }
+  k_mutex_unlock(&ra->lock);
+}
+
+/**
+ * @brief [SINK] Start collecting bitmap ACKs for a new REPORT_REQ round.
+ */
+static void report_ack_round_start(struct bt_mesh_gradient_srv *srv,
+                                   uint8_t req_id) {
+  struct sink_report_ack *ra = &srv->report_ack;
+
+  k_work_cancel_delayable(&ra->flush_work);
+
+  k_mutex_lock(&ra->lock, K_FOREVER);
+  ra->count = 0;
+  ra->req_id = req_id;
+  ra->repeats_left = 0;
+  ra->round_open = true;
+  k_mutex_unlock(&ra->lock);
+}
+
+/**
+ * @brief [NEW][SENSOR] Handle OP_REPORT_ACK_BITMAP broadcast from Sink.
+ *        Stops the REPORT_RSP retries when own bit is set for the round
+ *        this node is answering.
+ */
+static int handle_report_ack_bitmap(const struct bt_mesh_model *model,
+                                    struct bt_mesh_msg_ctx *ctx,
+                                    struct net_buf_simple *buf) {
+  struct bt_mesh_gradient_srv *srv = model->rt->user_data;
+
+  /* Dedup on content: ReqID + Seq + Base differ per message and per repeat */
+  if (IS_ENABLED(CONFIG_BT_MESH_GRADIENT_BCAST_CONTROLLED) && srv->gradient != 0) {
+    if (bcast_seen(BCAST_KEY(BCAST_KEY_REPORT_ACK,
+                             bcast_hash24(buf->data, buf->len)))) {
+      return 0;
+    }
+    BT_MESH_MODEL_BUF_DEFINE(fwd, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK_BITMAP,
+                             REPORT_ACK_BITMAP_HDR_LEN + REPORT_ACK_BITMAP_BYTES);
+    bt_mesh_model_msg_init(&fwd, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK_BITMAP);
+    net_buf_simple_add_mem(&fwd, buf->data,
+                           MIN(buf->len, REPORT_ACK_BITMAP_HDR_LEN +
+                                             REPORT_ACK_BITMAP_BYTES));
+    bcast_relay(srv, ctx, &fwd);
+  }
+
+  uint8_t req_id = net_buf_simple_pull_u8(buf);
+  (void)net_buf_simple_pull_u8(buf); /* Seq: relay dedup only */
+  uint16_t base = net_buf_simple_pull_le16(buf);
+  uint16_t my_addr = bt_mesh_model_elem(model)->rt->addr;
+
+  if (srv->gradient == 0 || !srv->is_report_pending ||
+      !srv->report_round_bcast || req_id != srv->report_wave_round) {
+    return 0;
+  }
+
+  if (my_addr < base || my_addr - base >= buf->len * 8) {
+    return 0;
+  }
+
+  uint16_t bit = my_addr - base;
+  if (buf->data[bit / 8] & BIT(bit % 8)) {
+    LOG_INF("Received REPORT_ACK bitmap (round %u)! Stopping retry.", req_id);
+    k_work_cancel_delayable(&srv->report_retry_work);
+    srv->is_report_pending = false;
+  }
+
+  return 0;
+}
+
 static int handle_report_ack(const struct bt_mesh_model *model,
                              struct bt_mesh_msg_ctx *ctx,
                              struct net_buf_simple *buf) {
@@ -778,19 +1534,14 @@ static int handle_report_ack(const struct bt_mesh_model *model,
   uint16_t my_addr = bt_mesh_model_elem(model)->rt->addr;
 
   if (target_addr == my_addr) {
-    LOG_INF("Received REPORT_ACK! Stopping retry and clearing RTT history.");
+    LOG_INF("Received REPORT_ACK! Stopping retry.");
     k_work_cancel_delayable(&srv->report_retry_work);
     srv->is_report_pending = false;
-
-    /* [NEW] Clear history because it has been acknowledged */
-    pkt_stats_clear_rtt_history();
     return 0;
   }
 
   /* Forwarding Logic using RRT */
-  uint16_t nexthop = rrt_find_nexthop(
-      srv->forwarding_table, CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-      target_addr);
+  uint16_t nexthop = srv_rrt_nexthop(srv, target_addr);
 
   if (nexthop != BT_MESH_ADDR_UNASSIGNED) {
     BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK, 2);
@@ -813,26 +1564,73 @@ static int handle_report_ack(const struct bt_mesh_model *model,
   return 0;
 }
 
+/**
+ * @brief [SINK] Print one decoded REPORT: CSV_LOG,REPORT + CSV_LOG,LATENCY
+ *        lines, or SINK_FRAME_REPORT / SINK_FRAME_LATENCY in binary mode.
+ */
+static void sink_report_print(uint16_t reporter_addr,
+                              const struct packet_stats *stats,
+                              const struct pkt_lat_summary *lat,
+                              uint8_t lat_count) {
+  if (sink_frame_binary()) {
+    NET_BUF_SIMPLE_DEFINE(frame, SINK_FRAME_BODY_MAX);
+
+    net_buf_simple_add_le16(&frame, reporter_addr);
+    net_buf_simple_add_le32(&frame, stats->data_tx);
+    net_buf_simple_add_le32(&frame, stats->gradient_beacon_tx);
+    net_buf_simple_add_le32(&frame, stats->heartbeat_tx);
+    net_buf_simple_add_le32(&frame, stats->route_change_count);
+    net_buf_simple_add_le32(&frame, stats->data_fwd_tx);
+    net_buf_simple_add_le32(&frame, stats->rx_data_count);
+    net_buf_simple_add_le32(&frame, stats->pong_timeouts);
+    net_buf_simple_add_le32(&frame, stats->epoch);
+    net_buf_simple_add_le32(&frame, stats->since_reset_s);
+    (void)sink_frame_send(SINK_FRAME_REPORT, frame.data, frame.len);
+
+    for (int i = 0; i < lat_count; i++) {
+      net_buf_simple_reset(&frame);
+      net_buf_simple_add_le16(&frame, reporter_addr);
+      net_buf_simple_add_u8(&frame, lat[i].metric);
+      net_buf_simple_add_u8(&frame, lat[i].hops);
+      net_buf_simple_add_le32(&frame, lat[i].count);
+      net_buf_simple_add_le16(&frame, lat[i].p50_ms);
+      net_buf_simple_add_le16(&frame, lat[i].p90_ms);
+      net_buf_simple_add_le16(&frame, lat[i].p99_ms);
+      net_buf_simple_add_le16(&frame, lat[i].max_ms);
+      (void)sink_frame_send(SINK_FRAME_LATENCY, frame.data, frame.len);
+    }
+    return;
+  }
+
+  // Format log cho Python script (Dùng reporter_addr để định danh đúng node) (Atomic)
+  char csv_buf[128];
+  snprintf(csv_buf, sizeof(csv_buf),
+           "CSV_LOG,REPORT,0x%04x,%u,%u,%u,%u,%u,%u,%u,%u,%u",
+           reporter_addr, stats->data_tx, stats->gradient_beacon_tx,
+           stats->heartbeat_tx, stats->route_change_count, stats->data_fwd_tx,
+           stats->rx_data_count, stats->pong_timeouts, stats->epoch,
+           stats->since_reset_s);
+  printk("%s\n", csv_buf);
+
+  /* Format: CSV_LOG,LATENCY,Src,Metric,Hops,Count,P50,P90,P99,Max */
+  for (int i = 0; i < lat_count; i++) {
+    snprintf(csv_buf, sizeof(csv_buf),
+             "CSV_LOG,LATENCY,0x%04x,%s,%u,%u,%u,%u,%u,%u", reporter_addr,
+             pkt_stats_lat_metric_str(lat[i].metric), lat[i].hops,
+             lat[i].count, lat[i].p50_ms, lat[i].p90_ms, lat[i].p99_ms,
+             lat[i].max_ms);
+    printk("%s\n", csv_buf);
+  }
+}
+
 static int handle_report_rsp(const struct bt_mesh_model *model,
                              struct bt_mesh_msg_ctx *ctx,
                              struct net_buf_simple *buf) {
-  /* Kiểm tra chiều dài payload (14 bytes: ReporterAddr(2) + 6 stats * 2) */
-  if (buf->len < 14)
+  /* ReporterAddr(2) + snapshot (version, epoch, uptime, n, ...) */
+  if (buf->len < 6)
     return -EINVAL;
 
   uint16_t reporter_addr = net_buf_simple_pull_le16(buf);
-  uint16_t data_tx = net_buf_simple_pull_le16(buf);
-  uint16_t beacon_tx = net_buf_simple_pull_le16(buf);
-  uint16_t hb_tx = net_buf_simple_pull_le16(buf);
-  uint16_t route_changes = net_buf_simple_pull_le16(buf);
-  uint16_t data_fwd = net_buf_simple_pull_le16(buf);
-  uint16_t rx_count = net_buf_simple_pull_le16(buf);
-
-  /* [NEW] Bóc tách RTT History */
-  uint8_t rtt_samples = 0;
-  if (buf->len >= 1) {
-    rtt_samples = net_buf_simple_pull_u8(buf);
-  }
 
   struct bt_mesh_gradient_srv *srv = model->rt->user_data;
 
@@ -848,74 +1646,50 @@ static int handle_report_rsp(const struct bt_mesh_model *model,
     LOG_INF("SINK received REPORT from 0x%04x (Forwarded by 0x%04x)",
             reporter_addr, ctx->addr);
 
-    // Format log cho Python script (Dùng reporter_addr để định danh đúng node) (Atomic)
-    char csv_buf[128];
-    snprintf(csv_buf, sizeof(csv_buf), "CSV_LOG,REPORT,0x%04x,%u,%u,%u,%u,%u,%u",
-             reporter_addr, data_tx, beacon_tx, hb_tx, route_changes, data_fwd, rx_count);
-    printk("%s\n", csv_buf);
+    struct packet_stats stats;
+    struct pkt_lat_summary lat[PKT_LAT_MAX_SUMMARIES];
+    uint8_t lat_count = 0;
+    int err = pkt_stats_snapshot_decode(buf, &stats, lat, &lat_count);
 
-    /* [NEW] Log Individual RTTs */
-    for (int i = 0; i < rtt_samples; i++) {
-      if (buf->len >= 4) {
-        uint16_t seq = net_buf_simple_pull_le16(buf);
-        uint16_t rtt = net_buf_simple_pull_le16(buf);
-        printk("CSV_LOG,RTT_DATA,0x%04x,%u,%u\n", reporter_addr, seq, rtt);
-      }
+    if (err) {
+      LOG_WRN("Malformed REPORT snapshot from 0x%04x (err %d)", reporter_addr,
+              err);
+      return 0;
     }
 
-    /* SEND ACK via Reverse Routing tới Reporter gốc */
-    uint16_t nexthop = rrt_find_nexthop(
-        srv->forwarding_table,
-        CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE, reporter_addr);
-
-    if (nexthop != BT_MESH_ADDR_UNASSIGNED) {
-      BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK, 2);
-      bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_ACK);
-      net_buf_simple_add_le16(&msg, reporter_addr);
+    sink_report_print(reporter_addr, &stats, lat, lat_count);
 
-      struct bt_mesh_msg_ctx ack_ctx = {
-          .app_idx = model->keys[0],
-          .addr = nexthop,
-          .send_ttl = BT_MESH_TTL_DEFAULT,
-      };
-      srv_send_msg_with_stat(srv, &ack_ctx, &msg);
-      LOG_DBG("Sink sent REPORT_ACK for 0x%04x via Nexthop 0x%04x",
-              reporter_addr, nexthop);
+    /* [NEW] First report of the round: ack via the next bitmap broadcast.
+     * A repeat means the reporter missed it (or is outside a broadcast
+     * round): ACK via Reverse Routing tới Reporter gốc. */
+    if (report_ack_mark(srv, reporter_addr) > 0) {
+      k_work_schedule(&srv->report_ack.flush_work,
+                      K_MSEC(CONFIG_BT_MESH_REPORT_ACK_INTERVAL_MS));
     } else {
-      LOG_WRN("Sink cannot find RRT route for ACK to 0x%04x (Source: 0x%04x)",
-              reporter_addr, ctx->addr);
+      report_ack_send_unicast(srv, reporter_addr, ctx->addr);
     }
   } else {
     /* [2. I AM RELAY] - Chuyển tiếp bản báo cáo lên CHA */
-    const neighbor_entry_t *best_parent =
-        find_strict_upstream_parent(srv, reporter_addr);
+    uint16_t parent_addr =
+        find_strict_upstream_parent(srv, reporter_addr, reporter_addr,
+                                    SDN_FLOW_CLASS_CTRL, NULL);
 
-    if (best_parent != NULL) {
+    if (parent_addr != BT_MESH_ADDR_UNASSIGNED) {
       LOG_INF("Relaying REPORT from 0x%04x to Parent 0x%04x", reporter_addr,
-              best_parent->addr);
+              parent_addr);
 
-      /* [UPDATED] Use larger buffer to accommodate RTT data */
-      BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_RSP, 220);
+      /* Snapshot is opaque to relays: forward it verbatim */
+      BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_RSP,
+                               REPORT_RSP_MAX_PAYLOAD);
       bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_RSP);
 
       net_buf_simple_add_le16(&msg, reporter_addr);
-      net_buf_simple_add_le16(&msg, data_tx);
-      net_buf_simple_add_le16(&msg, beacon_tx);
-      net_buf_simple_add_le16(&msg, hb_tx);
-      net_buf_simple_add_le16(&msg, route_changes);
-      net_buf_simple_add_le16(&msg, data_fwd);
-      net_buf_simple_add_le16(&msg, rx_count);
-
-      /* [NEW] Forward RTT count and all RTT samples */
-      net_buf_simple_add_u8(&msg, rtt_samples);
-      if (rtt_samples > 0 && buf->len > 0) {
-        uint8_t *data_ptr = net_buf_simple_add(&msg, buf->len);
-        memcpy(data_ptr, buf->data, buf->len);
-      }
+      net_buf_simple_add_mem(&msg, buf->data,
+                             MIN(buf->len, PKT_STATS_SNAPSHOT_MAX_LEN));
 
       struct bt_mesh_msg_ctx fwd_ctx = {
           .app_idx = model->keys[0],
-          .addr = best_parent->addr,
+          .addr = parent_addr,
           .send_ttl = BT_MESH_TTL_DEFAULT,
           .send_rel = true,
       };
@@ -941,23 +1715,83 @@ static int handle_topo_req(const struct bt_mesh_model *model,
 static int handle_topo_rep(const struct bt_mesh_model *model,
                            struct bt_mesh_msg_ctx *ctx,
                            struct net_buf_simple *buf);
+static int handle_topo_delta(const struct bt_mesh_model *model,
+                             struct bt_mesh_msg_ctx *ctx,
+                             struct net_buf_simple *buf);
+static int handle_topo_bundle(const struct bt_mesh_model *model,
+                              struct bt_mesh_msg_ctx *ctx,
+                              struct net_buf_simple *buf);
 static void topo_reply_work_handler(struct k_work *work);
 static void topo_poll_handler(struct k_work *work);
 
 /* Sink-side sequence counter for polling sessions (0-15, wraps around) */
 static uint8_t s_topo_seq_counter;
 
-/* [NEW] Accumulator for MAC layer absolute total packets sent 
+/* [NEW] Accumulator for MAC layer absolute total packets sent
  * (Preserved across 30s STAT resets to estimate battery) */
 static uint32_t s_mac_total_sent_accum = 0;
 
+static const struct neighbor_item *topo_find_item(const struct neighbor_item *items,
+                                                  uint8_t count, uint16_t addr) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (items[i].addr == addr) {
+      return &items[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Helper: Diff the fresh snapshot against the acked state.
+ *        Fills delta_upd (added, or RSSI/gradient changed beyond threshold),
+ *        delta_rem (gone) and the pending state the Sink will hold once
+ *        this delta is delivered. Sub-threshold RSSI drift is NOT folded
+ *        into pending, so it cannot accumulate silently across rounds.
+ */
+static void topo_build_delta(struct sensor_topo_ctx *tctx) {
+  tctx->n_upd = 0;
+  tctx->n_rem = 0;
+  tctx->pending_count = 0;
+
+  for (uint8_t i = 0; i < tctx->total_valid; i++) {
+    const struct neighbor_item *cur = &tctx->snapshot[i];
+    const struct neighbor_item *old =
+        topo_find_item(tctx->acked, tctx->acked_count, cur->addr);
+
+    if (old == NULL || old->grad != cur->grad ||
+        abs(cur->rssi - old->rssi) >= CONFIG_BT_MESH_TOPO_DELTA_RSSI_THRESHOLD) {
+      tctx->delta_upd[tctx->n_upd++] = *cur;
+      tctx->pending[tctx->pending_count++] = *cur;
+    } else {
+      tctx->pending[tctx->pending_count++] = *old;
+    }
+  }
+
+  for (uint8_t i = 0; i < tctx->acked_count; i++) {
+    if (!topo_find_item(tctx->snapshot, tctx->total_valid, tctx->acked[i].addr)) {
+      tctx->delta_rem[tctx->n_rem++] = tctx->acked[i].addr;
+    }
+  }
+
+  /* Counters ride along only when they moved noticeably */
+  uint32_t fwd_diff = abs((int32_t)tctx->fwd_rate_snapshot - (int32_t)tctx->acked_fwd);
+
+  tctx->delta_flags = 0;
+  if (tctx->drop_count_snapshot != tctx->acked_drop ||
+      fwd_diff * 100 > (uint32_t)tctx->acked_fwd *
+                           CONFIG_BT_MESH_TOPO_DELTA_FWD_THRESHOLD_PCT) {
+    tctx->delta_flags |= TOPO_DELTA_FLAG_COUNTERS;
+  }
+}
+
 /**
  * @brief Helper: Execute Atomic Snapshot of neighbor table.
  *        Copies ALL valid (non-expired, non-unassigned) neighbors up to
- *        TOPO_REP_MAX_NEIGHBORS. Returns false if is_reporting lock is active.
+ *        TOPO_REP_MAX_NEIGHBORS, then decides between a full paged report
+ *        and a delta. Returns false if is_reporting lock is active.
  */
 static bool topo_take_snapshot(struct bt_mesh_gradient_srv *srv,
-                               uint8_t seq_id) {
+                               uint8_t seq_id, bool force_full) {
   /* Điểm mù 1: Chống kẹt Snapshot */
   if (srv->topo_ctx.is_reporting) {
     LOG_WRN("[TOPO] Snapshot rejected: drip-feed still active");
@@ -968,19 +1802,15 @@ static bool topo_take_snapshot(struct bt_mesh_gradient_srv *srv,
   srv->topo_ctx.req_seq_id = seq_id;
   int64_t now = k_uptime_get();
 
-  k_mutex_lock(&srv->forwarding_table_mutex, K_FOREVER);
+  /* [NEW] Published view: the RX path never waits on a table scan */
+  const struct fwd_view *view = fwd_view_acquire(&srv->fwd_view);
 
-  for (int i = 0; i < CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE; i++) {
+  for (int i = 0; i < view->nb_count; i++) {
     if (srv->topo_ctx.total_valid >= TOPO_REP_MAX_NEIGHBORS) {
       break;
     }
 
-    neighbor_entry_t *e = &srv->forwarding_table[i];
-
-    /* Skip UNASSIGNED */
-    if (e->addr == BT_MESH_ADDR_UNASSIGNED) {
-      continue;
-    }
+    const neighbor_entry_t *e = &view->nb[i];
 
     /* Skip expired (> 2 minutes = 120000 ms) */
     if ((now - e->last_seen) > CONFIG_BT_MESH_GRADIENT_SRV_NODE_TIMEOUT_MS) {
@@ -998,43 +1828,63 @@ static bool topo_take_snapshot(struct bt_mesh_gradient_srv *srv,
     srv->topo_ctx.total_valid++;
   }
 
-  k_mutex_unlock(&srv->forwarding_table_mutex);
+  fwd_view_release(&srv->fwd_view, view);
 
-  /* Calculate pagination */
-  if (srv->topo_ctx.total_valid == 0) {
-    srv->topo_ctx.total_pages = 1; /* Will abort at send time (no uplink) */
-  } else {
-    srv->topo_ctx.total_pages =
-        (srv->topo_ctx.total_valid + TOPO_REP_MAX_PER_PAGE - 1) /
-        TOPO_REP_MAX_PER_PAGE;
-  }
   srv->topo_ctx.current_page = 1;
   srv->topo_ctx.is_reporting = true; /* Lock ON */
 
   /* [NEW] Capture Drops and Fwd Rate from Zephyr MAC once for the entire report session */
   struct bt_mesh_statistic stats;
   bt_mesh_stat_get(&stats);
-  
+
   uint32_t mac_planned = stats.tx_local_planned + stats.tx_adv_relay_planned;
   uint32_t mac_succeeded = stats.tx_local_succeeded + stats.tx_adv_relay_succeeded;
-  
+
   /* MAC Drops = Planned - Succeeded (with boundary safety clamping) */
   uint32_t mac_drops = (mac_planned > mac_succeeded) ? (mac_planned - mac_succeeded) : 0;
-  
+
   /* Universal Drops = MAC Hardware Drops + Application Soft Drops */
   uint32_t total_drops = mac_drops + srv->soft_drop_count;
-  
+
   srv->topo_ctx.drop_count_snapshot = (uint16_t)MIN(total_drops, 65535);
   srv->topo_ctx.fwd_rate_snapshot = (uint16_t)MIN(mac_succeeded, 65535);
 
   /* Absolute Total Sent = Accumulator (from previous resets) + Current statistics window */
   srv->topo_ctx.total_sent_snapshot = s_mac_total_sent_accum + mac_succeeded;
-  
+
   /* Clear local Soft Drop counter for the next window */
   srv->soft_drop_count = 0;
 
-  LOG_INF("[TOPO] Snapshot: %d valid neighbors, %d pages, seq=%d, Drops:%u, FwdR:%u, TotalSent:%u",
-          srv->topo_ctx.total_valid, srv->topo_ctx.total_pages, seq_id,
+  /* [NEW] Full vs Delta: full when the Sink asked for it, when we have no
+   * delivered base, or periodically to bound any divergence */
+  srv->topo_ctx.is_delta =
+      !force_full && srv->topo_ctx.acked_valid &&
+      (CONFIG_BT_MESH_TOPO_FULL_RESYNC_EVERY == 0 ||
+       srv->topo_ctx.deltas_since_full < CONFIG_BT_MESH_TOPO_FULL_RESYNC_EVERY);
+  srv->topo_ctx.ver++;
+
+  if (srv->topo_ctx.is_delta) {
+    topo_build_delta(&srv->topo_ctx);
+    srv->topo_ctx.total_pages = 1;
+  } else {
+    memcpy(srv->topo_ctx.pending, srv->topo_ctx.snapshot,
+           srv->topo_ctx.total_valid * sizeof(struct neighbor_item));
+    srv->topo_ctx.pending_count = srv->topo_ctx.total_valid;
+
+    /* Calculate pagination */
+    if (srv->topo_ctx.total_valid == 0) {
+      srv->topo_ctx.total_pages = 1; /* Will abort at send time (no uplink) */
+    } else {
+      srv->topo_ctx.total_pages =
+          (srv->topo_ctx.total_valid + TOPO_REP_MAX_PER_PAGE - 1) /
+          TOPO_REP_MAX_PER_PAGE;
+    }
+  }
+
+  LOG_INF("[TOPO] Snapshot: %d valid neighbors, %s v%u (+%u/-%u), seq=%d, Drops:%u, FwdR:%u, TotalSent:%u",
+          srv->topo_ctx.total_valid, srv->topo_ctx.is_delta ? "delta" : "full",
+          srv->topo_ctx.ver, srv->topo_ctx.is_delta ? srv->topo_ctx.n_upd : 0,
+          srv->topo_ctx.is_delta ? srv->topo_ctx.n_rem : 0, seq_id,
           srv->topo_ctx.drop_count_snapshot, srv->topo_ctx.fwd_rate_snapshot,
           srv->topo_ctx.total_sent_snapshot);
 
@@ -1043,7 +1893,9 @@ static bool topo_take_snapshot(struct bt_mesh_gradient_srv *srv,
 
 /**
  * @brief [SENSOR] Handle OP_TOPO_REQ broadcast from Sink.
- *        Extracts seq_id from payload, takes snapshot, schedules jitter reply.
+ *        Payload: [Commit|Full|Wave|Seq] + [collect_wave if Wave]
+ *                 + optional resync address list.
+ *        Takes snapshot, schedules reply in own wave slot (or jitter).
  */
 static int handle_topo_req(const struct bt_mesh_model *model,
                            struct bt_mesh_msg_ctx *ctx,
@@ -1055,190 +1907,799 @@ static int handle_topo_req(const struct bt_mesh_model *model,
     return 0;
   }
 
-  /* Extract payload (1 byte) */
+  /* [NEW] Controlled flooding: one copy per seq, passed on verbatim */
+  if (IS_ENABLED(CONFIG_BT_MESH_GRADIENT_BCAST_CONTROLLED) && buf->len >= 1) {
+    if (bcast_seen(BCAST_KEY(BCAST_KEY_TOPO_REQ, buf->data[0]))) {
+      return 0;
+    }
+    BT_MESH_MODEL_BUF_DEFINE(fwd, BT_MESH_GRADIENT_SRV_OP_TOPO_REQ,
+                             1 + COLLECT_WAVE_LEN + TOPO_REQ_MAX_RESYNC * 2);
+    bt_mesh_model_msg_init(&fwd, BT_MESH_GRADIENT_SRV_OP_TOPO_REQ);
+    net_buf_simple_add_mem(&fwd, buf->data,
+                           MIN(buf->len, 1 + COLLECT_WAVE_LEN +
+                                             TOPO_REQ_MAX_RESYNC * 2));
+    bcast_relay(srv, ctx, &fwd);
+  }
+
+  /* Extract payload (1 byte + N * 2 byte resync addresses) */
   uint8_t payload = 0;
   if (buf->len >= 1) {
     payload = net_buf_simple_pull_u8(buf);
   }
-  
+
   uint8_t seq_id = payload & 0x0F;
-  bool is_commit = (payload & 0x80) != 0;
+  bool is_commit = (payload & TOPO_REQ_FLAG_COMMIT) != 0;
+  bool force_full = (payload & TOPO_REQ_FLAG_FULL) != 0;
+
+  struct collect_wave wave = {0};
+  bool has_wave = (payload & TOPO_REQ_FLAG_WAVE) && collect_wave_pull(buf, &wave);
 
-  LOG_INF("[TOPO] RX TOPO_REQ from 0x%04x, seq=%d, commit=%d", ctx->addr, seq_id, is_commit);
+  /* [NEW] Gateway saw a version gap from us -> resend everything */
+  uint16_t my_addr = bt_mesh_model_elem(srv->model)->rt->addr;
+  while (buf->len >= 2) {
+    if (net_buf_simple_pull_le16(buf) == my_addr) {
+      force_full = true;
+    }
+  }
+
+  LOG_INF("[TOPO] RX TOPO_REQ from 0x%04x, seq=%d, commit=%d, full=%d",
+          ctx->addr, seq_id, is_commit, force_full);
 
   if (is_commit) {
-      if (srv->sdn_next_hop_pending != BT_MESH_ADDR_UNASSIGNED && srv->sdn_next_hop_pending != 0) {
-          LOG_WRN("[SDN 2PC] COMMIT! Active NextHop updated to 0x%04x", srv->sdn_next_hop_pending);
-          srv->sdn_next_hop_active = srv->sdn_next_hop_pending;
-          srv->sdn_next_hop_pending = BT_MESH_ADDR_UNASSIGNED; // Reset for next time
+      int applied = sdn_flow_commit(&srv->sdn_flows);
+
+      if (applied > 0) {
+          LOG_WRN("[SDN 2PC] COMMIT! %d flow rule(s) applied (v%u)", applied,
+                  srv->sdn_flows.active_version);
 
           /* [NEW] Visual Feedback: Toggle LED 4 when AI route is committed */
           led_indicate_sdn_commit();
       }
   }
 
-  /* 1. Atomic Snapshot (will fail if drip-feed is active) */
-  if (!topo_take_snapshot(srv, seq_id)) {
-    return 0; /* Busy, ignore this request */
+  /* 1. Atomic Snapshot (will fail if drip-feed is active) */
+  if (!topo_take_snapshot(srv, seq_id, force_full)) {
+    return 0; /* Busy, ignore this request */
+  }
+
+  /* 2. Schedule reply in own wave slot, or with Jitter (0 - 8000 ms) */
+  uint32_t delay_ms = has_wave
+      ? bt_mesh_gradient_srv_wave_delay_ms(&wave, srv->gradient, my_addr, seq_id)
+      : sys_rand32_get() % 8000;
+  LOG_DBG("[TOPO] Reply in %u ms", delay_ms);
+  k_work_reschedule(&srv->topo_ctx.reply_work, K_MSEC(delay_ms));
+
+  return 0;
+}
+
+/**
+ * @brief [NEW] Close a report session once every queued message is done.
+ *        The pending state becomes the acked base only if all messages
+ *        reached the parent; otherwise the old base is kept and the
+ *        Gateway detects the version gap and asks for a resync.
+ */
+static void topo_session_settle(struct sensor_topo_ctx *tctx) {
+  if (!tctx->tx_failed) {
+    memcpy(tctx->acked, tctx->pending,
+           tctx->pending_count * sizeof(struct neighbor_item));
+    tctx->acked_count = tctx->pending_count;
+    tctx->acked_grad = tctx->pending_grad;
+    tctx->acked_parent = tctx->pending_parent;
+    if (!tctx->is_delta || (tctx->delta_flags & TOPO_DELTA_FLAG_COUNTERS)) {
+      tctx->acked_drop = tctx->drop_count_snapshot;
+      tctx->acked_fwd = tctx->fwd_rate_snapshot;
+    }
+    tctx->acked_ver = tctx->ver;
+    tctx->acked_valid = true;
+    tctx->deltas_since_full = tctx->is_delta ? tctx->deltas_since_full + 1 : 0;
+  }
+
+  LOG_INF("[TOPO] %s v%u %s", tctx->is_delta ? "Delta" : "Full", tctx->ver,
+          tctx->tx_failed ? "NOT delivered, keeping old base" : "delivered");
+  tctx->is_reporting = false; /* Unlock for next cycle */
+}
+
+static void topo_send_end(int err, void *cb_data) {
+  struct sensor_topo_ctx *tctx = cb_data;
+
+  if (err) {
+    tctx->tx_failed = true;
+  }
+  if (atomic_dec(&tctx->tx_outstanding) == 1) {
+    topo_session_settle(tctx);
+  }
+}
+
+static const struct bt_mesh_send_cb topo_send_cb = {
+    .end = topo_send_end,
+};
+
+/**
+ * @brief [NEW] Pack and send the single OP_TOPO_DELTA message.
+ */
+static int topo_send_delta(struct bt_mesh_gradient_srv *srv,
+                           struct sensor_topo_ctx *tctx, uint16_t my_addr,
+                           uint16_t parent_addr) {
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TOPO_DELTA,
+                           TOPO_DELTA_MAX_PAYLOAD);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_TOPO_DELTA);
+
+  if (srv->gradient != tctx->acked_grad || parent_addr != tctx->acked_parent) {
+    tctx->delta_flags |= TOPO_DELTA_FLAG_ROUTE;
+  }
+
+  net_buf_simple_add_le16(&msg, my_addr);
+  net_buf_simple_add_u8(&msg, (tctx->req_seq_id << 4) | tctx->delta_flags);
+  net_buf_simple_add_u8(&msg, tctx->acked_ver); /* Base_Ver */
+  net_buf_simple_add_u8(&msg, tctx->ver);
+  net_buf_simple_add_u8(&msg, tctx->n_upd);
+  net_buf_simple_add_u8(&msg, tctx->n_rem);
+
+  uint8_t width = topo_codec_addr_width(my_addr, tctx->delta_upd, tctx->n_upd,
+                                        tctx->delta_rem, tctx->n_rem);
+  net_buf_simple_add_u8(&msg, (TOPO_CODEC_FORMAT << 4) | (width - 1));
+
+  if (tctx->delta_flags & TOPO_DELTA_FLAG_ROUTE) {
+    net_buf_simple_add_u8(&msg, srv->gradient);
+    net_buf_simple_add_le16(&msg, parent_addr);
+  }
+
+  if (tctx->delta_flags & TOPO_DELTA_FLAG_COUNTERS) {
+    net_buf_simple_add_le16(&msg, tctx->drop_count_snapshot);
+    net_buf_simple_add_le16(&msg, tctx->fwd_rate_snapshot);
+    net_buf_simple_add_le32(&msg, (uint32_t)(k_uptime_get() / 1000));
+    net_buf_simple_add_le32(&msg, tctx->total_sent_snapshot);
+  }
+
+  struct topo_bitw bw;
+  topo_bitw_init(&bw, &msg);
+  for (uint8_t i = 0; i < tctx->n_upd; i++) {
+    topo_codec_put_item(&bw, my_addr, width, &tctx->delta_upd[i]);
+  }
+  for (uint8_t i = 0; i < tctx->n_rem; i++) {
+    topo_codec_put_addr(&bw, my_addr, width, tctx->delta_rem[i]);
+  }
+  topo_bitw_flush(&bw);
+
+  struct bt_mesh_msg_ctx ctx = {
+      .app_idx = srv->model->keys[0],
+      .addr = parent_addr,
+      .send_ttl = BT_MESH_TTL_DEFAULT,
+      .send_rel = TOPO_SEND_REL(&msg), /* no-change delta: one unsegmented PDU */
+  };
+
+  return srv_send_msg_with_cb(srv, &ctx, &msg, &topo_send_cb, tctx);
+}
+
+/**
+ * @brief [SENSOR] Workqueue handler: Multi-Page Drip-feed TX.
+ *        Sends one page per invocation, then reschedules itself for the next
+ * page. A delta session sends a single OP_TOPO_DELTA instead.
+ */
+static void topo_reply_work_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct sensor_topo_ctx *tctx =
+      CONTAINER_OF(dwork, struct sensor_topo_ctx, reply_work);
+  struct bt_mesh_gradient_srv *srv =
+      CONTAINER_OF(tctx, struct bt_mesh_gradient_srv, topo_ctx);
+
+  /* Safety: Must have a model and be provisioned */
+  if (!srv->model || !bt_mesh_is_provisioned()) {
+    tctx->is_reporting = false;
+    return;
+  }
+
+  uint16_t my_addr = bt_mesh_model_elem(srv->model)->rt->addr;
+
+  /* Find actual nexthop being used for Uplink routing */
+  uint16_t parent_addr = find_strict_upstream_parent(
+      srv, BT_MESH_ADDR_UNASSIGNED, my_addr, SDN_FLOW_CLASS_CTRL, NULL);
+  uint16_t nexthop = parent_addr;
+
+  if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
+    LOG_WRN("[TOPO] No uplink route, aborting drip-feed");
+    tctx->is_reporting = false; /* Unlock */
+    return;
+  }
+
+  if (tctx->current_page == 1) {
+    /* Session start: guard reference, dropped after the last message */
+    atomic_set(&tctx->tx_outstanding, 1);
+    tctx->tx_failed = false;
+    tctx->pending_grad = srv->gradient;
+    tctx->pending_parent = parent_addr;
+  }
+
+  /* (MAC stats reset only after the full report cycle to ensure continuity) */
+  if (tctx->current_page >= tctx->total_pages) {
+    struct bt_mesh_statistic stats;
+    bt_mesh_stat_get(&stats);
+    uint32_t current_window_succeeded = stats.tx_local_succeeded + stats.tx_adv_relay_succeeded;
+    /* Accumulator = snapshot value + delta sent DURING drip-feed phase.
+     * fwd_rate_snapshot was the mac_succeeded at snapshot time.
+     * current_window_succeeded includes those PLUS packets sent during drip-feed.
+     * Delta = current_window_succeeded - fwd_rate_snapshot (drip-feed packets only). */
+    uint32_t drip_delta = (current_window_succeeded > tctx->fwd_rate_snapshot)
+                        ? (current_window_succeeded - tctx->fwd_rate_snapshot) : 0;
+    s_mac_total_sent_accum = tctx->total_sent_snapshot + drip_delta;
+    bt_mesh_stat_reset();
+    LOG_DBG("[TOPO] Report done. Accum=%u (snap=%u + drip=%u)",
+            s_mac_total_sent_accum, tctx->total_sent_snapshot, drip_delta);
+  }
+
+  int err;
+
+  if (tctx->is_delta) {
+    err = topo_send_delta(srv, tctx, my_addr, parent_addr);
+    if (err) {
+      LOG_ERR("[TOPO] Failed to send delta v%u, err=%d", tctx->ver, err);
+    } else {
+      LOG_INF("[TOPO] Sent delta v%u->v%u (+%u/-%u, flags 0x%x) to 0x%04x",
+              tctx->acked_ver, tctx->ver, tctx->n_upd, tctx->n_rem,
+              tctx->delta_flags, nexthop);
+    }
+  } else {
+    /* Điểm mù 2: Safe array indexing for current page */
+    uint8_t start_idx = (tctx->current_page - 1) * TOPO_REP_MAX_PER_PAGE;
+    uint8_t neighbors_in_page =
+        MIN(TOPO_REP_MAX_PER_PAGE, tctx->total_valid - start_idx);
+
+    /* Stack-allocated buffer (Code Safety: no malloc/free) */
+    BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TOPO_REP,
+                             TOPO_REP_MAX_PAYLOAD);
+    bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_TOPO_REP);
+
+    const struct neighbor_item *items = &tctx->snapshot[start_idx];
+    uint8_t width = topo_codec_addr_width(my_addr, items, neighbors_in_page, NULL, 0);
+
+    /* === Pack 6-byte Header === */
+    net_buf_simple_add_le16(&msg, my_addr);     /* Origin_Addr (2B) */
+    /* Seq_ID (4 bits cao) | Total_Pages (4 bits thấp) */
+    net_buf_simple_add_u8(&msg,
+                          (tctx->req_seq_id << 4) | (tctx->total_pages & 0x0F));
+    /* Current_Page (4 bits cao) | Neighbors_in_Page (4 bits thấp) */
+    net_buf_simple_add_u8(&msg, (tctx->current_page << 4) | neighbors_in_page);
+    net_buf_simple_add_u8(&msg, tctx->ver); /* [NEW] Base for following deltas */
+    net_buf_simple_add_u8(&msg, (TOPO_CODEC_FORMAT << 4) | (width - 1));
+
+    /* [UPD] Route + counters only once per report (page 1) */
+    if (tctx->current_page == 1) {
+      net_buf_simple_add_u8(&msg, srv->gradient); /* My_Grad (1B) */
+      net_buf_simple_add_le16(&msg, parent_addr); /* My_Parent (2B) */
+      /* Drop Count (2B) and Fwd Rate (2B): values captured at snapshot time */
+      net_buf_simple_add_le16(&msg, tctx->drop_count_snapshot);
+      net_buf_simple_add_le16(&msg, tctx->fwd_rate_snapshot);
+      /* Node Uptime (4B) in seconds */
+      net_buf_simple_add_le32(&msg, (uint32_t)(k_uptime_get() / 1000));
+      /* MAC-layer Total Packets Sent (4B) for precise battery estimation */
+      net_buf_simple_add_le32(&msg, tctx->total_sent_snapshot);
+    }
+
+    /* === Pack neighbor bitstream (AddrW + 16 bits each) === */
+    struct topo_bitw bw;
+    topo_bitw_init(&bw, &msg);
+    for (uint8_t i = 0; i < neighbors_in_page; i++) {
+      topo_codec_put_item(&bw, my_addr, width, &items[i]);
+    }
+    topo_bitw_flush(&bw);
+
+    /* Send Uplink via Gradient Routing (hop-by-hop) */
+    struct bt_mesh_msg_ctx ctx = {
+        .app_idx = srv->model->keys[0],
+        .addr = nexthop,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+        .send_rel = true, /* Segmented + BlockAck */
+    };
+
+    err = srv_send_msg_with_cb(srv, &ctx, &msg, &topo_send_cb, tctx);
+    if (err) {
+      LOG_ERR("[TOPO] Failed to send page %d/%d, err=%d", tctx->current_page,
+              tctx->total_pages, err);
+    } else {
+      LOG_INF("[TOPO] Sent page %d/%d (%d neighbors) to 0x%04x",
+              tctx->current_page, tctx->total_pages, neighbors_in_page, nexthop);
+    }
+  }
+
+  if (err) {
+    tctx->tx_failed = true;
+  } else {
+    atomic_inc(&tctx->tx_outstanding);
+  }
+
+  /* === Drip-feed state machine === */
+  if (tctx->current_page < tctx->total_pages) {
+    tctx->current_page++;
+    /* Adaptive Jitter: 300ms + 0-100ms random */
+    uint32_t delay = 300 + (sys_rand32_get() % 100);
+    k_work_reschedule(&tctx->reply_work, K_MSEC(delay));
+  } else {
+    /* All pages queued: drop the guard, the last completion settles */
+    LOG_INF("[TOPO] Drip-feed complete (seq=%d)", tctx->req_seq_id);
+    if (atomic_dec(&tctx->tx_outstanding) == 1) {
+      topo_session_settle(tctx);
+    }
+  }
+}
+
+/**
+ * @brief [RELAY] Send the buffered bundle to own best parent and empty it.
+ *        A bundle holding a single record goes out under the record's own
+ *        opcode, so the Sink sees exactly what a non-bundling relay sends.
+ *        Caller holds srv->topo_bundle.lock.
+ */
+static void topo_bundle_send_locked(struct bt_mesh_gradient_srv *srv) {
+  struct relay_topo_bundle *b = &srv->topo_bundle;
+
+  if (b->len == 0) {
+    return;
+  }
+
+  uint8_t count = b->buf[0];
+
+  /* Bundles mix origins: only class-wide flow rules apply */
+  uint16_t nexthop = find_strict_upstream_parent(
+      srv, BT_MESH_ADDR_UNASSIGNED, SDN_FLOW_SRC_ANY, SDN_FLOW_CLASS_CTRL, NULL);
+
+  if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
+    LOG_ERR("[TOPO] Relay: No parent, dropped bundle of %u records", count);
+    b->len = 0;
+    return;
+  }
+
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TOPO_BUNDLE,
+                           CONFIG_BT_MESH_TOPO_BUNDLE_MAX_LEN);
+
+  if (count == 1) {
+    uint8_t type = b->buf[1];
+    uint8_t rec_len = b->buf[2];
+
+    bt_mesh_model_msg_init(&msg, type == TOPO_BUNDLE_REC_DELTA
+                                     ? BT_MESH_GRADIENT_SRV_OP_TOPO_DELTA
+                                     : BT_MESH_GRADIENT_SRV_OP_TOPO_REP);
+    net_buf_simple_add_mem(&msg, &b->buf[3], rec_len);
+  } else {
+    bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_TOPO_BUNDLE);
+    net_buf_simple_add_mem(&msg, b->buf, b->len);
+  }
+
+  struct bt_mesh_msg_ctx ctx = {
+      .app_idx = srv->model->keys[0],
+      .addr = nexthop,
+      .send_ttl = BT_MESH_TTL_DEFAULT,
+      .send_rel = TOPO_SEND_REL(&msg), /* single short delta stays unsegmented */
+  };
+
+  int err = srv_send_msg_with_stat(srv, &ctx, &msg);
+  if (err) {
+    LOG_ERR("[TOPO] Relay bundle forward failed (%u records), err=%d", count, err);
+  } else {
+    LOG_INF("[TOPO] Relayed bundle of %u records (%u B) to 0x%04X", count,
+            b->len, nexthop);
+  }
+  b->len = 0;
+}
+
+/**
+ * @brief [RELAY] Append one TOPO_REP / TOPO_DELTA payload to the bundle.
+ *        The window starts with the first record; a record that would
+ *        overflow the bundle flushes it first.
+ */
+static void topo_bundle_add(struct bt_mesh_gradient_srv *srv, uint8_t type,
+                            const uint8_t *rec, uint8_t rec_len) {
+  struct relay_topo_bundle *b = &srv->topo_bundle;
+
+  k_mutex_lock(&b->lock, K_FOREVER);
+
+  if (b->len > 0 && b->len + 2 + rec_len > sizeof(b->buf)) {
+    topo_bundle_send_locked(srv);
+  }
+  if (b->len == 0) {
+    b->buf[0] = 0;
+    b->len = 1;
+  }
+
+  b->buf[b->len++] = type;
+  b->buf[b->len++] = rec_len;
+  memcpy(&b->buf[b->len], rec, rec_len);
+  b->len += rec_len;
+  b->buf[0]++;
+
+  if (CONFIG_BT_MESH_TOPO_BUNDLE_WINDOW_MS == 0) {
+    topo_bundle_send_locked(srv);
+  }
+  k_mutex_unlock(&b->lock);
+
+  /* No-op while already scheduled: the window is not extended */
+  if (CONFIG_BT_MESH_TOPO_BUNDLE_WINDOW_MS > 0) {
+    k_work_schedule(&b->flush_work, K_MSEC(CONFIG_BT_MESH_TOPO_BUNDLE_WINDOW_MS));
+  }
+}
+
+/**
+ * @brief [RELAY] Bundle window expired: send whatever was collected.
+ */
+static void topo_bundle_flush_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct relay_topo_bundle *b =
+      CONTAINER_OF(dwork, struct relay_topo_bundle, flush_work);
+  struct bt_mesh_gradient_srv *srv =
+      CONTAINER_OF(b, struct bt_mesh_gradient_srv, topo_bundle);
+
+  k_mutex_lock(&b->lock, K_FOREVER);
+  topo_bundle_send_locked(srv);
+  k_mutex_unlock(&b->lock);
+}
+
+/**
+ * @brief [SINK] Append N(1) + N neighbor entries to a binary UART record
+ */
+static void sink_frame_add_nbs(struct net_buf_simple *frame,
+                               const struct neighbor_item *nbs, uint8_t n) {
+  net_buf_simple_add_u8(frame, n);
+  for (int i = 0; i < n; i++) {
+    net_buf_simple_add_le16(frame, nbs[i].addr);
+    net_buf_simple_add_u8(frame, (uint8_t)nbs[i].rssi);
+    net_buf_simple_add_u8(frame, nbs[i].grad);
+    net_buf_simple_add_le16(frame, nbs[i].link_uptime);
+  }
+}
+
+/**
+ * @brief [SINK] Decode one TOPO_REP page and print it as a $[TOPO] line
+ *        (or a SINK_FRAME_TOPO record in binary UART mode).
+ * @param via Neighbor the record arrived from (log only)
+ */
+static int topo_rep_sink_print(struct net_buf_simple *buf, uint16_t via) {
+  uint16_t origin_addr = net_buf_simple_pull_le16(buf);
+  uint8_t total_and_seq = net_buf_simple_pull_u8(buf);
+  uint8_t page_and_count = net_buf_simple_pull_u8(buf);
+  uint8_t ver = net_buf_simple_pull_u8(buf);
+  uint8_t fmt_width = net_buf_simple_pull_u8(buf);
+
+  /* Unpack seq_id/total_pages and current_page/count from combined bytes */
+  uint8_t seq_id = (total_and_seq >> 4) & 0x0F;
+  uint8_t total_pages = total_and_seq & 0x0F;
+  uint8_t current_page = page_and_count >> 4;
+  uint8_t count = MIN(page_and_count & 0x0F, TOPO_REP_MAX_PER_PAGE);
+  uint8_t width = (fmt_width & 0x0F) + 1;
+
+  if ((fmt_width >> 4) != TOPO_CODEC_FORMAT) {
+    LOG_WRN("[TOPO] Unknown page format %u from 0x%04X", fmt_width >> 4, origin_addr);
+    return -EINVAL;
+  }
+
+  /* Route + counters ride on page 1 only; other pages print zeros */
+  uint8_t grad = 0;
+  uint16_t parent = 0;
+  uint16_t drop_count = 0, fwd_rate = 0;
+  uint32_t node_uptime = 0, total_sent = 0;
+
+  if (current_page == 1) {
+    if (buf->len < TOPO_REP_FIRST_PAGE_LEN) {
+      return -EINVAL;
+    }
+    grad = net_buf_simple_pull_u8(buf);
+    parent = net_buf_simple_pull_le16(buf);
+    drop_count = net_buf_simple_pull_le16(buf);
+    fwd_rate = net_buf_simple_pull_le16(buf);
+    node_uptime = net_buf_simple_pull_le32(buf);
+    total_sent = net_buf_simple_pull_le32(buf);
+  }
+
+  struct neighbor_item nbs[TOPO_REP_MAX_PER_PAGE];
+  uint8_t n_nbs = 0;
+  struct topo_bitr br;
+
+  topo_bitr_init(&br, buf);
+  /* Bounds checking inside the bit reader */
+  while (n_nbs < count &&
+         topo_codec_get_item(&br, origin_addr, width, &nbs[n_nbs])) {
+    n_nbs++;
+  }
+
+  if (sink_frame_binary()) {
+    NET_BUF_SIMPLE_DEFINE(frame, SINK_FRAME_BODY_MAX);
+
+    net_buf_simple_add_le16(&frame, origin_addr);
+    net_buf_simple_add_u8(&frame, seq_id);
+    net_buf_simple_add_u8(&frame, total_pages);
+    net_buf_simple_add_u8(&frame, current_page);
+    net_buf_simple_add_u8(&frame, grad);
+    net_buf_simple_add_le16(&frame, parent);
+    net_buf_simple_add_le16(&frame, drop_count);
+    net_buf_simple_add_le16(&frame, fwd_rate);
+    net_buf_simple_add_le32(&frame, node_uptime);
+    net_buf_simple_add_le32(&frame, total_sent);
+    net_buf_simple_add_u8(&frame, ver);
+    sink_frame_add_nbs(&frame, nbs, n_nbs);
+    (void)sink_frame_send(SINK_FRAME_TOPO, frame.data, frame.len);
+  } else {
+    /* ═══════════════════════════════════════════════════════
+     * I AM SINK: Decode and print to UART with SOF/EOF
+     * Format:
+     * $[TOPO],<Origin>,<Seq>,<TotalPg>,<CurPg>,<Count>,<My_Grad>,<My_Parent>,<Drops>,<FwdRate>,<Uptime>s,<TotalSent>,<Ver>,[neighbors]
+     * ═══════════════════════════════════════════════════════ */
+    char uart_buf[300];
+    int pos = snprintf(uart_buf, sizeof(uart_buf),
+                       "$[TOPO],%04X,%d,%d,%d,%d,%d,%04X,%u,%u,%u,%u,%u", origin_addr,
+                       seq_id, total_pages, current_page, count, grad, parent,
+                       drop_count, fwd_rate, node_uptime, total_sent, ver);
+
+    for (int i = 0; i < n_nbs && pos < sizeof(uart_buf); i++) {
+      pos += snprintf(uart_buf + pos, sizeof(uart_buf) - pos,
+                      ",[%04X,%d,%d,%u]", nbs[i].addr, nbs[i].rssi, nbs[i].grad,
+                      nbs[i].link_uptime);
+    }
+    printk("%s\n",
+           uart_buf); /* Atomic print to avoid shell prompt interleaving */
   }
 
-  /* 2. Schedule reply with Jitter (0 - 8000 ms) */
-  uint32_t delay_ms = sys_rand32_get() % 8000;
-  k_work_reschedule(&srv->topo_ctx.reply_work, K_MSEC(delay_ms));
+  LOG_INF("[TOPO] RX page %d/%d from 0x%04X (seq=%d, v%u, grad=%d, Drp=%u, FwdR=%u, "
+          "UP:%u, TX:%u, parent=0x%04X via 0x%04x)",
+          current_page, total_pages, origin_addr, seq_id, ver, grad, drop_count,
+          fwd_rate, node_uptime, total_sent, parent, via);
 
   return 0;
 }
 
 /**
- * @brief [SENSOR] Workqueue handler: Multi-Page Drip-feed TX.
- *        Sends one page per invocation, then reschedules itself for the next
- * page.
+ * @brief [SINK] Decode one TOPO_DELTA and print it as a $[TOPOD] line
+ *        (or a SINK_FRAME_TOPO_DELTA record in binary UART mode).
+ * @param via Neighbor the record arrived from (log only)
  */
-static void topo_reply_work_handler(struct k_work *work) {
-  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-  struct sensor_topo_ctx *tctx =
-      CONTAINER_OF(dwork, struct sensor_topo_ctx, reply_work);
-  struct bt_mesh_gradient_srv *srv =
-      CONTAINER_OF(tctx, struct bt_mesh_gradient_srv, topo_ctx);
+static int topo_delta_sink_print(struct net_buf_simple *buf, uint16_t via) {
+  uint16_t origin_addr = net_buf_simple_pull_le16(buf);
+  uint8_t seq_flags = net_buf_simple_pull_u8(buf);
+  uint8_t base_ver = net_buf_simple_pull_u8(buf);
+  uint8_t ver = net_buf_simple_pull_u8(buf);
+  /* MIN() evaluates its arguments twice: pull into locals first */
+  uint8_t n_upd = net_buf_simple_pull_u8(buf);
+  uint8_t n_rem = net_buf_simple_pull_u8(buf);
+  uint8_t fmt_width = net_buf_simple_pull_u8(buf);
+  uint8_t width = (fmt_width & 0x0F) + 1;
+  uint8_t flags = seq_flags & 0x0F;
+
+  n_upd = MIN(n_upd, TOPO_REP_MAX_NEIGHBORS);
+  n_rem = MIN(n_rem, TOPO_REP_MAX_NEIGHBORS);
+
+  if ((fmt_width >> 4) != TOPO_CODEC_FORMAT) {
+    LOG_WRN("[TOPO] Unknown delta format %u from 0x%04X", fmt_width >> 4, origin_addr);
+    return -EINVAL;
+  }
+  uint8_t grad = 0;
+  uint16_t parent = 0;
+  uint16_t drop_count = 0, fwd_rate = 0;
+  uint32_t node_uptime = 0, total_sent = 0;
 
-  /* Safety: Must have a model and be provisioned */
-  if (!srv->model || !bt_mesh_is_provisioned()) {
-    tctx->is_reporting = false;
-    return;
+  if (flags & TOPO_DELTA_FLAG_ROUTE) {
+    if (buf->len < 3) {
+      return -EINVAL;
+    }
+    grad = net_buf_simple_pull_u8(buf);
+    parent = net_buf_simple_pull_le16(buf);
   }
 
-  uint16_t my_addr = bt_mesh_model_elem(srv->model)->rt->addr;
+  if (flags & TOPO_DELTA_FLAG_COUNTERS) {
+    if (buf->len < 12) {
+      return -EINVAL;
+    }
+    drop_count = net_buf_simple_pull_le16(buf);
+    fwd_rate = net_buf_simple_pull_le16(buf);
+    node_uptime = net_buf_simple_pull_le32(buf);
+    total_sent = net_buf_simple_pull_le32(buf);
+  }
+
+  struct neighbor_item upd[TOPO_REP_MAX_NEIGHBORS];
+  uint16_t rem[TOPO_REP_MAX_NEIGHBORS];
+  uint8_t got_upd = 0, got_rem = 0;
+  struct topo_bitr br;
+
+  topo_bitr_init(&br, buf);
+  while (got_upd < n_upd &&
+         topo_codec_get_item(&br, origin_addr, width, &upd[got_upd])) {
+    got_upd++;
+  }
+  /* Removals only follow a complete update list */
+  while (got_upd == n_upd && got_rem < n_rem &&
+         topo_codec_get_addr(&br, origin_addr, width, &rem[got_rem])) {
+    got_rem++;
+  }
+
+  if (sink_frame_binary()) {
+    NET_BUF_SIMPLE_DEFINE(frame, SINK_FRAME_BODY_MAX);
+
+    net_buf_simple_add_le16(&frame, origin_addr);
+    net_buf_simple_add_u8(&frame, seq_flags >> 4);
+    net_buf_simple_add_u8(&frame, flags);
+    net_buf_simple_add_u8(&frame, base_ver);
+    net_buf_simple_add_u8(&frame, ver);
+    net_buf_simple_add_u8(&frame, grad);
+    net_buf_simple_add_le16(&frame, parent);
+    net_buf_simple_add_le16(&frame, drop_count);
+    net_buf_simple_add_le16(&frame, fwd_rate);
+    net_buf_simple_add_le32(&frame, node_uptime);
+    net_buf_simple_add_le32(&frame, total_sent);
+    sink_frame_add_nbs(&frame, upd, got_upd);
+    net_buf_simple_add_u8(&frame, got_rem);
+    for (int i = 0; i < got_rem; i++) {
+      net_buf_simple_add_le16(&frame, rem[i]);
+    }
+    (void)sink_frame_send(SINK_FRAME_TOPO_DELTA, frame.data, frame.len);
+  } else {
+    /* ═══════════════════════════════════════════════════════
+     * Format (fields not flagged are printed as 0):
+     * $[TOPOD],<Origin>,<Seq>,<Flags>,<BaseVer>,<Ver>,<Grad>,<Parent>,<Drops>,<FwdRate>,<Uptime>,<TotalSent>,[upd]...,-[rem]...
+     * ═══════════════════════════════════════════════════════ */
+    char uart_buf[400];
+    int pos = snprintf(uart_buf, sizeof(uart_buf),
+                       "$[TOPOD],%04X,%d,%d,%u,%u,%d,%04X,%u,%u,%u,%u", origin_addr,
+                       seq_flags >> 4, flags, base_ver, ver, grad, parent,
+                       drop_count, fwd_rate, node_uptime, total_sent);
 
-  /* Find actual nexthop being used for Uplink routing */
-  const neighbor_entry_t *best_parent = find_strict_upstream_parent(srv, BT_MESH_ADDR_UNASSIGNED);
-  uint16_t parent_addr = (best_parent != NULL) ? best_parent->addr : BT_MESH_ADDR_UNASSIGNED;
-  uint16_t nexthop = parent_addr;
+    for (int i = 0; i < got_upd && pos < sizeof(uart_buf); i++) {
+      pos += snprintf(uart_buf + pos, sizeof(uart_buf) - pos,
+                      ",[%04X,%d,%d,%u]", upd[i].addr, upd[i].rssi, upd[i].grad,
+                      upd[i].link_uptime);
+    }
+    for (int i = 0; i < got_rem && pos < sizeof(uart_buf); i++) {
+      pos += snprintf(uart_buf + pos, sizeof(uart_buf) - pos, ",-[%04X]", rem[i]);
+    }
+    printk("%s\n", uart_buf);
+  }
 
-  if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
-    LOG_WRN("[TOPO] No uplink route, aborting drip-feed");
-    tctx->is_reporting = false; /* Unlock */
-    return;
+  LOG_INF("[TOPO] RX delta from 0x%04X v%u->v%u (+%u/-%u, flags 0x%x) via 0x%04x",
+          origin_addr, base_ver, ver, n_upd, n_rem, flags, via);
+  return 0;
+}
+
+/******************************************************************************/
+/* Sink ingest (UART output outside the mesh RX context)                      */
+/******************************************************************************/
+
+/** @brief [SINK] Queue one TOPO_REP / TOPO_DELTA record for printing */
+static int sink_ingest_topo(uint8_t type, const uint8_t *data, uint16_t len,
+                            uint16_t via) {
+  struct sink_ingest_rec *rec = sink_ingest_alloc();
+
+  if (rec == NULL) {
+    return -ENOBUFS;
   }
 
-  /* Điểm mù 2: Safe array indexing for current page */
-  uint8_t start_idx = (tctx->current_page - 1) * TOPO_REP_MAX_PER_PAGE;
-  uint8_t neighbors_in_page =
-      MIN(TOPO_REP_MAX_PER_PAGE, tctx->total_valid - start_idx);
+  rec->type = type;
+  rec->src = sys_get_le16(data);
+  rec->via = via;
+  rec->len = MIN(len, SINK_INGEST_RAW_MAX);
+  memcpy(rec->raw, data, rec->len);
+  sink_ingest_commit(rec);
+  return 0;
+}
 
-  /* Stack-allocated buffer (Code Safety: no malloc/free) */
-  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TOPO_REP,
-                           TOPO_REP_MAX_PAYLOAD);
-  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_TOPO_REP);
+/**
+ * @brief [SINK] Ingest thread: format and print one record (text line or
+ *        binary frame, see sink_frame.h), send PONGs.
+ */
+static void sink_ingest_process(struct sink_ingest_rec *rec, void *user_data) {
+  struct bt_mesh_gradient_srv *srv = user_data;
+  struct net_buf_simple buf;
+  bool binary = sink_frame_binary();
+  NET_BUF_SIMPLE_DEFINE(frame, SINK_FRAME_BODY_MAX);
+  char out[256];
+
+  net_buf_simple_init_with_data(&buf, rec->raw, rec->len);
+
+  switch (rec->type) {
+  case SINK_INGEST_HEARTBEAT:
+    if (binary) {
+      net_buf_simple_add_le16(&frame, rec->src);
+      net_buf_simple_add_le16(&frame, rec->via);
+      net_buf_simple_add_u8(&frame, rec->hop);
+      (void)sink_frame_send(SINK_FRAME_HEARTBEAT, frame.data, frame.len);
+      break;
+    }
+    /* Delay column: filled by Ping-Pong later, always 0 here */
+    printk("CSV_LOG,SENSOR_DATA,0x%04x,0x%04x,%d,%d\n", rec->src, rec->via,
+           rec->hop, 0);
+    break;
+
+  case SINK_INGEST_DATA: {
+    if (binary) {
+      net_buf_simple_add_le16(&frame, rec->src);
+      net_buf_simple_add_le16(&frame, rec->via);
+      net_buf_simple_add_le16(&frame, rec->data);
+      net_buf_simple_add_u8(&frame, rec->hop);
+      net_buf_simple_add_u8(&frame, (uint8_t)rec->rssi);
+      (void)sink_frame_send(SINK_FRAME_DATA, frame.data, frame.len);
+    } else {
+      printk("CSV_LOG,DATA,0x%04x,0x%04x,%d,%d,0,%d\n", rec->src, rec->via,
+             rec->data, rec->hop, rec->rssi);
+    }
 
-  /* === Pack 8-byte Header === */
-  net_buf_simple_add_le16(&msg, my_addr);     /* Origin_Addr (2B) */
-  net_buf_simple_add_u8(&msg, srv->gradient); /* My_Grad (1B) */
-  net_buf_simple_add_le16(&msg, parent_addr); /* My_Parent (2B) */
-  /* Seq_ID (4 bits cao) | Total_Pages (4 bits thấp) */
-  net_buf_simple_add_u8(&msg,
-                        (tctx->req_seq_id << 4) | (tctx->total_pages & 0x0F));
-  net_buf_simple_add_u8(&msg, tctx->current_page); /* Current_Page (1B) */
-  net_buf_simple_add_u8(&msg, neighbors_in_page);  /* Neighbors_in_Page (1B) */
+    /* [NEW] Send PONG back to original source */
+    int err = bt_mesh_gradient_srv_send_pong(srv, rec->src, rec->data);
 
-  /* [UPD] Drop Count (2B) and Fwd Rate (2B): Use values captured at snapshot time */
-  net_buf_simple_add_le16(&msg, tctx->drop_count_snapshot);
-  net_buf_simple_add_le16(&msg, tctx->fwd_rate_snapshot);
+    if (binary) {
+      net_buf_simple_reset(&frame);
+      net_buf_simple_add_le16(&frame, rec->src);
+      net_buf_simple_add_le16(&frame, rec->data);
+      net_buf_simple_add_u8(&frame, (uint8_t)CLAMP(err, INT8_MIN, 0));
+      (void)sink_frame_send(SINK_FRAME_PONG, frame.data, frame.len);
+    }
 
-  /* (MAC stats reset only after the full report cycle to ensure continuity) */
-  if (tctx->current_page >= tctx->total_pages) {
-    struct bt_mesh_statistic stats;
-    bt_mesh_stat_get(&stats);
-    uint32_t current_window_succeeded = stats.tx_local_succeeded + stats.tx_adv_relay_succeeded;
-    /* Accumulator = snapshot value + delta sent DURING drip-feed phase.
-     * fwd_rate_snapshot was the mac_succeeded at snapshot time.  
-     * current_window_succeeded includes those PLUS packets sent during drip-feed.
-     * Delta = current_window_succeeded - fwd_rate_snapshot (drip-feed packets only). */
-    uint32_t drip_delta = (current_window_succeeded > tctx->fwd_rate_snapshot) 
-                        ? (current_window_succeeded - tctx->fwd_rate_snapshot) : 0;
-    s_mac_total_sent_accum = tctx->total_sent_snapshot + drip_delta;
-    bt_mesh_stat_reset();
-    LOG_DBG("[TOPO] Report done. Accum=%u (snap=%u + drip=%u)", 
-            s_mac_total_sent_accum, tctx->total_sent_snapshot, drip_delta);
+    if (srv->handlers->data_received) {
+      srv->handlers->data_received(srv, rec->data);
+    }
+    break;
   }
 
-  /* [NEW] Add Node Uptime (4B) in seconds */
-  uint32_t node_uptime_s = (uint32_t)(k_uptime_get() / 1000);
-  net_buf_simple_add_le32(&msg, node_uptime_s);
+  case SINK_INGEST_SENSOR: {
+    if (binary) {
+      uint8_t n = MIN(rec->data, buf.len / 3);
+
+      net_buf_simple_add_le16(&frame, rec->src);
+      net_buf_simple_add_u8(&frame, n);
+      net_buf_simple_add_mem(&frame, buf.data, n * 3);
+      (void)sink_frame_send(SINK_FRAME_SENSOR, frame.data, frame.len);
+      break;
+    }
 
-  /* [NEW] Add MAC-layer Total Packets Sent (4B) for precise battery estimation */
-  net_buf_simple_add_le32(&msg, tctx->total_sent_snapshot);
+    int pos = snprintf(out, sizeof(out), "$[SENSOR],0x%04X,%d", rec->src,
+                       rec->data);
 
-  /* === Pack neighbor data (max 24B) === */
-  for (uint8_t i = 0; i < neighbors_in_page; i++) {
-    uint8_t idx = start_idx + i;
-    net_buf_simple_add_le16(&msg, tctx->snapshot[idx].addr);
-    net_buf_simple_add_u8(&msg, (uint8_t)tctx->snapshot[idx].rssi);
-    net_buf_simple_add_u8(&msg, tctx->snapshot[idx].grad);
-    net_buf_simple_add_le16(&msg, tctx->snapshot[idx].link_uptime);
+    for (int i = 0; i < rec->data; i++) {
+      if (buf.len < 3) break;
+      uint8_t id = net_buf_simple_pull_u8(&buf);
+      int16_t val = net_buf_simple_pull_le16(&buf);
+      if (pos < (int)sizeof(out)) {
+        pos += snprintf(out + pos, sizeof(out) - pos, ",[%d,%d]", id, val);
+      }
+    }
+    printk("%s\n", out);
+    break;
   }
 
-  /* Send Uplink via Gradient Routing (hop-by-hop) */
-  struct bt_mesh_msg_ctx ctx = {
-      .app_idx = srv->model->keys[0],
-      .addr = nexthop,
-      .send_ttl = BT_MESH_TTL_DEFAULT,
-      .send_rel = true, /* Segmented + BlockAck */
-  };
+  case SINK_INGEST_TOPO_REP:
+    if (buf.len >= TOPO_REP_HDR_LEN) {
+      (void)topo_rep_sink_print(&buf, rec->via);
+    }
+    break;
 
-  int err = srv_send_msg_with_stat(srv, &ctx, &msg);
-  if (err) {
-    LOG_ERR("[TOPO] Failed to send page %d/%d, err=%d", tctx->current_page,
-            tctx->total_pages, err);
-  } else {
-    LOG_INF("[TOPO] Sent page %d/%d (%d neighbors) to 0x%04x",
-            tctx->current_page, tctx->total_pages, neighbors_in_page, nexthop);
-  }
+  case SINK_INGEST_TOPO_DELTA:
+    if (buf.len >= TOPO_DELTA_HDR_LEN) {
+      (void)topo_delta_sink_print(&buf, rec->via);
+    }
+    break;
 
-  /* === Drip-feed state machine === */
-  if (tctx->current_page < tctx->total_pages) {
-    tctx->current_page++;
-    /* Adaptive Jitter: 300ms + 0-100ms random */
-    uint32_t delay = 300 + (sys_rand32_get() % 100);
-    k_work_reschedule(&tctx->reply_work, K_MSEC(delay));
-  } else {
-    /* All pages sent! Unlock for next cycle */
-    tctx->is_reporting = false;
-    LOG_INF("[TOPO] Drip-feed complete (seq=%d)", tctx->req_seq_id);
+  default:
+    break;
   }
 }
 
+BUILD_ASSERT(TOPO_DELTA_MAX_PAYLOAD <= SINK_INGEST_RAW_MAX,
+             "sink ingest record too small for a TOPO_DELTA");
+BUILD_ASSERT(TOPO_REP_MAX_PAYLOAD <= SINK_INGEST_RAW_MAX,
+             "sink ingest record too small for a TOPO_REP page");
+BUILD_ASSERT(2 + 1 + SINK_INGEST_RAW_MAX <= SINK_FRAME_BODY_MAX,
+             "binary SENSOR record does not fit a frame");
+BUILD_ASSERT(23 + TOPO_REP_MAX_NEIGHBORS * (SINK_FRAME_NB_LEN + 2) <=
+                 SINK_FRAME_BODY_MAX,
+             "binary TOPO_DELTA record does not fit a frame");
+
 /**
  * @brief [SINK + RELAY] Handle OP_TOPO_REP (Multi-Page aware).
- *   - Sink (gradient==0): Parse 8-byte header, print UART frame with seq_id.
- *   - Relay (gradient>0): Forward payload intact to own best parent.
+ *   - Sink (gradient==0): Decode dense page, print UART frame with seq_id.
+ *   - Relay (gradient>0): Queue payload intact into the upstream bundle.
  */
 static int handle_topo_rep(const struct bt_mesh_model *model,
                            struct bt_mesh_msg_ctx *ctx,
                            struct net_buf_simple *buf) {
   struct bt_mesh_gradient_srv *srv = model->rt->user_data;
 
-  /* --- Parse 20-byte header --- */
-  if (buf->len < 20) {
+  /* --- Check 6-byte header --- */
+  if (buf->len < TOPO_REP_HDR_LEN) {
     return -EINVAL;
   }
-  uint16_t origin_addr = net_buf_simple_pull_le16(buf);
-  uint8_t grad = net_buf_simple_pull_u8(buf);
-  uint16_t parent = net_buf_simple_pull_le16(buf);
-  uint8_t total_and_seq = net_buf_simple_pull_u8(buf);
-  uint8_t current_page = net_buf_simple_pull_u8(buf);
-  uint8_t count = net_buf_simple_pull_u8(buf);
-  uint16_t drop_count = net_buf_simple_pull_le16(buf);
-  uint16_t fwd_rate = net_buf_simple_pull_le16(buf);
-  uint32_t node_uptime = net_buf_simple_pull_le32(buf);
-  uint32_t total_sent = net_buf_simple_pull_le32(buf);
-
-  /* Unpack seq_id and total_pages from combined byte */
-  uint8_t seq_id = (total_and_seq >> 4) & 0x0F;
-  uint8_t total_pages = total_and_seq & 0x0F;
-
-  if (count > TOPO_REP_MAX_PER_PAGE) {
-    count = TOPO_REP_MAX_PER_PAGE; /* Safety clamp */
-  }
+  uint16_t origin_addr = sys_get_le16(buf->data);
 
   /* [ROBUST RRT] Update RRT for Topology Reports for ALL nodes (Sink & Relays)
    * This ensures intermediate nodes learn the path back to the origin.
@@ -1246,90 +2707,92 @@ static int handle_topo_rep(const struct bt_mesh_model *model,
   rrt_update_from_uplink_msg(srv, ctx->addr, origin_addr, ctx->recv_rssi,
                              k_uptime_get());
 
-  if (srv->gradient == 0) {
-    /* ═══════════════════════════════════════════════════════
-     * I AM SINK: Parse and print to UART with SOF/EOF
-     * Format:
-     * $[TOPO],<Origin>,<Seq>,<TotalPg>,<CurPg>,<Count>,<My_Grad>,<My_Parent>,<Drops>,<FwdRate>,<Uptime>s,<TotalSent>,[neighbors]
-     * ═══════════════════════════════════════════════════════ */
-    char uart_buf[300];
-    int pos = snprintf(uart_buf, sizeof(uart_buf),
-                       "$[TOPO],%04X,%d,%d,%d,%d,%d,%04X,%u,%u,%u,%u", origin_addr,
-                       seq_id, total_pages, current_page, count, grad, parent,
-                       drop_count, fwd_rate, node_uptime, total_sent);
+  if (srv->gradient != 0) {
+    /* Payload is opaque to relays: bundle as-is */
+    topo_bundle_add(srv, TOPO_BUNDLE_REC_REP, buf->data,
+                    MIN(buf->len, TOPO_REP_MAX_PAYLOAD));
+    return 0;
+  }
 
-    for (int i = 0; i < count; i++) {
-      /* Bounds checking before each pull */
-      if (buf->len < 6) {
-        break;
-      }
-      uint16_t n_addr = net_buf_simple_pull_le16(buf);
-      int8_t n_rssi = (int8_t)net_buf_simple_pull_u8(buf);
-      uint8_t n_grad = net_buf_simple_pull_u8(buf);
-      uint16_t n_uptime = net_buf_simple_pull_le16(buf);
-
-      if (pos < sizeof(uart_buf)) {
-        pos += snprintf(uart_buf + pos, sizeof(uart_buf) - pos,
-                        ",[%04X,%d,%d,%u]", n_addr, n_rssi, n_grad, n_uptime);
-      }
-    }
-    printk("%s\n",
-           uart_buf); /* Atomic print to avoid shell prompt interleaving */
+  return sink_ingest_topo(SINK_INGEST_TOPO_REP, buf->data, buf->len, ctx->addr);
+}
 
-    LOG_INF("[TOPO] RX page %d/%d from 0x%04X (seq=%d, grad=%d, Drp=%u, FwdR=%u, "
-            "UP:%u, TX:%u, parent=0x%04X via 0x%04x)",
-            current_page, total_pages, origin_addr, seq_id, grad, drop_count, fwd_rate,
-            node_uptime, total_sent, parent, ctx->addr);
-  } else {
-    /* ═══════════════════════════════════════════════════════
-     * I AM RELAY: Forward entire payload to my best parent
-     * ═══════════════════════════════════════════════════════ */
-    k_mutex_lock(&srv->forwarding_table_mutex, K_FOREVER);
-    uint16_t nexthop = srv->forwarding_table[0].addr;
-    k_mutex_unlock(&srv->forwarding_table_mutex);
+/**
+ * @brief [NEW][SINK + RELAY] Handle OP_TOPO_DELTA.
+ *   - Sink: print one $[TOPOD] line (the Gateway applies it as a patch).
+ *   - Relay: queue the payload verbatim into the upstream bundle.
+ */
+static int handle_topo_delta(const struct bt_mesh_model *model,
+                             struct bt_mesh_msg_ctx *ctx,
+                             struct net_buf_simple *buf) {
+  struct bt_mesh_gradient_srv *srv = model->rt->user_data;
 
-    if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
-      LOG_ERR("[TOPO] Relay: No parent to forward from 0x%04X", origin_addr);
-      return 0;
+  if (buf->len < TOPO_DELTA_HDR_LEN) {
+    return -EINVAL;
+  }
+
+  uint16_t origin_addr = sys_get_le16(buf->data);
+
+  rrt_update_from_uplink_msg(srv, ctx->addr, origin_addr, ctx->recv_rssi,
+                             k_uptime_get());
+
+  if (srv->gradient != 0) {
+    topo_bundle_add(srv, TOPO_BUNDLE_REC_DELTA, buf->data,
+                    MIN(buf->len, TOPO_DELTA_MAX_PAYLOAD));
+    return 0;
+  }
+
+  return sink_ingest_topo(SINK_INGEST_TOPO_DELTA, buf->data, buf->len, ctx->addr);
+}
+
+/**
+ * @brief [NEW][SINK + RELAY] Handle OP_TOPO_BUNDLE.
+ *   - Sink: unpack every record into the usual $[TOPO] / $[TOPOD] lines.
+ *   - Relay: merge the records into its own bundle (bundles are flattened,
+ *     never nested).
+ */
+static int handle_topo_bundle(const struct bt_mesh_model *model,
+                              struct bt_mesh_msg_ctx *ctx,
+                              struct net_buf_simple *buf) {
+  struct bt_mesh_gradient_srv *srv = model->rt->user_data;
+  uint8_t count = net_buf_simple_pull_u8(buf);
+  int64_t now = k_uptime_get();
+
+  for (uint8_t i = 0; i < count; i++) {
+    if (buf->len < 2) {
+      return -EINVAL;
     }
+    uint8_t type = net_buf_simple_pull_u8(buf);
+    uint8_t rec_len = net_buf_simple_pull_u8(buf);
 
-    /* Re-pack the full payload for forwarding (header + data) */
-    BT_MESH_MODEL_BUF_DEFINE(fwd, BT_MESH_GRADIENT_SRV_OP_TOPO_REP,
-                             TOPO_REP_MAX_PAYLOAD);
-    bt_mesh_model_msg_init(&fwd, BT_MESH_GRADIENT_SRV_OP_TOPO_REP);
-
-    net_buf_simple_add_le16(&fwd, origin_addr);
-    net_buf_simple_add_u8(&fwd, grad);
-    net_buf_simple_add_le16(&fwd, parent);
-    net_buf_simple_add_u8(&fwd, total_and_seq); /* Preserve seq+pages */
-    net_buf_simple_add_u8(&fwd, current_page);
-    net_buf_simple_add_u8(&fwd, count);
-    net_buf_simple_add_le16(&fwd, drop_count);
-    net_buf_simple_add_le16(&fwd, fwd_rate);
-    net_buf_simple_add_le32(&fwd, node_uptime);
-    net_buf_simple_add_le32(&fwd, total_sent);
-
-    for (int i = 0; i < count; i++) {
-      if (buf->len < 6) {
-        break;
-      }
-      uint8_t *chunk = net_buf_simple_pull_mem(buf, 6);
-      net_buf_simple_add_mem(&fwd, chunk, 6);
+    if (buf->len < rec_len) {
+      return -EINVAL;
     }
 
-    struct bt_mesh_msg_ctx fwd_ctx = {
-        .app_idx = model->keys[0],
-        .addr = nexthop,
-        .send_ttl = BT_MESH_TTL_DEFAULT,
-        .send_rel = true,
-    };
+    struct net_buf_simple rec;
+    net_buf_simple_init_with_data(&rec, net_buf_simple_pull_mem(buf, rec_len),
+                                  rec_len);
 
-    int err = srv_send_msg_with_stat(srv, &fwd_ctx, &fwd);
-    if (err) {
-      LOG_ERR("[TOPO] Relay forward failed, err=%d", err);
+    uint8_t min_len = (type == TOPO_BUNDLE_REC_DELTA) ? TOPO_DELTA_HDR_LEN
+                                                      : TOPO_REP_HDR_LEN;
+    if ((type != TOPO_BUNDLE_REC_REP && type != TOPO_BUNDLE_REC_DELTA) ||
+        rec_len < min_len) {
+      LOG_WRN("[TOPO] Bundle from 0x%04x: skipping record type %u len %u",
+              ctx->addr, type, rec_len);
+      continue;
+    }
+
+    /* Every origin in the bundle is reachable through the sender */
+    rrt_update_from_uplink_msg(srv, ctx->addr, sys_get_le16(rec.data),
+                               ctx->recv_rssi, now);
+
+    if (srv->gradient != 0) {
+      topo_bundle_add(srv, type, rec.data, rec_len);
     } else {
-      LOG_INF("[TOPO] Relayed page %d/%d from 0x%04X to 0x%04X", current_page,
-              total_pages, origin_addr, nexthop);
+      (void)sink_ingest_topo(type == TOPO_BUNDLE_REC_DELTA
+                                 ? SINK_INGEST_TOPO_DELTA
+                                 : SINK_INGEST_TOPO_REP,
+                             rec.data, rec_len, ctx->addr);
     }
   }
 
@@ -1350,7 +2813,7 @@ static void topo_poll_handler(struct k_work *work) {
     return;
   }
 
-  bt_mesh_gradient_srv_send_topo_req(srv, false);
+  bt_mesh_gradient_srv_send_topo_req(srv, false, NULL, 0);
 
   /* Reschedule */
   k_work_reschedule(&srv->topo_poll_work,
@@ -1358,25 +2821,52 @@ static void topo_poll_handler(struct k_work *work) {
 }
 
 /**
- * @brief [PUBLIC] Broadcast OP_TOPO_REQ with Sequence ID and optional Commit Flag.
+ * @brief [PUBLIC] Broadcast OP_TOPO_REQ with Sequence ID, optional Commit Flag
+ *        and the list of nodes that must resync with a full snapshot.
  */
-int bt_mesh_gradient_srv_send_topo_req(struct bt_mesh_gradient_srv *srv, bool commit_flag) {
+int bt_mesh_gradient_srv_send_topo_req(struct bt_mesh_gradient_srv *srv,
+                                       bool commit_flag,
+                                       const uint16_t *resync_addrs,
+                                       uint8_t resync_count) {
   s_topo_seq_counter = (s_topo_seq_counter + 1) & 0x0F; /* Wrap 0-15 */
-  
-  uint8_t payload = (commit_flag ? 0x80 : 0x00) | s_topo_seq_counter;
 
-  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TOPO_REQ, 1);
+  uint8_t payload = (commit_flag ? TOPO_REQ_FLAG_COMMIT : 0x00) | s_topo_seq_counter;
+
+  if (resync_count == TOPO_REQ_RESYNC_ALL) {
+    payload |= TOPO_REQ_FLAG_FULL;
+    resync_count = 0;
+  } else if (resync_count > TOPO_REQ_MAX_RESYNC) {
+    /* Too many to list: cheaper to resync everybody */
+    payload |= TOPO_REQ_FLAG_FULL;
+    resync_count = 0;
+  }
+
+  bool has_wave = collect_wave_enabled(&srv->wave_cfg);
+  if (has_wave) {
+    payload |= TOPO_REQ_FLAG_WAVE;
+  }
+
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TOPO_REQ,
+                           1 + COLLECT_WAVE_LEN + TOPO_REQ_MAX_RESYNC * 2);
   bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_TOPO_REQ);
   net_buf_simple_add_u8(&msg, payload);
+  if (has_wave) {
+    collect_wave_add(&msg, &srv->wave_cfg);
+  }
+  for (uint8_t i = 0; i < resync_count; i++) {
+    net_buf_simple_add_le16(&msg, resync_addrs[i]);
+  }
 
   struct bt_mesh_msg_ctx ctx = {
       .app_idx = srv->model->keys[0],
       .addr = BT_MESH_ADDR_ALL_NODES,
-      .send_ttl = BT_MESH_TTL_DEFAULT,
+      .send_ttl = BT_MESH_GRADIENT_SRV_BCAST_TTL(BT_MESH_TTL_DEFAULT),
       .send_rel = false,
   };
 
-  LOG_INF("[TOPO] Broadcasting TOPO_REQ (seq=%d)", s_topo_seq_counter);
+  LOG_INF("[TOPO] Broadcasting TOPO_REQ (seq=%d, full=%d, resync=%d, wave=%u ms)",
+          s_topo_seq_counter, (payload & TOPO_REQ_FLAG_FULL) != 0, resync_count,
+          bt_mesh_gradient_srv_wave_round_ms(&srv->wave_cfg));
   return srv_send_msg_with_stat(srv, &ctx, &msg);
 }
 
@@ -1384,6 +2874,8 @@ int bt_mesh_gradient_srv_send_topo_req(struct bt_mesh_gradient_srv *srv, bool co
  * @brief [PUBLIC] Trigger an immediate Delta Topology Report.
  *        Called when best_parent changes or an important neighbor drops.
  *        Uses seq_id = 15 (0x0F) to distinguish from polled reports.
+ *        Sends only the changes since the last delivered report (a full
+ *        report only if there is no delivered base yet).
  */
 void bt_mesh_gradient_srv_trigger_delta_topo(struct bt_mesh_gradient_srv *srv) {
   if (srv->gradient == 0) {
@@ -1391,7 +2883,7 @@ void bt_mesh_gradient_srv_trigger_delta_topo(struct bt_mesh_gradient_srv *srv) {
   }
 
   /* Respect the is_reporting lock */
-  if (!topo_take_snapshot(srv, 0x0F)) { /* Delta uses seq_id = 15 */
+  if (!topo_take_snapshot(srv, 0x0F, false)) { /* Delta uses seq_id = 15 */
     return;
   }
 
@@ -1417,6 +2909,18 @@ void topo_routing_init(struct bt_mesh_gradient_srv *srv) {
   srv->topo_ctx.req_seq_id = 0;
   srv->topo_ctx.last_reported_parent = BT_MESH_ADDR_UNASSIGNED;
 
+  /* No delivered base after boot: the first report is always full */
+  srv->topo_ctx.acked_valid = false;
+  srv->topo_ctx.acked_count = 0;
+  srv->topo_ctx.deltas_since_full = 0;
+  srv->topo_ctx.ver = 0;
+  atomic_set(&srv->topo_ctx.tx_outstanding, 0);
+
+  /* Init relay-side bundling */
+  k_mutex_init(&srv->topo_bundle.lock);
+  k_work_init_delayable(&srv->topo_bundle.flush_work, topo_bundle_flush_handler);
+  srv->topo_bundle.len = 0;
+
   /* Init sink-side polling work */
   k_work_init_delayable(&srv->topo_poll_work, topo_poll_handler);
   s_topo_seq_counter = 0;
@@ -1433,13 +2937,14 @@ void topo_routing_init(struct bt_mesh_gradient_srv *srv) {
 /**
  * @brief [NEW] Handle OP_SENSOR_INTERVAL — Gateway sets per-node sensor data interval.
  *
- * Message format (5 bytes):
+ * Message format (6 bytes):
  *   dest_addr   (2B LE) — final destination; 0xFFFF = broadcast to all non-sink
  *   interval_sec (2B LE) — new interval in seconds
  *   ttl          (1B)   — remaining hops
+ *   seq          (1B)   — Sink send counter (broadcast dedup key)
  *
  * Routing logic mirrors BACKPROP_DATA:
- *   - dest == 0xFFFF  → apply to self (if gradient != 0), done
+ *   - dest == 0xFFFF  → apply to self (if gradient != 0), elected relays re-broadcast
  *   - dest == my_addr → apply to self, done
  *   - dest != my_addr → find nexthop via RRT, forward with TTL-1
  */
@@ -1454,6 +2959,7 @@ static int handle_sensor_interval(const struct bt_mesh_model *model,
   uint16_t dest_addr   = net_buf_simple_pull_le16(buf);
   uint16_t interval_sec = net_buf_simple_pull_le16(buf);
   uint8_t  ttl          = net_buf_simple_pull_u8(buf);
+  uint8_t  seq          = net_buf_simple_pull_u8(buf);
 
   LOG_INF("[SENSOR_INTERVAL] RX: dest=0x%04x, interval=%us, ttl=%u, from=0x%04x",
           dest_addr, interval_sec, ttl, ctx->addr);
@@ -1465,12 +2971,34 @@ static int handle_sensor_interval(const struct bt_mesh_model *model,
 
   /* --- Broadcast mode: dest_addr == 0xFFFF --- */
   if (dest_addr == BT_MESH_ADDR_ALL_NODES) {
-    if (srv->gradient != 0) {
-      /* Non-sink node: apply interval */
+    if (srv->gradient == 0) {
+      return 0;
+    }
+    if (!IS_ENABLED(CONFIG_BT_MESH_GRADIENT_BCAST_CONTROLLED)) {
+      /* Non-sink node: apply interval. Flooding by BLE Mesh network layer */
       LOG_INF("[SENSOR_INTERVAL] Broadcast: applying interval=%us", interval_sec);
       heartbeat_set_interval(interval_sec);
+      return 0;
+    }
+
+    /* [NEW] Controlled flooding: dedup on seq + value (a re-send of the
+     * same interval gets a new seq); the TTL byte bounds the hops */
+    if (bcast_seen(BCAST_KEY(BCAST_KEY_SENSOR_INTV,
+                             ((uint32_t)seq << 16) | interval_sec))) {
+      return 0;
+    }
+    LOG_INF("[SENSOR_INTERVAL] Broadcast: applying interval=%us", interval_sec);
+    heartbeat_set_interval(interval_sec);
+
+    if (ttl > 1) {
+      BT_MESH_MODEL_BUF_DEFINE(fwd, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, 6);
+      bt_mesh_model_msg_init(&fwd, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL);
+      net_buf_simple_add_le16(&fwd, BT_MESH_ADDR_ALL_NODES);
+      net_buf_simple_add_le16(&fwd, interval_sec);
+      net_buf_simple_add_u8(&fwd, ttl - 1);
+      net_buf_simple_add_u8(&fwd, seq);
+      bcast_relay(srv, ctx, &fwd);
     }
-    /* Broadcast flooding is handled by BLE Mesh network layer (TTL) — no manual relay */
     return 0;
   }
 
@@ -1487,10 +3015,7 @@ static int handle_sensor_interval(const struct bt_mesh_model *model,
     return 0;
   }
 
-  uint16_t nexthop = rrt_find_nexthop(
-      srv->forwarding_table,
-      CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-      dest_addr);
+  uint16_t nexthop = srv_rrt_nexthop(srv, dest_addr);
 
   if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
     LOG_WRN("[SENSOR_INTERVAL] No RRT route to dest=0x%04x", dest_addr);
@@ -1498,11 +3023,12 @@ static int handle_sensor_interval(const struct bt_mesh_model *model,
   }
 
   /* Re-pack and forward with TTL-1 */
-  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, 5);
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, 6);
   bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL);
   net_buf_simple_add_le16(&msg, dest_addr);
   net_buf_simple_add_le16(&msg, interval_sec);
   net_buf_simple_add_u8(&msg, ttl - 1);
+  net_buf_simple_add_u8(&msg, seq);
 
   struct bt_mesh_msg_ctx tx_ctx = {
       .app_idx  = model->keys[0],
@@ -1529,18 +3055,31 @@ const struct bt_mesh_model_op _bt_mesh_gradient_srv_op[] = {
     {BT_MESH_GRADIENT_SRV_OP_DATA_MESSAGE,
      BT_MESH_LEN_MIN(BT_MESH_GRADIENT_SRV_MSG_MINLEN_MESSAGE),
      handle_data_message},
-    {BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA, BT_MESH_LEN_EXACT(11),
+    {BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA,
+     BT_MESH_LEN_EXACT(BT_MESH_GRADIENT_SRV_BACKPROP_LEN),
      handle_backprop_message},
+    {BT_MESH_GRADIENT_SRV_OP_BACKPROP_SR,
+     BT_MESH_LEN_MIN(BT_MESH_GRADIENT_SRV_BACKPROP_SR_HDR_LEN), /* + hop list */
+     handle_backprop_sr},
+    {BT_MESH_GRADIENT_SRV_OP_BACKPROP_MULTI,
+     BT_MESH_LEN_MIN(BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_HDR_LEN), /* + records */
+     handle_backprop_multi},
+    {BT_MESH_GRADIENT_SRV_OP_SDN_FLOW,
+     BT_MESH_LEN_MIN(BT_MESH_GRADIENT_SRV_SDN_FLOW_HDR_LEN), /* + rules */
+     handle_sdn_flow},
     /* [UPDATED] Report Req expects 1 byte ID now */
     {BT_MESH_GRADIENT_SRV_OP_REPORT_REQ, BT_MESH_LEN_MIN(1), handle_report_req},
     {BT_MESH_GRADIENT_SRV_OP_REPORT_RSP,
-     BT_MESH_LEN_MIN(15), /* reporter(2) + 6*stats(12) + rtt_count(1) */
+     BT_MESH_LEN_MIN(6), /* reporter(2) + snapshot header(4) */
      handle_report_rsp},
     {BT_MESH_GRADIENT_SRV_OP_REPORT_REQ_UNICAST,
      BT_MESH_LEN_EXACT(0), /* No payload */
      handle_report_req_unicast},
     {BT_MESH_GRADIENT_SRV_OP_REPORT_ACK, BT_MESH_LEN_EXACT(2),
      handle_report_ack},
+    {BT_MESH_GRADIENT_SRV_OP_REPORT_ACK_BITMAP,
+     BT_MESH_LEN_MIN(REPORT_ACK_BITMAP_HDR_LEN + 1), /* ReqID + Seq + Base + >=1B */
+     handle_report_ack_bitmap},
     {BT_MESH_GRADIENT_SRV_OP_DOWNLINK_REPORT, BT_MESH_LEN_EXACT(2),
      handle_downlink_report},
     {BT_MESH_GRADIENT_SRV_OP_TEST_START,
@@ -1549,12 +3088,18 @@ const struct bt_mesh_model_op _bt_mesh_gradient_srv_op[] = {
     /* [NEW] Topology Reporting Opcodes (Multi-Page v5) */
     {BT_MESH_GRADIENT_SRV_OP_TOPO_REQ, BT_MESH_LEN_MIN(1), handle_topo_req},
     {BT_MESH_GRADIENT_SRV_OP_TOPO_REP,
-     BT_MESH_LEN_MIN(20), /* 20B header (no neighbors) */
+     BT_MESH_LEN_MIN(TOPO_REP_HDR_LEN), /* 6B header (page 2+, no neighbors) */
      handle_topo_rep},
+    {BT_MESH_GRADIENT_SRV_OP_TOPO_DELTA,
+     BT_MESH_LEN_MIN(TOPO_DELTA_HDR_LEN), /* 8B header (no changes) */
+     handle_topo_delta},
+    {BT_MESH_GRADIENT_SRV_OP_TOPO_BUNDLE,
+     BT_MESH_LEN_MIN(1), /* Count, records follow */
+     handle_topo_bundle},
     {BT_MESH_GRADIENT_SRV_OP_BACKPROP_BROADCAST, BT_MESH_LEN_MIN(5), /* 1B ID + at least 1 pair(4B) */
      handle_backprop_broadcast},
     /* [NEW] Sensor Interval: Gateway sets per-node sensor data TX interval */
-    {BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, BT_MESH_LEN_EXACT(5), handle_sensor_interval},
+    {BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, BT_MESH_LEN_EXACT(6), handle_sensor_interval},
     /* [NEW] Sensor Data Telemetry */
     {BT_MESH_GRADIENT_SRV_OP_SENSOR_DATA, BT_MESH_LEN_MIN(4), handle_sensor_data_message},
     BT_MESH_MODEL_OP_END,
@@ -1581,22 +3126,14 @@ static int handle_pong_message(const struct bt_mesh_model *model,
   uint16_t my_addr = bt_mesh_model_elem(model)->rt->addr;
 
   if (target_addr == my_addr) {
-    LOG_INF("Received PONG for seq %u from 0x%04x (Origin: 0x%04x)", seq,
+    GTRACE(GT_PONG_RX, 0, target_addr, seq, ctx->addr);
+    LOG_DBG("Received PONG for seq %u from 0x%04x (Origin: 0x%04x)", seq,
             ctx->addr, target_addr);
-    /* Record RTT and check if buffer is full */
-    if (pkt_stats_record_pong(seq)) {
-      LOG_INF("RTT Buffer FULL (50 samples). Triggering Report.");
-      if (!srv->is_report_pending) {
-        srv->report_retry_count = 0;
-        k_work_reschedule(&srv->report_retry_work, K_NO_WAIT);
-        srv->is_report_pending = true;
-      }
-    }
+    /* RTT goes into the histogram; percentiles ride on the next REPORT */
+    (void)pkt_stats_record_pong(seq);
   } else {
     /* [FORWARDING] Chuyển tiếp PONG về node nguồn thông qua RRT */
-    uint16_t nexthop = rrt_find_nexthop(
-        srv->forwarding_table,
-        CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE, target_addr);
+    uint16_t nexthop = srv_rrt_nexthop(srv, target_addr);
     if (nexthop != BT_MESH_ADDR_UNASSIGNED) {
       LOG_INF("Relaying PONG for 0x%04x to Nexthop 0x%04x", target_addr,
               nexthop);
@@ -1623,9 +3160,7 @@ static int handle_pong_message(const struct bt_mesh_model *model,
 int bt_mesh_gradient_srv_send_pong(struct bt_mesh_gradient_srv *srv,
                                    uint16_t dest_addr, uint16_t seq) {
   /* Find nexthop back to the source using RRT */
-  uint16_t nexthop = rrt_find_nexthop(
-      srv->forwarding_table, CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-      dest_addr);
+  uint16_t nexthop = srv_rrt_nexthop(srv, dest_addr);
 
   if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
     LOG_WRN("No route to send PONG to 0x%04x", dest_addr);
@@ -1683,10 +3218,19 @@ static int bt_mesh_gradient_srv_init(const struct bt_mesh_model *model) {
   k_work_init_delayable(&gradient_srv->report_retry_work, report_retry_handler);
   gradient_srv->is_report_pending = false;
   gradient_srv->report_retry_count = 0;
+  gradient_srv->report_wave_valid = false;
+  gradient_srv->report_round_bcast = false;
+  k_mutex_init(&gradient_srv->report_ack.lock);
+  k_work_init_delayable(&gradient_srv->report_ack.flush_work,
+                        report_ack_flush_handler);
+  gradient_srv->report_ack.count = 0;
+  gradient_srv->report_ack.round_open = false;
+  gradient_srv->wave_cfg.slot_units =
+      DIV_ROUND_UP(CONFIG_BT_MESH_COLLECT_SLOT_MS, COLLECT_WAVE_SLOT_UNIT_MS);
+  gradient_srv->wave_cfg.levels = CONFIG_BT_MESH_COLLECT_LEVELS;
+  gradient_srv->wave_cfg.slots_per_level = CONFIG_BT_MESH_COLLECT_SLOTS_PER_LEVEL;
   gradient_srv->soft_drop_count = 0;
-  gradient_srv->sdn_next_hop_active = BT_MESH_ADDR_UNASSIGNED;
-  gradient_srv->sdn_next_hop_pending = BT_MESH_ADDR_UNASSIGNED;
-  gradient_srv->sdn_route_expiry = 0;
+  sdn_flow_init(&gradient_srv->sdn_flows);
 
   net_buf_simple_init_with_data(&gradient_srv->pub_msg, gradient_srv->buf,
                                 sizeof(gradient_srv->buf));
@@ -1694,6 +3238,8 @@ static int bt_mesh_gradient_srv_init(const struct bt_mesh_model *model) {
   gradient_srv->pub.update = bt_mesh_gradient_srv_update_handler;
 
   k_mutex_init(&gradient_srv->forwarding_table_mutex);
+  fwd_view_init(&gradient_srv->fwd_view);
+  sink_ingest_init(sink_ingest_process, gradient_srv);
 
   led_indication_init();
   data_forward_init();
@@ -1761,6 +3307,29 @@ int bt_mesh_gradient_srv_data_send(struct bt_mesh_gradient_srv *gradient_srv,
   return data_forward_send_direct(gradient_srv, addr, data, initial_rssi);
 }
 
+/** [RELATIVE TIMESTAMP] Thời điểm gửi BACKPROP tính từ lúc bắt đầu test */
+static uint32_t backprop_rel_timestamp(void) {
+  return k_uptime_get_32() -
+         (g_test_start_time > 0 ? g_test_start_time : k_uptime_get_32());
+}
+
+/**
+ * @brief Đóng gói cấu trúc 11 bytes: Dest(2) | Payload(2) | TTL(1) | Hops(1)
+ *        | TS(4) | MinRSSI(1) — dùng chung cho BACKPROP_DATA và BACKPROP_SR
+ */
+static void backprop_add_hdr(struct net_buf_simple *msg, uint16_t dest_addr,
+                             uint16_t payload) {
+  net_buf_simple_add_le16(msg, dest_addr);
+  net_buf_simple_add_le16(msg, payload);
+  net_buf_simple_add_u8(msg, BT_MESH_GRADIENT_SRV_BACKPROP_DEFAULT_TTL);
+  net_buf_simple_add_u8(msg, 1); // Initial hop count
+
+  net_buf_simple_add_le32(msg, backprop_rel_timestamp());
+
+  /* [INITIAL RSSI] Sink bắt đầu với 0 (lớn nhất) */
+  net_buf_simple_add_u8(msg, 0);
+}
+
 int bt_mesh_gradient_srv_backprop_send(
     struct bt_mesh_gradient_srv *gradient_srv, uint16_t dest_addr,
     uint16_t payload) {
@@ -1769,63 +3338,135 @@ int bt_mesh_gradient_srv_backprop_send(
   if (dest_addr == my_addr)
     return -EINVAL;
 
-  uint16_t nexthop = rrt_find_nexthop(
-      gradient_srv->forwarding_table,
-      CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE, dest_addr);
+  uint16_t nexthop = srv_rrt_nexthop(gradient_srv, dest_addr);
 
   if (nexthop == BT_MESH_ADDR_UNASSIGNED)
     return -ENETUNREACH;
 
-  /* Đóng gói cấu trúc 11 bytes: Dest(2) | Payload(2) | TTL(1) | Hops(1) | TS(4)
-   * | MinRSSI(1) */
-  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA, 11);
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA,
+                           BT_MESH_GRADIENT_SRV_BACKPROP_LEN);
   bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_BACKPROP_DATA);
+  backprop_add_hdr(&msg, dest_addr, payload);
+
+  struct bt_mesh_msg_ctx ctx = {
+      .app_idx = gradient_srv->model->keys[0],
+      .addr = nexthop,
+      .send_ttl = 0,
+      .send_rel = true, /* [FIX] Reliable delivery for Backprop */
+  };
+
+  return srv_send_msg_with_stat(gradient_srv, &ctx, &msg);
+}
+
+int bt_mesh_gradient_srv_backprop_send_multi(
+    struct bt_mesh_gradient_srv *gradient_srv,
+    const struct bt_mesh_gradient_srv_bp_rec *recs, uint8_t count) {
+  if (recs == NULL || count == 0 ||
+      count > CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX)
+    return -EINVAL;
+
+  /* Sink is the first branch point; MinRSSI starts at 0 like BACKPROP_DATA */
+  int branches = backprop_multi_split(
+      gradient_srv, BT_MESH_GRADIENT_SRV_BACKPROP_DEFAULT_TTL, 1,
+      backprop_rel_timestamp(), 0, recs, count);
+
+  return (branches > 0) ? 0 : -ENETUNREACH;
+}
+
+int bt_mesh_gradient_srv_sdn_flow_send(
+    struct bt_mesh_gradient_srv *gradient_srv, uint16_t dest_addr,
+    uint8_t version, const struct sdn_flow_rule *rules, uint8_t count) {
+  uint16_t my_addr = bt_mesh_model_elem(gradient_srv->model)->rt->addr;
+
+  if (dest_addr == my_addr || rules == NULL || count == 0 ||
+      count > BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES)
+    return -EINVAL;
 
+  uint16_t nexthop = srv_rrt_nexthop(gradient_srv, dest_addr);
+
+  if (nexthop == BT_MESH_ADDR_UNASSIGNED)
+    return -ENETUNREACH;
+
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SDN_FLOW,
+                           BT_MESH_GRADIENT_SRV_SDN_FLOW_HDR_LEN +
+                               BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES *
+                                   SDN_FLOW_RULE_LEN);
+  bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_SDN_FLOW);
   net_buf_simple_add_le16(&msg, dest_addr);
-  net_buf_simple_add_le16(&msg, payload);
   net_buf_simple_add_u8(&msg, BT_MESH_GRADIENT_SRV_BACKPROP_DEFAULT_TTL);
-  net_buf_simple_add_u8(&msg, 1); // Initial hop count
-
-  /* [RELATIVE TIMESTAMP] */
-  uint32_t timestamp =
-      k_uptime_get_32() -
-      (g_test_start_time > 0 ? g_test_start_time : k_uptime_get_32());
-  net_buf_simple_add_le32(&msg, timestamp);
+  net_buf_simple_add_u8(&msg, version);
+  net_buf_simple_add_u8(&msg, count);
+  for (uint8_t i = 0; i < count; i++) {
+    /* Lifetime in minutes on air, 0 = node default */
+    uint32_t life_min = DIV_ROUND_UP((uint32_t)rules[i].expiry, 60U * 1000U);
 
-  /* [INITIAL RSSI] Sink bắt đầu với 0 (lớn nhất) */
-  net_buf_simple_add_u8(&msg, 0);
+    net_buf_simple_add_le16(&msg, rules[i].src);
+    net_buf_simple_add_u8(&msg, rules[i].tclass);
+    net_buf_simple_add_le16(&msg, rules[i].next_hop);
+    net_buf_simple_add_u8(&msg, MIN(life_min, UINT8_MAX));
+  }
 
   struct bt_mesh_msg_ctx ctx = {
       .app_idx = gradient_srv->model->keys[0],
       .addr = nexthop,
       .send_ttl = 0,
-      .send_rel = true, /* [FIX] Reliable delivery for Backprop */
+      .send_rel = true,
   };
 
   return srv_send_msg_with_stat(gradient_srv, &ctx, &msg);
 }
 
+int bt_mesh_gradient_srv_backprop_send_sr(
+    struct bt_mesh_gradient_srv *gradient_srv, uint16_t dest_addr,
+    uint16_t payload, const uint16_t *hops, uint8_t hop_count) {
+  uint16_t my_addr = bt_mesh_model_elem(gradient_srv->model)->rt->addr;
+
+  if (dest_addr == my_addr || hop_count > CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS ||
+      (hop_count > 0 && hops == NULL))
+    return -EINVAL;
+
+  uint16_t first = (hop_count > 0) ? hops[0] : dest_addr;
+
+  /* Gateway's graph is stale for the first hop: plain RRT routing */
+  if (!srv_is_neighbor(gradient_srv, first)) {
+    LOG_WRN("[CONTROL - Backprop SR] First hop 0x%04x gone, using RRT", first);
+    return bt_mesh_gradient_srv_backprop_send(gradient_srv, dest_addr, payload);
+  }
+
+  NET_BUF_SIMPLE_DEFINE(hdr, BT_MESH_GRADIENT_SRV_BACKPROP_LEN);
+  backprop_add_hdr(&hdr, dest_addr, payload);
+
+  return backprop_sr_send(gradient_srv, first, hdr.data,
+                          (hop_count > 0) ? &hops[1] : hops,
+                          (hop_count > 0) ? hop_count - 1 : 0);
+}
+
 /**
  * @brief [UPDATED] Gửi lệnh yêu cầu báo cáo xuống toàn mạng (Controlled
  * Flooding)
  */
 int bt_mesh_gradient_srv_send_report_req(
     struct bt_mesh_gradient_srv *gradient_srv, bool force_new_id) {
-  /* 1. Tăng ID cho lần gửi mới nếu được yêu cầu */
+  /* 1. Tăng ID cho lần gửi mới nếu được yêu cầu (mở vòng ACK bitmap mới) */
   if (force_new_id) {
     current_tx_req_id++;
+    report_ack_round_start(gradient_srv, current_tx_req_id);
   }
 
-  /* 2. Đóng gói ID (1 byte) vào payload */
-  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_REQ, 1);
+  /* 2. Đóng gói ID (1 byte) + lịch trả lời (collection wave) vào payload */
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_REPORT_REQ,
+                           1 + COLLECT_WAVE_LEN);
   bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_REPORT_REQ);
   net_buf_simple_add_u8(&msg, current_tx_req_id);
+  if (collect_wave_enabled(&gradient_srv->wave_cfg)) {
+    collect_wave_add(&msg, &gradient_srv->wave_cfg);
+  }
 
-  /* 3. Gửi Broadcast với TTL mặc định */
+  /* 3. Gửi Broadcast (1 hop nếu controlled flooding, relay được bầu lan tiếp) */
   struct bt_mesh_msg_ctx ctx = {
       .app_idx = gradient_srv->model->keys[0],
       .addr = BT_MESH_ADDR_ALL_NODES,
-      .send_ttl = BT_MESH_TTL_DEFAULT,
+      .send_ttl = BT_MESH_GRADIENT_SRV_BCAST_TTL(BT_MESH_TTL_DEFAULT),
   };
 
   LOG_INF(">>> BROADCASTING REPORT REQUEST (ID: %d) <<<", current_tx_req_id);
@@ -1837,7 +3478,7 @@ int bt_mesh_gradient_srv_send_test_start(struct bt_mesh_gradient_srv *srv, bool
 	struct bt_mesh_msg_ctx ctx = {
 		.app_idx = srv->model->keys[0],
 		.addr = BT_MESH_ADDR_ALL_NODES,
-		.send_ttl = BT_MESH_GRADIENT_SRV_DEFAULT_TTL,
+		.send_ttl = BT_MESH_GRADIENT_SRV_BCAST_TTL(BT_MESH_GRADIENT_SRV_DEFAULT_TTL),
 	};
 
 	BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_TEST_START, 3);
@@ -1866,11 +3507,21 @@ int bt_mesh_gradient_srv_report_rsp_send(
   gradient_srv->is_report_pending = true;
   gradient_srv->report_retry_count = 0;
 
-  /* [FIX CONGESTION] Thêm Delay ngẫu nhiên ban đầu (0-5s) cho cấu hình 40 node
-   * để tránh việc hàng chục node cùng ập vào Sink một lúc gây nghẽn.
-   */
-  uint32_t initial_jitter = sys_rand32_get() % 5000;
-  k_work_schedule(&gradient_srv->report_retry_work, K_MSEC(initial_jitter));
+  /* [NEW] Broadcast REPORT_REQ carried a wave: answer in own slot */
+  uint32_t delay_ms;
+  if (gradient_srv->report_wave_valid) {
+    delay_ms = bt_mesh_gradient_srv_wave_delay_ms(
+        &gradient_srv->report_wave, gradient_srv->gradient,
+        bt_mesh_model_elem(gradient_srv->model)->rt->addr,
+        gradient_srv->report_wave_round);
+  } else {
+    /* [FIX CONGESTION] Delay ngẫu nhiên ban đầu (0.5-4s) để tránh việc hàng
+     * chục node cùng ập vào Sink một lúc gây nghẽn.
+     */
+    delay_ms = 500 + (sys_rand32_get() % 3500);
+  }
+  LOG_INF(">> Report will be sent in %u ms (Reliable Sequence)...", delay_ms);
+  k_work_schedule(&gradient_srv->report_retry_work, K_MSEC(delay_ms));
 
   return 0;
 }
@@ -1878,9 +3529,7 @@ int bt_mesh_gradient_srv_report_rsp_send(
 int bt_mesh_gradient_srv_send_downlink_report(
     struct bt_mesh_gradient_srv *gradient_srv, uint16_t dest_addr,
     uint16_t total_tx) {
-  uint16_t nexthop = rrt_find_nexthop(
-      gradient_srv->forwarding_table,
-      CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE, dest_addr);
+  uint16_t nexthop = srv_rrt_nexthop(gradient_srv, dest_addr);
 
   if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
     LOG_ERR("No route to send Downlink Report to 0x%04x", dest_addr);
@@ -1902,6 +3551,9 @@ int bt_mesh_gradient_srv_send_downlink_report(
   return srv_send_msg_with_stat(gradient_srv, &ctx, &msg);
 }
 
+/* [NEW] Sink-side SENSOR_INTERVAL send counter (broadcast dedup key, wraps) */
+static uint8_t sensor_intv_seq;
+
 /**
  * @brief [NEW] Send OP_SENSOR_INTERVAL to set per-node sensor data interval.
  *
@@ -1909,7 +3561,8 @@ int bt_mesh_gradient_srv_send_downlink_report(
  *   Looks up nexthop in RRT and sends hop-by-hop to destination.
  *
  * Broadcast mode (dest_addr == 0xFFFF):
- *   Sends to BT_MESH_ADDR_ALL_NODES — BLE Mesh network layer handles flooding.
+ *   Sends to BT_MESH_ADDR_ALL_NODES — flooded by elected gradient relays
+ *   (or the BLE Mesh network layer without controlled flooding).
  *   All non-sink nodes will apply the interval upon reception.
  */
 int bt_mesh_gradient_srv_send_sensor_interval(
@@ -1926,16 +3579,17 @@ int bt_mesh_gradient_srv_send_sensor_interval(
 
   /* --- Broadcast mode: send to ALL_NODES --- */
   if (dest_addr == BT_MESH_ADDR_ALL_NODES) {
-    BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, 5);
+    BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, 6);
     bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL);
     net_buf_simple_add_le16(&msg, BT_MESH_ADDR_ALL_NODES);
     net_buf_simple_add_le16(&msg, interval_sec);
     net_buf_simple_add_u8(&msg, BT_MESH_TTL_DEFAULT);
+    net_buf_simple_add_u8(&msg, sensor_intv_seq++);
 
     struct bt_mesh_msg_ctx ctx = {
         .app_idx  = srv->model->keys[0],
         .addr     = BT_MESH_ADDR_ALL_NODES,
-        .send_ttl = BT_MESH_TTL_DEFAULT,
+        .send_ttl = BT_MESH_GRADIENT_SRV_BCAST_TTL(BT_MESH_TTL_DEFAULT),
         .send_rel = false,
     };
 
@@ -1949,21 +3603,19 @@ int bt_mesh_gradient_srv_send_sensor_interval(
     return -EINVAL;
   }
 
-  uint16_t nexthop = rrt_find_nexthop(
-      srv->forwarding_table,
-      CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-      dest_addr);
+  uint16_t nexthop = srv_rrt_nexthop(srv, dest_addr);
 
   if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
     LOG_WRN("[SENSOR_INTERVAL] No RRT route to 0x%04x", dest_addr);
     return -ENETUNREACH;
   }
 
-  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, 5);
+  BT_MESH_MODEL_BUF_DEFINE(msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL, 6);
   bt_mesh_model_msg_init(&msg, BT_MESH_GRADIENT_SRV_OP_SENSOR_INTERVAL);
   net_buf_simple_add_le16(&msg, dest_addr);
   net_buf_simple_add_le16(&msg, interval_sec);
   net_buf_simple_add_u8(&msg, BT_MESH_GRADIENT_SRV_BACKPROP_DEFAULT_TTL);
+  net_buf_simple_add_u8(&msg, sensor_intv_seq++);
 
   struct bt_mesh_msg_ctx ctx = {
       .app_idx  = srv->model->keys[0],
@@ -1984,9 +3636,8 @@ int bt_mesh_gradient_srv_sensor_data_send(struct bt_mesh_gradient_srv *srv,
 
   if (srv->gradient == 0) return -EINVAL; // Sink doesn't send
 
-  k_mutex_lock(&srv->forwarding_table_mutex, K_FOREVER);
-  uint16_t nexthop = srv->forwarding_table[0].addr;
-  k_mutex_unlock(&srv->forwarding_table_mutex);
+  uint16_t nexthop = find_strict_upstream_parent(
+      srv, BT_MESH_ADDR_UNASSIGNED, my_addr, SDN_FLOW_CLASS_SENSOR, NULL);
 
   if (nexthop == BT_MESH_ADDR_UNASSIGNED) {
     LOG_WRN("[SENSOR] TX Failed: No parent route");
@@ -236,6 +236,8 @@ static void cleanup_handler(struct k_work *work)
     }
 #endif
 
+    fwd_view_publish(&g_gradient_srv->fwd_view, g_gradient_srv->forwarding_table,
+                     CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE);
     k_mutex_unlock(&g_gradient_srv->forwarding_table_mutex);
 
     if (should_publish) {
@@ -261,13 +263,19 @@ static void gradient_process_handler(struct k_work *work)
     LOG_INF("Received gradient %d from 0x%04x (RSSI: %d)", msg, sender_addr, rssi);
     
     int64_t current_time = k_uptime_get();
+    neighbor_entry_t evicted;
     
     k_mutex_lock(&gradient_srv->forwarding_table_mutex, K_FOREVER);
     
     nt_update_sorted((neighbor_entry_t *)gradient_srv->forwarding_table,
                       CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE,
-                      sender_addr, msg, rssi, current_time);
+                      sender_addr, msg, rssi, current_time, &evicted);
+    /* [FIX] Beacon của neighbor mới vào bảng đầy đẩy entry cuối ra: giải phóng
+     * route của nó (và bump rrt_gen cho fast path RRT) */
+    rrt_free_evicted(&evicted);
 
+    fwd_view_publish(&gradient_srv->fwd_view, gradient_srv->forwarding_table,
+                     CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE);
     k_mutex_unlock(&gradient_srv->forwarding_table_mutex);
 
     /* Check if gradient should be updated */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file gtrace.c
+ * @brief Binary ring-buffer event tracer implementation
+ */
+
+#include "gtrace.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+/*============================================================================*/
+/* Private Data                                                               */
+/*============================================================================*/
+
+#if defined(CONFIG_BT_MESH_GRADIENT_SRV_TRACE)
+
+#define GTRACE_RING_SIZE CONFIG_BT_MESH_GRADIENT_SRV_TRACE_BUF_SIZE
+
+BUILD_ASSERT(sizeof(struct gtrace_rec) == 12, "trace record must stay 12 bytes");
+BUILD_ASSERT((GTRACE_RING_SIZE & (GTRACE_RING_SIZE - 1)) == 0,
+             "trace ring size must be a power of two");
+
+static struct gtrace_rec ring[GTRACE_RING_SIZE];
+
+/** Free-running indices; ring slot = index & (size - 1) */
+static uint32_t ring_head;
+static uint32_t ring_tail;
+static uint32_t ring_overruns;
+static bool trace_enabled = true;
+
+/** Emit is a 12-byte copy: a spinlock is cheaper than any lock-free retry */
+static struct k_spinlock ring_lock;
+
+/*============================================================================*/
+/* Public Functions                                                           */
+/*============================================================================*/
+
+void gtrace_emit(uint8_t id, uint8_t b, uint16_t a0, uint16_t a1, uint16_t a2)
+{
+    if (!trace_enabled) {
+        return;
+    }
+
+    uint32_t now = k_cycle_get_32();
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+    if (ring_head - ring_tail == GTRACE_RING_SIZE) {
+        ring_tail++;
+        ring_overruns++;
+    }
+
+    struct gtrace_rec *r = &ring[ring_head & (GTRACE_RING_SIZE - 1)];
+
+    r->cycles = now;
+    r->id = id;
+    r->b = b;
+    r->a[0] = a0;
+    r->a[1] = a1;
+    r->a[2] = a2;
+    ring_head++;
+
+    k_spin_unlock(&ring_lock, key);
+}
+
+size_t gtrace_drain(struct gtrace_rec *out, size_t max_count)
+{
+    size_t n = 0;
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+    while (n < max_count && ring_tail != ring_head) {
+        out[n++] = ring[ring_tail & (GTRACE_RING_SIZE - 1)];
+        ring_tail++;
+    }
+
+    k_spin_unlock(&ring_lock, key);
+    return n;
+}
+
+size_t gtrace_count(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+    size_t n = ring_head - ring_tail;
+
+    k_spin_unlock(&ring_lock, key);
+    return n;
+}
+
+uint32_t gtrace_overruns(void)
+{
+    return ring_overruns;
+}
+
+void gtrace_clear(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+    ring_tail = ring_head;
+    ring_overruns = 0;
+    k_spin_unlock(&ring_lock, key);
+}
+
+void gtrace_set_enabled(bool enable)
+{
+    trace_enabled = enable;
+}
+
+bool gtrace_is_enabled(void)
+{
+    return trace_enabled;
+}
+
+#else /* !CONFIG_BT_MESH_GRADIENT_SRV_TRACE */
+
+size_t gtrace_drain(struct gtrace_rec *out, size_t max_count)
+{
+    ARG_UNUSED(out);
+    ARG_UNUSED(max_count);
+    return 0;
+}
+
+size_t gtrace_count(void)
+{
+    return 0;
+}
+
+uint32_t gtrace_overruns(void)
+{
+    return 0;
+}
+
+void gtrace_clear(void)
+{
+}
+
+void gtrace_set_enabled(bool enable)
+{
+    ARG_UNUSED(enable);
+}
+
+bool gtrace_is_enabled(void)
+{
+    return false;
+}
+
+#endif /* CONFIG_BT_MESH_GRADIENT_SRV_TRACE */
+
+uint32_t gtrace_clock_hz(void)
+{
+    return sys_clock_hw_cycles_per_sec();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file link_cost_model.c
+ * @brief Fixed-point tree ensemble evaluator for local parent scoring
+ */
+
+#include "link_cost_model.h"
+#include <stdbool.h>
+
+/* Generated at build time from ml_training/routing_cost_model.txt */
+#include "cost_model_tables.h"
+
+_Static_assert(COST_MODEL_FRAC_BITS == LINK_COST_FRAC_BITS,
+               "cost_model_tables.h generated with a different Q format");
+
+/*============================================================================*/
+/* Private Functions                                                          */
+/*============================================================================*/
+
+/** num / den rounded half to even, like Python round() on the Gateway */
+static int32_t div_round_even(int64_t num, int64_t den)
+{
+    int64_t q = num / den;
+    int64_t r2 = 2 * (num % den);
+
+    if (r2 > den || (r2 == den && (q & 1))) {
+        q++;
+    }
+    return (int32_t)q;
+}
+
+/*============================================================================*/
+/* Public Functions                                                           */
+/*============================================================================*/
+
+void link_cost_model_features(const struct link_cost_input *in,
+                              int32_t q[LINK_COST_N_FEATURES])
+{
+    uint32_t processed = (uint32_t)in->drop_count + in->fwd_count;
+
+    q[LINK_COST_F_GRAD] = in->grad;
+    q[LINK_COST_F_RSSI] = in->rssi;
+    q[LINK_COST_F_LINK_UP] = in->link_up_s;
+    q[LINK_COST_F_DROP_COUNT] = in->drop_count;
+    q[LINK_COST_F_FWD_COUNT] = in->fwd_count;
+
+    /* Gateway: round(drp / (drp + fwd) * 100, 1) */
+    q[LINK_COST_F_DROP_RATE] =
+        processed ? div_round_even((int64_t)in->drop_count * 1000, processed) : 0;
+
+    /* Gateway estimate_battery(): 100 - (uptime * 0.00005 + tx * 0.002),
+     * clamped to [0, 100] and rounded to 0.1 -- here in 1e-5 tenths */
+    int64_t pin = 100000000LL - (int64_t)in->uptime_s * 50 -
+                  (int64_t)in->total_sent * 2000;
+
+    if (pin < 0) {
+        pin = 0;
+    }
+    q[LINK_COST_F_PIN] = div_round_even(pin, 100000);
+
+    q[LINK_COST_F_NB_COUNT] = in->nb_count;
+    q[LINK_COST_F_LINK_STAB] = in->link_up_s;
+
+    int64_t load = ((int64_t)in->fwd_count << LINK_COST_FRAC_BITS) / (in->nb_count + 1);
+
+    q[LINK_COST_F_LOAD_PER_NB] = (int32_t)(load > INT32_MAX ? INT32_MAX : load);
+}
+
+int32_t link_cost_model_eval(const int32_t q[LINK_COST_N_FEATURES])
+{
+    int32_t sum = 0;
+
+    for (int t = 0; t < COST_MODEL_N_TREES; t++) {
+        int idx = cost_model_roots[t];
+
+        while (idx >= 0) {
+            const struct cost_model_node *node = &cost_model_nodes[idx];
+            int32_t v = q[node->feature];
+            bool left;
+
+            if ((node->flags & COST_MODEL_NODE_MISSING_ZERO) && v == 0) {
+                left = (node->flags & COST_MODEL_NODE_DEFAULT_LEFT) != 0;
+            } else {
+                left = v <= node->threshold;
+            }
+            idx = left ? node->left : node->right;
+        }
+        sum += cost_model_leaves[~idx];
+    }
+    return sum;
+}
+
+int32_t link_cost_model_score(const struct link_cost_input *in)
+{
+    int32_t q[LINK_COST_N_FEATURES];
+
+    link_cost_model_features(in, q);
+    return link_cost_model_eval(q);
+}
@@ -216,17 +216,11 @@ static void handle_report_req_received(struct bt_mesh_gradient_srv *srv) {
 
   LOG_INF(">>> TEST STOPPED. Reported DATA Tx: %u <<<", g_test_data_tx_count);
 
-  /* 2. LOGIC JITTER: Đợi một khoảng thời gian ngẫu nhiên trước khi báo cáo
-   * để tránh "nghẽn cổ chai" tại các nexthop gần Gateway.
+  /* 2. Bắt đầu tiến trình gửi báo cáo tin cậy (có ACK/Retry). Thời điểm gửi
+   * theo slot của collection wave (sâu nhất trước) để tránh "nghẽn cổ chai"
+   * tại các nexthop gần Gateway; không có wave thì dùng jitter ngẫu nhiên.
    */
-  uint32_t random_delay = 500 + (sys_rand32_get() % 3500);
-  LOG_INF(">> Report will be sent in %d ms (Reliable Sequence)...",
-          random_delay);
-
-  /* 3. Bắt đầu tiến trình gửi báo cáo tin cậy (có ACK/Retry) */
-  srv->is_report_pending = true;
-  srv->report_retry_count = 0;
-  k_work_schedule(&srv->report_retry_work, K_MSEC(random_delay));
+  (void)bt_mesh_gradient_srv_report_rsp_send(srv);
 }
 
 static const struct bt_mesh_gradient_srv_handlers chat_handlers = {
@@ -5,6 +5,7 @@
  */
 
 #include "neighbor_table.h"
+#include "gtrace.h"
 #include <limits.h>
 #include <string.h>
 #include <zephyr/logging/log.h>
@@ -29,8 +30,13 @@ void nt_init(neighbor_entry_t *table, size_t table_size)
 
 bool nt_update_sorted(neighbor_entry_t *table, size_t table_size,
                       uint16_t sender_addr, uint8_t sender_gradient, int8_t sender_rssi,
-                      int64_t now_ms)
+                      int64_t now_ms, neighbor_entry_t *evicted)
 {
+    if (evicted != NULL) {
+        evicted->addr = GR_ADDR_UNASSIGNED;
+        evicted->backprop_dest = NULL;
+    }
+
     if (table == NULL || table_size == 0) {
         return false;
     }
@@ -86,6 +92,12 @@ bool nt_update_sorted(neighbor_entry_t *table, size_t table_size,
     
     // TRƯỜNG HỢP A: Node mới hoàn toàn
     if (existing_pos == -1) {
+        /* [FIX] Bảng đầy: entry cuối bị đẩy ra. Trả nó cho caller để giải phóng
+         * danh sách RRT (trước đây list bị mất, rrt_gen không đổi) */
+        if (table[table_size - 1].addr != GR_ADDR_UNASSIGNED && evicted != NULL) {
+            *evicted = table[table_size - 1];
+        }
+
         // Dịch các phần tử từ insert_pos về sau lùi 1 bước để tạo chỗ trống
         for (int i = table_size - 1; i > insert_pos; i--) {
             table[i] = table[i - 1]; 
@@ -104,6 +116,7 @@ bool nt_update_sorted(neighbor_entry_t *table, size_t table_size,
             table[insert_pos].rssi = sender_rssi;
             table[insert_pos].last_seen = now_ms;
             // backprop_dest giữ nguyên
+            GTRACE(GT_NT_UPDATE, insert_pos, sender_addr, sender_gradient, sender_rssi);
             return true;
         }
 
@@ -140,6 +153,7 @@ bool nt_update_sorted(neighbor_entry_t *table, size_t table_size,
         table[insert_pos].rssi = sender_rssi;
         table[insert_pos].last_seen = now_ms;
         // backprop_dest đã được xử lý ở bước 3
+        GTRACE(GT_NT_UPDATE, insert_pos, sender_addr, sender_gradient, sender_rssi);
     }
 
     return true;
@@ -13,6 +13,10 @@
 #include <zephyr/kernel.h>
 #include <zephyr/sys/atomic.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/net_buf.h>
+#include <errno.h>
+#include <string.h>
 
 LOG_MODULE_REGISTER(packet_stats, LOG_LEVEL_INF);
 
@@ -20,28 +24,273 @@ LOG_MODULE_REGISTER(packet_stats, LOG_LEVEL_INF);
 /* Private Data                                                               */
 /*============================================================================*/
 
-#define MAX_PENDING_PONGS 10
-#define MAX_RTT_HISTORY   50
+/** Pending PONG table: open addressing by seq, bounded probe window */
+#define PONG_TABLE_BITS     5
+#define PONG_TABLE_SIZE     (1U << PONG_TABLE_BITS)
+#define PONG_PROBE_WINDOW   4
+#define PONG_TIMEOUT_MS     30000U
 
-struct pending_pong {
-    uint16_t seq;
-    uint32_t send_time;
+/**
+ * Slot word: seq(16) | valid(1) | send tick(15), 0 = free. 4 ms ticks span
+ * 131 s, well past PONG_TIMEOUT_MS; RTT is measured to the same 4 ms, finer
+ * than the histogram buckets above 32 ms. A slot nobody probes for 131 s
+ * reads as young again and simply expires one timeout later.
+ */
+#define PONG_TICK_SHIFT     2
+#define PONG_TICK_MASK      0x7FFFU
+#define PONG_SLOT_VALID     BIT(15)
+#define PONG_SLOT(seq, tick) \
+    (((uint32_t)(seq) << 16) | PONG_SLOT_VALID | ((tick) & PONG_TICK_MASK))
+#define PONG_SLOT_SEQ(w)    ((uint16_t)((uint32_t)(w) >> 16))
+
+/** HDR-style log buckets: 8 sub-buckets per power of two, 0..65535 ms */
+#define LAT_SUB_BITS        3
+#define LAT_SUB_COUNT       (1U << LAT_SUB_BITS)
+#define LAT_MAX_MSB         15
+#define LAT_BUCKETS         ((LAT_MAX_MSB - LAT_SUB_BITS + 2) * LAT_SUB_COUNT)
+
+/** Histogram slots: RTT, backprop (all), backprop per hop bin */
+#define LAT_HIST_RTT        0
+#define LAT_HIST_BACKPROP   1
+#define LAT_HIST_HOP_BASE   2
+#define LAT_HIST_COUNT      (LAT_HIST_HOP_BASE + PKT_LAT_HOP_BINS)
+
+struct lat_hist {
+    uint32_t count;
+    uint16_t max_ms;
+    uint32_t buckets[LAT_BUCKETS];
+};
+
+/** Counter slots. Order is also the on-air order of the binary snapshot. */
+enum stat_id {
+    /* Hot: touched on every DATA / beacon TX or RX */
+    STAT_DATA_TX = 0,
+    STAT_BEACON,
+    STAT_HEARTBEAT,
+    STAT_ROUTE_CHANGE,
+    STAT_DATA_FWD,
+    STAT_RX_DATA,
+    /* Cold: event driven */
+    STAT_PONG_TIMEOUT,
+    STAT_COUNT,
 };
 
-/** Atomic counters for thread-safe access */
-static atomic_t gradient_beacon_count = ATOMIC_INIT(0);
-static atomic_t heartbeat_count = ATOMIC_INIT(0);
-static atomic_t data_tx_count = ATOMIC_INIT(0);
-static atomic_t data_fwd_count = ATOMIC_INIT(0);
-static atomic_t route_change_count = ATOMIC_INIT(0);
-static atomic_t rx_data_count = ATOMIC_INIT(0); /* [NEW] */
+#define STATS_LINE_SIZE     32
+
+/**
+ * All counters share one cache line and are bumped with relaxed atomics:
+ * increments never need ordering against each other, only against reset,
+ * which is what the seqlock below provides.
+ */
+static uint32_t stat_counters[STAT_COUNT] __aligned(STATS_LINE_SIZE);
+
+/** Seqlock guarding multi-word updates (reset); odd = write in progress */
+static atomic_t stats_seq __aligned(STATS_LINE_SIZE) = ATOMIC_INIT(0);
+static uint8_t stats_epoch;
+static uint32_t stats_reset_time;
+static struct k_spinlock stats_wr_lock;
 static bool stats_enabled = false;
 
-/* [NEW] RTT Tracking Data */
-static struct pending_pong pending_pongs[MAX_PENDING_PONGS];
-static struct rtt_sample rtt_history[MAX_RTT_HISTORY];
-static uint16_t rtt_count = 0;
-K_MUTEX_DEFINE(stats_mutex);
+/*
+ * Latency tracking without a lock: each pending PONG is one atomic word
+ * claimed and released by CAS, histogram fields take relaxed atomic adds.
+ * A summary racing with a record may see a bucket without its count bump;
+ * ranks are taken from the copied buckets, so that only skews by one sample.
+ */
+static atomic_t pending_pongs[PONG_TABLE_SIZE];
+static struct lat_hist lat_hists[LAT_HIST_COUNT];
+
+/*============================================================================*/
+/* Private Functions                                                          */
+/*============================================================================*/
+
+static inline void stat_inc(enum stat_id id)
+{
+    (void)__atomic_fetch_add(&stat_counters[id], 1U, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t stat_load(enum stat_id id)
+{
+    return __atomic_load_n(&stat_counters[id], __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Zero all counters inside a seqlock write section
+ *
+ * Concurrent increments are not blocked: they land either before the
+ * zeroing (and are dropped with the old epoch) or after it.
+ */
+static void stats_counters_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_wr_lock);
+
+    atomic_inc(&stats_seq);
+    for (int i = 0; i < STAT_COUNT; i++) {
+        __atomic_store_n(&stat_counters[i], 0U, __ATOMIC_RELAXED);
+    }
+    stats_epoch++;
+    stats_reset_time = k_uptime_get_32();
+    atomic_inc(&stats_seq);
+
+    k_spin_unlock(&stats_wr_lock, key);
+}
+
+static void put_uleb32(struct net_buf_simple *buf, uint32_t v)
+{
+    do {
+        uint8_t b = v & 0x7F;
+
+        v >>= 7;
+        net_buf_simple_add_u8(buf, v ? (b | 0x80) : b);
+    } while (v);
+}
+
+static int pull_uleb32(struct net_buf_simple *buf, uint32_t *v)
+{
+    uint32_t out = 0;
+
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (buf->len < 1) {
+            return -EMSGSIZE;
+        }
+        uint8_t b = net_buf_simple_pull_u8(buf);
+
+        out |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = out;
+            return 0;
+        }
+    }
+
+    return -EINVAL;
+}
+
+static inline uint32_t pong_hash(uint16_t seq)
+{
+    /* Fibonacci hashing: consecutive seqs spread over the table */
+    return ((uint16_t)(seq * 40503U)) >> (16 - PONG_TABLE_BITS);
+}
+
+static inline uint32_t pong_tick(uint32_t now_ms)
+{
+    return (now_ms >> PONG_TICK_SHIFT) & PONG_TICK_MASK;
+}
+
+static inline uint32_t pong_age_ms(atomic_val_t w, uint32_t tick)
+{
+    return ((tick - (uint32_t)w) & PONG_TICK_MASK) << PONG_TICK_SHIFT;
+}
+
+/**
+ * @brief Release a slot that outlived PONG_TIMEOUT_MS
+ * @return true if @p w was live and expired (slot cleared by us or a peer)
+ */
+static bool pong_slot_expire(atomic_t *slot, atomic_val_t w, uint32_t tick)
+{
+    if (!(w & PONG_SLOT_VALID) || pong_age_ms(w, tick) <= PONG_TIMEOUT_MS) {
+        return false;
+    }
+    if (atomic_cas(slot, w, 0)) {
+        stat_inc(STAT_PONG_TIMEOUT);
+    }
+    return true;
+}
+
+static uint32_t lat_bucket_index(uint32_t value)
+{
+    if (value > UINT16_MAX) {
+        value = UINT16_MAX;
+    }
+    if (value < LAT_SUB_COUNT) {
+        return value;
+    }
+
+    uint32_t msb = 31U - __builtin_clz(value);
+    uint32_t shift = msb - LAT_SUB_BITS;
+
+    return ((shift + 1U) << LAT_SUB_BITS) + ((value >> shift) & (LAT_SUB_COUNT - 1U));
+}
+
+static uint32_t lat_bucket_upper(uint32_t idx)
+{
+    if (idx < LAT_SUB_COUNT) {
+        return idx;
+    }
+
+    uint32_t shift = (idx >> LAT_SUB_BITS) - 1U;
+    uint32_t sub = idx & (LAT_SUB_COUNT - 1U);
+    uint32_t upper = ((LAT_SUB_COUNT + sub) << shift) + (1U << shift) - 1U;
+
+    return MIN(upper, UINT16_MAX);
+}
+
+static void lat_hist_record(struct lat_hist *h, uint32_t value)
+{
+    uint16_t v = (uint16_t)MIN(value, UINT16_MAX);
+    uint16_t max = __atomic_load_n(&h->max_ms, __ATOMIC_RELAXED);
+
+    (void)__atomic_fetch_add(&h->buckets[lat_bucket_index(value)], 1U, __ATOMIC_RELAXED);
+    (void)__atomic_fetch_add(&h->count, 1U, __ATOMIC_RELAXED);
+    while (v > max &&
+           !__atomic_compare_exchange_n(&h->max_ms, &max, v, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/** Relaxed field-by-field copy; count is rebuilt from the copied buckets */
+static void lat_hist_load(struct lat_hist *dst, const struct lat_hist *src)
+{
+    dst->count = 0;
+    for (uint32_t i = 0; i < LAT_BUCKETS; i++) {
+        dst->buckets[i] = __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+        dst->count += dst->buckets[i];
+    }
+    dst->max_ms = __atomic_load_n(&src->max_ms, __ATOMIC_RELAXED);
+}
+
+static uint16_t lat_hist_percentile(const struct lat_hist *h, uint32_t pct)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * pct + 99U) / 100U);
+    uint32_t seen = 0;
+
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    for (uint32_t i = 0; i < LAT_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            /* Never report above the exact observed maximum */
+            return (uint16_t)MIN(lat_bucket_upper(i), h->max_ms);
+        }
+    }
+
+    return h->max_ms;
+}
+
+/**
+ * @brief Clear pending PONGs and histograms
+ *
+ * Like the counters, records racing with a reset land either before the
+ * clearing (and are dropped) or after it.
+ */
+static void lat_reset(void)
+{
+    for (uint32_t i = 0; i < PONG_TABLE_SIZE; i++) {
+        atomic_set(&pending_pongs[i], 0);
+    }
+    for (uint32_t h = 0; h < LAT_HIST_COUNT; h++) {
+        for (uint32_t i = 0; i < LAT_BUCKETS; i++) {
+            __atomic_store_n(&lat_hists[h].buckets[i], 0U, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&lat_hists[h].count, 0U, __ATOMIC_RELAXED);
+        __atomic_store_n(&lat_hists[h].max_ms, 0U, __ATOMIC_RELAXED);
+    }
+}
 
 /*============================================================================*/
 /* Public Functions                                                           */
@@ -49,21 +298,9 @@ K_MUTEX_DEFINE(stats_mutex);
 
 void pkt_stats_init(void)
 {
-    atomic_set(&gradient_beacon_count, 0);
-    atomic_set(&heartbeat_count, 0);
-    atomic_set(&data_tx_count, 0);
-    atomic_set(&data_fwd_count, 0);
-    atomic_set(&route_change_count, 0);
-    atomic_set(&rx_data_count, 0); /* [NEW] */
-    
-    k_mutex_lock(&stats_mutex, K_FOREVER);
-    for (int i = 0; i < MAX_PENDING_PONGS; i++) {
-        pending_pongs[i].seq = 0;
-        pending_pongs[i].send_time = 0;
-    }
-    rtt_count = 0;
-    k_mutex_unlock(&stats_mutex);
-    
+    stats_counters_reset();
+    lat_reset();
+
     LOG_INF("[PktStats] Initialized - all counters reset");
 }
 
@@ -71,178 +308,355 @@ void pkt_stats_record_sent(uint16_t seq)
 {
     if (!stats_enabled) return;
 
-    k_mutex_lock(&stats_mutex, K_FOREVER);
-    
-    /* Find empty slot or oldest slot in pending_pongs */
-    int slot = -1;
-    uint32_t oldest_time = UINT32_MAX;
-    int oldest_idx = 0;
-
-    for (int i = 0; i < MAX_PENDING_PONGS; i++) {
-        if (pending_pongs[i].send_time == 0) {
-            slot = i;
-            break;
-        }
-        if (pending_pongs[i].send_time < oldest_time) {
-            oldest_time = pending_pongs[i].send_time;
-            oldest_idx = i;
-        }
-    }
+    uint32_t tick = pong_tick(k_uptime_get_32());
+    uint32_t home = pong_hash(seq);
+    atomic_val_t entry = PONG_SLOT(seq, tick);
+
+    for (uint32_t i = 0; i < PONG_PROBE_WINDOW; i++) {
+        atomic_t *slot = &pending_pongs[(home + i) & (PONG_TABLE_SIZE - 1U)];
+        atomic_val_t w;
 
-    if (slot == -1) {
-        /* Reuse oldest slot if full (stale ping cleanup) */
-        slot = oldest_idx;
-        LOG_DBG("[PktStats] Pending Pongs full, overwriting oldest (seq=%u)", pending_pongs[slot].seq);
+        do {
+            w = atomic_get(slot);
+            if (pong_slot_expire(slot, w, tick)) {
+                w = atomic_get(slot);
+            }
+            if (w != 0 && PONG_SLOT_SEQ(w) != seq) {
+                break; /* Live entry of another seq: probe on */
+            }
+            if (atomic_cas(slot, w, entry)) {
+                return;
+            }
+        } while (true);
     }
 
-    pending_pongs[slot].seq = seq;
-    pending_pongs[slot].send_time = k_uptime_get_32();
-    
-    k_mutex_unlock(&stats_mutex);
+    /* Window full of live entries: evict the home slot */
+    if (atomic_set(&pending_pongs[home], entry) & PONG_SLOT_VALID) {
+        stat_inc(STAT_PONG_TIMEOUT);
+    }
 }
 
 bool pkt_stats_record_pong(uint16_t seq)
 {
     if (!stats_enabled) return false;
-    bool buffer_full = false;
 
-    k_mutex_lock(&stats_mutex, K_FOREVER);
+    uint32_t tick = pong_tick(k_uptime_get_32());
+    uint32_t home = pong_hash(seq);
+    uint32_t rtt = 0;
+    bool found = false;
 
-    /* 1. Find the matching pending ping */
-    int slot = -1;
-    for (int i = 0; i < MAX_PENDING_PONGS; i++) {
-        if (pending_pongs[i].send_time != 0 && pending_pongs[i].seq == seq) {
-            slot = i;
-            break;
+    for (uint32_t i = 0; i < PONG_PROBE_WINDOW && !found; i++) {
+        atomic_t *slot = &pending_pongs[(home + i) & (PONG_TABLE_SIZE - 1U)];
+        atomic_val_t w = atomic_get(slot);
+
+        if (pong_slot_expire(slot, w, tick)) {
+            continue;
+        }
+        /* CAS claims the entry: a duplicate PONG racing us finds it gone */
+        if ((w & PONG_SLOT_VALID) && PONG_SLOT_SEQ(w) == seq && atomic_cas(slot, w, 0)) {
+            rtt = pong_age_ms(w, tick);
+            lat_hist_record(&lat_hists[LAT_HIST_RTT], rtt);
+            found = true;
         }
     }
 
-    if (slot != -1) {
-        uint32_t rtt = k_uptime_get_32() - pending_pongs[slot].send_time;
-        
-        /* 2. Record in history */
-        if (rtt_count < MAX_RTT_HISTORY) {
-            rtt_history[rtt_count].seq = seq;
-            rtt_history[rtt_count].rtt_ms = (uint16_t)rtt;
-            rtt_count++;
-            
-            if (rtt_count >= MAX_RTT_HISTORY) {
-                buffer_full = true;
-            }
-        }
-        
-        /* 3. Clear the pending slot */
-        pending_pongs[slot].send_time = 0;
+    if (found) {
         LOG_DBG("[PktStats] PONG received for seq=%u, RTT=%u ms", seq, rtt);
     } else {
         LOG_DBG("[PktStats] PONG received for unknown/expired seq=%u", seq);
     }
 
-    k_mutex_unlock(&stats_mutex);
-    return buffer_full;
+    return found;
 }
 
-uint16_t pkt_stats_get_rtt_history(struct rtt_sample *buffer, uint16_t max_count)
+void pkt_stats_record_backprop_delay(uint32_t delay_ms, uint8_t hops)
 {
-    uint16_t count = 0;
-    
-    k_mutex_lock(&stats_mutex, K_FOREVER);
-    
-    count = (rtt_count < max_count) ? rtt_count : max_count;
-    if (count > 0 && buffer != NULL) {
-        memcpy(buffer, rtt_history, count * sizeof(struct rtt_sample));
+    if (!stats_enabled) return;
+
+    uint32_t bin = (hops == 0) ? 0 : MIN(hops, PKT_LAT_HOP_BINS) - 1U;
+
+    lat_hist_record(&lat_hists[LAT_HIST_BACKPROP], delay_ms);
+    lat_hist_record(&lat_hists[LAT_HIST_HOP_BASE + bin], delay_ms);
+}
+
+uint8_t pkt_stats_get_latency_summary(struct pkt_lat_summary *out, uint8_t max_count)
+{
+    uint8_t n = 0;
+
+    if (out == NULL) {
+        return 0;
     }
-    
-    k_mutex_unlock(&stats_mutex);
-    return count;
+
+    for (uint32_t i = 0; i < LAT_HIST_COUNT && n < max_count; i++) {
+        struct lat_hist copy;
+        const struct lat_hist *h = &copy;
+
+        /* Rank a private copy: writers keep adding while we scan */
+        lat_hist_load(&copy, &lat_hists[i]);
+
+        if (h->count == 0) {
+            continue;
+        }
+
+        if (i == LAT_HIST_RTT) {
+            out[n].metric = PKT_LAT_UPLINK_RTT;
+            out[n].hops = 0;
+        } else if (i == LAT_HIST_BACKPROP) {
+            out[n].metric = PKT_LAT_BACKPROP_DELAY;
+            out[n].hops = 0;
+        } else {
+            out[n].metric = PKT_LAT_BACKPROP_HOP;
+            out[n].hops = (uint8_t)(i - LAT_HIST_HOP_BASE + 1U);
+        }
+        out[n].count = h->count;
+        out[n].p50_ms = lat_hist_percentile(h, 50);
+        out[n].p90_ms = lat_hist_percentile(h, 90);
+        out[n].p99_ms = lat_hist_percentile(h, 99);
+        out[n].max_ms = h->max_ms;
+        n++;
+    }
+
+    return n;
 }
 
-void pkt_stats_clear_rtt_history(void)
+uint32_t pkt_stats_get_pong_timeouts(void)
 {
-    k_mutex_lock(&stats_mutex, K_FOREVER);
-    rtt_count = 0;
-    k_mutex_unlock(&stats_mutex);
-    LOG_DBG("[PktStats] RTT History cleared");
+    return stat_load(STAT_PONG_TIMEOUT);
+}
+
+const char *pkt_stats_lat_metric_str(uint8_t metric)
+{
+    switch (metric) {
+    case PKT_LAT_UPLINK_RTT:
+        return "RTT";
+    case PKT_LAT_BACKPROP_DELAY:
+        return "BACKPROP";
+    case PKT_LAT_BACKPROP_HOP:
+        return "BACKPROP_HOP";
+    default:
+        return "UNKNOWN";
+    }
 }
 
 void pkt_stats_inc_gradient_beacon(void)
 {
     if (!stats_enabled) return;
-    atomic_inc(&gradient_beacon_count);
+    stat_inc(STAT_BEACON);
 }
 
 void pkt_stats_inc_heartbeat(void)
 {
     if (!stats_enabled) return;
-    atomic_inc(&heartbeat_count);
+    stat_inc(STAT_HEARTBEAT);
 }
 
 void pkt_stats_inc_data_tx(void)
 {
     if (!stats_enabled) return;
-    atomic_inc(&data_tx_count);
+    stat_inc(STAT_DATA_TX);
 }
 
 void pkt_stats_inc_data_fwd(void)
 {
     if (!stats_enabled) return;
-    atomic_inc(&data_fwd_count);
+    stat_inc(STAT_DATA_FWD);
 }
 
 void pkt_stats_inc_route_change(void)
 {
     if (!stats_enabled) return;
-    atomic_inc(&route_change_count);
+    stat_inc(STAT_ROUTE_CHANGE);
 }
 
 void pkt_stats_inc_rx(void)
 {
     if (!stats_enabled) return;
-    atomic_inc(&rx_data_count);
+    stat_inc(STAT_RX_DATA);
 }
 
 void pkt_stats_get(struct packet_stats *stats)
 {
+    uint32_t c[STAT_COUNT];
+    uint32_t reset_time;
+    uint8_t epoch;
+    atomic_val_t seq;
+
     if (stats == NULL) {
         return;
     }
-    
-    stats->gradient_beacon_tx = (uint32_t)atomic_get(&gradient_beacon_count);
-    stats->heartbeat_tx = (uint32_t)atomic_get(&heartbeat_count);
-    stats->data_tx = (uint32_t)atomic_get(&data_tx_count);
-    stats->data_fwd_tx = (uint32_t)atomic_get(&data_fwd_count);
-    stats->route_change_count = (uint32_t)atomic_get(&route_change_count);
-    stats->rx_data_count = (uint32_t)atomic_get(&rx_data_count); /* [NEW] */
+
+    /* Seqlock read: retry if a reset ran while copying */
+    do {
+        seq = atomic_get(&stats_seq);
+        if (seq & 1) {
+            k_yield();
+            continue;
+        }
+        for (int i = 0; i < STAT_COUNT; i++) {
+            c[i] = stat_load(i);
+        }
+        epoch = stats_epoch;
+        reset_time = stats_reset_time;
+    } while ((seq & 1) || atomic_get(&stats_seq) != seq);
+
+    stats->data_tx = c[STAT_DATA_TX];
+    stats->gradient_beacon_tx = c[STAT_BEACON];
+    stats->heartbeat_tx = c[STAT_HEARTBEAT];
+    stats->route_change_count = c[STAT_ROUTE_CHANGE];
+    stats->data_fwd_tx = c[STAT_DATA_FWD];
+    stats->rx_data_count = c[STAT_RX_DATA];
+    stats->pong_timeouts = c[STAT_PONG_TIMEOUT];
+    stats->epoch = epoch;
+    stats->since_reset_s = (k_uptime_get_32() - reset_time) / 1000U;
 }
 
 uint32_t pkt_stats_get_gradient_beacon(void)
 {
-    return (uint32_t)atomic_get(&gradient_beacon_count);
+    return stat_load(STAT_BEACON);
 }
 
 uint32_t pkt_stats_get_heartbeat(void)
 {
-    return (uint32_t)atomic_get(&heartbeat_count);
+    return stat_load(STAT_HEARTBEAT);
 }
 
 uint32_t pkt_stats_get_data_tx(void)
 {
-    return (uint32_t)atomic_get(&data_tx_count);
+    return stat_load(STAT_DATA_TX);
 }
 
 uint32_t pkt_stats_get_data_fwd(void)
 {
-    return (uint32_t)atomic_get(&data_fwd_count);
+    return stat_load(STAT_DATA_FWD);
 }
 
 uint32_t pkt_stats_get_route_change(void)
 {
-    return (uint32_t)atomic_get(&route_change_count);
+    return stat_load(STAT_ROUTE_CHANGE);
 }
 
 uint32_t pkt_stats_get_rx(void)
 {
-    return (uint32_t)atomic_get(&rx_data_count);
+    return stat_load(STAT_RX_DATA);
+}
+
+int pkt_stats_snapshot_encode(struct net_buf_simple *buf)
+{
+    struct packet_stats stats;
+    struct pkt_lat_summary lat[PKT_LAT_MAX_SUMMARIES];
+    uint32_t c[STAT_COUNT];
+
+    if (net_buf_simple_tailroom(buf) < PKT_STATS_SNAPSHOT_MAX_LEN) {
+        return -ENOBUFS;
+    }
+
+    pkt_stats_get(&stats);
+    uint8_t lat_count = pkt_stats_get_latency_summary(lat, PKT_LAT_MAX_SUMMARIES);
+
+    c[STAT_DATA_TX] = stats.data_tx;
+    c[STAT_BEACON] = stats.gradient_beacon_tx;
+    c[STAT_HEARTBEAT] = stats.heartbeat_tx;
+    c[STAT_ROUTE_CHANGE] = stats.route_change_count;
+    c[STAT_DATA_FWD] = stats.data_fwd_tx;
+    c[STAT_RX_DATA] = stats.rx_data_count;
+    c[STAT_PONG_TIMEOUT] = stats.pong_timeouts;
+
+    net_buf_simple_add_u8(buf, PKT_STATS_SNAPSHOT_VERSION);
+    net_buf_simple_add_u8(buf, stats.epoch);
+    put_uleb32(buf, stats.since_reset_s);
+
+    net_buf_simple_add_u8(buf, STAT_COUNT);
+    for (int i = 0; i < STAT_COUNT; i++) {
+        put_uleb32(buf, c[i]);
+    }
+
+    /* metric byte = (hops << 4) | enum pkt_lat_metric */
+    net_buf_simple_add_u8(buf, lat_count);
+    for (int i = 0; i < lat_count; i++) {
+        net_buf_simple_add_u8(buf, (uint8_t)((lat[i].hops << 4) | lat[i].metric));
+        net_buf_simple_add_le16(buf, (uint16_t)MIN(lat[i].count, UINT16_MAX));
+        net_buf_simple_add_le16(buf, lat[i].p50_ms);
+        net_buf_simple_add_le16(buf, lat[i].p90_ms);
+        net_buf_simple_add_le16(buf, lat[i].p99_ms);
+        net_buf_simple_add_le16(buf, lat[i].max_ms);
+    }
+
+    return 0;
+}
+
+int pkt_stats_snapshot_decode(struct net_buf_simple *buf, struct packet_stats *stats,
+                              struct pkt_lat_summary *lat, uint8_t *lat_count)
+{
+    uint32_t c[STAT_COUNT] = {0};
+    uint32_t v;
+    int err;
+
+    if (buf->len < 4) {
+        return -EMSGSIZE;
+    }
+
+    if (net_buf_simple_pull_u8(buf) != PKT_STATS_SNAPSHOT_VERSION) {
+        return -ENOTSUP;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->epoch = net_buf_simple_pull_u8(buf);
+    err = pull_uleb32(buf, &stats->since_reset_s);
+    if (err) {
+        return err;
+    }
+
+    if (buf->len < 1) {
+        return -EMSGSIZE;
+    }
+
+    /* Newer senders may append counters: keep the ones we know */
+    uint8_t n = net_buf_simple_pull_u8(buf);
+
+    for (int i = 0; i < n; i++) {
+        err = pull_uleb32(buf, &v);
+        if (err) {
+            return err;
+        }
+        if (i < STAT_COUNT) {
+            c[i] = v;
+        }
+    }
+
+    stats->data_tx = c[STAT_DATA_TX];
+    stats->gradient_beacon_tx = c[STAT_BEACON];
+    stats->heartbeat_tx = c[STAT_HEARTBEAT];
+    stats->route_change_count = c[STAT_ROUTE_CHANGE];
+    stats->data_fwd_tx = c[STAT_DATA_FWD];
+    stats->rx_data_count = c[STAT_RX_DATA];
+    stats->pong_timeouts = c[STAT_PONG_TIMEOUT];
+
+    *lat_count = 0;
+    if (buf->len < 1) {
+        return 0;
+    }
+
+    uint8_t count = net_buf_simple_pull_u8(buf);
+
+    for (int i = 0; i < count && buf->len >= 11; i++) {
+        uint8_t metric = net_buf_simple_pull_u8(buf);
+        struct pkt_lat_summary tmp = {
+            .metric = metric & 0x0F,
+            .hops = metric >> 4,
+        };
+
+        tmp.count = net_buf_simple_pull_le16(buf);
+        tmp.p50_ms = net_buf_simple_pull_le16(buf);
+        tmp.p90_ms = net_buf_simple_pull_le16(buf);
+        tmp.p99_ms = net_buf_simple_pull_le16(buf);
+        tmp.max_ms = net_buf_simple_pull_le16(buf);
+
+        if (*lat_count < PKT_LAT_MAX_SUMMARIES) {
+            lat[(*lat_count)++] = tmp;
+        }
+    }
+
+    return 0;
 }
 
 uint32_t pkt_stats_get_control_total(void)
@@ -252,23 +666,10 @@ uint32_t pkt_stats_get_control_total(void)
 
 void pkt_stats_reset(void)
 {
-    atomic_set(&gradient_beacon_count, 0);
-    atomic_set(&heartbeat_count, 0);
-    atomic_set(&data_tx_count, 0);
-    atomic_set(&data_fwd_count, 0);
-    atomic_set(&route_change_count, 0);
-    atomic_set(&rx_data_count, 0); /* [NEW] */
-    
-    pkt_stats_clear_rtt_history();
-    
-    k_mutex_lock(&stats_mutex, K_FOREVER);
-    for (int i = 0; i < MAX_PENDING_PONGS; i++) {
-        pending_pongs[i].seq = 0;
-        pending_pongs[i].send_time = 0;
-    }
-    k_mutex_unlock(&stats_mutex);
-
-    LOG_INF("[PktStats] All counters, RTT history, and Pending Pongs reset to 0");
+    stats_counters_reset();
+    lat_reset();
+
+    LOG_INF("[PktStats] All counters, latency histograms, and Pending Pongs reset to 0");
 }
 
 void pkt_stats_set_enabled(bool enable)
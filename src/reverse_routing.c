@@ -6,8 +6,10 @@
 
 #include "reverse_routing.h"
 #include "gradient_srv.h"
+#include "gtrace.h"
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
 #include <errno.h>
 
 LOG_MODULE_REGISTER(reverse_routing, LOG_LEVEL_INF);
@@ -30,6 +32,10 @@ LOG_MODULE_REGISTER(reverse_routing, LOG_LEVEL_INF);
 /* Define the Memory Slab */
 K_MEM_SLAB_DEFINE(rrt_mem_slab, sizeof(backprop_node_t), RRT_TOTAL_NODES, 4);
 
+/* Bumped whenever a destination stops being covered by its entry
+ * (see rrt_generation()) */
+static atomic_t rrt_gen = ATOMIC_INIT(0);
+
 
 /*******************************************************************************
  * Helper Functions
@@ -51,15 +57,21 @@ static bt_mesh_gradient_srv_forwarding_ctx *find_entry_by_addr(
     return NULL;
 }
 
+static inline bool run_contains(const backprop_node_t *node, uint16_t dest_addr)
+{
+    return node->addr <= dest_addr && dest_addr <= node->hi;
+}
+
 /**
- * @brief Find destination in a linked list
+ * @brief Find the run (or exception, if @p moved) covering a destination
  * * @return Pointer to node if found, NULL otherwise
  */
-static backprop_node_t *find_dest_in_list(backprop_node_t *head, uint16_t dest_addr)
+static backprop_node_t *find_dest_in_list(backprop_node_t *head, uint16_t dest_addr,
+                                          bool moved)
 {
     backprop_node_t *current = head;
     while (current != NULL) {
-        if (current->addr == dest_addr) {
+        if (current->moved == moved && run_contains(current, dest_addr)) {
             return current;
         }
         current = current->next;
@@ -67,33 +79,138 @@ static backprop_node_t *find_dest_in_list(backprop_node_t *head, uint16_t dest_a
     return NULL;
 }
 
+static backprop_node_t *alloc_node(uint16_t lo, uint16_t hi, bool moved,
+                                   int64_t timestamp)
+{
+    backprop_node_t *node;
+
+    if (k_mem_slab_alloc(&rrt_mem_slab, (void **)&node, K_NO_WAIT) != 0) {
+        LOG_ERR("[RRT] Memory Slab Full (%d nodes). Dropping route to 0x%04x",
+                RRT_TOTAL_NODES, lo);
+        return NULL;
+    }
+
+    node->addr = lo;
+    node->hi = hi;
+    node->moved = moved;
+    node->last_seen = timestamp;
+    node->next = NULL;
+    return node;
+}
+
+/**
+ * @brief Unlink and free a node from a linked list
+ */
+static void free_node_in_list(backprop_node_t **head, backprop_node_t *node)
+{
+    for (backprop_node_t **pp = head; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == node) {
+            *pp = node->next;
+            k_mem_slab_free(&rrt_mem_slab, node);
+            atomic_inc(&rrt_gen);
+            return;
+        }
+    }
+}
+
 /**
  * @brief Remove destination from a linked list
- * * @return true if removed, false if not found
+ *
+ * Single-address nodes are freed, runs shrink at the ends or split in two.
+ * * @return true if removed, false if not found (or the split failed)
  */
 static bool remove_dest_from_list(backprop_node_t **head, uint16_t dest_addr)
 {
-    backprop_node_t *prev = NULL;
-    backprop_node_t *current = *head;
-    
-    while (current != NULL) {
-        if (current->addr == dest_addr) {
-            if (prev == NULL) {
-                *head = current->next;  /* Remove head node */
-            } else {
-                prev->next = current->next;  /* Remove middle/tail node */
-            }
-            
+    for (backprop_node_t **pp = head; *pp != NULL; pp = &(*pp)->next) {
+        backprop_node_t *current = *pp;
+
+        if (!run_contains(current, dest_addr)) {
+            continue;
+        }
+
+        if (current->addr == current->hi) {
+            *pp = current->next;
             /* CHANGED: Use slab free instead of k_free */
             k_mem_slab_free(&rrt_mem_slab, current);
-            return true;
+        } else if (dest_addr == current->addr) {
+            current->addr++;
+        } else if (dest_addr == current->hi) {
+            current->hi--;
+        } else {
+            /* Split: [addr, dest-1] stays, [dest+1, hi] becomes a new run */
+            backprop_node_t *tail = alloc_node(dest_addr + 1, current->hi, false,
+                                               current->last_seen);
+            if (tail == NULL) {
+                return false;
+            }
+            current->hi = dest_addr - 1;
+            tail->next = current->next;
+            current->next = tail;
         }
-        prev = current;
-        current = current->next;
+        atomic_inc(&rrt_gen);
+        return true;
     }
     return false;
 }
 
+/**
+ * @brief Insert destination into a linked list as part of a run
+ *
+ * Extends a run ending at dest-1 or starting at dest+1 (merging both if
+ * dest closes the gap); otherwise adds a single-address run.
+ */
+static int insert_dest_in_list(backprop_node_t **head, uint16_t dest_addr,
+                               int64_t timestamp)
+{
+    backprop_node_t *lower = NULL;
+    backprop_node_t *upper = NULL;
+
+    for (backprop_node_t *n = *head; n != NULL; n = n->next) {
+        if (n->moved) {
+            continue;
+        }
+        if (n->hi + 1 == dest_addr) {
+            lower = n;
+        } else if (n->addr == dest_addr + 1) {
+            upper = n;
+        }
+    }
+
+    if (lower != NULL) {
+        lower->hi = (upper != NULL) ? upper->hi : dest_addr;
+        lower->last_seen = timestamp;
+        if (upper != NULL) {
+            free_node_in_list(head, upper);
+        }
+        return 0;
+    }
+    if (upper != NULL) {
+        upper->addr = dest_addr;
+        upper->last_seen = timestamp;
+        return 0;
+    }
+
+    backprop_node_t *new_node = alloc_node(dest_addr, dest_addr, false, timestamp);
+    if (new_node == NULL) {
+        return -ENOMEM;
+    }
+    new_node->next = *head;
+    *head = new_node;
+    return 0;
+}
+
+/**
+ * @brief Number of destination addresses covered by a list
+ */
+static size_t count_dests(backprop_node_t *head)
+{
+    size_t count = 0;
+    for (backprop_node_t *n = head; n != NULL; n = n->next) {
+        count += (size_t)(n->hi - n->addr) + 1;
+    }
+    return count;
+}
+
 /**
  * @brief Count nodes in a linked list
  */
@@ -139,10 +256,12 @@ static void remove_oldest_from_list(backprop_node_t **head)
         oldest_prev->next = oldest->next;
     }
     
-    LOG_DBG("[RRT] Removed oldest dest 0x%04x to make room", oldest->addr);
+    LOG_DBG("[RRT] Removed oldest dest 0x%04x-0x%04x to make room",
+            oldest->addr, oldest->hi);
     
     /* CHANGED: Use slab free instead of k_free */
     k_mem_slab_free(&rrt_mem_slab, oldest);
+    atomic_inc(&rrt_gen);
 }
 
 /*******************************************************************************
@@ -174,39 +293,65 @@ int rrt_add_dest(void *table, size_t table_size,
         return -ENOENT;
     }
 
-    /* 2. Check if it's already on the correct neighbor */
-    backprop_node_t *existing = find_dest_in_list(target_entry->backprop_dest, dest_addr);
-    if (existing != NULL) {
-        existing->last_seen = timestamp; /* Just update time */
-        
-        /* Ensure it doesn't exist elsewhere (duplicate cleanup) */
-        for (size_t i = 0; i < table_size; i++) {
-             if (&ft[i] != target_entry && ft[i].addr != 0) {
-                 if (remove_dest_from_list(&ft[i].backprop_dest, dest_addr)) {
-                     LOG_WRN("[RRT] Fixed duplicate dest 0x%04x (removed from 0x%04x)", dest_addr, ft[i].addr);
-                 }
-             }
+    /* 2. Exception entry (moved node): refresh, or drop it if it moved again */
+    for (size_t i = 0; i < table_size; i++) {
+        if (ft[i].addr == 0) {
+            continue;
         }
-        return 0;
+        backprop_node_t *exc = find_dest_in_list(ft[i].backprop_dest, dest_addr, true);
+        if (exc == NULL) {
+            continue;
+        }
+        if (&ft[i] == target_entry) {
+            exc->last_seen = timestamp;
+            return 0;
+        }
+        LOG_INF("[RRT] Dest 0x%04x left exception at nexthop 0x%04x",
+                dest_addr, ft[i].addr);
+        free_node_in_list(&ft[i].backprop_dest, exc);
+        break; /* Can only exist in one place */
     }
 
-    /* 3. It's a Move or New Add. ALLOCATE FROM SLAB FIRST */
-    backprop_node_t *new_node;
-    if (k_mem_slab_alloc(&rrt_mem_slab, (void **)&new_node, K_NO_WAIT) != 0) {
-        LOG_ERR("[RRT] Memory Slab Full (%d nodes). Dropping route to 0x%04x", 
-                RRT_TOTAL_NODES, dest_addr);
-        return -ENOMEM; /* Abort cleanly */
+    /* 3. Already covered by a run on the correct neighbor */
+    backprop_node_t *existing = find_dest_in_list(target_entry->backprop_dest, dest_addr, false);
+    if (existing != NULL) {
+        existing->last_seen = timestamp; /* Just update time */
+        return 0;
     }
 
-    /* 4. Now safe to remove from old location (Move operation) */
+    /* 4. It's a Move or New Add */
     for (size_t i = 0; i < table_size; i++) {
-        if (ft[i].addr != nexthop_addr && ft[i].addr != 0) {
-            if (remove_dest_from_list(&ft[i].backprop_dest, dest_addr)) {
-                LOG_INF("[RRT] Dest 0x%04x moved from nexthop 0x%04x to 0x%04x",
-                        dest_addr, ft[i].addr, nexthop_addr);
-                break; /* Can only exist in one place */
+        if (&ft[i] == target_entry || ft[i].addr == 0) {
+            continue;
+        }
+        backprop_node_t *old = find_dest_in_list(ft[i].backprop_dest, dest_addr, false);
+        if (old == NULL) {
+            continue;
+        }
+
+        if (old->addr < dest_addr && dest_addr < old->hi) {
+            /* Inside another run: exception here, the run stays whole */
+            backprop_node_t *exc = alloc_node(dest_addr, dest_addr, true, timestamp);
+            if (exc == NULL) {
+                return -ENOMEM; /* Abort cleanly */
+            }
+            if (count_list(target_entry->backprop_dest) >= RRT_MAX_DEST_PER_NEXTHOP) {
+                remove_oldest_from_list(&target_entry->backprop_dest);
             }
+            exc->next = target_entry->backprop_dest;
+            target_entry->backprop_dest = exc;
+            LOG_INF("[RRT] Dest 0x%04x moved from nexthop 0x%04x to 0x%04x (exception)",
+                    dest_addr, ft[i].addr, nexthop_addr);
+            return 0;
+        }
+
+        if (!remove_dest_from_list(&ft[i].backprop_dest, dest_addr)) {
+            /* Split failed: keep the old route rather than point dest at two nexthops */
+            return -ENOMEM;
         }
+        LOG_INF("[RRT] Dest 0x%04x moved from nexthop 0x%04x to 0x%04x",
+                dest_addr, ft[i].addr, nexthop_addr);
+        break; /* Can only exist in one place */
     }
 
     /* 5. Check limits and insert */
@@ -216,13 +361,11 @@ int rrt_add_dest(void *table, size_t table_size,
         remove_oldest_from_list(&target_entry->backprop_dest);
     }
 
-    new_node->addr = dest_addr;
-    new_node->last_seen = timestamp;
-    new_node->next = target_entry->backprop_dest;
-    target_entry->backprop_dest = new_node;
-    
-    LOG_INF("[RRT] Added dest 0x%04x via nexthop 0x%04x", dest_addr, nexthop_addr);
-    return 0;
+    int err = insert_dest_in_list(&target_entry->backprop_dest, dest_addr, timestamp);
+    if (err == 0) {
+        LOG_INF("[RRT] Added dest 0x%04x via nexthop 0x%04x", dest_addr, nexthop_addr);
+    }
+    return err;
 }
 
 int rrt_remove_dest(void *table, size_t table_size,
@@ -248,9 +391,9 @@ uint16_t rrt_find_nexthop(const void *table, size_t table_size, uint16_t dest_ad
 {
     const bt_mesh_gradient_srv_forwarding_ctx *ft = 
         (const bt_mesh_gradient_srv_forwarding_ctx *)table;
+    uint16_t run_hop = 0;
     
-    // LOG_DBG("[RRT_SEARCH] Looking for dest 0x%04x in table size %d", dest_addr, table_size);
-
+    /* Precedence: direct neighbor > exception (moved node) > range */
     for (size_t i = 0; i < table_size; i++) {
         /* Bỏ qua các entry trống */
         if (ft[i].addr == GR_ADDR_UNASSIGNED || ft[i].addr == 0) {
@@ -263,18 +406,29 @@ uint16_t rrt_find_nexthop(const void *table, size_t table_size, uint16_t dest_ad
             return ft[i].addr;
         }
         
-        /* Kiểm tra danh sách gián tiếp (Backprop list) */
-        backprop_node_t *current = ft[i].backprop_dest;
-        while (current != NULL) {
-            // LOG_DBG("  Checking nexthop 0x%04x -> knows 0x%04x?", ft[i].addr, current->addr);
-            if (current->addr == dest_addr) {
-                LOG_INF("[RRT] Found route to 0x%04x via nexthop 0x%04x",
+        /* Kiểm tra danh sách gián tiếp (Backprop runs [addr, hi]) */
+        for (backprop_node_t *current = ft[i].backprop_dest; current != NULL;
+             current = current->next) {
+            if (!run_contains(current, dest_addr)) {
+                continue;
+            }
+            if (current->moved) {
+                GTRACE(GT_RRT_HIT, 1, dest_addr, ft[i].addr, 0);
+                LOG_DBG("[RRT] Found exception route to 0x%04x via nexthop 0x%04x",
                         dest_addr, ft[i].addr);
                 return ft[i].addr;
             }
-            current = current->next;
+            if (run_hop == 0) {
+                run_hop = ft[i].addr;
+            }
         }
     }
+
+    if (run_hop != 0) {
+        GTRACE(GT_RRT_HIT, 0, dest_addr, run_hop, 0);
+        LOG_DBG("[RRT] Found route to 0x%04x via nexthop 0x%04x", dest_addr, run_hop);
+        return run_hop;
+    }
     
     LOG_WRN("[RRT] No route found to dest 0x%04x", dest_addr);
     return 0;  /* BT_MESH_ADDR_UNASSIGNED */
@@ -299,8 +453,8 @@ int rrt_cleanup_expired(void *table, size_t table_size,
             int64_t age = current_time - current->last_seen;
             
             if (age > timeout_ms) {
-                LOG_INF("[RRT] Expired dest 0x%04x from nexthop 0x%04x (age=%lld ms)",
-                        current->addr, ft[i].addr, age);
+                LOG_INF("[RRT] Expired dest 0x%04x-0x%04x from nexthop 0x%04x (age=%lld ms)",
+                        current->addr, current->hi, ft[i].addr, age);
                 *pp = current->next;
                 
                 /* CHANGED: Use slab free instead of k_free */
@@ -314,6 +468,7 @@ int rrt_cleanup_expired(void *table, size_t table_size,
     }
     
     if (removed_count > 0) {
+        atomic_inc(&rrt_gen);
         LOG_INF("[RRT] Cleanup removed %d expired entries", removed_count);
     }
     
@@ -326,6 +481,18 @@ size_t rrt_get_dest_count(const void *table, size_t table_size, size_t index)
         return 0;
     }
     
+    const bt_mesh_gradient_srv_forwarding_ctx *ft = 
+        (const bt_mesh_gradient_srv_forwarding_ctx *)table;
+    
+    return count_dests(ft[index].backprop_dest);
+}
+
+size_t rrt_get_run_count(const void *table, size_t table_size, size_t index)
+{
+    if (index >= table_size) {
+        return 0;
+    }
+    
     const bt_mesh_gradient_srv_forwarding_ctx *ft = 
         (const bt_mesh_gradient_srv_forwarding_ctx *)table;
     
@@ -344,13 +511,15 @@ void rrt_print_table(const void *table, size_t table_size)
             continue;
         }
         
-        size_t count = count_list(ft[i].backprop_dest);
-        LOG_INF("Entry[%d]: nexthop=0x%04x, %d destinations:", i, ft[i].addr, count);
+        size_t count = count_dests(ft[i].backprop_dest);
+        LOG_INF("Entry[%d]: nexthop=0x%04x, %d destinations in %d runs:", i, ft[i].addr,
+                count, count_list(ft[i].backprop_dest));
         
         backprop_node_t *current = ft[i].backprop_dest;
         while (current != NULL) {
-            LOG_INF("  -> dest=0x%04x (last_seen=%lld)", 
-                    current->addr, current->last_seen);
+            LOG_INF("  -> dest=0x%04x-0x%04x%s (last_seen=%lld)", 
+                    current->addr, current->hi, current->moved ? " moved" : "",
+                    current->last_seen);
             current = current->next;
         }
     }
@@ -378,9 +547,28 @@ void rrt_clear_entry(void *table, size_t table_size, size_t index)
     }
     
     ft[index].backprop_dest = NULL;
+    atomic_inc(&rrt_gen);
     LOG_DBG("[RRT] Cleared backprop_dest for entry[%d]", index);
 }
 
+void rrt_free_evicted(void *entry)
+{
+    bt_mesh_gradient_srv_forwarding_ctx *e = (bt_mesh_gradient_srv_forwarding_ctx *)entry;
+
+    if (e == NULL || e->addr == GR_ADDR_UNASSIGNED) {
+        return;
+    }
+
+    LOG_INF("[RRT] Neighbor 0x%04x evicted from full table, dropping %d destinations",
+            e->addr, count_dests(e->backprop_dest));
+    rrt_clear_entry(e, 1, 0);
+}
+
+uint32_t rrt_generation(void)
+{
+    return (uint32_t)atomic_get(&rrt_gen);
+}
+
 uint16_t rrt_get_any_destination(const void *table, size_t table_size)
 {
     const bt_mesh_gradient_srv_forwarding_ctx *ft = 
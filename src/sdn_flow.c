@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file sdn_flow.c
+ * @brief Per-node SDN flow table (staged install, commit, soft-state expiry)
+ */
+
+#include "sdn_flow.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(sdn_flow, LOG_LEVEL_INF);
+
+/*============================================================================*/
+/* Private Functions                                                          */
+/*============================================================================*/
+
+static int rule_find(const struct sdn_flow_rule *rules, uint8_t count,
+                     uint16_t src, uint8_t tclass)
+{
+    for (int i = 0; i < count; i++) {
+        if (rules[i].src == src && rules[i].tclass == tclass) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** Remove by moving the last rule into the hole (order does not matter) */
+static void rule_remove(struct sdn_flow_rule *rules, uint8_t *count, int idx)
+{
+    (*count)--;
+    rules[idx] = rules[*count];
+}
+
+/** Higher = more specific; -1 = no match */
+static int rule_score(const struct sdn_flow_rule *rule, uint16_t src,
+                      uint8_t tclass)
+{
+    if (rule->src != SDN_FLOW_SRC_ANY && rule->src != src) {
+        return -1;
+    }
+    if (rule->tclass != SDN_FLOW_CLASS_ANY && rule->tclass != tclass) {
+        return -1;
+    }
+    return (rule->src != SDN_FLOW_SRC_ANY ? 2 : 0) +
+           (rule->tclass != SDN_FLOW_CLASS_ANY ? 1 : 0);
+}
+
+/*============================================================================*/
+/* Public Functions                                                           */
+/*============================================================================*/
+
+void sdn_flow_init(struct sdn_flow_table *ft)
+{
+    memset(ft, 0, sizeof(*ft));
+}
+
+void sdn_flow_reset(struct sdn_flow_table *ft)
+{
+    k_spinlock_key_t key = k_spin_lock(&ft->lock);
+
+    ft->active_count = 0;
+    ft->staged_count = 0;
+    k_spin_unlock(&ft->lock, key);
+}
+
+int sdn_flow_stage(struct sdn_flow_table *ft, uint8_t version, uint16_t src,
+                   uint8_t tclass, uint16_t next_hop, uint32_t lifetime_ms)
+{
+    int err = 0;
+    k_spinlock_key_t key = k_spin_lock(&ft->lock);
+
+    if (version != ft->staged_version) {
+        if (ft->staged_count) {
+            LOG_WRN("[SDN FLOW] v%u replaces unfinished v%u (%u rules)",
+                    version, ft->staged_version, ft->staged_count);
+        }
+        ft->staged_count = 0;
+        ft->staged_version = version;
+    }
+
+    int idx = rule_find(ft->staged, ft->staged_count, src, tclass);
+
+    if (idx < 0) {
+        if (ft->staged_count >= ARRAY_SIZE(ft->staged)) {
+            err = -ENOMEM;
+            goto out;
+        }
+        idx = ft->staged_count++;
+    }
+
+    ft->staged[idx].src = src;
+    ft->staged[idx].tclass = tclass;
+    ft->staged[idx].next_hop = next_hop;
+    ft->staged[idx].expiry = lifetime_ms;
+
+out:
+    k_spin_unlock(&ft->lock, key);
+    return err;
+}
+
+int sdn_flow_stage_default(struct sdn_flow_table *ft, uint16_t next_hop,
+                           uint32_t lifetime_ms)
+{
+    return sdn_flow_stage(ft, ft->staged_version, SDN_FLOW_SRC_ANY,
+                          SDN_FLOW_CLASS_ANY, next_hop, lifetime_ms);
+}
+
+int sdn_flow_commit(struct sdn_flow_table *ft)
+{
+    int64_t now = k_uptime_get();
+    int applied = 0;
+    k_spinlock_key_t key = k_spin_lock(&ft->lock);
+
+    for (int i = 0; i < ft->staged_count; i++) {
+        const struct sdn_flow_rule *s = &ft->staged[i];
+        int idx = rule_find(ft->active, ft->active_count, s->src, s->tclass);
+
+        if (s->next_hop == BT_MESH_ADDR_UNASSIGNED) {
+            if (idx >= 0) {
+                rule_remove(ft->active, &ft->active_count, idx);
+            }
+            applied++;
+            continue;
+        }
+        if (idx < 0) {
+            if (ft->active_count >= ARRAY_SIZE(ft->active)) {
+                LOG_WRN("[SDN FLOW] Table full, rule 0x%04x/%u dropped",
+                        s->src, s->tclass);
+                continue;
+            }
+            idx = ft->active_count++;
+        }
+
+        ft->active[idx] = *s;
+        ft->active[idx].expiry = now + s->expiry;
+        applied++;
+    }
+
+    if (ft->staged_count) {
+        ft->active_version = ft->staged_version;
+    }
+    ft->staged_count = 0;
+    k_spin_unlock(&ft->lock, key);
+
+    return applied;
+}
+
+uint16_t sdn_flow_lookup(struct sdn_flow_table *ft, uint16_t src, uint8_t tclass)
+{
+    int64_t now = k_uptime_get();
+    uint16_t next_hop = BT_MESH_ADDR_UNASSIGNED;
+    int best = -1;
+    k_spinlock_key_t key = k_spin_lock(&ft->lock);
+
+    for (int i = 0; i < ft->active_count; i++) {
+        if (now >= ft->active[i].expiry) {
+            LOG_DBG("[SDN FLOW] Rule 0x%04x/%u -> 0x%04x expired",
+                    ft->active[i].src, ft->active[i].tclass,
+                    ft->active[i].next_hop);
+            rule_remove(ft->active, &ft->active_count, i--);
+            continue;
+        }
+
+        int score = rule_score(&ft->active[i], src, tclass);
+
+        if (score > best) {
+            best = score;
+            next_hop = ft->active[i].next_hop;
+        }
+    }
+
+    k_spin_unlock(&ft->lock, key);
+    return next_hop;
+}
+
+int sdn_flow_snapshot(struct sdn_flow_table *ft, struct sdn_flow_rule *out,
+                      int max, uint8_t *version)
+{
+    int64_t now = k_uptime_get();
+    int n = 0;
+    k_spinlock_key_t key = k_spin_lock(&ft->lock);
+
+    for (int i = 0; i < ft->active_count && n < max; i++) {
+        if (now < ft->active[i].expiry) {
+            out[n] = ft->active[i];
+            out[n].expiry -= now;
+            n++;
+        }
+    }
+    if (version) {
+        *version = ft->active_version;
+    }
+
+    k_spin_unlock(&ft->lock, key);
+    return n;
+}
@@ -40,11 +40,13 @@
  *   - Hiển thị trạng thái heartbeat (active/inactive)
  */
 
+#include <limits.h>
 #include <stdlib.h>
 #include <zephyr/bluetooth/mesh.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
 
 
 #include "data_forward.h"
@@ -52,7 +54,10 @@
 #include "heartbeat.h"
 #include "model_handler.h"
 #include "packet_stats.h"
+#include "gtrace.h"
 #include "reverse_routing.h"
+#include "sink_ingest.h"
+#include "sink_frame.h"
 
 
 LOG_MODULE_REGISTER(shell_cmd, LOG_LEVEL_INF);
@@ -218,33 +223,40 @@ static int cmd_mesh_rrt(const struct shell *sh, size_t argc, char **argv) {
 
   int64_t now = k_uptime_get();
   int total_routes = 0;
+  int total_dests = 0;
 
   for (int i = 0; i < CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE; i++) {
     if (gradient_srv.forwarding_table[i].addr == BT_MESH_ADDR_UNASSIGNED) {
       continue;
     }
 
-    /* Đếm số destination của neighbor này */
-    int dest_count = 0;
-    struct backprop_node *node = gradient_srv.forwarding_table[i].backprop_dest;
-    while (node != NULL) {
-      dest_count++;
-      node = node->next;
-    }
+    /* Đếm số destination (địa chỉ) và số run của neighbor này */
+    size_t dest_count = rrt_get_dest_count(gradient_srv.forwarding_table,
+                                           CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE, i);
+    size_t run_count = rrt_get_run_count(gradient_srv.forwarding_table,
+                                         CONFIG_BT_MESH_GRADIENT_SRV_FORWARDING_TABLE_SIZE, i);
 
-    if (dest_count == 0) {
+    if (run_count == 0) {
       continue;
     }
 
-    shell_print(sh, "Nexthop 0x%04x (%d destinations):",
-                gradient_srv.forwarding_table[i].addr, dest_count);
+    shell_print(sh, "Nexthop 0x%04x (%d destinations, %d entries):",
+                gradient_srv.forwarding_table[i].addr, (int)dest_count,
+                (int)run_count);
 
-    /* In từng destination */
-    node = gradient_srv.forwarding_table[i].backprop_dest;
+    /* [UPD] In từng run [addr..hi]; entry "moved" ghi đè run của nexthop khác */
+    struct backprop_node *node = gradient_srv.forwarding_table[i].backprop_dest;
     while (node != NULL) {
       int64_t age_sec = (now - node->last_seen) / 1000;
-      shell_print(sh, "  -> dest=0x%04x (age=%lld sec)", node->addr, age_sec);
+      if (node->hi == node->addr) {
+        shell_print(sh, "  -> dest=0x%04x%s (age=%lld sec)", node->addr,
+                    node->moved ? " (moved)" : "", age_sec);
+      } else {
+        shell_print(sh, "  -> dest=0x%04x..0x%04x (age=%lld sec)", node->addr,
+                    node->hi, age_sec);
+      }
       total_routes++;
+      total_dests += node->hi - node->addr + 1;
       node = node->next;
     }
   }
@@ -254,7 +266,8 @@ static int cmd_mesh_rrt(const struct shell *sh, size_t argc, char **argv) {
     shell_print(sh, "Cho cac node gui heartbeat...");
   } else {
     shell_print(sh, "---");
-    shell_print(sh, "Tong: %d reverse routes", total_routes);
+    shell_print(sh, "Tong: %d destinations trong %d reverse route entries",
+                total_dests, total_routes);
   }
 
   /* FIX: Add Mutex Unlock */
@@ -300,9 +313,15 @@ static int cmd_mesh_dest(const struct shell *sh, size_t argc, char **argv) {
 
     struct backprop_node *node = gradient_srv.forwarding_table[i].backprop_dest;
     while (node != NULL) {
-      shell_print(sh, "  0x%04x  (via nexthop 0x%04x)", node->addr,
-                  gradient_srv.forwarding_table[i].addr);
-      count++;
+      if (node->hi == node->addr) {
+        shell_print(sh, "  0x%04x  (via nexthop 0x%04x)%s", node->addr,
+                    gradient_srv.forwarding_table[i].addr,
+                    node->moved ? " moved" : "");
+      } else {
+        shell_print(sh, "  0x%04x..0x%04x  (via nexthop 0x%04x)", node->addr,
+                    node->hi, gradient_srv.forwarding_table[i].addr);
+      }
+      count += node->hi - node->addr + 1;
       node = node->next;
     }
   }
@@ -363,7 +382,7 @@ static int cmd_mesh_sdn_reset(const struct shell *sh, size_t argc, char **argv)
   struct bt_mesh_msg_ctx ctx = {
       .app_idx = gradient_srv.model->keys[0],
       .addr = BT_MESH_ADDR_ALL_NODES,
-      .send_ttl = BT_MESH_TTL_DEFAULT,
+      .send_ttl = BT_MESH_GRADIENT_SRV_BCAST_TTL(BT_MESH_TTL_DEFAULT),
   };
 
   int err = bt_mesh_model_send(gradient_srv.model, &ctx, &msg, NULL, NULL);
@@ -377,6 +396,157 @@ static int cmd_mesh_sdn_reset(const struct shell *sh, size_t argc, char **argv)
   return 0;
 }
 
+/*============================================================================*/
+/*                         Command: mesh sdn_flow / sdn_flows                 */
+/*============================================================================*/
+
+/**
+ * @brief [NEW] Cài luật flow SDN cho một node (staged, commit theo TOPO_REQ)
+ *
+ * Lệnh: mesh sdn_flow <dest> <version> <src:class:nexthop[:min]> [...]
+ *
+ * Tham số:
+ *   - src:     Nguồn gốc gói tin (hexa), 0 = mọi nguồn
+ *   - class:   0 = mọi loại, 1 = DATA, 2 = SENSOR, 3 = TOPO/REPORT
+ *   - nexthop: Hàng xóm chuyển tiếp (hexa), 0 = xóa luật
+ *   - min:     Thời gian sống (phút), bỏ trống = mặc định
+ */
+static int cmd_mesh_sdn_flow(const struct shell *sh, size_t argc, char **argv) {
+  struct sdn_flow_rule rules[BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES];
+  uint8_t count = argc - 3;
+  char *endptr;
+
+  if (!check_provisioned(sh)) {
+    return -EAGAIN;
+  }
+
+  if (gradient_srv.gradient != 0) {
+    shell_error(sh, "Chi node GATEWAY moi co the cai luat SDN!");
+    return -EACCES;
+  }
+
+  unsigned long dest = strtoul(argv[1], &endptr, 16);
+  if (*endptr != '\0' || dest == 0 || dest > 0x7FFF) {
+    shell_error(sh, "Dia chi khong hop le: %s", argv[1]);
+    return -EINVAL;
+  }
+
+  unsigned long version = strtoul(argv[2], &endptr, 0);
+  if (*endptr != '\0' || version > UINT8_MAX) {
+    shell_error(sh, "Version khong hop le: %s", argv[2]);
+    return -EINVAL;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    const char *arg = argv[3 + i];
+    unsigned long src = strtoul(arg, &endptr, 16);
+    unsigned long tclass = (*endptr == ':') ? strtoul(endptr + 1, &endptr, 0) : ULONG_MAX;
+    unsigned long nexthop = (*endptr == ':') ? strtoul(endptr + 1, &endptr, 16) : ULONG_MAX;
+    unsigned long life_min = (*endptr == ':') ? strtoul(endptr + 1, &endptr, 0) : 0;
+
+    if (*endptr != '\0' || src > 0x7FFF || tclass > SDN_FLOW_CLASS_MAX ||
+        nexthop > 0x7FFF || life_min > UINT8_MAX) {
+      shell_error(sh, "Luat khong hop le: %s", arg);
+      return -EINVAL;
+    }
+    rules[i].src = (uint16_t)src;
+    rules[i].tclass = (uint8_t)tclass;
+    rules[i].next_hop = (uint16_t)nexthop;
+    rules[i].expiry = (int64_t)life_min * 60 * 1000;
+  }
+
+  int err = bt_mesh_gradient_srv_sdn_flow_send(&gradient_srv, (uint16_t)dest,
+                                               (uint8_t)version, rules, count);
+  if (err == -ENETUNREACH) {
+    shell_error(sh, "Khong tim thay route den 0x%04lx!", dest);
+  } else if (err) {
+    shell_error(sh, "Gui that bai, err=%d", err);
+  } else {
+    shell_print(sh, "Da gui %u luat SDN v%lu den 0x%04lx (cho COMMIT)", count,
+                version, dest);
+  }
+  return err;
+}
+
+/**
+ * @brief [NEW] In bảng flow SDN đang áp dụng trên node này
+ *
+ * Lệnh: mesh sdn_flows
+ */
+static int cmd_mesh_sdn_flows(const struct shell *sh, size_t argc, char **argv) {
+  struct sdn_flow_rule rules[CONFIG_BT_MESH_GRADIENT_SDN_FLOW_TABLE_SIZE];
+  uint8_t version;
+
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  int n = sdn_flow_snapshot(&gradient_srv.sdn_flows, rules, ARRAY_SIZE(rules),
+                            &version);
+
+  shell_print(sh, "SDN flow table v%u: %d luat (staged: %u)", version, n,
+              gradient_srv.sdn_flows.staged_count);
+  for (int i = 0; i < n; i++) {
+    shell_print(sh, "  src=0x%04x class=%u -> 0x%04x  con %llds", rules[i].src,
+                rules[i].tclass, rules[i].next_hop, rules[i].expiry / 1000);
+  }
+  return 0;
+}
+
+/*============================================================================*/
+/*                         Command: mesh ingest                               */
+/*============================================================================*/
+
+/**
+ * @brief [NEW] Thống kê hàng đợi ingest của Sink (UART output)
+ *
+ * Lệnh: mesh ingest
+ */
+static int cmd_mesh_ingest(const struct shell *sh, size_t argc, char **argv) {
+  struct sink_ingest_stats st;
+
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  sink_ingest_get_stats(&st);
+  shell_print(sh, "Sink ingest: queued=%u dropped=%u max_depth=%u", st.queued,
+              st.dropped, st.max_depth);
+  if (!IS_ENABLED(CONFIG_BT_MESH_GRADIENT_SINK_INGEST)) {
+    shell_print(sh, "(ingest thread tat - in truc tiep trong RX)");
+  }
+  return 0;
+}
+
+/*============================================================================*/
+/*                         Command: mesh uart_mode                            */
+/*============================================================================*/
+
+/**
+ * @brief [NEW] Chọn định dạng UART của Sink: text (CSV_LOG/$[TOPO]) hoặc
+ *        frame nhị phân COBS + CRC16 (sink_frame.h)
+ *
+ * Lệnh: mesh uart_mode [text|bin]
+ */
+static int cmd_mesh_uart_mode(const struct shell *sh, size_t argc, char **argv) {
+  if (argc > 1) {
+    if (strcmp(argv[1], "bin") == 0) {
+      sink_frame_set_binary(true);
+    } else if (strcmp(argv[1], "text") == 0) {
+      sink_frame_set_binary(false);
+    } else {
+      shell_error(sh, "Usage: mesh uart_mode [text|bin]");
+      return -EINVAL;
+    }
+  }
+
+  uint32_t frames, bytes;
+
+  sink_frame_get_stats(&frames, &bytes);
+  shell_print(sh, "Sink UART: %s (v%u), frames=%u bytes=%u",
+              sink_frame_binary() ? "bin" : "text", SINK_FRAME_VERSION, frames,
+              bytes);
+  return 0;
+}
+
 /*============================================================================*/
 /*                         Command: mesh backprop                             */
 /*============================================================================*/
@@ -452,6 +622,138 @@ static int cmd_mesh_backprop(const struct shell *sh, size_t argc, char **argv) {
   return err;
 }
 
+/*============================================================================*/
+/*                         Command: mesh backprop_multi                       */
+/*============================================================================*/
+
+/**
+ * @brief [NEW] Gửi nhiều lệnh BACKPROP trong một bản tin, tách tại nhánh
+ *
+ * Lệnh: mesh backprop_multi <dest:payload> [dest:payload ...]
+ *
+ * Tham số:
+ *   - dest:    Địa chỉ đích (hexa)
+ *   - payload: Dữ liệu (hex 0x.. hoặc decimal)
+ *
+ * Lưu ý:
+ *   - Mỗi relay chia các bản ghi theo nexthop trong RRT, mỗi nhánh 1 bản tin
+ */
+static int cmd_mesh_backprop_multi(const struct shell *sh, size_t argc,
+                                   char **argv) {
+  struct bt_mesh_gradient_srv_bp_rec recs[CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX];
+  uint8_t count = argc - 1;
+  char *endptr;
+
+  if (!check_provisioned(sh)) {
+    return -ENOEXEC;
+  }
+
+  if (gradient_srv.gradient != 0) {
+    shell_error(sh, "Chi Gateway (gradient=0) moi co the gui BACKPROP!");
+    return -ENOEXEC;
+  }
+
+  if (count > ARRAY_SIZE(recs)) {
+    shell_error(sh, "Toi da %d ban ghi", (int)ARRAY_SIZE(recs));
+    return -EINVAL;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    unsigned long dest = strtoul(argv[1 + i], &endptr, 16);
+    if (*endptr != ':' || dest == 0 || dest > 0x7FFF) {
+      shell_error(sh, "Ban ghi khong hop le: %s", argv[1 + i]);
+      return -EINVAL;
+    }
+    unsigned long payload = strtoul(endptr + 1, &endptr, 0);
+    if (*endptr != '\0' || payload > 0xFFFF) {
+      shell_error(sh, "Payload khong hop le: %s", argv[1 + i]);
+      return -EINVAL;
+    }
+    recs[i].dest = (uint16_t)dest;
+    recs[i].payload = (uint16_t)payload;
+  }
+
+  int err = bt_mesh_gradient_srv_backprop_send_multi(&gradient_srv, recs, count);
+
+  if (err == 0) {
+    shell_print(sh, "BACKPROP_MULTI da gui (%u ban ghi)", count);
+  } else if (err == -ENETUNREACH) {
+    shell_error(sh, "Khong co route cho ban ghi nao!");
+  } else {
+    shell_error(sh, "Gui that bai, err=%d", err);
+  }
+
+  return err;
+}
+
+/*============================================================================*/
+/*                         Command: mesh backprop_sr                          */
+/*============================================================================*/
+
+/**
+ * @brief [NEW] Gửi BACKPROP theo source route do Gateway tính sẵn
+ *
+ * Lệnh: mesh backprop_sr <dest_addr> <payload> [hop1 hop2 ...]
+ *
+ * Tham số:
+ *   - hop1..hopN: Các relay từ phía Sink đến đích (hexa, không gồm đích)
+ *                 Không có hop = đích là hàng xóm trực tiếp của Sink
+ *
+ * Lưu ý:
+ *   - Relay không tra RRT, chỉ lấy hop kế tiếp trong danh sách
+ *   - Hop đầu không còn là hàng xóm -> tự chuyển sang BACKPROP thường (RRT)
+ */
+static int cmd_mesh_backprop_sr(const struct shell *sh, size_t argc,
+                                char **argv) {
+  uint16_t hops[CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS];
+  uint8_t hop_count = argc - 3;
+  char *endptr;
+
+  if (!check_provisioned(sh)) {
+    return -ENOEXEC;
+  }
+
+  if (gradient_srv.gradient != 0) {
+    shell_error(sh, "Chi Gateway (gradient=0) moi co the gui BACKPROP!");
+    return -ENOEXEC;
+  }
+
+  unsigned long dest_addr = strtoul(argv[1], &endptr, 16);
+  if (*endptr != '\0' || dest_addr > 0xFFFF) {
+    shell_error(sh, "Dia chi khong hop le: %s", argv[1]);
+    return -EINVAL;
+  }
+
+  unsigned long payload = strtoul(argv[2], &endptr, 0);
+  if (*endptr != '\0' || payload > 0xFFFF) {
+    shell_error(sh, "Payload khong hop le: %s", argv[2]);
+    return -EINVAL;
+  }
+
+  for (uint8_t i = 0; i < hop_count; i++) {
+    unsigned long hop = strtoul(argv[3 + i], &endptr, 16);
+    if (*endptr != '\0' || hop == 0 || hop > 0x7FFF) {
+      shell_error(sh, "Hop khong hop le: %s", argv[3 + i]);
+      return -EINVAL;
+    }
+    hops[i] = (uint16_t)hop;
+  }
+
+  int err = bt_mesh_gradient_srv_backprop_send_sr(
+      &gradient_srv, (uint16_t)dest_addr, (uint16_t)payload, hops, hop_count);
+
+  if (err == 0) {
+    shell_print(sh, "BACKPROP_SR da gui den 0x%04x (%u hop)",
+                (uint16_t)dest_addr, hop_count + 1);
+  } else if (err == -ENETUNREACH) {
+    shell_error(sh, "Khong tim thay route den 0x%04x!", (uint16_t)dest_addr);
+  } else {
+    shell_error(sh, "Gui that bai, err=%d", err);
+  }
+
+  return err;
+}
+
 /*============================================================================*/
 /*                         Command: mesh data                                 */
 /*============================================================================*/
@@ -794,11 +1096,40 @@ static int cmd_mesh_stats_show(const struct shell *sh, size_t argc,
     shell_print(sh, "Control Overhead: N/A (chua co goi tin)");
   }
 
+  shell_print(sh, "PONG timeout    : %u", stats.pong_timeouts);
+  shell_print(sh, "Epoch / Uptime  : %u / %u s", stats.epoch, stats.since_reset_s);
   shell_print(sh, "===========================");
 
   return 0;
 }
 
+/**
+ * @brief In snapshot nhị phân (giống payload REPORT_RSP) dạng hex
+ *
+ * Lệnh: mesh stats snapshot
+ *
+ * Một dòng CSV_LOG,STATS_BIN chứa toàn bộ counters + phân vị độ trễ,
+ * nhất quán tại một thời điểm (seqlock).
+ */
+static int cmd_mesh_stats_snapshot(const struct shell *sh, size_t argc,
+                                   char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  NET_BUF_SIMPLE_DEFINE(snap, PKT_STATS_SNAPSHOT_MAX_LEN);
+  char hex[2 * PKT_STATS_SNAPSHOT_MAX_LEN + 1];
+
+  if (pkt_stats_snapshot_encode(&snap)) {
+    shell_error(sh, "Loi: khong ma hoa duoc snapshot");
+    return -ENOBUFS;
+  }
+
+  bin2hex(snap.data, snap.len, hex, sizeof(hex));
+  shell_print(sh, "CSV_LOG,STATS_BIN,0x%04x,%s", get_my_addr(), hex);
+
+  return 0;
+}
+
 /**
  * @brief Reset tất cả counters về 0
  *
@@ -815,11 +1146,60 @@ static int cmd_mesh_stats_reset(const struct shell *sh, size_t argc,
   return 0;
 }
 
+/**
+ * @brief Hiển thị phân vị độ trễ (p50/p90/p99) từ histogram
+ *
+ * Lệnh: mesh stats latency
+ *
+ * Ngoài bảng cho người đọc, in thêm dòng CSV_LOG,LATENCY cùng định dạng
+ * với Sink để Gateway có thể thu trực tiếp qua UART.
+ */
+static int cmd_mesh_stats_latency(const struct shell *sh, size_t argc,
+                                  char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  struct pkt_lat_summary lat[PKT_LAT_MAX_SUMMARIES];
+  uint8_t n = pkt_stats_get_latency_summary(lat, PKT_LAT_MAX_SUMMARIES);
+  uint16_t my_addr = get_my_addr();
+
+  shell_print(sh, "");
+  shell_print(sh, "=== Do Tre (ms) ===");
+  shell_print(sh, "Metric        Hops  Count    p50    p90    p99    max");
+
+  for (int i = 0; i < n; i++) {
+    shell_print(sh, "%-13s %4u %6u %6u %6u %6u %6u",
+                pkt_stats_lat_metric_str(lat[i].metric), lat[i].hops,
+                lat[i].count, lat[i].p50_ms, lat[i].p90_ms, lat[i].p99_ms,
+                lat[i].max_ms);
+  }
+  if (n == 0) {
+    shell_print(sh, "(chua co mau nao)");
+  }
+  shell_print(sh, "PONG timeout    : %u", pkt_stats_get_pong_timeouts());
+  shell_print(sh, "===================");
+
+  for (int i = 0; i < n; i++) {
+    printk("CSV_LOG,LATENCY,0x%04x,%s,%u,%u,%u,%u,%u,%u\n", my_addr,
+           pkt_stats_lat_metric_str(lat[i].metric), lat[i].hops,
+           lat[i].count, lat[i].p50_ms, lat[i].p90_ms, lat[i].p99_ms,
+           lat[i].max_ms);
+  }
+
+  return 0;
+}
+
 /* Subcommands for stats */
 SHELL_STATIC_SUBCMD_SET_CREATE(stats_subcmds,
                                SHELL_CMD_ARG(reset, NULL,
                                              "Reset tat ca counters ve 0",
                                              cmd_mesh_stats_reset, 1, 0),
+                               SHELL_CMD_ARG(latency, NULL,
+                                             "Phan vi do tre p50/p90/p99",
+                                             cmd_mesh_stats_latency, 1, 0),
+                               SHELL_CMD_ARG(snapshot, NULL,
+                                             "Snapshot nhi phan (hex) cua stats",
+                                             cmd_mesh_stats_snapshot, 1, 0),
                                SHELL_SUBCMD_SET_END);
 
 /*============================================================================*/
@@ -829,7 +1209,11 @@ SHELL_STATIC_SUBCMD_SET_CREATE(stats_subcmds,
 /**
  * @brief Yêu cầu tất cả Sensor gửi báo cáo Topology & Piggyback Commit flag
  *
- * Lệnh: mesh topo_req [commit_flag]
+ * Lệnh: mesh topo_req [commit_flag] [full | <addr> ...]
+ *
+ * Mặc định node trả về Delta (chỉ neighbor thay đổi). "full" bắt mọi node
+ * gửi snapshot đầy đủ; danh sách <addr> (tối đa 8) chỉ bắt các node đó
+ * resync (Gateway phát hiện lệch version).
  */
 static int cmd_mesh_topo_req(const struct shell *sh, size_t argc, char **argv) {
   if (!check_provisioned(sh)) {
@@ -842,19 +1226,78 @@ static int cmd_mesh_topo_req(const struct shell *sh, size_t argc, char **argv) {
   }
 
   bool commit_flag = false;
-  if (argc == 2) {
+  if (argc >= 2) {
       commit_flag = (atoi(argv[1]) != 0);
   }
 
-  int err = bt_mesh_gradient_srv_send_topo_req(&gradient_srv, commit_flag);
+  uint16_t resync[TOPO_REQ_MAX_RESYNC];
+  uint8_t resync_count = 0;
+
+  if (argc >= 3 && strcmp(argv[2], "full") == 0) {
+    resync_count = TOPO_REQ_RESYNC_ALL;
+  } else {
+    for (size_t i = 2; i < argc && resync_count < TOPO_REQ_MAX_RESYNC; i++) {
+      resync[resync_count++] = (uint16_t)strtol(argv[i], NULL, 16);
+    }
+  }
+
+  int err = bt_mesh_gradient_srv_send_topo_req(&gradient_srv, commit_flag,
+                                               resync, resync_count);
   if (!err) {
-    shell_print(sh, "Da phat Broadcast TOPO_REQ (Commit=%d)! Cho 8-10 giay...", commit_flag);
+    /* Wave round, or the worst-case random jitter without a wave */
+    uint32_t round_ms = bt_mesh_gradient_srv_wave_round_ms(&gradient_srv.wave_cfg);
+
+    shell_print(sh, "Da phat Broadcast TOPO_REQ (Commit=%d, Resync=%s)! Cho %u ms...",
+                commit_flag,
+                resync_count == TOPO_REQ_RESYNC_ALL ? "all" :
+                resync_count ? "list" : "none",
+                round_ms ? round_ms : 8000);
   } else {
     shell_error(sh, "Gui that bai, err=%d", err);
   }
   return err;
 }
 
+/*============================================================================*/
+/*                         Command: mesh wave                                 */
+/*============================================================================*/
+
+/**
+ * @brief Xem / đặt lịch trả lời (collection wave) cho TOPO_REQ và REPORT_REQ
+ *
+ * Lệnh: mesh wave [slot_ms levels slots_per_level]
+ *
+ * Node trả lời theo slot: gradient sâu nhất trước, trong cùng level theo
+ * hash địa chỉ. slots_per_level = 0 tắt wave (quay về jitter ngẫu nhiên).
+ */
+static int cmd_mesh_wave(const struct shell *sh, size_t argc, char **argv) {
+  struct collect_wave *w = &gradient_srv.wave_cfg;
+
+  if (argc == 4) {
+    long slot_ms = strtol(argv[1], NULL, 10);
+    long levels = strtol(argv[2], NULL, 10);
+    long slots = strtol(argv[3], NULL, 10);
+
+    if (slot_ms < COLLECT_WAVE_SLOT_UNIT_MS ||
+        slot_ms > 255 * COLLECT_WAVE_SLOT_UNIT_MS ||
+        levels < 1 || levels > 15 || slots < 0 || slots > 64) {
+      shell_error(sh, "slot_ms 10-2550, levels 1-15, slots_per_level 0-64");
+      return -EINVAL;
+    }
+    w->slot_units = DIV_ROUND_UP(slot_ms, COLLECT_WAVE_SLOT_UNIT_MS);
+    w->levels = levels;
+    w->slots_per_level = slots;
+  } else if (argc != 1) {
+    shell_error(sh, "Su dung: mesh wave [slot_ms levels slots_per_level]");
+    return -EINVAL;
+  }
+
+  shell_print(sh, "Wave: slot=%u ms, levels=%u, slots/level=%u, round=%u ms",
+              w->slot_units * COLLECT_WAVE_SLOT_UNIT_MS, w->levels,
+              w->slots_per_level, bt_mesh_gradient_srv_wave_round_ms(w));
+  return 0;
+}
+
 /*============================================================================*/
 /*                         Command: mesh attention                            */
 /*============================================================================*/
@@ -956,7 +1399,7 @@ static int cmd_mesh_backprop_broadcast(const struct shell *sh, size_t argc, char
   struct bt_mesh_msg_ctx ctx = {
       .app_idx = gradient_srv.model->keys[0],
       .addr = BT_MESH_ADDR_ALL_NODES,
-      .send_ttl = BT_MESH_TTL_DEFAULT,
+      .send_ttl = BT_MESH_GRADIENT_SRV_BCAST_TTL(BT_MESH_TTL_DEFAULT),
   };
 
   LOG_INF(">>> Pushing Hybrid Broadcast Bundle %d <<<", bundle_id);
@@ -969,6 +1412,198 @@ static int cmd_mesh_backprop_broadcast(const struct shell *sh, size_t argc, char
   return err;
 }
 
+/*============================================================================*/
+/*                         Command: mesh trace                                */
+/*============================================================================*/
+
+/** Số record mỗi dòng $[TRACE] (8 x 12 bytes = 192 ký tự hex) */
+#define TRACE_RECS_PER_LINE 8
+
+/**
+ * @brief Trạng thái bộ ghi trace nhị phân
+ *
+ * Lệnh: mesh trace
+ */
+static int cmd_mesh_trace_show(const struct shell *sh, size_t argc,
+                               char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  if (!IS_ENABLED(CONFIG_BT_MESH_GRADIENT_SRV_TRACE)) {
+    shell_warn(sh, "Trace bi tat (CONFIG_BT_MESH_GRADIENT_SRV_TRACE=n)");
+    return 0;
+  }
+
+  shell_print(sh, "Trace     : %s", gtrace_is_enabled() ? "ON" : "OFF");
+  shell_print(sh, "Records   : %u", (uint32_t)gtrace_count());
+  shell_print(sh, "Overruns  : %u", gtrace_overruns());
+  shell_print(sh, "Clock     : %u Hz", gtrace_clock_hz());
+
+  return 0;
+}
+
+/**
+ * @brief Xuất (và xoá) các record trong ring dưới dạng hex
+ *
+ * Lệnh: mesh trace dump [max_records]
+ *
+ * Định dạng (giải mã bằng DataLogging/trace_decode.py):
+ *   $[TRACE_HDR],<version>,<addr>,<clock_hz>,<count>,<overruns>
+ *   $[TRACE],<hex 12 bytes/record>...
+ *   $[TRACE_END],<records_dumped>
+ */
+static int cmd_mesh_trace_dump(const struct shell *sh, size_t argc,
+                               char **argv) {
+  size_t remaining = gtrace_count();
+  size_t dumped = 0;
+
+  if (argc > 1) {
+    remaining = MIN(remaining, strtoul(argv[1], NULL, 0));
+  }
+
+  shell_print(sh, "$[TRACE_HDR],%u,0x%04x,%u,%u,%u", GTRACE_FORMAT_VERSION,
+              get_my_addr(), gtrace_clock_hz(), (uint32_t)remaining,
+              gtrace_overruns());
+
+  while (remaining > 0) {
+    struct gtrace_rec recs[TRACE_RECS_PER_LINE];
+    char hex[sizeof(recs) * 2 + 1];
+    size_t n = gtrace_drain(recs, MIN(remaining, TRACE_RECS_PER_LINE));
+
+    if (n == 0) {
+      break;
+    }
+    bin2hex((const uint8_t *)recs, n * sizeof(recs[0]), hex, sizeof(hex));
+    shell_print(sh, "$[TRACE],%s", hex);
+    remaining -= n;
+    dumped += n;
+  }
+
+  shell_print(sh, "$[TRACE_END],%u", (uint32_t)dumped);
+  return 0;
+}
+
+static int cmd_mesh_trace_clear(const struct shell *sh, size_t argc,
+                                char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  gtrace_clear();
+  shell_print(sh, "Da xoa trace ring.");
+  return 0;
+}
+
+static int cmd_mesh_trace_on(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  gtrace_set_enabled(true);
+  shell_print(sh, "Trace: ON");
+  return 0;
+}
+
+static int cmd_mesh_trace_off(const struct shell *sh, size_t argc,
+                              char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  gtrace_set_enabled(false);
+  shell_print(sh, "Trace: OFF");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(trace_subcmds,
+                               SHELL_CMD_ARG(dump, NULL,
+                                             "Xuat trace hex: dump [max]",
+                                             cmd_mesh_trace_dump, 1, 1),
+                               SHELL_CMD_ARG(clear, NULL, "Xoa trace ring",
+                                             cmd_mesh_trace_clear, 1, 0),
+                               SHELL_CMD_ARG(on, NULL, "Bat ghi trace",
+                                             cmd_mesh_trace_on, 1, 0),
+                               SHELL_CMD_ARG(off, NULL, "Tat ghi trace",
+                                             cmd_mesh_trace_off, 1, 0),
+                               SHELL_SUBCMD_SET_END);
+
+/*============================================================================*/
+/*                         Command: mesh rpc                                  */
+/*============================================================================*/
+
+/**
+ * Lệnh Gateway được phép gọi qua RPC, cùng giới hạn tham số như khi đăng ký
+ * trong mesh_cmds (shell chỉ kiểm tra số tham số của chính "rpc").
+ */
+struct rpc_cmd {
+  const char *name;
+  shell_cmd_handler handler;
+  uint8_t mand;
+  uint8_t opt;
+};
+
+static const struct rpc_cmd rpc_cmds[] = {
+    {"backprop", cmd_mesh_backprop, 3, 0},
+    {"backprop_multi", cmd_mesh_backprop_multi, 2,
+     CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX - 1},
+    {"backprop_sr", cmd_mesh_backprop_sr, 3, CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS},
+    {"backprop_broadcast", cmd_mesh_backprop_broadcast, 2, 0},
+    {"sdn_flow", cmd_mesh_sdn_flow, 4, BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES - 1},
+    {"sdn_reset", cmd_mesh_sdn_reset, 1, 0},
+    {"topo_req", cmd_mesh_topo_req, 1, 1 + TOPO_REQ_MAX_RESYNC},
+    {"wave", cmd_mesh_wave, 1, 3},
+    {"attention", cmd_mesh_attention, 2, 0},
+    {"sensor_interval", cmd_mesh_sensor_interval, 3, 0},
+    {"sensor_interval_all", cmd_mesh_sensor_interval_all, 2, 0},
+    {"uart_mode", cmd_mesh_uart_mode, 1, 1},
+};
+
+/**
+ * @brief [NEW] Gọi một lệnh mesh có mã yêu cầu, trả về trạng thái tường minh
+ *
+ * Lệnh: mesh rpc <id> <cmd> [args...]
+ *
+ * Chạy lệnh con như "mesh <cmd> [args...]" rồi in "$[RSP],<id>,<status>"
+ * (hoặc record SINK_FRAME_RSP ở chế độ nhị phân). status = giá trị trả về
+ * của lệnh: 0 khi bản tin đã vào hàng đợi mesh (bt_mesh_model_send), -ENOBUFS
+ * khi hàng đợi đầy (Gateway gửi lại), lỗi khác là từ chối hẳn. Mỗi lệnh chỉ
+ * xếp hàng rồi trả về, nên Gateway giữ được nhiều yêu cầu cùng lúc và ghép
+ * phản hồi theo id.
+ */
+static int cmd_mesh_rpc(const struct shell *sh, size_t argc, char **argv) {
+  char *endptr;
+  unsigned long id = strtoul(argv[1], &endptr, 10);
+  int status = -ENOENT;
+
+  if (*endptr != '\0' || id > UINT16_MAX) {
+    shell_error(sh, "RPC id khong hop le: %s", argv[1]);
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(rpc_cmds); i++) {
+    const struct rpc_cmd *rc = &rpc_cmds[i];
+
+    if (strcmp(argv[2], rc->name) != 0) {
+      continue;
+    }
+    /* argv[2..] nhìn như "mesh <cmd> [args...]" với lệnh con */
+    if (argc - 2 < rc->mand || argc - 2 > rc->mand + rc->opt) {
+      status = -EINVAL;
+    } else {
+      status = rc->handler(sh, argc - 2, &argv[2]);
+    }
+    break;
+  }
+
+  if (sink_frame_binary()) {
+    uint8_t body[4];
+
+    sys_put_le16((uint16_t)id, &body[0]);
+    sys_put_le16((uint16_t)(int16_t)status, &body[2]);
+    (void)sink_frame_send(SINK_FRAME_RSP, body, sizeof(body));
+  } else {
+    printk("$[RSP],%lu,%d\n", id, status);
+  }
+  return 0;
+}
+
 /*============================================================================*/
 /*                         Shell Command Registration                         */
 /*============================================================================*/
@@ -998,6 +1633,20 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
                   "  Vi du: mesh backprop 0x0003 123",
                   cmd_mesh_backprop, 3, 0),
 
+    SHELL_CMD_ARG(backprop_multi, NULL,
+                  "Gui nhieu BACKPROP trong 1 ban tin: "
+                  "mesh backprop_multi <dest:payload> [dest:payload ...]\n"
+                  "  Vi du: mesh backprop_multi 0003:32773 0007:32770",
+                  cmd_mesh_backprop_multi, 2,
+                  CONFIG_BT_MESH_GRADIENT_SRV_BACKPROP_MULTI_MAX - 1),
+
+    SHELL_CMD_ARG(backprop_sr, NULL,
+                  "Gui BACKPROP theo source route: "
+                  "mesh backprop_sr <dest_addr> <payload> [hop1 hop2 ...]\n"
+                  "  Vi du: mesh backprop_sr 0x0007 123 0005",
+                  cmd_mesh_backprop_sr, 3,
+                  CONFIG_BT_MESH_GRADIENT_SRV_SR_MAX_HOPS),
+
     SHELL_CMD_ARG(attention, NULL,
                   "Bat Attention Mode: mesh attention <dest_addr>\n"
                   "  Vi du: mesh attention 0x0003",
@@ -1030,21 +1679,45 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
                   cmd_mesh_stress_dl, 2, 0),
 
     SHELL_CMD(stats, &stats_subcmds,
-              "Thong ke goi tin TX (mesh stats | mesh stats reset)",
+              "Thong ke goi tin TX (mesh stats | reset | latency | snapshot)",
               cmd_mesh_stats_show),
 
     SHELL_CMD_ARG(topo_req, NULL,
-                  "Yeu cau Sensor bao cao Topology: mesh topo_req [commit_flag]",
-                  cmd_mesh_topo_req, 1, 1),
+                  "Yeu cau Sensor bao cao Topology: mesh topo_req [commit_flag] [full|addr...]",
+                  cmd_mesh_topo_req, 1, 1 + TOPO_REQ_MAX_RESYNC),
+    SHELL_CMD_ARG(wave, NULL,
+                  "Lich tra loi TOPO/REPORT: mesh wave [slot_ms levels slots_per_level]",
+                  cmd_mesh_wave, 1, 3),
 
     SHELL_CMD_ARG(backprop_broadcast, NULL,
                   "Push Broadcast: mesh backprop_broadcast <hex>\n",
                   cmd_mesh_backprop_broadcast, 2, 0),
 
+    SHELL_CMD_ARG(sdn_flow, NULL,
+                  "Cai luat flow SDN: mesh sdn_flow <dest> <version> "
+                  "<src:class:nexthop[:min]> [...]\n"
+                  "  class: 0=moi loai 1=DATA 2=SENSOR 3=TOPO/REPORT",
+                  cmd_mesh_sdn_flow, 4,
+                  BT_MESH_GRADIENT_SRV_SDN_FLOW_MAX_RULES - 1),
+    SHELL_CMD_ARG(sdn_flows, NULL, "In bang flow SDN cua node nay",
+                  cmd_mesh_sdn_flows, 1, 0),
+    SHELL_CMD_ARG(ingest, NULL, "Thong ke hang doi ingest cua Sink (dropped)",
+                  cmd_mesh_ingest, 1, 0),
+    SHELL_CMD_ARG(uart_mode, NULL, "Dinh dang UART cua Sink: mesh uart_mode [text|bin]",
+                  cmd_mesh_uart_mode, 1, 1),
     SHELL_CMD_ARG(sdn_reset, NULL, 
                   "Gui lenh RESET SDN cho toan mang (Chi Gateway)",
                   cmd_mesh_sdn_reset, 1, 0),
 
+    SHELL_CMD_ARG(rpc, NULL,
+                  "Goi lenh co ma yeu cau (Gateway): mesh rpc <id> <cmd> [args...]\n"
+                  "  Tra loi: $[RSP],<id>,<status>",
+                  cmd_mesh_rpc, 3, SHELL_OPT_ARG_MAX),
+
+    SHELL_CMD(trace, &trace_subcmds,
+              "Trace nhi phan (mesh trace | dump [max] | clear | on | off)",
+              cmd_mesh_trace_show),
+
     SHELL_SUBCMD_SET_END);
 
 /**
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file sink_frame.c
+ * @brief COBS + CRC16 framing of Sink records on the console UART
+ */
+
+#include "sink_frame.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(sink_frame, LOG_LEVEL_INF);
+
+/* Ver + Type + Body + CRC */
+#define FRAME_RAW_MAX   (2 + SINK_FRAME_BODY_MAX + 2)
+/* COBS adds one byte per 254 plus the leading code; two delimiters */
+#define FRAME_ENC_MAX   (FRAME_RAW_MAX + FRAME_RAW_MAX / 254 + 1 + 2)
+
+static const struct device *const console_dev =
+    DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+
+static atomic_t binary_mode =
+    ATOMIC_INIT(IS_ENABLED(CONFIG_BT_MESH_GRADIENT_SINK_UART_BINARY));
+
+static K_MUTEX_DEFINE(frame_lock);
+
+/* Encode buffers are shared: callers are serialised by frame_lock */
+static uint8_t raw_buf[FRAME_RAW_MAX];
+static uint8_t enc_buf[FRAME_ENC_MAX];
+
+static uint32_t frames_sent;
+static uint32_t bytes_sent;
+
+/*============================================================================*/
+/* Private Functions                                                          */
+/*============================================================================*/
+
+/** CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection */
+static uint16_t frame_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS-encode @p len bytes of @p in to @p out (no delimiters)
+ * @return encoded length
+ */
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_idx = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[o++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_idx] = code;
+            code_idx = o++;
+            code = 1;
+        }
+    }
+    out[code_idx] = code;
+    return o;
+}
+
+/*============================================================================*/
+/* Public Functions                                                           */
+/*============================================================================*/
+
+bool sink_frame_binary(void)
+{
+    return atomic_get(&binary_mode) != 0;
+}
+
+void sink_frame_set_binary(bool binary)
+{
+    atomic_set(&binary_mode, binary ? 1 : 0);
+}
+
+int sink_frame_send(uint8_t type, const uint8_t *body, size_t len)
+{
+    if (len > SINK_FRAME_BODY_MAX) {
+        return -EMSGSIZE;
+    }
+    if (!device_is_ready(console_dev)) {
+        return -ENODEV;
+    }
+
+    k_mutex_lock(&frame_lock, K_FOREVER);
+
+    raw_buf[0] = SINK_FRAME_VERSION;
+    raw_buf[1] = type;
+    memcpy(&raw_buf[2], body, len);
+
+    uint16_t crc = frame_crc16(raw_buf, 2 + len);
+
+    raw_buf[2 + len] = crc & 0xFF;
+    raw_buf[3 + len] = crc >> 8;
+
+    size_t enc_len = cobs_encode(raw_buf, len + 4, &enc_buf[1]);
+
+    enc_buf[0] = 0x00;
+    enc_buf[enc_len + 1] = 0x00;
+    enc_len += 2;
+
+    for (size_t i = 0; i < enc_len; i++) {
+        uart_poll_out(console_dev, enc_buf[i]);
+    }
+
+    frames_sent++;
+    bytes_sent += enc_len;
+    k_mutex_unlock(&frame_lock);
+
+    return 0;
+}
+
+void sink_frame_get_stats(uint32_t *frames, uint32_t *bytes)
+{
+    k_mutex_lock(&frame_lock, K_FOREVER);
+    *frames = frames_sent;
+    *bytes = bytes_sent;
+    k_mutex_unlock(&frame_lock);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file sink_ingest.c
+ * @brief Lock-free SPSC ring + ingest thread for Sink output
+ */
+
+#include "sink_ingest.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+
+LOG_MODULE_REGISTER(sink_ingest, LOG_LEVEL_INF);
+
+/*============================================================================*/
+/* Private Data                                                               */
+/*============================================================================*/
+
+static sink_ingest_handler_t ingest_handler;
+static void *ingest_user_data;
+
+static atomic_t stat_queued;
+static atomic_t stat_dropped;
+static atomic_t stat_max_depth;
+
+#if defined(CONFIG_BT_MESH_GRADIENT_SINK_INGEST)
+
+#define RING_SLOTS (CONFIG_BT_MESH_GRADIENT_SINK_INGEST_DEPTH + 1) /* one slot kept free */
+
+static struct sink_ingest_rec ring[RING_SLOTS];
+static atomic_t ring_head; /* next slot to fill (producer) */
+static atomic_t ring_tail; /* next slot to drain (consumer) */
+static K_SEM_DEFINE(ring_sem, 0, 1);
+
+/*============================================================================*/
+/* Ingest Thread                                                              */
+/*============================================================================*/
+
+static void sink_ingest_thread(void *p1, void *p2, void *p3)
+{
+    uint32_t reported_drops = 0;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    for (;;) {
+        k_sem_take(&ring_sem, K_FOREVER);
+
+        atomic_val_t tail = atomic_get(&ring_tail);
+
+        while (tail != atomic_get(&ring_head)) {
+            if (ingest_handler != NULL) {
+                ingest_handler(&ring[tail], ingest_user_data);
+            }
+            tail = (tail + 1) % RING_SLOTS;
+            /* Slot is free for the producer only after the handler ran */
+            atomic_set(&ring_tail, tail);
+        }
+
+        uint32_t drops = (uint32_t)atomic_get(&stat_dropped);
+
+        if (drops != reported_drops) {
+            LOG_WRN("[INGEST] %u records dropped under overload (total %u)",
+                    drops - reported_drops, drops);
+            reported_drops = drops;
+        }
+    }
+}
+
+K_THREAD_DEFINE(sink_ingest_tid, CONFIG_BT_MESH_GRADIENT_SINK_INGEST_STACK_SIZE,
+                sink_ingest_thread, NULL, NULL, NULL,
+                CONFIG_BT_MESH_GRADIENT_SINK_INGEST_PRIO, 0, 0);
+
+#else
+
+static struct sink_ingest_rec inline_rec;
+
+#endif /* CONFIG_BT_MESH_GRADIENT_SINK_INGEST */
+
+/*============================================================================*/
+/* Public Functions                                                           */
+/*============================================================================*/
+
+void sink_ingest_init(sink_ingest_handler_t handler, void *user_data)
+{
+    ingest_user_data = user_data;
+    ingest_handler = handler;
+}
+
+struct sink_ingest_rec *sink_ingest_alloc(void)
+{
+#if defined(CONFIG_BT_MESH_GRADIENT_SINK_INGEST)
+    atomic_val_t head = atomic_get(&ring_head);
+
+    if ((head + 1) % RING_SLOTS == atomic_get(&ring_tail)) {
+        atomic_inc(&stat_dropped);
+        return NULL;
+    }
+    ring[head].len = 0;
+    return &ring[head];
+#else
+    inline_rec.len = 0;
+    return &inline_rec;
+#endif
+}
+
+void sink_ingest_commit(struct sink_ingest_rec *rec)
+{
+    atomic_inc(&stat_queued);
+
+#if defined(CONFIG_BT_MESH_GRADIENT_SINK_INGEST)
+    atomic_val_t head = (atomic_val_t)(rec - ring);
+    atomic_val_t next = (head + 1) % RING_SLOTS;
+    atomic_val_t depth = (next - atomic_get(&ring_tail) + RING_SLOTS) % RING_SLOTS;
+
+    if (depth > atomic_get(&stat_max_depth)) {
+        atomic_set(&stat_max_depth, depth);
+    }
+
+    /* Record contents become visible to the consumer with the new head */
+    atomic_set(&ring_head, next);
+    k_sem_give(&ring_sem);
+#else
+    if (ingest_handler != NULL) {
+        ingest_handler(rec, ingest_user_data);
+    }
+#endif
+}
+
+void sink_ingest_get_stats(struct sink_ingest_stats *stats)
+{
+    stats->queued = (uint32_t)atomic_get(&stat_queued);
+    stats->dropped = (uint32_t)atomic_get(&stat_dropped);
+    stats->max_depth = (uint32_t)atomic_get(&stat_max_depth);
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * @file topo_codec.c
+ * @brief Dense bit-packed neighbor encoding for topology reports
+ */
+
+#include "topo_codec.h"
+#include <zephyr/sys/util.h>
+
+/*============================================================================*/
+/* Private Data                                                               */
+/*============================================================================*/
+
+#define RSSI_Q_OFFSET 40
+#define GRAD_Q_MAX    ((1U << TOPO_CODEC_GRAD_BITS) - 1)
+#define RSSI_Q_MAX    ((1U << TOPO_CODEC_RSSI_BITS) - 1)
+
+/** Link uptime code -> seconds: 0, then round(2^((k+1)/2)) */
+static const uint16_t uptime_table[1U << TOPO_CODEC_UPTIME_BITS] = {
+    0, 2, 3, 4, 6, 8, 11, 16, 23, 32, 45, 64, 91, 128, 181, 256,
+    362, 512, 724, 1024, 1448, 2048, 2896, 4096, 5793, 8192, 11585,
+    16384, 23170, 32768, 46341, 65535,
+};
+
+static inline uint16_t zigzag16(int16_t v)
+{
+    return (uint16_t)(((uint16_t)v << 1) ^ (uint16_t)(v >> 15));
+}
+
+static inline int16_t unzigzag16(uint16_t v)
+{
+    return (int16_t)((v >> 1) ^ (uint16_t)-(int16_t)(v & 1));
+}
+
+static uint8_t bit_width(uint16_t v)
+{
+    uint8_t n = 1;
+
+    while (n < 16 && (v >> n) != 0) {
+        n++;
+    }
+    return n;
+}
+
+/*============================================================================*/
+/* Public Functions                                                           */
+/*============================================================================*/
+
+uint8_t topo_codec_rssi_q(int8_t rssi)
+{
+    int q = -(int)rssi - RSSI_Q_OFFSET;
+
+    return (uint8_t)CLAMP(q, 0, (int)RSSI_Q_MAX);
+}
+
+int8_t topo_codec_rssi_dq(uint8_t q)
+{
+    return (int8_t)(-(int)(q & RSSI_Q_MAX) - RSSI_Q_OFFSET);
+}
+
+uint8_t topo_codec_uptime_q(uint16_t seconds)
+{
+    if (seconds == 0) {
+        return 0;
+    }
+
+    /* Largest code not above the value, then round in the log domain */
+    uint8_t k = 1;
+
+    while (k < ARRAY_SIZE(uptime_table) - 1 && uptime_table[k + 1] <= seconds) {
+        k++;
+    }
+    if (k < ARRAY_SIZE(uptime_table) - 1 &&
+        (uint32_t)seconds * seconds >
+            (uint32_t)uptime_table[k] * uptime_table[k + 1]) {
+        k++;
+    }
+    return k;
+}
+
+uint16_t topo_codec_uptime_dq(uint8_t q)
+{
+    return uptime_table[q & (ARRAY_SIZE(uptime_table) - 1)];
+}
+
+uint8_t topo_codec_addr_width(uint16_t origin, const struct neighbor_item *items,
+                              uint8_t count, const uint16_t *addrs,
+                              uint8_t addr_count)
+{
+    uint8_t width = 1;
+
+    for (uint8_t i = 0; i < count; i++) {
+        width = MAX(width, bit_width(zigzag16((int16_t)(items[i].addr - origin))));
+    }
+    for (uint8_t i = 0; i < addr_count; i++) {
+        width = MAX(width, bit_width(zigzag16((int16_t)(addrs[i] - origin))));
+    }
+    return width;
+}
+
+void topo_bitw_init(struct topo_bitw *w, struct net_buf_simple *buf)
+{
+    w->buf = buf;
+    w->acc = 0;
+    w->bits = 0;
+}
+
+void topo_bitw_put(struct topo_bitw *w, uint32_t val, uint8_t nbits)
+{
+    w->acc |= (val & ((1UL << nbits) - 1)) << w->bits;
+    w->bits += nbits;
+
+    while (w->bits >= 8) {
+        net_buf_simple_add_u8(w->buf, (uint8_t)w->acc);
+        w->acc >>= 8;
+        w->bits -= 8;
+    }
+}
+
+void topo_bitw_flush(struct topo_bitw *w)
+{
+    if (w->bits) {
+        net_buf_simple_add_u8(w->buf, (uint8_t)w->acc);
+        w->acc = 0;
+        w->bits = 0;
+    }
+}
+
+void topo_bitr_init(struct topo_bitr *r, struct net_buf_simple *buf)
+{
+    r->buf = buf;
+    r->acc = 0;
+    r->bits = 0;
+}
+
+bool topo_bitr_get(struct topo_bitr *r, uint8_t nbits, uint32_t *val)
+{
+    while (r->bits < nbits) {
+        if (r->buf->len == 0) {
+            return false;
+        }
+        r->acc |= (uint32_t)net_buf_simple_pull_u8(r->buf) << r->bits;
+        r->bits += 8;
+    }
+
+    *val = r->acc & ((1UL << nbits) - 1);
+    r->acc >>= nbits;
+    r->bits -= nbits;
+    return true;
+}
+
+void topo_codec_put_addr(struct topo_bitw *w, uint16_t origin, uint8_t width,
+                         uint16_t addr)
+{
+    topo_bitw_put(w, zigzag16((int16_t)(addr - origin)), width);
+}
+
+bool topo_codec_get_addr(struct topo_bitr *r, uint16_t origin, uint8_t width,
+                         uint16_t *addr)
+{
+    uint32_t v;
+
+    if (!topo_bitr_get(r, width, &v)) {
+        return false;
+    }
+    *addr = (uint16_t)(origin + unzigzag16((uint16_t)v));
+    return true;
+}
+
+void topo_codec_put_item(struct topo_bitw *w, uint16_t origin, uint8_t width,
+                         const struct neighbor_item *item)
+{
+    topo_codec_put_addr(w, origin, width, item->addr);
+    topo_bitw_put(w, topo_codec_rssi_q(item->rssi), TOPO_CODEC_RSSI_BITS);
+    topo_bitw_put(w, MIN(item->grad, GRAD_Q_MAX), TOPO_CODEC_GRAD_BITS);
+    topo_bitw_put(w, topo_codec_uptime_q(item->link_uptime),
+                  TOPO_CODEC_UPTIME_BITS);
+}
+
+bool topo_codec_get_item(struct topo_bitr *r, uint16_t origin, uint8_t width,
+                         struct neighbor_item *item)
+{
+    uint32_t rssi_q, grad, uptime_q;
+
+    if (!topo_codec_get_addr(r, origin, width, &item->addr) ||
+        !topo_bitr_get(r, TOPO_CODEC_RSSI_BITS, &rssi_q) ||
+        !topo_bitr_get(r, TOPO_CODEC_GRAD_BITS, &grad) ||
+        !topo_bitr_get(r, TOPO_CODEC_UPTIME_BITS, &uptime_q)) {
+        return false;
+    }
+
+    item->rssi = topo_codec_rssi_dq((uint8_t)rssi_q);
+    item->grad = (uint8_t)grad;
+    item->link_uptime = topo_codec_uptime_dq((uint8_t)uptime_q);
+    return true;
+}